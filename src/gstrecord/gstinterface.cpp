@@ -27,9 +27,15 @@ gstInterface::p_gst_event_new_eos gstInterface::m_gst_event_new_eos = nullptr;
 gstInterface::p_gst_bus_timed_pop_filtered gstInterface::m_gst_bus_timed_pop_filtered = nullptr;
 gstInterface::p_gst_parse_launch gstInterface::m_gst_parse_launch = nullptr;
 gstInterface::p_gst_bin_get_type gstInterface::m_gst_bin_get_type = nullptr;
+gstInterface::p_gst_element_get_static_pad gstInterface::m_gst_element_get_static_pad = nullptr;
+gstInterface::p_gst_pad_add_probe gstInterface::m_gst_pad_add_probe = nullptr;
+gstInterface::p_gst_buffer_new_wrapped_full gstInterface::m_gst_buffer_new_wrapped_full = nullptr;
+gstInterface::p_gst_buffer_get_size gstInterface::m_gst_buffer_get_size = nullptr;
 
 gstInterface::p_g_type_check_instance_cast gstInterface::m_g_type_check_instance_cast = nullptr;
 gstInterface::p_g_signal_emit_by_name gstInterface::m_g_signal_emit_by_name = nullptr;
+gstInterface::p_g_signal_connect_data gstInterface::m_g_signal_connect_data = nullptr;
+gstInterface::p_g_object_get gstInterface::m_g_object_get = nullptr;
 gstInterface::p_g_object_set gstInterface::m_g_object_set = nullptr;
 
 
@@ -94,10 +100,16 @@ void gstInterface::initFunctions()
     m_gst_bus_timed_pop_filtered = reinterpret_cast<p_gst_bus_timed_pop_filtered>(m_libgstreamer.resolve("gst_bus_timed_pop_filtered")); // -lgstreamer-1.0
     m_gst_parse_launch = reinterpret_cast<p_gst_parse_launch>(m_libgstreamer.resolve("gst_parse_launch")); // -lgstreamer-1.0
     m_gst_bin_get_type = reinterpret_cast<p_gst_bin_get_type>(m_libgstreamer.resolve("gst_bin_get_type")); // -lgstreamer-1.0
+    m_gst_element_get_static_pad = reinterpret_cast<p_gst_element_get_static_pad>(m_libgstreamer.resolve("gst_element_get_static_pad")); // -lgstreamer-1.0
+    m_gst_pad_add_probe = reinterpret_cast<p_gst_pad_add_probe>(m_libgstreamer.resolve("gst_pad_add_probe")); // -lgstreamer-1.0
+    m_gst_buffer_new_wrapped_full = reinterpret_cast<p_gst_buffer_new_wrapped_full>(m_libgstreamer.resolve("gst_buffer_new_wrapped_full")); // -lgstreamer-1.0
+    m_gst_buffer_get_size = reinterpret_cast<p_gst_buffer_get_size>(m_libgstreamer.resolve("gst_buffer_get_size")); // -lgstreamer-1.0
 
     m_g_type_check_instance_cast = reinterpret_cast<p_g_type_check_instance_cast>(m_libgobject.resolve("g_type_check_instance_cast")); //-lgobject-2.0
     m_g_object_set = reinterpret_cast<p_g_object_set>(m_libgobject.resolve("g_object_set")); //-lgobject-2.0
     m_g_signal_emit_by_name = reinterpret_cast<p_g_signal_emit_by_name>(m_libgobject.resolve("g_signal_emit_by_name")); // -lgobject-2.0
+    m_g_signal_connect_data = reinterpret_cast<p_g_signal_connect_data>(m_libgobject.resolve("g_signal_connect_data")); // -lgobject-2.0
+    m_g_object_get = reinterpret_cast<p_g_object_get>(m_libgobject.resolve("g_object_get")); // -lgobject-2.0
 
     qDebug() << "gstreamer-1.0 function is load";
 
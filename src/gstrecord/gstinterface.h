@@ -49,10 +49,16 @@ public:
     typedef GstMessage *(*p_gst_bus_timed_pop_filtered)(GstBus *, GstClockTime, GstMessageType);    //-lgstreamer-1.0
     typedef GstElement *(*p_gst_parse_launch)(const gchar *, GError **);     //-lgstreamer-1.0
     typedef GType(*p_gst_bin_get_type)(void);     //-lgstreamer-1.0
+    typedef GstPad *(*p_gst_element_get_static_pad)(GstElement *, const gchar *);     //-lgstreamer-1.0
+    typedef gulong(*p_gst_pad_add_probe)(GstPad *, GstPadProbeType, GstPadProbeCallback, gpointer, GDestroyNotify);     //-lgstreamer-1.0
+    typedef gsize(*p_gst_buffer_get_size)(GstBuffer *); //-lgstreamer-1.0
+    typedef GstBuffer *(*p_gst_buffer_new_wrapped_full)(GstMemoryFlags, gpointer, gsize, gsize, gsize, gpointer, GDestroyNotify); //-lgstreamer-1.0
 
     typedef GType(*p_g_type_check_instance_cast)(GTypeInstance *, GType);     //-lgobject-2.0
     typedef void(*p_g_object_set)(gpointer, const gchar *, ...);//-lgobject-2.0
     typedef void(*p_g_signal_emit_by_name)(gpointer, const gchar *, ...);//-lgobject-2.0
+    typedef void(*p_g_object_get)(gpointer, const gchar *, ...);//-lgobject-2.0
+    typedef gulong(*p_g_signal_connect_data)(gpointer, const gchar *, GCallback, gpointer, GClosureNotify, GConnectFlags);//-lgobject-2.0
 
     //-lglib-2.0
     static p_gst_message_parse_error m_gst_message_parse_error;
@@ -79,11 +85,17 @@ public:
     static p_gst_bus_timed_pop_filtered m_gst_bus_timed_pop_filtered;
     static p_gst_parse_launch m_gst_parse_launch;
     static p_gst_bin_get_type m_gst_bin_get_type;
+    static p_gst_element_get_static_pad m_gst_element_get_static_pad;
+    static p_gst_pad_add_probe m_gst_pad_add_probe;
+    static p_gst_buffer_new_wrapped_full m_gst_buffer_new_wrapped_full;
+    static p_gst_buffer_get_size m_gst_buffer_get_size;
 
     //-lgobject-2.0
     static p_g_type_check_instance_cast m_g_type_check_instance_cast;
     static p_g_object_set m_g_object_set;
     static p_g_signal_emit_by_name m_g_signal_emit_by_name;
+    static p_g_signal_connect_data m_g_signal_connect_data;
+    static p_g_object_get m_g_object_get;
 
 
 public:
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2020 ~ now Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     Wang Cong <wangcong@uniontech.com>
+ *
+ * Maintainer: Wang Cong <wangcong@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gstpipelinetracer.h"
+
+#include <QDebug>
+#include <QSettings>
+
+//buffer离开编码器时，落后于管道运行时间超过该值即认为迟到
+static const GstClockTime LATE_THRESHOLD = 500 * GST_MSECOND;
+
+static GstPadProbeReturn sourceProbeCb(GstPad *pad, GstPadProbeInfo *info, GstPipelineTracer *tracer)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+    tracer->onSourceBuffer();
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn encoderInputProbeCb(GstPad *pad, GstPadProbeInfo *info, GstPipelineTracer *tracer)
+{
+    Q_UNUSED(pad);
+    tracer->onEncoderInput(GST_PAD_PROBE_INFO_BUFFER(info));
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn encoderOutputProbeCb(GstPad *pad, GstPadProbeInfo *info, GstPipelineTracer *tracer)
+{
+    Q_UNUSED(pad);
+    tracer->onEncoderOutput(GST_PAD_PROBE_INFO_BUFFER(info));
+    return GST_PAD_PROBE_OK;
+}
+
+GstPipelineTracer::GstPipelineTracer(const QString &tag, GstElement *pipeline)
+    : m_tag(tag)
+    , m_pipeline(pipeline)
+    , m_queue(nullptr)
+    , m_videoRate(nullptr)
+    , m_sourceBuffers(0)
+    , m_encoderInputBuffers(0)
+    , m_encoderOutputBuffers(0)
+    , m_encoderOutputBytes(0)
+    , m_lateBuffers(0)
+    , m_firstOutputTime(0)
+    , m_lastOutputTime(0)
+    , m_latencySum(0)
+    , m_latencyMax(0)
+    , m_latencyCount(0)
+    , m_queueLevelSum(0)
+    , m_queueLevelMax(0)
+{
+    m_timer.start();
+}
+
+GstPipelineTracer::~GstPipelineTracer()
+{
+    if (m_queue) {
+        gstInterface::m_gst_object_unref(m_queue);
+    }
+    if (m_videoRate) {
+        gstInterface::m_gst_object_unref(m_videoRate);
+    }
+}
+
+//是否开启管道统计
+bool GstPipelineTracer::isEnabled()
+{
+    if (qgetenv("DEEPIN_SCREEN_RECORDER_GST_TRACE") == "1") {
+        return true;
+    }
+    QSettings settings("deepin", "deepin-screen-recorder");
+    return settings.value("debug/gst_trace", false).toBool();
+}
+
+//在管道的视频源、队列、编码器上添加探针
+void GstPipelineTracer::attach(GstElement *source, GstElement *queue, GstElement *encoder, GstElement *videoRate)
+{
+    //队列及帧率转换器只在输出统计结果时读取属性，持有其引用
+    m_queue = queue;
+    m_videoRate = videoRate;
+    if (source) {
+        addBufferProbe(source, "src", reinterpret_cast<GstPadProbeCallback>(sourceProbeCb));
+    }
+    if (encoder) {
+        addBufferProbe(encoder, "sink", reinterpret_cast<GstPadProbeCallback>(encoderInputProbeCb));
+        addBufferProbe(encoder, "src", reinterpret_cast<GstPadProbeCallback>(encoderOutputProbeCb));
+    } else {
+        qWarning() << "(" << m_tag << "Gstreamer trace) video encoder is not found!";
+    }
+    qInfo() << "(" << m_tag << "Gstreamer trace) pipeline tracing is enabled";
+}
+
+//在元素的端口上添加buffer探针
+void GstPipelineTracer::addBufferProbe(GstElement *element, const gchar *padName, GstPadProbeCallback callback)
+{
+    GstPad *pad = gstInterface::m_gst_element_get_static_pad(element, padName);
+    if (!pad) {
+        return;
+    }
+    gstInterface::m_gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, callback, this, nullptr);
+    gstInterface::m_gst_object_unref(pad);
+}
+
+//视频源输出buffer
+void GstPipelineTracer::onSourceBuffer()
+{
+    QMutexLocker locker(&m_mutex);
+    m_sourceBuffers++;
+}
+
+//buffer进入编码器
+void GstPipelineTracer::onEncoderInput(GstBuffer *buffer)
+{
+    guint queueLevel = 0;
+    if (m_queue) {
+        gstInterface::m_g_object_get(m_queue, "current-level-buffers", &queueLevel, NULL);
+    }
+    QMutexLocker locker(&m_mutex);
+    m_encoderInputBuffers++;
+    m_queueLevelSum += queueLevel;
+    m_queueLevelMax = qMax(m_queueLevelMax, queueLevel);
+    if (GST_BUFFER_PTS_IS_VALID(buffer)) {
+        m_encoderInputTime.insert(GST_BUFFER_PTS(buffer), m_timer.nsecsElapsed());
+    }
+}
+
+//buffer离开编码器
+void GstPipelineTracer::onEncoderOutput(GstBuffer *buffer)
+{
+    const qint64 now = m_timer.nsecsElapsed();
+    const gsize size = gstInterface::m_gst_buffer_get_size(buffer);
+    GstClockTime runningTime = GST_CLOCK_TIME_NONE;
+    GstClock *clock = GST_ELEMENT_CLOCK(m_pipeline);
+    if (clock) {
+        runningTime = gstInterface::m_gst_clock_get_time(clock) - GST_ELEMENT_CAST(m_pipeline)->base_time;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (0 == m_encoderOutputBuffers) {
+        m_firstOutputTime = now;
+    }
+    m_lastOutputTime = now;
+    m_encoderOutputBuffers++;
+    m_encoderOutputBytes += size;
+    if (!GST_BUFFER_PTS_IS_VALID(buffer)) {
+        return;
+    }
+    const GstClockTime pts = GST_BUFFER_PTS(buffer);
+    auto it = m_encoderInputTime.find(pts);
+    if (it != m_encoderInputTime.end()) {
+        const qint64 latency = now - it.value();
+        m_latencySum += latency;
+        m_latencyMax = qMax(m_latencyMax, latency);
+        m_latencyCount++;
+    }
+    //编码器输出按时间戳递增，更早的记录不会再被用到（如被编码器丢弃的帧）
+    m_encoderInputTime.erase(m_encoderInputTime.begin(), m_encoderInputTime.upperBound(pts));
+    if (GST_CLOCK_TIME_IS_VALID(runningTime) && runningTime > pts + LATE_THRESHOLD) {
+        m_lateBuffers++;
+    }
+}
+
+//输出统计结果
+GstPipelineTracer::Summary GstPipelineTracer::printSummary(quint64 droppedAtSource)
+{
+    Summary summary;
+    summary.droppedAtSource = droppedAtSource;
+    if (m_videoRate) {
+        gstInterface::m_g_object_get(m_videoRate, "drop", &summary.rateDropped, "duplicate", &summary.rateDuplicated, NULL);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    summary.sourceBuffers = m_sourceBuffers;
+    summary.encoderInputBuffers = m_encoderInputBuffers;
+    summary.encoderOutputBuffers = m_encoderOutputBuffers;
+    summary.lateBuffers = m_lateBuffers;
+    summary.latencyCount = m_latencyCount;
+    summary.latencyAvg = m_latencyCount > 0 ? m_latencySum / static_cast<qint64>(m_latencyCount) : 0;
+    summary.latencyMax = m_latencyMax;
+
+    const double outputSeconds = (m_lastOutputTime - m_firstOutputTime) / 1e9;
+    const double encoderFps = outputSeconds > 0 ? (m_encoderOutputBuffers - 1) / outputSeconds : 0;
+    const double encoderKbps = outputSeconds > 0 ? m_encoderOutputBytes * 8 / 1000.0 / outputSeconds : 0;
+    qInfo() << "(" << m_tag << "Gstreamer trace) source buffers:" << summary.sourceBuffers
+            << ", dropped before pipeline:" << summary.droppedAtSource
+            << ", videorate dropped/duplicated:" << summary.rateDropped << "/" << summary.rateDuplicated;
+    qInfo() << "(" << m_tag << "Gstreamer trace) queue level (buffers) avg:"
+            << (m_encoderInputBuffers > 0 ? static_cast<double>(m_queueLevelSum) / m_encoderInputBuffers : 0)
+            << ", max:" << m_queueLevelMax;
+    qInfo() << "(" << m_tag << "Gstreamer trace) encoder in/out buffers:" << summary.encoderInputBuffers << "/" << summary.encoderOutputBuffers
+            << ", throughput:" << encoderFps << "fps," << encoderKbps << "kbps"
+            << ", late buffers (>" << LATE_THRESHOLD / GST_MSECOND << "ms):" << summary.lateBuffers;
+    qInfo() << "(" << m_tag << "Gstreamer trace) encoder latency avg:" << summary.latencyAvg / 1000000
+            << "ms, max:" << summary.latencyMax / 1000000 << "ms";
+    return summary;
+}
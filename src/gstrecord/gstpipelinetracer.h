@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 ~ now Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     Wang Cong <wangcong@uniontech.com>
+ *
+ * Maintainer: Wang Cong <wangcong@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GSTPIPELINETRACER_H
+#define GSTPIPELINETRACER_H
+#include "gstinterface.h"
+
+#include <QString>
+#include <QMap>
+#include <QMutex>
+#include <QElapsedTimer>
+
+/**
+ * @brief Gstreamer录屏管道的延迟及吞吐量统计
+ * 通过环境变量DEEPIN_SCREEN_RECORDER_GST_TRACE=1或配置文件[debug]gst_trace=true开启，
+ * 未开启时不创建该对象，也不在管道上添加任何探针
+ */
+class GstPipelineTracer
+{
+public:
+    /**
+     * @brief 统计结果，时间单位为纳秒
+     */
+    struct Summary {
+        quint64 sourceBuffers = 0;
+        quint64 droppedAtSource = 0;    // 在写入管道前被丢弃的帧数
+        guint64 rateDropped = 0;        // 帧率转换器丢弃的帧数
+        guint64 rateDuplicated = 0;     // 帧率转换器重复的帧数
+        quint64 encoderInputBuffers = 0;
+        quint64 encoderOutputBuffers = 0;
+        quint64 lateBuffers = 0;        // 离开编码器时迟到的buffer数量
+        quint64 latencyCount = 0;       // 统计了编码延迟的buffer数量
+        qint64 latencyAvg = 0;
+        qint64 latencyMax = 0;
+    };
+
+    /**
+     * @param tag:日志标识（x11/wayland）
+     * @param pipeline:录屏管道
+     */
+    GstPipelineTracer(const QString &tag, GstElement *pipeline);
+    ~GstPipelineTracer();
+
+    /**
+     * @brief 是否开启管道统计
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief 在管道的视频源、队列、编码器上添加探针
+     * @param source:视频源
+     * @param queue:编码器前的队列，可为空
+     * @param encoder:视频编码器
+     * @param videoRate:帧率转换器，可为空
+     */
+    void attach(GstElement *source, GstElement *queue, GstElement *encoder, GstElement *videoRate);
+
+    /**
+     * @brief 输出统计结果，需在管道释放前调用
+     * @param droppedAtSource:在写入管道前被丢弃的帧数
+     * @return 统计结果
+     */
+    Summary printSummary(quint64 droppedAtSource);
+
+    /**
+     * @brief 视频源输出buffer
+     */
+    void onSourceBuffer();
+
+    /**
+     * @brief buffer进入编码器，记录进入时间，并采样队列长度
+     * @param buffer
+     */
+    void onEncoderInput(GstBuffer *buffer);
+
+    /**
+     * @brief buffer离开编码器，统计编码延迟、吞吐量及迟到的buffer
+     * @param buffer
+     */
+    void onEncoderOutput(GstBuffer *buffer);
+
+private:
+    /**
+     * @brief 在元素的端口上添加buffer探针
+     */
+    void addBufferProbe(GstElement *element, const gchar *padName, GstPadProbeCallback callback);
+
+private:
+    QString m_tag;
+    GstElement *m_pipeline;
+    GstElement *m_queue;
+    GstElement *m_videoRate;
+    QMutex m_mutex;
+    QElapsedTimer m_timer;
+
+    /**
+     * @brief 进入编码器的buffer的时间戳及进入时间（纳秒）
+     */
+    QMap<GstClockTime, qint64> m_encoderInputTime;
+
+    quint64 m_sourceBuffers;
+    quint64 m_encoderInputBuffers;
+    quint64 m_encoderOutputBuffers;
+    quint64 m_encoderOutputBytes;
+    quint64 m_lateBuffers;
+    qint64 m_firstOutputTime;
+    qint64 m_lastOutputTime;
+    qint64 m_latencySum;
+    qint64 m_latencyMax;
+    quint64 m_latencyCount;
+    quint64 m_queueLevelSum;
+    guint m_queueLevelMax;
+};
+
+#endif // GSTPIPELINETRACER_H
@@ -22,6 +22,14 @@
 #include "gstrecordx.h"
 #include "utils.h"
 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QSysInfo>
+#include <QtMath>
+
+//编码器测试的总耗时上限（毫秒），需远小于3秒的录屏倒计时
+static const int ENCODER_BENCHMARK_BUDGET_MS = 1000;
 
 /**
  * @brief gstBusMessageCb
@@ -62,6 +70,55 @@ static gboolean gstBusMessageCb(GstBus *bus, GstMessage *message, GstRecordX *gs
     return true;
 }
 
+/**
+ * @brief 视频源探针回调，统计从开始录制到第一帧进入管道的耗时
+ * @param pad:视频源的输出端口
+ * @param info:探针信息
+ * @param gstRecord:用户数据
+ * @return 只统计第一帧，统计完成后移除探针
+ */
+static GstPadProbeReturn firstFrameProbeCb(GstPad *pad, GstPadProbeInfo *info, GstRecordX *gstRecord)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+    qInfo() << "(Gstreamer) time-to-first-frame:" << QDateTime::currentMSecsSinceEpoch() - gstRecord->getRecordStartTime() << "ms";
+    return GST_PAD_PROBE_REMOVE;
+}
+
+/**
+ * @brief GstBuffer释放回调，将视频帧内存块归还内存池
+ * @param userData:视频帧内存块
+ */
+static void releaseFrameBlockCb(gpointer userData)
+{
+    GstRecordX::FrameBlock *block = static_cast<GstRecordX::FrameBlock *>(userData);
+    block->owner->releaseFrameBlock(block);
+}
+
+/**
+ * @brief appsrc内部队列低于max-bytes，请求数据
+ * @param appsrc:视频源
+ * @param length:请求的数据长度，未使用
+ * @param gstRecord:用户数据
+ */
+static void appsrcNeedDataCb(GstElement *appsrc, guint length, GstRecordX *gstRecord)
+{
+    Q_UNUSED(appsrc);
+    Q_UNUSED(length);
+    gstRecord->setNeedData(true);
+}
+
+/**
+ * @brief appsrc内部队列达到max-bytes，下游（编码器）处理不过来
+ * @param appsrc:视频源
+ * @param gstRecord:用户数据
+ */
+static void appsrcEnoughDataCb(GstElement *appsrc, GstRecordX *gstRecord)
+{
+    Q_UNUSED(appsrc);
+    gstRecord->setNeedData(false);
+}
+
 GstRecordX::GstRecordX(QObject *parent) : QObject(parent)
 {
     initMemberVariables();
@@ -71,6 +128,15 @@ GstRecordX::GstRecordX(QObject *parent) : QObject(parent)
 void GstRecordX::initMemberVariables()
 {
     m_pipeline = nullptr;
+    m_gloop = nullptr;
+    m_videoSrc = nullptr;
+    m_isNeedData = true;
+    m_pushedFrames = 0;
+    m_droppedFrames = 0;
+    m_tracer = nullptr;
+    m_isPrepared = false;
+    m_isCanceled = false;
+    m_recordStartTime = 0;
     m_audioType = AudioType::None;
     m_videoType = VideoType::webm;
     m_sysDevcieName = "";
@@ -83,8 +149,20 @@ void GstRecordX::initMemberVariables()
     m_boardVendorType = 0;
 }
 
-//x11协议下gstreamer录制视频
-void GstRecordX::x11GstStartRecord()
+//x11协议下预先构建gstreamer录制管道，在倒计时期间调用
+void GstRecordX::x11GstPrepareRecord()
+{
+    QMutexLocker locker(&m_prepareMutex);
+    if (m_isPrepared || m_isCanceled) {
+        return;
+    }
+    m_isPrepared = true;
+    //管道解析及插件加载较耗时，放到线程中执行，避免阻塞倒计时界面
+    m_prepareFuture = QtConcurrent::run(this, &GstRecordX::x11CreatePipeline);
+}
+
+//构建x11录制管道并切换到PAUSED状态
+bool GstRecordX::x11CreatePipeline()
 {
     QStringList arguments;
     QStringList areaList;
@@ -92,6 +170,7 @@ void GstRecordX::x11GstStartRecord()
     //设置录制区域的大小及位置 show-pointer:是否录制光标
     //这里录制区域有个ximagesrc的bug，endx或者endy只要有一个的大小为显示屏的大小。录制的视频最终结果都是全屏。因此需要减一个像素
     areaList << "ximagesrc"
+             << "name=videoSrc"
              << "display-name=" + qgetenv("DISPLAY")
              << "use-damage=false"
              << "show-pointer=" + m_isRecordMouse //是否录制光标
@@ -105,27 +184,49 @@ void GstRecordX::x11GstStartRecord()
     arguments << QString("video/x-raw, framerate=%1/1").arg(m_framerate);
     //设置视频转换器
     arguments << "videoconvert";
-    arguments << "videorate";
-    arguments << "queue max-size-bytes=1073741824 max-size-time=10000000000 max-size-buffers=1000";
+    arguments << "videorate name=videoRate";
+    //队列最多缓存1秒或256MB的原始视频帧，编码器处理不过来时阻塞ximagesrc，由源头少采集画面，避免积压上G内存
+    arguments << "queue name=videoQueue max-size-bytes=268435456 max-size-time=1000000000 max-size-buffers=0";
 
     //创建管道
-    if (createPipeline(arguments)) {
-        if (nullptr == m_pipeline) {
-            qCritical() << "Error: Gstreamer's Pipeline create failure!";
-            return;
-        }
-        qInfo() << "Gstreamer's Pipeline create successfully!";
-        //启动Gstreamer录屏管道
-        GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
-        if (ret == GST_STATE_CHANGE_FAILURE) {
-            qWarning() << "Unable to set the pipeline to the playing state. Recording is failure";
-            gstInterface::m_gst_object_unref(m_pipeline);
-            return;
-        }
-        qInfo() << "(x11) Gstreamer's Pipeline starup successfully!";
-    } else {
+    if (!createPipeline(arguments) || nullptr == m_pipeline) {
+        qCritical() << "Error: Gstreamer's Pipeline create failure!";
+        return false;
+    }
+    qInfo() << "Gstreamer's Pipeline create successfully!";
+    attachTracer("x11");
+    //切换到PAUSED状态，打开音频设备及文件，实时源在此状态下不会产生数据
+    GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PAUSED);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        qWarning() << "Unable to set the pipeline to the paused state. Recording is failure";
+        gstInterface::m_gst_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+        return false;
+    }
+    qInfo() << "(x11) Gstreamer's Pipeline is prepared!";
+    return true;
+}
+
+//x11协议下gstreamer录制视频
+void GstRecordX::x11GstStartRecord()
+{
+    m_recordStartTime = QDateTime::currentMSecsSinceEpoch();
+    //未预先构建管道时，在此处构建
+    x11GstPrepareRecord();
+    if (m_isCanceled || !m_prepareFuture.result() || nullptr == m_pipeline) {
         qCritical() << "Error: Gstreamer's Pipeline create failure!";
+        return;
+    }
+    addFirstFrameProbe();
+    //启动Gstreamer录屏管道
+    GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        qWarning() << "Unable to set the pipeline to the playing state. Recording is failure";
+        gstInterface::m_gst_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+        return;
     }
+    qInfo() << "(x11) Gstreamer's Pipeline starup successfully!";
 }
 
 //x11协议下gstreamer停止录制视频
@@ -139,8 +240,49 @@ void GstRecordX::x11GstStopRecord()
     qInfo() << "x11 Gstreamer 录屏结束！";
 }
 
-//wayland协议下gstreamer录制管道构建及启动录制视频
-void GstRecordX::waylandGstStartRecord()
+//取消预先构建的录制管道，管道未启动，无需发送EOS
+void GstRecordX::cancelPrepare()
+{
+    QMutexLocker locker(&m_prepareMutex);
+    m_isCanceled = true;
+    if (!m_isPrepared) {
+        return;
+    }
+    m_prepareFuture.waitForFinished();
+    if (m_pipeline) {
+        gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        if (m_tracer) {
+            delete m_tracer;
+            m_tracer = nullptr;
+        }
+        if (m_videoSrc) {
+            gstInterface::m_gst_object_unref(m_videoSrc);
+            m_videoSrc = nullptr;
+        }
+        gstInterface::m_gst_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+    }
+    //filesink在PAUSED状态下已创建输出文件
+    if (!m_savePath.isEmpty() && QFile::exists(m_savePath)) {
+        QFile::remove(m_savePath);
+    }
+    qInfo() << "Gstreamer's prepared pipeline is canceled!";
+}
+
+//wayland协议下预先构建gstreamer录制管道，在倒计时期间调用
+void GstRecordX::waylandGstPrepareRecord()
+{
+    QMutexLocker locker(&m_prepareMutex);
+    if (m_isPrepared || m_isCanceled) {
+        return;
+    }
+    m_isPrepared = true;
+    //管道解析及插件加载较耗时，放到线程中执行，避免阻塞倒计时界面
+    m_prepareFuture = QtConcurrent::run(this, &GstRecordX::waylandCreatePipeline);
+}
+
+//构建wayland录制管道并切换到PAUSED状态
+bool GstRecordX::waylandCreatePipeline()
 {
     QStringList wlarguments;
     wlarguments << "appsrc name=videoSrc";
@@ -150,37 +292,64 @@ void GstRecordX::waylandGstStartRecord()
     } else {
         wlarguments << QString("video/x-raw, format=RGBA, framerate=%1/1, width=%2, height=%3").arg(m_framerate).arg(m_recordArea.width()).arg(m_recordArea.height());
     }
-    wlarguments << "queue ! videoconvert primaries-mode=2 name=convert ! queue";
+    wlarguments << "queue ! videoconvert primaries-mode=2 name=convert ! queue name=videoQueue";
 
     //创建管道
-    if (createPipeline(wlarguments)) {
-        if (nullptr == m_pipeline) {
-            qCritical() << "Error: Gstreamer's Pipeline create failure!";
-            return;
-        }
-        qInfo() << "Gstreamer's Pipeline create successfully!";
-        //添加视频相关流信息
-        GstElement *videoSrc = gstInterface::m_gst_bin_get_by_name(getGstBin(m_pipeline), "videoSrc");
-        gstInterface::m_g_object_set(videoSrc, "format", GST_FORMAT_TIME, NULL);
-        gstInterface::m_g_object_set(videoSrc, "is-live", TRUE, NULL);
-        m_gloop = gstInterface::m_g_main_loop_new(NULL, TRUE);
-
-        GstBus *bus = gstInterface::m_gst_pipeline_get_bus(reinterpret_cast<GstPipeline *>(m_pipeline));
-        gstInterface::m_gst_bus_add_watch(bus, reinterpret_cast<GstBusFunc>(gstBusMessageCb), this);
-        gstInterface::m_gst_object_unref(bus);
+    if (!createPipeline(wlarguments) || nullptr == m_pipeline) {
+        qCritical() << "Error: Gstreamer's Pipeline create failure!";
+        return false;
+    }
+    qInfo() << "Gstreamer's Pipeline create successfully!";
+    //添加视频相关流信息，视频源在此缓存，写入视频帧时不再查找
+    m_videoSrc = gstInterface::m_gst_bin_get_by_name(getGstBin(m_pipeline), "videoSrc");
+    gstInterface::m_g_object_set(m_videoSrc, "format", GST_FORMAT_TIME, NULL);
+    gstInterface::m_g_object_set(m_videoSrc, "is-live", TRUE, NULL);
+    //限制appsrc内部队列最多缓存3帧，编码器处理不过来时通过enough-data通知写帧线程节流或丢帧，
+    //而不是在管道中无限积压原始视频帧
+    guint64 maxBytes = static_cast<guint64>(m_recordArea.width()) * static_cast<guint64>(m_recordArea.height()) * 4 * 3;
+    gstInterface::m_g_object_set(m_videoSrc, "max-bytes", maxBytes, "block", FALSE, NULL);
+    gstInterface::m_g_signal_connect_data(m_videoSrc, "need-data", reinterpret_cast<GCallback>(appsrcNeedDataCb), this, nullptr, static_cast<GConnectFlags>(0));
+    gstInterface::m_g_signal_connect_data(m_videoSrc, "enough-data", reinterpret_cast<GCallback>(appsrcEnoughDataCb), this, nullptr, static_cast<GConnectFlags>(0));
+    attachTracer("wayland");
+    m_gloop = gstInterface::m_g_main_loop_new(NULL, TRUE);
+
+    GstBus *bus = gstInterface::m_gst_pipeline_get_bus(reinterpret_cast<GstPipeline *>(m_pipeline));
+    gstInterface::m_gst_bus_add_watch(bus, reinterpret_cast<GstBusFunc>(gstBusMessageCb), this);
+    gstInterface::m_gst_object_unref(bus);
+
+    //切换到PAUSED状态，打开音频设备及文件，appsrc在此状态下不接收视频帧
+    GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PAUSED);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        qWarning() << "Unable to set the pipeline to the paused state. Recording is failure";
+        gstInterface::m_gst_object_unref(m_videoSrc);
+        m_videoSrc = nullptr;
+        gstInterface::m_gst_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+        return false;
+    }
+    qInfo() << "(Wayland) Gstreamer's Pipeline is prepared!";
+    return true;
+}
 
-        //启动Gstreamer录屏管道
-        GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
-        if (ret == GST_STATE_CHANGE_FAILURE) {
-            qWarning() << "Unable to set the pipeline to the playing state. Recording is failure";
-            gstInterface::m_gst_object_unref(m_pipeline);
-            return;
-        }
-        QtConcurrent::run(gstInterface::m_g_main_loop_run, m_gloop);
-        qInfo() << "(Wayland) Gstreamer's Pipeline starup successfully!";
-    } else {
+//wayland协议下gstreamer录制管道构建及启动录制视频
+void GstRecordX::waylandGstStartRecord()
+{
+    //未预先构建管道时，在此处构建
+    waylandGstPrepareRecord();
+    if (m_isCanceled || !m_prepareFuture.result() || nullptr == m_pipeline) {
         qCritical() << "Error: Gstreamer's Pipeline create failure!";
+        return;
+    }
+    //启动Gstreamer录屏管道
+    GstStateChangeReturn ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        qWarning() << "Unable to set the pipeline to the playing state. Recording is failure";
+        gstInterface::m_gst_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+        return;
     }
+    QtConcurrent::run(gstInterface::m_g_main_loop_run, m_gloop);
+    qInfo() << "(Wayland) Gstreamer's Pipeline starup successfully!";
 }
 
 //wayland协议下gstreamer停止录制视频
@@ -191,17 +360,19 @@ void GstRecordX::waylandGstStopRecord()
         return;
     }
 
-    GstElement *videoSrc = gstInterface::m_gst_bin_get_by_name(getGstBin(m_pipeline), "videoSrc");
     GstFlowReturn ret = GST_FLOW_NOT_LINKED;
-    if (videoSrc) {
-        gstInterface::m_g_signal_emit_by_name(videoSrc, "end-of-stream", &ret);
+    if (m_videoSrc) {
+        gstInterface::m_g_signal_emit_by_name(m_videoSrc, "end-of-stream", &ret);
     }
     if (GST_FLOW_OK == ret) {
         qInfo() << "(wayland Gstreamer) Stop writing video data";
     } else {
         qInfo() << "(wayland Gstreamer) Stopping video data writing failed! Gstreamer internal Error Code: " << ret;
     }
+    qInfo() << "(wayland Gstreamer) pushed frames:" << m_pushedFrames << ", dropped frames (pipeline backlog):" << m_droppedFrames;
     stopPipeline();
+    //唤醒可能仍在等待数据请求的写帧线程
+    setNeedData(true);
     //发射wayland gstreamer录屏完成信号
     emit waylandGstRecrodFinish();
     qInfo() << "wayland Gstreamer 录屏结束！";
@@ -210,44 +381,132 @@ void GstRecordX::waylandGstStopRecord()
 //wayland下写入视频帧
 bool GstRecordX::waylandWriteVideoFrame(const unsigned char *frame, const int framewidth, const int frameheight)
 {
-    if (!m_pipeline) {
+    if (!m_pipeline || !m_videoSrc) {
         qWarning() << "wayland Gstreamer 写入视频帧失败！录屏管道未初始化！";
         return false;
     }
 
     //qDebug() << " ======= 取视频帧进行编码 ";
 
-    GstFlowReturn ret;
-    guint8 *ptr;
-    int size = m_recordArea.width() * m_recordArea.height() * 4;
-    ptr = (guint8 *)gstInterface::m_g_malloc(size * sizeof(uchar));
-    if (nullptr == ptr) {
+    //appsrc队列已满（编码器处理不过来），在源头丢弃该帧，不再拷贝和入队
+    {
+        QMutexLocker locker(&m_needDataMutex);
+        if (!m_isNeedData) {
+            m_droppedFrames++;
+            return false;
+        }
+    }
+
+    const int width = m_recordArea.width();
+    const int height = m_recordArea.height();
+    const int size = width * height * 4;
+    FrameBlock *block = acquireFrameBlock(size);
+    if (nullptr == block) {
         qWarning("GStreamerRecorder::writeFrame malloc failed!");
         return false;
+    }
+
+    //按行直接从原始帧拷贝录制区域到内存池的内存块中，省去QImage::copy及中间内存的申请和拷贝
+    const QRect srcRect = m_recordArea & QRect(0, 0, framewidth, frameheight);
+    if (srcRect != m_recordArea) {
+        memset(block->data, 0, static_cast<size_t>(size));
+    }
+    if (!srcRect.isEmpty()) {
+        const int srcStride = framewidth * 4;
+        const int dstStride = width * 4;
+        const size_t lineSize = static_cast<size_t>(srcRect.width() * 4);
+        const unsigned char *src = frame + srcRect.y() * srcStride + srcRect.x() * 4;
+        guint8 *dst = block->data + (srcRect.y() - m_recordArea.y()) * dstStride + (srcRect.x() - m_recordArea.x()) * 4;
+        if (srcStride == dstStride && srcRect == m_recordArea) {
+            memcpy(dst, src, lineSize * static_cast<size_t>(srcRect.height()));
+        } else {
+            for (int y = 0; y < srcRect.height(); ++y) {
+                memcpy(dst + y * dstStride, src + y * srcStride, lineSize);
+            }
+        }
+    }
+    //buffer直接引用内存块，buffer释放时通过回调归还内存池
+    GstBuffer *buffer = gstInterface::m_gst_buffer_new_wrapped_full(static_cast<GstMemoryFlags>(0), block->data, static_cast<gsize>(size),
+                                                                      0, static_cast<gsize>(size), block, releaseFrameBlockCb);
+
+    //设置时间戳
+    GST_BUFFER_PTS(buffer) = gstInterface::m_gst_clock_get_time(m_pipeline->clock) - m_pipeline->base_time;
+    //注入视频帧数据
+    GstFlowReturn ret;
+    gstInterface::m_g_signal_emit_by_name(m_videoSrc, "push-buffer", buffer, &ret);
+    //释放buffer，appsrc内部持有引用
+    gstInterface::m_gst_mini_object_unref(GST_MINI_OBJECT_CAST(buffer));
+    if (ret == GST_FLOW_OK) {
+        m_pushedFrames++;
     } else {
-        GstBuffer *buffer;
-        QImage img(frame, framewidth, frameheight, QImage::Format::Format_RGBA8888);
-        img = img.copy(m_recordArea);
-        memcpy(ptr, img.bits(), size);
-        buffer = gstInterface::m_gst_buffer_new_wrapped((void *)ptr, size);
-//        QImage *img = new QImage(frame, m_recordArea.width(), m_recordArea.height(), QImage::Format::Format_RGBA8888);
-//        img->save(QString("/home/uos/Desktop/test/image/test_%1.png").arg(globalCount));
-//        globalCount++;
-
-        //设置时间戳
-        GST_BUFFER_PTS(buffer) = gstInterface::m_gst_clock_get_time(m_pipeline->clock) - m_pipeline->base_time;
-        //获取视频源
-        GstElement *videoSrc = gstInterface::m_gst_bin_get_by_name(getGstBin(m_pipeline), "videoSrc");
-        //注入视频帧数据
-        gstInterface::m_g_signal_emit_by_name(videoSrc, "push-buffer", buffer, &ret);
-        //释放buffer
-//        gstInterface::m_gst_buffer_unref(buffer);
-        gstInterface::m_gst_mini_object_unref(GST_MINI_OBJECT_CAST(buffer));
+        m_droppedFrames++;
     }
 
     return ret == GST_FLOW_OK;
 }
 
+//从内存池获取视频帧内存块
+GstRecordX::FrameBlock *GstRecordX::acquireFrameBlock(int size)
+{
+    QMutexLocker locker(&m_framePoolMutex);
+    while (!m_freeFrameBlocks.isEmpty()) {
+        FrameBlock *block = m_freeFrameBlocks.takeFirst();
+        if (block->size == size) {
+            return block;
+        }
+        //录制区域变化后旧的内存块不再复用
+        m_frameBlocks.removeOne(block);
+        delete [] block->data;
+        delete block;
+    }
+    guint8 *data = new (std::nothrow) guint8[size];
+    if (nullptr == data) {
+        return nullptr;
+    }
+    FrameBlock *block = new FrameBlock{this, data, size};
+    m_frameBlocks.append(block);
+    return block;
+}
+
+//归还视频帧内存块
+void GstRecordX::releaseFrameBlock(FrameBlock *block)
+{
+    QMutexLocker locker(&m_framePoolMutex);
+    m_freeFrameBlocks.append(block);
+}
+
+//设置appsrc是否需要数据
+void GstRecordX::setNeedData(bool needData)
+{
+    QMutexLocker locker(&m_needDataMutex);
+    m_isNeedData = needData;
+    if (needData) {
+        m_needDataCondition.wakeAll();
+    }
+}
+
+//等待appsrc请求数据
+bool GstRecordX::waitForNeedData(unsigned long timeout)
+{
+    QMutexLocker locker(&m_needDataMutex);
+    if (!m_isNeedData) {
+        m_needDataCondition.wait(&m_needDataMutex, timeout);
+    }
+    return m_isNeedData;
+}
+
+//释放内存池中的所有内存块
+void GstRecordX::clearFramePool()
+{
+    QMutexLocker locker(&m_framePoolMutex);
+    for (FrameBlock *block : m_frameBlocks) {
+        delete [] block->data;
+        delete block;
+    }
+    m_frameBlocks.clear();
+    m_freeFrameBlocks.clear();
+}
+
 //设置输入设备名称
 void GstRecordX::setInputDeviceName(const QString &device)
 {
@@ -313,17 +572,8 @@ void GstRecordX::setBoardVendorType(int boardVendorType)
 //创建Gstreamer录屏管道，这部分x11和wayland可共用
 bool GstRecordX::createPipeline(QStringList arguments)
 {
-    //设置编码器
-    // arguments << QString("vp8enc min_quantizer=20 max_quantizer=20 cpu-used=%1 deadline=1000000 threads=%2").arg(QThread::idealThreadCount()).arg(QThread::idealThreadCount());
-    if (m_videoType == VideoType::webm) {
-        //vp8编码
-        arguments << "vp8enc min-quantizer=1 max-quantizer=50 undershoot=95 cpu-used=5 deadline=1 static-threshold=50 error-resilient=1";
-    } else if (m_videoType == VideoType::ogg) {
-        //ogg不支持vp8编码，需使用theora编码，该编码器基于vp3,编码效率低，生成的视频容存在时长不正确的问题
-        arguments << "theoraenc  bitrate=2200 drop-frames=false keyframe-auto=false keyframe-force=5 keyframe-freq=5";
-    } else {
-        arguments << "vp8enc min-quantizer=1 max-quantizer=50 undershoot=95 cpu-used=5 deadline=1 static-threshold=50 error-resilient=1";
-    }
+    //设置编码器，根据当前机器的编码能力选择
+    arguments << selectVideoEncoder() + " name=videoEnc";
     arguments << "queue";
     arguments << "mux.";
 
@@ -381,6 +631,153 @@ bool GstRecordX::createPipeline(QStringList arguments)
     return true;
 }
 
+//选择视频编码器及参数
+QString GstRecordX::selectVideoEncoder()
+{
+    const QString threads = QString::number(QThread::idealThreadCount());
+    //按画质优先级排列的候选编码器配置，越靠后编码越快
+    QStringList candidates;
+    if (m_videoType == VideoType::ogg) {
+        //ogg不支持vp8编码，需使用theora编码，该编码器基于vp3,编码效率低，生成的视频容存在时长不正确的问题
+        candidates << "theoraenc  bitrate=2200 drop-frames=false keyframe-auto=false keyframe-force=5 keyframe-freq=5"
+                   << "theoraenc  bitrate=2200 drop-frames=false keyframe-auto=false keyframe-force=5 keyframe-freq=5 speed-level=2";
+    } else {
+        //vp8编码，vp9在同等速度档位下比vp8慢，不作为候选
+        candidates << "vp8enc min-quantizer=1 max-quantizer=50 undershoot=95 cpu-used=5 deadline=1 static-threshold=50 error-resilient=1 threads=" + threads
+                   << "vp8enc min-quantizer=1 max-quantizer=50 undershoot=95 cpu-used=8 deadline=1 static-threshold=50 error-resilient=1 threads=" + threads
+                   << "vp8enc min-quantizer=4 max-quantizer=56 undershoot=95 cpu-used=16 deadline=1 static-threshold=100 error-resilient=1 threads=" + threads;
+    }
+
+    //机器标识变化（如配置文件随家目录迁移到其他机器）时，之前的测试结果作废
+    const QString machineId = QString("%1_%2_%3").arg(QString(QSysInfo::machineUniqueId()))
+                              .arg(QSysInfo::currentCpuArchitecture()).arg(threads);
+    const QString cacheKey = encoderCacheKey();
+    QSettings settings("deepin", "deepin-screen-recorder");
+    settings.beginGroup("gstencoder");
+    if (settings.value("machine").toString() != machineId) {
+        settings.remove("");
+        settings.setValue("machine", machineId);
+    }
+    const QString cachedEncoder = settings.value(cacheKey).toString();
+    if (candidates.contains(cachedEncoder)) {
+        qInfo() << "(Gstreamer) use cached video encoder:" << cachedEncoder;
+        return cachedEncoder;
+    }
+
+    //按所在档位的最高像素速率测试，结果对同档位的所有录制区域都适用
+    const QSize benchmarkSize = encoderBenchmarkSize();
+    //每个配置分得固定的测试时间，慢速机器上也能测到最后（最快）的配置
+    const qint64 slice = ENCODER_BENCHMARK_BUDGET_MS / candidates.size();
+    QString selectedEncoder;
+    double bestFps = 0;
+    QElapsedTimer budgetTimer;
+    budgetTimer.start();
+    for (int i = 0; i < candidates.size(); ++i) {
+        const qint64 remaining = ENCODER_BENCHMARK_BUDGET_MS - budgetTimer.elapsed();
+        if (remaining < slice / 2) {
+            //测试超时，已测的配置都达不到实时编码速度，未测的配置更快，直接选择最快的配置
+            qWarning() << "(Gstreamer) video encoder benchmark is out of time, use the fastest encoder";
+            selectedEncoder = candidates.last();
+            break;
+        }
+        const double fps = benchmarkVideoEncoder(candidates[i], benchmarkSize, qMin(slice, remaining));
+        qInfo() << "(Gstreamer) video encoder benchmark:" << candidates[i] << "," << fps << "fps";
+        //留出余量给画面采集及格式转换
+        if (fps >= m_framerate * 1.2) {
+            selectedEncoder = candidates[i];
+            break;
+        }
+        //都达不到实时编码速度时选择最快的配置
+        if (fps > bestFps) {
+            bestFps = fps;
+            selectedEncoder = candidates[i];
+        }
+    }
+    if (selectedEncoder.isEmpty()) {
+        //测试均失败（如插件缺失），使用默认配置，不缓存结果
+        qWarning() << "(Gstreamer) video encoder benchmark failed, use default encoder";
+        return candidates.first();
+    }
+    settings.setValue(cacheKey, selectedEncoder);
+    qInfo() << "(Gstreamer) select video encoder:" << selectedEncoder;
+    return selectedEncoder;
+}
+
+//计算录制区域所在的像素速率档位
+int GstRecordX::encoderPixelRateClass() const
+{
+    //以720p@24fps为基准，每档像素速率翻倍，低于基准的都归为第0档
+    const double baseRate = 1280.0 * 720 * 24;
+    const double rate = qMax(1.0, static_cast<double>(m_recordArea.width()) * m_recordArea.height() * m_framerate);
+    return qMax(0, qCeil(std::log2(rate / baseRate)));
+}
+
+//编码器测试结果的缓存键
+QString GstRecordX::encoderCacheKey() const
+{
+    return QString("%1_class%2").arg(m_videoType == VideoType::ogg ? "ogg" : "webm").arg(encoderPixelRateClass());
+}
+
+//将录制区域按比例放大到所在档位的最高像素速率，作为测试分辨率
+QSize GstRecordX::encoderBenchmarkSize() const
+{
+    const double baseRate = 1280.0 * 720 * 24;
+    const double maxRate = baseRate * std::pow(2.0, encoderPixelRateClass());
+    const double rate = qMax(1.0, static_cast<double>(m_recordArea.width()) * m_recordArea.height() * m_framerate);
+    const double scale = std::sqrt(maxRate / rate);
+    //I420格式要求宽高为偶数
+    const int width = qMax(2, static_cast<int>(m_recordArea.width() * scale) & ~1);
+    const int height = qMax(2, static_cast<int>(m_recordArea.height() * scale) & ~1);
+    return QSize(width, height);
+}
+
+//使用合成画面测试编码器的编码速度
+double GstRecordX::benchmarkVideoEncoder(const QString &encoder, const QSize &size, qint64 timeLimit)
+{
+    //帧数取以1.2倍实时速度在测试时间内能编码完的帧数，超时即说明达不到要求的速度
+    const qint64 limit = qMax<qint64>(1, timeLimit);
+    const int frameCount = qMax(1, qCeil(limit * m_framerate * 1.2 / 1000));
+    const GstClockTime timeout = static_cast<GstClockTime>(limit) * GST_MSECOND;
+    //画面水平滚动，模拟有变化的录屏内容
+    const QString line = QString("videotestsrc num-buffers=%1 pattern=smpte horizontal-speed=4 ! "
+                                 "video/x-raw, format=I420, framerate=%2/1, width=%3, height=%4 ! %5 ! fakesink sync=false")
+                         .arg(frameCount).arg(m_framerate).arg(size.width()).arg(size.height()).arg(encoder);
+    GError *error = nullptr;
+    GstElement *pipeline = gstInterface::m_gst_parse_launch(line.toUtf8().constData(), &error);
+    if (error != nullptr || nullptr == pipeline) {
+        //编码器不存在或不支持该参数
+        if (error != nullptr) {
+            qWarning() << "(Gstreamer) video encoder is not available:" << error->message;
+        }
+        if (pipeline) {
+            gstInterface::m_gst_object_unref(pipeline);
+        }
+        return 0;
+    }
+
+    double fps = 0;
+    QElapsedTimer timer;
+    timer.start();
+    if (gstInterface::m_gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE) {
+        GstBus *bus = gstInterface::m_gst_pipeline_get_bus(reinterpret_cast<GstPipeline *>(pipeline));
+        GstMessage *msg = gstInterface::m_gst_bus_timed_pop_filtered(bus, timeout, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+        if (nullptr == msg) {
+            //超时，说明达不到要求的速度，最多编码完frameCount-1帧，此时的速度只是上限
+            fps = (frameCount - 1) * 1000.0 / elapsed;
+        } else {
+            if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+                fps = frameCount * 1000.0 / elapsed;
+            }
+            gstInterface::m_gst_mini_object_unref(GST_MINI_OBJECT_CAST(msg));
+        }
+        gstInterface::m_gst_object_unref(bus);
+    }
+    gstInterface::m_gst_element_set_state(pipeline, GST_STATE_NULL);
+    gstInterface::m_gst_object_unref(pipeline);
+    return fps;
+}
+
 //根据传入的参数获取，音频管道创建命令
 QString GstRecordX::getAudioPipeline(const QString &audioDevName, const QString &audioType, const QString &arg)
 {
@@ -406,6 +803,21 @@ QString GstRecordX::getAudioPipeline(const QString &audioDevName, const QString
     return result;
 }
 
+//在视频源上添加探针，统计从开始录制到第一帧进入管道的耗时
+void GstRecordX::addFirstFrameProbe()
+{
+    GstElement *videoSrc = gstInterface::m_gst_bin_get_by_name(getGstBin(m_pipeline), "videoSrc");
+    if (!videoSrc) {
+        return;
+    }
+    GstPad *pad = gstInterface::m_gst_element_get_static_pad(videoSrc, "src");
+    if (pad) {
+        gstInterface::m_gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, reinterpret_cast<GstPadProbeCallback>(firstFrameProbeCb), this, nullptr);
+        gstInterface::m_gst_object_unref(pad);
+    }
+    gstInterface::m_gst_object_unref(videoSrc);
+}
+
 //停止管道，x11和wayland可共用
 void GstRecordX::stopPipeline()
 {
@@ -415,6 +827,10 @@ void GstRecordX::stopPipeline()
     GstClockTime timeout = 5 * GST_SECOND;
     GstMessage *msg = gstInterface::m_gst_bus_timed_pop_filtered(GST_ELEMENT_BUS(m_pipeline), timeout, GST_MESSAGE_EOS);
     Q_UNUSED(msg);
+    //所有数据已流过管道，输出统计结果
+    if (m_tracer) {
+        m_tracer->printSummary(m_droppedFrames);
+    }
 
     GstStateChangeReturn ret ;
     Q_UNUSED(ret);
@@ -424,10 +840,40 @@ void GstRecordX::stopPipeline()
     Q_UNUSED(ret);
     ret = gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_NULL);
     Q_UNUSED(ret);
+    if (m_tracer) {
+        delete m_tracer;
+        m_tracer = nullptr;
+    }
+    if (m_videoSrc) {
+        gstInterface::m_gst_object_unref(m_videoSrc);
+        m_videoSrc = nullptr;
+    }
     gstInterface::m_gst_object_unref(m_pipeline);
+    m_pipeline = nullptr;
 }
 
 
+//开启管道统计时添加探针
+void GstRecordX::attachTracer(const QString &tag)
+{
+    //未开启时不添加任何探针，对录制无影响
+    if (!GstPipelineTracer::isEnabled()) {
+        return;
+    }
+    GstBin *bin = getGstBin(m_pipeline);
+    GstElement *source = gstInterface::m_gst_bin_get_by_name(bin, "videoSrc");
+    GstElement *encoder = gstInterface::m_gst_bin_get_by_name(bin, "videoEnc");
+    m_tracer = new GstPipelineTracer(tag, m_pipeline);
+    m_tracer->attach(source, gstInterface::m_gst_bin_get_by_name(bin, "videoQueue"),
+                     encoder, gstInterface::m_gst_bin_get_by_name(bin, "videoRate"));
+    if (source) {
+        gstInterface::m_gst_object_unref(source);
+    }
+    if (encoder) {
+        gstInterface::m_gst_object_unref(encoder);
+    }
+}
+
 //格式化输出gstreamer命令
 void GstRecordX::pipelineStructuredOutput(QString pipeline)
 {
@@ -450,11 +896,24 @@ GstBin *GstRecordX::getGstBin(GstElement *element)
 
 GstRecordX::~GstRecordX()
 {
+    //等待预构建线程结束，避免其仍在创建管道
+    m_prepareFuture.waitForFinished();
+    //未正常停止的管道须先置为NULL状态再释放，管道中在途的buffer随之归还内存池
     if (m_pipeline) {
+        gstInterface::m_gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        if (m_videoSrc) {
+            gstInterface::m_gst_object_unref(m_videoSrc);
+            m_videoSrc = nullptr;
+        }
+        gstInterface::m_gst_object_unref(m_pipeline);
         m_pipeline = nullptr;
-        delete m_pipeline;
     }
-
+    if (m_tracer) {
+        delete m_tracer;
+        m_tracer = nullptr;
+    }
+    //管道已停止并释放，所有buffer均已归还内存池
+    clearFramePool();
 }
 
 
@@ -21,13 +21,16 @@
 #ifndef GSTRECORDX_H
 #define GSTRECORDX_H
 #include "gstinterface.h"
+#include "gstpipelinetracer.h"
 
 #include <QDebug>
 
 #include <QString>
 #include <QRect>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QDateTime>
+#include <QFuture>
 #include <QtConcurrent>
 #include <QObject>
 
@@ -51,12 +54,26 @@ public:
         webm = 0,
         ogg
     };
+    /**
+     * @brief 视频帧内存块，写入管道时由GstBuffer直接引用，buffer释放时归还内存池
+     */
+    struct FrameBlock {
+        GstRecordX *owner;
+        guint8 *data;
+        int size;
+    };
 public:
     GstRecordX(QObject *parent = nullptr);
     ~GstRecordX();
 
+    /**
+     * @brief x11协议下预先构建gstreamer录制管道（倒计时期间调用，管道停在PAUSED状态，不采集画面）
+     */
+    void x11GstPrepareRecord();
+
     /**
      * @brief x11协议下gstreamer录制管道构建及启动录制视频
+     * 若已调用x11GstPrepareRecord，则只等待管道构建完成并切换到PLAYING状态
      */
     void x11GstStartRecord();
 
@@ -65,8 +82,14 @@ public:
      */
     void x11GstStopRecord();
 
+    /**
+     * @brief wayland协议下预先构建gstreamer录制管道（倒计时期间调用，管道停在PAUSED状态，不写入视频帧）
+     */
+    void waylandGstPrepareRecord();
+
     /**
      * @brief wayland协议下gstreamer录制管道构建及启动录制视频
+     * 若已调用waylandGstPrepareRecord，则只等待管道构建完成并切换到PLAYING状态
      */
     void waylandGstStartRecord();
 
@@ -75,6 +98,12 @@ public:
      */
     void waylandGstStopRecord();
 
+    /**
+     * @brief 取消预先构建的录制管道（倒计时期间退出时调用）
+     * 等待管道构建完成后释放管道，并删除已打开的输出文件
+     */
+    void cancelPrepare();
+
     /**
      * @brief wayland下写入视频帧
      */
@@ -141,6 +170,31 @@ public:
 
     GMainLoop *getGloop() {return m_gloop;}
 
+    /**
+     * @brief 获取开始录制（倒计时结束）的时间，用于统计首帧耗时
+     * @return 毫秒时间戳
+     */
+    qint64 getRecordStartTime() {return m_recordStartTime;}
+
+    /**
+     * @brief 归还视频帧内存块，由GstBuffer的释放回调调用（gstreamer流线程）
+     * @param block:内存块
+     */
+    void releaseFrameBlock(FrameBlock *block);
+
+    /**
+     * @brief 设置appsrc是否需要数据，由appsrc的need-data/enough-data信号回调调用
+     * @param needData:true:need-data false:enough-data
+     */
+    void setNeedData(bool needData);
+
+    /**
+     * @brief 等待appsrc请求数据，用于写帧线程根据管道的消费速度节流
+     * @param timeout:最长等待时间（毫秒）
+     * @return 超时时appsrc仍处于enough-data状态返回false
+     */
+    bool waitForNeedData(unsigned long timeout);
+
 signals:
     /**
      * @brief Gstreamer录屏已结束
@@ -155,6 +209,42 @@ private:
      */
     bool createPipeline(QStringList);
 
+    /**
+     * @brief 选择视频编码器及参数
+     * 按画质优先级依次测试当前机器上可用的编码器配置，选择第一个能达到实时编码速度的配置，
+     * 都达不到时选择最快的配置；每个配置分得固定的测试时间，总耗时超过上限时选择最快的配置；
+     * 结果按机器、视频类型及像素速率档位缓存到配置文件中，之后不再重复测试
+     * @return 编码器管道命令
+     */
+    QString selectVideoEncoder();
+
+    /**
+     * @brief 录制区域及帧率对应的像素速率档位，每档像素速率翻倍
+     * @return 档位
+     */
+    int encoderPixelRateClass() const;
+
+    /**
+     * @brief 编码器测试结果的缓存键，同一视频类型及档位共用
+     * @return 缓存键
+     */
+    QString encoderCacheKey() const;
+
+    /**
+     * @brief 编码器测试使用的分辨率，即录制区域放大到所在档位的最高像素速率
+     * @return 测试分辨率
+     */
+    QSize encoderBenchmarkSize() const;
+
+    /**
+     * @brief 使用合成画面测试编码器在指定分辨率及录制帧率下的编码速度
+     * @param encoder:编码器管道命令
+     * @param size:测试分辨率
+     * @param timeLimit:测试时间上限（毫秒），以1.2倍实时速度能在该时间内编码完测试的帧数
+     * @return 每秒编码帧数，超时时为速度上限，编码器不可用时返回0
+     */
+    double benchmarkVideoEncoder(const QString &encoder, const QSize &size, qint64 timeLimit);
+
     /**
      * @brief 根据传入的参数获取，音频管道创建命令
      * @param audioDevName:音频设备名称
@@ -164,6 +254,29 @@ private:
      */
     QString getAudioPipeline(const QString &audioDevName, const QString &audioType, const QString &arg);
 
+    /**
+     * @brief 构建x11录制管道并切换到PAUSED状态
+     * @return 是否构建成功
+     */
+    bool x11CreatePipeline();
+
+    /**
+     * @brief 构建wayland录制管道并切换到PAUSED状态
+     * @return 是否构建成功
+     */
+    bool waylandCreatePipeline();
+
+    /**
+     * @brief 在视频源上添加探针，统计从开始录制到第一帧进入管道的耗时
+     */
+    void addFirstFrameProbe();
+
+    /**
+     * @brief 开启管道统计时，在视频源、队列及编码器上添加探针
+     * @param tag:日志标识（x11/wayland）
+     */
+    void attachTracer(const QString &tag);
+
     /**
      * @brief 停止管道，x11和wayland可共用
      */
@@ -186,6 +299,18 @@ private:
      */
     GstBin *getGstBin(GstElement *element);
 
+    /**
+     * @brief 从内存池获取视频帧内存块，内存池为空时新申请
+     * @param size:内存块大小
+     * @return
+     */
+    FrameBlock *acquireFrameBlock(int size);
+
+    /**
+     * @brief 释放内存池中的所有内存块
+     */
+    void clearFramePool();
+
 private:
     /**
      * @brief gstreamer的管道元素
@@ -194,6 +319,60 @@ private:
 
     GMainLoop *m_gloop;
 
+    /**
+     * @brief wayland下的视频源appsrc，管道创建时缓存，避免每帧查找
+     */
+    GstElement *m_videoSrc;
+
+    /**
+     * @brief 视频帧内存池，所有申请过的内存块及空闲内存块
+     */
+    QList<FrameBlock *> m_frameBlocks;
+    QList<FrameBlock *> m_freeFrameBlocks;
+    QMutex m_framePoolMutex;
+
+    /**
+     * @brief appsrc是否需要数据，appsrc内部队列达到max-bytes时为false，此时写入的视频帧被丢弃
+     */
+    bool m_isNeedData;
+    QMutex m_needDataMutex;
+    QWaitCondition m_needDataCondition;
+
+    /**
+     * @brief wayland下写入管道的视频帧数及因管道积压丢弃的视频帧数
+     */
+    quint64 m_pushedFrames;
+    quint64 m_droppedFrames;
+
+    /**
+     * @brief 管道延迟及吞吐量统计，未开启时为空
+     */
+    GstPipelineTracer *m_tracer;
+
+    /**
+     * @brief 是否已开始预先构建管道
+     */
+    bool m_isPrepared;
+
+    /**
+     * @brief 是否已取消录制，取消后不再构建管道
+     */
+    bool m_isCanceled;
+
+    /**
+     * @brief 预先构建管道的结果
+     */
+    QFuture<bool> m_prepareFuture;
+    /**
+     * @brief 保护m_isPrepared及m_prepareFuture，wayland下在采集线程中预先构建管道，取消时在界面线程
+     */
+    QMutex m_prepareMutex;
+
+    /**
+     * @brief 开始录制（倒计时结束）的时间
+     */
+    qint64 m_recordStartTime;
+
     /**
      * @brief 音频类型
      */
@@ -625,6 +625,8 @@ void MainWindow::initShortcut()
     QShortcut *undoSC = new QShortcut(QKeySequence("Ctrl+Z"), this);
     //截图模式 全部撤销
     QShortcut *undoAllSC = new QShortcut(QKeySequence("Ctrl+Shift+Z"), this);
+    //截图模式 恢复
+    QShortcut *redoSC = new QShortcut(QKeySequence("Ctrl+Y"), this);
     //录屏模式（未做穿透） 监控键盘
     QShortcut *keyBoardSC = new QShortcut(QKeySequence("K"), this);
     //录屏模式（未做穿透） 摄像头
@@ -732,6 +734,14 @@ void MainWindow::initShortcut()
             emit unDoAll();
         }
     });
+    //截图模式 恢复
+    connect(redoSC, &QShortcut::activated, this, [ = ] {
+        if (status::shot == m_functionType)
+        {
+            qDebug() << "shortcut : redoSC (key: ctrl+y)";
+            emit reDo();
+        }
+    });
     //录屏模式（未做穿透） 监控键盘
     connect(keyBoardSC, &QShortcut::activated, this, [ = ] {
         if (status::record == m_functionType && RECORD_BUTTON_NORMAL == recordButtonStatus)
@@ -784,6 +794,10 @@ void MainWindow::initShortcut()
         if (RECORD_BUTTON_RECORDING != recordButtonStatus)
         {
             qDebug() << "shortcut : escSC (key: esc)";
+            //倒计时期间退出，释放预先构建的录制管道
+            if (RECORD_BUTTON_WAIT == recordButtonStatus) {
+                recordProcess.cancelRecord();
+            }
             exitApp();
         }
         if (status::record == m_functionType && Utils::isWaylandMode)
@@ -1197,10 +1211,10 @@ void MainWindow::showScrollShot()
     bool ok;
     QRect rect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
     //滚动截图截取指定区域的第一张图片
-    m_firstScrollShotImg = m_screenGrabber.grabEntireDesktop(ok, rect, m_pixelRatio);
+    m_firstScrollShotImg = m_screenGrabber.grabDetachedDesktopImage(ok, rect, m_pixelRatio);
     //m_firstScrollShotImg.save("m_firstScrollShotImg1.png");
     //预览区域显示当前指定区域的第一张图片
-    m_previewWidget->updateImage(m_firstScrollShotImg.toImage());
+    m_previewWidget->updateImage(m_firstScrollShotImg);
     m_previewWidget->show();
     //打开工具栏显示 需放在更新工具栏之前，避免出现工具栏没显示但是已经执行位置更新
     m_toolBar->show();
@@ -1305,7 +1319,7 @@ void MainWindow::scrollShotGrabPixmap(PreviewWidget::PostionStatus previewPostio
             bool ok;
             QRect rect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
             //抓取捕捉区域图片
-            QPixmap img = m_screenGrabber.grabEntireDesktop(ok, rect, m_pixelRatio);
+            QImage img = m_screenGrabber.grabDetachedDesktopImage(ok, rect, m_pixelRatio);
             //滚动截图处理类进行图片的拼接
             m_scrollShot->addPixmap(img, direction);
             if (m_previewWidget)
@@ -1324,7 +1338,7 @@ void MainWindow::scrollShotGrabPixmap(PreviewWidget::PostionStatus previewPostio
         bool ok;
         QRect rect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
         //抓取捕捉区域图片
-        QPixmap img = m_screenGrabber.grabEntireDesktop(ok, rect, m_pixelRatio);
+        QImage img = m_screenGrabber.grabDetachedDesktopImage(ok, rect, m_pixelRatio);
         //滚动截图处理类进行图片的拼接
         m_scrollShot->addPixmap(img, direction);
     }
@@ -1356,14 +1370,14 @@ bool MainWindow::isToolBarInShotArea()
 
 
 //显示预览窗口和图片
-void MainWindow::showPreviewWidgetImage(QImage img)
+void MainWindow::showPreviewWidgetImage(QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize)
 {
 #ifdef OCR_SCROLL_FLAGE_ON
     if (m_isSaveScrollShot) {
         return;
     }
-    m_scrollShotSizeTips ->updateTips(QPoint(recordX, recordY), QSize(int(img.width() / m_pixelRatio + 2), int(img.height() / m_pixelRatio + 2)));
-    m_previewWidget->updateImage(img);
+    m_scrollShotSizeTips ->updateTips(QPoint(recordX, recordY), QSize(int(imageSize.width() / m_pixelRatio + 2), int(imageSize.height() / m_pixelRatio + 2)));
+    m_previewWidget->updateImageRows(rows, keepStart, keepEnd, isPrepend, imageSize);
 #endif
 }
 
@@ -1626,9 +1640,22 @@ QPixmap MainWindow::getPixmapofRect(const QRect &rect)
 bool MainWindow::saveImg(const QPixmap &pix, const QString &fileName, const char *format)
 {
     qInfo() << __FUNCTION__ << __LINE__ << "保存图片到目录：" << fileName;
+    bool isStreamSave = false;
+    QString saveFileName = fileName;
+#ifdef OCR_SCROLL_FLAGE_ON
+    // 长图过大时未拼合为整张图片，逐行写入PNG文件，JPEG、BMP不支持如此大的图片
+    isStreamSave = status::scrollshot == m_functionType && m_scrollShot && m_scrollShot->isStreamSave();
+    if (isStreamSave && QString("PNG") != QString(format).toUpper()) {
+        const QFileInfo fileInfo(fileName);
+        saveFileName = fileInfo.path() + QDir::separator() + fileInfo.completeBaseName() + ".png";
+        m_saveFileName = saveFileName;
+        format = "PNG";
+        qWarning() << __FUNCTION__ << __LINE__ << "长图过大，改为保存为PNG图片：" << saveFileName;
+    }
+#endif
     int quality = -1;
     //qt5环境，经测试quality值对png效果明显，对jpg和bmp不明显
-    if (pix.width() * pix.height() > 1920 * 1080 && QString("PNG") == QString(format).toUpper()) {
+    if ((isStreamSave || pix.width() * pix.height() > 1920 * 1080) && QString("PNG") == QString(format).toUpper()) {
         if (QSysInfo::currentCpuArchitecture().startsWith("x86") && !m_isZhaoxin) {
             quality = 60;
         } else if (QSysInfo::currentCpuArchitecture().startsWith("x86") && m_isZhaoxin) {
@@ -1640,7 +1667,12 @@ bool MainWindow::saveImg(const QPixmap &pix, const QString &fileName, const char
         }
     }
     if (status::pinscreenshots == m_functionType) return false;
-    if (pix.save(fileName, format, quality)) {
+#ifdef OCR_SCROLL_FLAGE_ON
+    if (isStreamSave) {
+        return m_scrollShot->saveLongImage(saveFileName, quality);
+    }
+#endif
+    if (pix.save(saveFileName, format, quality)) {
         qInfo() << __FUNCTION__ << __LINE__ << "保存图片成功！";
         return true;
     } else {
@@ -1818,6 +1850,10 @@ void MainWindow::showReleaseFeedback(int x, int y)
 void MainWindow::responseEsc()
 {
     if (status::record == m_functionType && RECORD_BUTTON_RECORDING != recordButtonStatus) {
+        //倒计时期间退出，释放预先构建的录制管道
+        if (RECORD_BUTTON_WAIT == recordButtonStatus) {
+            recordProcess.cancelRecord();
+        }
         exitApp();
     }
 }
@@ -2617,10 +2653,13 @@ void MainWindow::saveScreenShot()
 #ifdef OCR_SCROLL_FLAGE_ON
         bool ok;
         QRect rect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
-        QPixmap img = m_screenGrabber.grabEntireDesktop(ok, rect, m_pixelRatio); // 抓取当前捕捉区域图片
+        QImage img = m_screenGrabber.grabDetachedDesktopImage(ok, rect, m_pixelRatio); // 抓取当前捕捉区域图片
         m_scrollShot->addLastPixmap(img);
-        m_resultPixmap = QPixmap::fromImage(m_scrollShot->savePixmap());
-        if (m_resultPixmap.isNull()) {
+        // 长图过大时不拼合为整张图片，保存时逐行写入文件，不再复制到剪贴板；只保存到剪贴板时仍需拼合
+        const bool streamLargeImage = m_shotWithPath
+                                      || ConfigSettings::instance()->value("save", "save_op").value<SaveAction>() != SaveToClipboard;
+        m_resultPixmap = QPixmap::fromImage(m_scrollShot->savePixmap(streamLargeImage));
+        if (m_resultPixmap.isNull() && !m_scrollShot->isStreamSave()) {
             //普通截图保存图片
             shotCurrentImg();
         }
@@ -4483,8 +4522,8 @@ void MainWindow::onAdjustCaptureArea()
         bool ok;
         QRect previewRecordRect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
         m_previewWidget->updatePreviewSize(previewRecordRect);
-        m_firstScrollShotImg = m_screenGrabber.grabEntireDesktop(ok, previewRecordRect, m_pixelRatio);
-        m_previewWidget->updateImage(m_firstScrollShotImg.toImage());
+        m_firstScrollShotImg = m_screenGrabber.grabDetachedDesktopImage(ok, previewRecordRect, m_pixelRatio);
+        m_previewWidget->updateImage(m_firstScrollShotImg);
         m_previewWidget->show();
         //打开工具栏显示
         m_toolBar->show();
@@ -4773,7 +4812,7 @@ void MainWindow::startAutoScrollShot()
         bool ok;
         QRect rect(recordX + 1, recordY + 1, recordWidth - 2, recordHeight - 2);
         //抓取捕捉区域图片
-        QPixmap img = m_screenGrabber.grabEntireDesktop(ok, rect, m_pixelRatio);
+        QImage img = m_screenGrabber.grabDetachedDesktopImage(ok, rect, m_pixelRatio);
         //滚动截图处理类进行图片的拼接
         m_scrollShot->addPixmap(img);
     } else {
@@ -4834,6 +4873,10 @@ void MainWindow::shotCurrentImg()
 
     //m_needDrawSelectedPoint = false;
     //m_drawNothing = true;
+    //模糊和马赛克在后台计算，截取前同步计算完，避免截到未打码的内容
+    if (m_isShapesWidgetExist) {
+        m_shapesWidget->flushEffects();
+    }
     update();
 
     int eventTime = 60;
@@ -5184,6 +5227,8 @@ void MainWindow::startCountdown()
     qDebug() << "record rect:" << recordRect;
 
     recordProcess.setRecordInfo(recordRect, selectAreaName);
+    //倒计时期间预先初始化录屏（构建管道、打开音频设备及编码器），倒计时结束后直接开始采集画面
+    recordProcess.prepareRecord();
 
     resetCursor();
     hideAllWidget();
@@ -5313,6 +5358,7 @@ void MainWindow::initShapeWidget(QString type)
             this, &MainWindow::shapeClickedSlot);
     connect(this, &MainWindow::unDo, m_shapesWidget, &ShapesWidget::undoDrawShapes);
     connect(this, &MainWindow::unDoAll, m_shapesWidget, &ShapesWidget::undoAllDrawShapes);
+    connect(this, &MainWindow::reDo, m_shapesWidget, &ShapesWidget::redoDrawShapes);
     connect(this, &MainWindow::saveActionTriggered,
             m_shapesWidget, &ShapesWidget::saveActionTriggered);
     connect(m_shapesWidget, &ShapesWidget::menuNoFocus, this, &MainWindow::activateWindow);
@@ -5321,6 +5367,10 @@ void MainWindow::initShapeWidget(QString type)
 void MainWindow::exitApp()
 {
     m_initScroll = false; // 保存时关闭滚动截图
+    //倒计时期间退出时，预先构建的录制管道已打开输出文件，需释放并删除
+    if (RECORD_BUTTON_WAIT == recordButtonStatus) {
+        recordProcess.cancelRecord();
+    }
     emit releaseEvent();
     qInfo() << __FUNCTION__ << __LINE__ << "退出截图录屏！";
     qApp->quit();
@@ -5331,25 +5381,10 @@ void MainWindow::exitApp()
 
 void MainWindow::reloadImage(QString effect)
 {
-    //*save tmp image file
+    Q_UNUSED(effect);
+    //模糊和马赛克效果由ShapesWidget按图形所在范围在后台计算，这里只提供原图
     shotImgWidthEffect();
-    //using namespace utils;
-    const int radius = 10;
-    QPixmap tmpImg = m_resultPixmap;
-    int imgWidth = tmpImg.width();
-    int imgHeight = tmpImg.height();
-
-    TempFile *tempFile = TempFile::instance();
-    if (!tmpImg.isNull()) {
-        tmpImg = tmpImg.scaled(imgWidth / radius, imgHeight / radius, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        if (effect == "blur") {
-            tmpImg = tmpImg.scaled(imgWidth, imgHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-            tempFile->setBlurPixmap(tmpImg);
-        } else {
-            tmpImg = tmpImg.scaled(imgWidth, imgHeight);
-            tempFile->setMosaicPixmap(tmpImg);
-        }
-    }
+    m_shapesWidget->setEffectSource(m_resultPixmap);
 }
 
 void MainWindow::shotImgWidthEffect()
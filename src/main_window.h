@@ -332,6 +332,7 @@ signals:
     void saveActionTriggered();
     void unDo();
     void unDoAll();
+    void reDo();
     void deleteShapes();
     void changeMicrophoneSelectEvent(bool checked);
     void changeSystemAudioSelectEvent(bool checked);
@@ -540,7 +541,7 @@ public slots:
      * @brief 退出截图录屏事件监控线程
      */
     void exitScreenCuptureEvent();
-    void showPreviewWidgetImage(QImage img);//显示预览窗口和图片
+    void showPreviewWidgetImage(QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize);//更新预览窗口的图片，只包含预览图变化的行，imageSize为长图实际大小
 protected:
     bool eventFilter(QObject *object, QEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
@@ -765,7 +766,7 @@ private:
     /**
      * @brief 初始化滚动截图时的第一张图
      */
-    QPixmap m_firstScrollShotImg;
+    QImage m_firstScrollShotImg;
 
     /**
      * @brief 获取预览框相对于捕捉区域的位置
@@ -432,8 +432,8 @@ void RecordProcess::waylandRecord()
 #endif
     return;
 }
-//gstreamer录制视频
-void RecordProcess::GstStartRecord()
+//gstreamer预先构建录制管道
+void RecordProcess::GstPrepareRecord()
 {
     int argc = 1;
 //    char *mock[1] = {QString("empty").toLatin1().data()};
@@ -481,7 +481,7 @@ void RecordProcess::GstStartRecord()
     m_gstRecordX->setVidoeType(videoType);
     m_gstRecordX->setSavePath(savePath);
     m_gstRecordX->setX11RecordMouse(m_isRecordMouse);
-    //开始录制
+    //预先构建管道，wayland下在收到第一个画面时构建
     if (Utils::isWaylandMode) {
 #ifdef KF5_WAYLAND_FLAGE_ON
         //wayland下停止录屏需要通过信号槽控制，避免Gstreamer管道数据未写完程序就被退出了
@@ -498,8 +498,19 @@ void RecordProcess::GstStartRecord()
         WaylandIntegration::init(arguments, m_gstRecordX);
 #endif
     } else {
-        m_gstRecordX->x11GstStartRecord();
+        m_gstRecordX->x11GstPrepareRecord();
+    }
+}
 
+//gstreamer录制视频
+void RecordProcess::GstStartRecord()
+{
+    if (Utils::isWaylandMode) {
+#ifdef KF5_WAYLAND_FLAGE_ON
+        WaylandIntegration::startRecord();
+#endif
+    } else {
+        m_gstRecordX->x11GstStartRecord();
     }
 }
 
@@ -544,9 +555,13 @@ void RecordProcess::setSystemAudio(const bool status)
     m_selectedSystemAudio = status;
 }
 
-//开始录屏
-void RecordProcess::startRecord()
+//预先初始化录屏，在倒计时期间调用
+void RecordProcess::prepareRecord()
 {
+    if (m_isPrepared) {
+        return;
+    }
+    m_isPrepared = true;
     //使用QtConcurrent::run受cpu核心线程数的影响，线程池默认大小为CPU核心线程数大小，由于程序中通过此方法启动的线程数超出4个，故再次设置线程池大小
     QThreadPool::globalInstance()->setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount() > 6 ? QThreadPool::globalInstance()->maxThreadCount() : 8);
     m_framerate = settings->value("recordConfig", "mkv_framerate").toString().toInt();
@@ -565,6 +580,50 @@ void RecordProcess::startRecord()
             recordAudioInputType = RECORD_AUDIO_INPUT_SYSTEMAUDIO;
         }
     }
+    if (!Utils::isFFmpegEnv) {
+        GstPrepareRecord();
+    } else if (Utils::isWaylandMode) {
+        //wayland下的录屏，倒计时期间建立wayland链接，收到第一个画面时打开音频设备、编码器及输出文件
+        if (recordType != RECORD_TYPE_GIF) {
+            if (settings->value("recordConfig", "lossless_recording").toBool()) {
+                recordType = RECORD_TYPE_MKV;
+            } else {
+                recordType = RECORD_TYPE_MP4;
+            }
+        }
+        waylandRecord();
+    }
+    //x11下的ffmpeg进程启动后即开始采集画面，无法预先启动
+}
+
+//取消倒计时期间预先初始化的录屏，录屏开始后不再处理
+void RecordProcess::cancelRecord()
+{
+    if (!m_isPrepared || m_isStarted) {
+        return;
+    }
+    if (m_gstRecordX) {
+        m_gstRecordX->cancelPrepare();
+    }
+#ifdef KF5_WAYLAND_FLAGE_ON
+    //wayland下释放倒计时期间打开的音频设备、编码器及输出文件
+    if (Utils::isFFmpegEnv && Utils::isWaylandMode) {
+        WaylandIntegration::cancelRecord();
+    }
+#endif
+    //wayland下收到第一个画面时已创建输出文件
+    if (!savePath.isEmpty() && QFile::exists(savePath)) {
+        QFile::remove(savePath);
+    }
+    qInfo() << "Prepared record is canceled!";
+}
+
+//开始录屏
+void RecordProcess::startRecord()
+{
+    //未在倒计时期间预先初始化时，在此处初始化
+    prepareRecord();
+    m_isStarted = true;
     if (!Utils::isFFmpegEnv) {
         GstStartRecord();
     } else {
@@ -577,14 +636,9 @@ void RecordProcess::startRecord()
         }
         //wayland下的录屏
         else {
-            if (recordType != RECORD_TYPE_GIF) {
-                if (settings->value("recordConfig", "lossless_recording").toBool()) {
-                    recordType = RECORD_TYPE_MKV;
-                } else {
-                    recordType = RECORD_TYPE_MP4;
-                }
-            }
-            waylandRecord();
+#ifdef KF5_WAYLAND_FLAGE_ON
+            WaylandIntegration::startRecord();
+#endif
         }
     }
     if (Utils::isSysHighVersion1040() == false) {
@@ -71,9 +71,17 @@ public:
      */
     void setRecordInfo(const QRect &recordRect, const QString &filename);
     /**
-     * @brief 开始录屏
+     * @brief 预先初始化录屏（倒计时期间调用）：构建gstreamer管道、打开音频设备及编码器等，不采集画面
+     */
+    void prepareRecord();
+    /**
+     * @brief 开始录屏（倒计时结束时调用），未预先初始化时会先进行初始化
      */
     void startRecord();
+    /**
+     * @brief 取消预先初始化的录屏（倒计时期间退出时调用）：释放管道并删除已创建的输出文件
+     */
+    void cancelRecord();
     /**
      * @brief 停止录屏
      */
@@ -97,6 +105,11 @@ private:
      */
     void waylandRecord();
 
+    /**
+     * @brief gstreamer预先构建录制管道
+     */
+    void GstPrepareRecord();
+
     /**
      * @brief gstreamer录制视频
      */
@@ -212,6 +225,14 @@ private:
      * @brief gstreamer录屏处理类
      */
     GstRecordX *m_gstRecordX;
+    /**
+     * @brief 是否已预先初始化录屏
+     */
+    bool m_isPrepared = false;
+    /**
+     * @brief 是否已开始录屏（倒计时已结束）
+     */
+    bool m_isStarted = false;
 
 };
 
@@ -93,6 +93,9 @@ HEADERS += main_window.h \
     utils/calculaterect.h \
     utils/saveutils.h \
     utils/shapesutils.h \
+    utils/shapeeffect.h \
+    utils/shapesgrid.h \
+    utils/shapeshistory.h \
     widgets/zoomIndicator.h \
     widgets/zoomIndicatorGL.h \
     widgets/textedit.h \
@@ -120,10 +123,14 @@ HEADERS += main_window.h \
     dbusinterface/ocrinterface.h \
     dbusinterface/pinscreenshotsinterface.h \
     gstrecord/gstrecordx.h \
-    gstrecord/gstinterface.h
+    gstrecord/gstinterface.h \
+    gstrecord/gstpipelinetracer.h
 contains(DEFINES , OCR_SCROLL_FLAGE_ON) {
     HEADERS += widgets/scrollshottip.h \
     utils/pixmergethread.h \
+    utils/longimage.h \
+    utils/longimagepreview.h \
+    utils/autoscrollcontroller.h \
     utils/scrollScreenshot.h \
     widgets/previewwidget.h
 }
@@ -151,6 +158,9 @@ SOURCES += main.cpp \
     utils/audioutils.cpp \
     menucontroller/menucontroller.cpp \
     utils/shapesutils.cpp \
+    utils/shapeeffect.cpp \
+    utils/shapesgrid.cpp \
+    utils/shapeshistory.cpp \
     utils/tempfile.cpp \
     utils/calculaterect.cpp \
     utils/shortcut.cpp \
@@ -182,11 +192,15 @@ SOURCES += main.cpp \
     dbusinterface/ocrinterface.cpp \
     dbusinterface/pinscreenshotsinterface.cpp \
     gstrecord/gstrecordx.cpp \
-    gstrecord/gstinterface.cpp
+    gstrecord/gstinterface.cpp \
+    gstrecord/gstpipelinetracer.cpp
 
 contains(DEFINES , OCR_SCROLL_FLAGE_ON) {
     SOURCES += widgets/scrollshottip.cpp \
     utils/pixmergethread.cpp \
+    utils/longimage.cpp \
+    utils/longimagepreview.cpp \
+    utils/autoscrollcontroller.cpp \
     utils/scrollScreenshot.cpp \
     widgets/previewwidget.cpp \
 }
@@ -213,7 +227,7 @@ QT += concurrent
 LIBS += -lX11 -lXext -lXtst -lXfixes -lXcursor
 
 contains(DEFINES , OCR_SCROLL_FLAGE_ON) {
-    LIBS += -lopencv_core -lopencv_imgproc
+    LIBS += -lopencv_core -lopencv_imgproc -lpng
 }
 
 QMAKE_CXXFLAGS += -g
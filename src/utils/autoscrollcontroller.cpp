@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "autoscrollcontroller.h"
+
+#include <QDebug>
+
+// 原固定的滚轮事件间隔
+const int AutoScrollController::INITIAL_INTERVAL = 300;
+// 间隔过短时页面的平滑滚动还未结束就已截图
+const int AutoScrollController::MIN_INTERVAL = 100;
+const int AutoScrollController::MAX_INTERVAL = 600;
+const int AutoScrollController::INTERVAL_STEP = 20;
+const int AutoScrollController::INITIAL_SHOT_FREQUENCY = 2;
+const int AutoScrollController::MAX_SHOT_FREQUENCY = 8;
+// 相邻两张图片至少保持一半高度重叠，行哈希与模板匹配均有足够的余量
+const qreal AutoScrollController::TARGET_OVERLAP = 0.5;
+
+AutoScrollController::AutoScrollController()
+{
+    reset();
+}
+
+void AutoScrollController::reset()
+{
+    m_interval = INITIAL_INTERVAL;
+    m_shotFrequency = INITIAL_SHOT_FREQUENCY;
+    m_ticks = 0;
+    m_tickRatio = -1;
+}
+
+int AutoScrollController::interval() const
+{
+    return m_interval;
+}
+
+int AutoScrollController::shotFrequency() const
+{
+    return m_shotFrequency;
+}
+
+int AutoScrollController::wheelTicked()
+{
+    if (++m_ticks < m_shotFrequency) {
+        return 0;
+    }
+    const int ticks = m_ticks;
+    m_ticks = 0;
+    return ticks;
+}
+
+bool AutoScrollController::update(bool isMerged, qreal overlapRatio, int ticks, int queueDepth)
+{
+    const int oldInterval = m_interval;
+    const int oldShotFrequency = m_shotFrequency;
+    if (!isMerged) {
+        // 拼接失败，重叠区域可能已不足，退回到较慢的速度
+        m_shotFrequency = qMax(1, m_shotFrequency / 2);
+        m_interval = qMin(MAX_INTERVAL, m_interval * 3 / 2);
+    } else {
+        // 流水线中有积压的图片，拼接时截图间隔可能已经变化，按截图时的滚轮事件数计算
+        if (ticks > 0) {
+            const qreal tickRatio = qBound<qreal>(0, 1 - overlapRatio, 1) / ticks;
+            m_tickRatio = m_tickRatio < 0 ? tickRatio : (m_tickRatio + tickRatio) / 2;
+        }
+        if (m_tickRatio > 0) {
+            // 保持目标重叠比例的最大滚轮事件数
+            m_shotFrequency = qBound(1, static_cast<int>((1 - TARGET_OVERLAP) / m_tickRatio), MAX_SHOT_FREQUENCY);
+        }
+        if (queueDepth > 0) {
+            m_interval = qMin(MAX_INTERVAL, m_interval * 3 / 2);
+        } else {
+            m_interval = qMax(MIN_INTERVAL, m_interval - INTERVAL_STEP);
+        }
+    }
+    if (m_interval == oldInterval && m_shotFrequency == oldShotFrequency) {
+        return false;
+    }
+    qInfo() << __FUNCTION__ << __LINE__ << "auto scroll:" << (isMerged ? "merged" : "merge failed")
+            << ", overlap:" << qRound(overlapRatio * 100) << "%, queue depth:" << queueDepth
+            << ", interval:" << oldInterval << "->" << m_interval << "ms"
+            << ", shot frequency:" << oldShotFrequency << "->" << m_shotFrequency;
+    return true;
+}
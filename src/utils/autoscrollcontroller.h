@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOSCROLLCONTROLLER_H
+#define AUTOSCROLLCONTROLLER_H
+
+#include <QtGlobal>
+
+/**
+ * @brief 自动滚动截图的滚动速度控制
+ * 根据最近拼接的重叠比例估计每次滚轮事件滚动的高度，选择保持安全重叠比例的最大截图间隔（每截图一次发送的滚轮事件数）；
+ * 根据拼接队列中等待的图片数调整滚轮事件的间隔：队列有积压时加倍减速，没有积压时逐步加速
+ */
+class AutoScrollController
+{
+public:
+    AutoScrollController();
+
+    /**
+     * @brief 恢复初始的滚动速度，开始新的滚动截图时调用
+     */
+    void reset();
+
+    /**
+     * @brief 滚轮事件的间隔(ms)
+     */
+    int interval() const;
+
+    /**
+     * @brief 每截图一次发送的滚轮事件数
+     */
+    int shotFrequency() const;
+
+    /**
+     * @brief 发送了一次滚轮事件
+     * @return 需要截图时返回上次截图后发送的滚轮事件数，该值随图片一起传递到拼接完成；不需要截图时返回0
+     */
+    int wheelTicked();
+
+    /**
+     * @brief 一张图片拼接完成后调整滚动速度
+     * @param isMerged:是否拼接成功
+     * @param overlapRatio:新图片与长图重叠的行数占新图片高度的比例，拼接成功时有效
+     * @param ticks:截图时wheelTicked返回的滚轮事件数，为0时（非自动滚动截取的图片）不用于估计滚动高度
+     * @param queueDepth:流水线中等待转换和拼接的图片数
+     * @return 滚动速度是否变化
+     */
+    bool update(bool isMerged, qreal overlapRatio, int ticks, int queueDepth);
+
+private:
+    int m_interval;
+    int m_shotFrequency;
+    int m_ticks;                // 上次截图后发送的滚轮事件数
+    qreal m_tickRatio;          // 每次滚轮事件滚动的高度占图片高度的比例（平滑后），小于0表示还未测量
+
+    static const int INITIAL_INTERVAL;
+    static const int MIN_INTERVAL;
+    static const int MAX_INTERVAL;
+    static const int INTERVAL_STEP;
+    static const int INITIAL_SHOT_FREQUENCY;
+    static const int MAX_SHOT_FREQUENCY;
+    static const qreal TARGET_OVERLAP;
+};
+
+#endif // AUTOSCROLLCONTROLLER_H
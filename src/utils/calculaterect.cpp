@@ -22,6 +22,8 @@
 #include "calculaterect.h"
 #include "../utils.h"
 
+#include <QVector>
+
 #include <cmath>
 
 const int padding = 2;
@@ -31,6 +33,26 @@ const int TANT2_EDGEVALUE = 2;
 const int MIN_PADDING = 3;
 const qreal SLOPE = 0.5522848;
 
+static int clickPadding()
+{
+    //平板需求暂定20，根据测试反馈可调
+    return Utils::isTabletEnvironment ? 20 : 4;
+}
+
+//点到线段的距离，垂足不在线段上时为到较近端点的距离
+static qreal pointToSegmentDistance(const QPointF &point1, const QPointF &point2, const QPointF &point3)
+{
+    const QPointF ab = point2 - point1;
+    const QPointF ac = point3 - point1;
+    const qreal length = QPointF::dotProduct(ab, ab);
+    qreal t = 0;
+    if (length > 0) {
+        t = qBound<qreal>(0, QPointF::dotProduct(ab, ac) / length, 1);
+    }
+    const QPointF d = ac - t * ab;
+    return std::sqrt(QPointF::dotProduct(d, d));
+}
+
 /* judge whether the point1 is on the point2 or not */
 /**
  * @brief pointClickIn: 鼠标点击的位置point1是否在point2上
@@ -43,14 +65,7 @@ bool pointClickIn(QPointF point2, QPointF point1, int padding)
 {
     //参数padding不再使用，pointClickIn函数有多处调用，以最小修改量为原则不改变原函数参数个数
     Q_UNUSED(padding);
-    int pointPadding = 0;
-
-    if (Utils::isTabletEnvironment) {
-        //平板需求暂定20，根据测试反馈可调
-        pointPadding = 20;
-    } else {
-        pointPadding = 4;
-    }
+    const int pointPadding = clickPadding();
 
     if (point2.x() >= point1.x() - pointPadding && point2.x() <= point1.x() + pointPadding &&
             point2.y() >= point1.y() - pointPadding && point2.y() <= point1.y() + pointPadding) {
@@ -169,7 +184,7 @@ QPointF getRotatePoint(QPointF point1, QPointF point2, QPointF point3, QPointF p
 }
 
 /* get the four points from a line */
-FourPoints fourPointsOfLine(QList<QPointF> points)
+FourPoints fourPointsOfLine(QVector<QPointF> points)
 {
     FourPoints resultFPoint;
     const int _MIN_PADDING = 10;
@@ -308,11 +323,11 @@ QPointF getControlPoint(QPointF point1, QPointF point2, bool direction)
 }
 
 /* get eight control points */
-QList<QPointF> getEightControlPoint(FourPoints rectFPoints)
+QVector<QPointF> getEightControlPoint(FourPoints rectFPoints)
 {
     FourPoints anotherFPoints = getAnotherFPoints(rectFPoints);
 
-    QList<QPointF> resultPointList;
+    QVector<QPointF> resultPointList;
     resultPointList.append(getControlPoint(rectFPoints[0], anotherFPoints[0], true));
     resultPointList.append(getControlPoint(rectFPoints[0], anotherFPoints[1], true));
     resultPointList.append(getControlPoint(anotherFPoints[0], rectFPoints[1], false));
@@ -347,7 +362,7 @@ bool pointOnBezier(QPointF point1, QPointF point2, QPointF point3, QPointF point
 bool pointOnEllipse(FourPoints rectFPoints, QPointF pos)
 {
     FourPoints anotherFPoints = getAnotherFPoints(rectFPoints);
-    QList<QPointF> controlPointList;
+    QVector<QPointF> controlPointList;
     controlPointList.append(getControlPoint(rectFPoints[0], anotherFPoints[0], true));
     controlPointList.append(getControlPoint(rectFPoints[0], anotherFPoints[1], true));
     controlPointList.append(getControlPoint(anotherFPoints[0], rectFPoints[1], false));
@@ -369,7 +384,7 @@ bool pointOnEllipse(FourPoints rectFPoints, QPointF pos)
 }
 
 /* get the three points of arrow A/B/D */
-QList<QPointF> pointOfArrow(QPointF startPoint, QPointF endPoint, qreal arrowLength)
+QVector<QPointF> pointOfArrow(QPointF startPoint, QPointF endPoint, qreal arrowLength)
 {
     qreal xMultiplier, yMultiplier;
     if (static_cast<int>(startPoint.x()) == static_cast<int>(endPoint.x())) {
@@ -392,27 +407,69 @@ QList<QPointF> pointOfArrow(QPointF startPoint, QPointF endPoint, qreal arrowLen
     add = pointSplid(startPoint, endPoint, arrowLength);
     QPointF pointE = QPointF(endPoint.x() - xMultiplier * add.x(), endPoint.y() - yMultiplier * add.y());
 
-    QList<QPointF> arrowPoints;
+    QVector<QPointF> arrowPoints;
     arrowPoints.append(pointB);
     arrowPoints.append(pointD);
     arrowPoints.append(pointE);
     return arrowPoints;
 }
 
-/* judge whether the pos is on the points of arbitrary- curved*/
-bool pointOnArLine(QList<QPointF> points, QPointF pos)
+/* judge whether the pos is on the polyline of arbitrary- curved*/
+bool pointOnArLine(QVector<QPointF> points, QPointF pos)
 {
+    //画笔保存的是简化后的折线，相邻两点可能相距很远，需要判断到每段线段的距离
+    const int pointPadding = clickPadding();
     for (int i = 0; i < points.length(); i++) {
         if (pointClickIn(points[i], pos)) {
             return true;
-        } else {
-            continue;
+        } else if (i > 0 && pointToSegmentDistance(points[i - 1], points[i], pos) <= pointPadding) {
+            return true;
         }
     }
 
     return false;
 }
 
+/* simplify the polyline of arbitrary curved */
+QVector<QPointF> simplifyLine(const QVector<QPointF> &points, qreal tolerance)
+{
+    if (points.length() <= 2) {
+        return points;
+    }
+
+    //Ramer-Douglas-Peucker：保留离首尾连线最远且超出容差的点，再分别处理两边；用栈代替递归，长线条也不会栈溢出
+    QVector<bool> keep(points.length(), false);
+    keep[0] = true;
+    keep[points.length() - 1] = true;
+    QVector<QPair<int, int>> ranges;
+    ranges.append(qMakePair(0, points.length() - 1));
+    while (!ranges.isEmpty()) {
+        const QPair<int, int> range = ranges.takeLast();
+        qreal maxDistance = 0;
+        int farthest = -1;
+        for (int i = range.first + 1; i < range.second; i++) {
+            const qreal distance = pointToSegmentDistance(points[range.first], points[range.second], points[i]);
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+        if (farthest != -1 && maxDistance > tolerance) {
+            keep[farthest] = true;
+            ranges.append(qMakePair(range.first, farthest));
+            ranges.append(qMakePair(farthest, range.second));
+        }
+    }
+
+    QVector<QPointF> result;
+    for (int i = 0; i < points.length(); i++) {
+        if (keep[i]) {
+            result.append(points[i]);
+        }
+    }
+    return result;
+}
+
 /* resize arbitrary curved */
 QList<qreal> relativePosition(FourPoints mainPoints,  QPointF pos)
 {
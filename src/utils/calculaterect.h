@@ -56,7 +56,7 @@ FourPoints initFourPoints(FourPoints fourPoints);
 //FourPoints  fourPointsOnRect(DiagPoints diagPoints);
 
 /* get the four points from a line */
-FourPoints fourPointsOfLine(QList<QPointF> points);
+FourPoints fourPointsOfLine(QVector<QPointF> points);
 
 /* get the rotate angle by three points*/
 qreal  calculateAngle(QPointF point1, QPointF point2, QPointF point3);
@@ -77,7 +77,7 @@ FourPoints getAnotherFPoints(FourPoints mainPoints);
 QPointF getControlPoint(QPointF point1, QPointF point2, bool direction) ;
 
 /* get eight control points */
-QList<QPointF> getEightControlPoint(FourPoints rectFPoints);
+QVector<QPointF> getEightControlPoint(FourPoints rectFPoints);
 
 /* judge whether the clickOnPoint is on the bezier */
 /* 0 <= pos.x() <= 1*/
@@ -90,10 +90,13 @@ bool pointOnEllipse(FourPoints rectFPoints, QPointF pos);
 /* judge whether the clickOnPoint is in the ellipse*/
 
 /* get the three points of arrow A/B/D */
-QList<QPointF> pointOfArrow(QPointF startPoint, QPointF endPoint, qreal arrowLength);
+QVector<QPointF> pointOfArrow(QPointF startPoint, QPointF endPoint, qreal arrowLength);
 
-/* judge whether the pos is on the points*/
-bool pointOnArLine(QList<QPointF> points, QPointF pos);
+/* judge whether the pos is on the polyline of the points*/
+bool pointOnArLine(QVector<QPointF> points, QPointF pos);
+
+/* simplify the polyline of arbitrary curved, keep the points within tolerance (Ramer-Douglas-Peucker) */
+QVector<QPointF> simplifyLine(const QVector<QPointF> &points, qreal tolerance);
 
 /* resize arbitrary curved */
 QList<qreal> relativePosition(FourPoints mainPoints, QPointF pos);
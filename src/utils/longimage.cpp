@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "longimage.h"
+
+#include <QVector>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QStandardPaths>
+
+#include <png.h>
+#include <stdio.h>
+
+// 内存预算默认值
+static const qint64 DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+// 长图开头和末尾各保留在内存中的条带数量，模板匹配只读取长图开头或末尾约两屏的区域
+static const int RESIDENT_STRIPS = 2;
+
+namespace {
+// 各条带拷贝到目标图片的对应行，条带之间互不重叠，可以并行
+class StripCopyBody : public cv::ParallelLoopBody
+{
+public:
+    StripCopyBody(const QVector<cv::Mat> &strips, const QVector<int> &offsets, cv::Mat &dst)
+        : m_strips(strips)
+        , m_offsets(offsets)
+        , m_dst(dst)
+    {
+    }
+
+    void operator()(const cv::Range &range) const override
+    {
+        for (int i = range.start; i < range.end; ++i) {
+            const cv::Mat &strip = m_strips.at(i);
+            cv::Mat dstRows = m_dst.rowRange(m_offsets.at(i), m_offsets.at(i) + strip.rows);
+            strip.copyTo(dstRows);
+        }
+    }
+
+private:
+    const QVector<cv::Mat> &m_strips;
+    const QVector<int> &m_offsets;
+    cv::Mat &m_dst;
+};
+
+// 条带占用的内存，只计算条带保留的行
+qint64 stripMemory(const cv::Mat &image)
+{
+    return static_cast<qint64>(image.rows) * static_cast<qint64>(image.step[0]);
+}
+
+// 裁剪条带：行区间视图会使整张来源图片保留在内存中，保留的行不足来源图片的一半时拷贝出来，
+// 释放来源图片，条带占用的内存与保留的行数一致
+cv::Mat trimStrip(const cv::Mat &image, int startRow, int endRow)
+{
+    const cv::Mat part = image.rowRange(startRow, endRow);
+    if (stripMemory(part) * 2 < image.datalimit - image.datastart) {
+        return part.clone();
+    }
+    return part;
+}
+}
+
+LongImage::LongImage()
+    : m_rows(0)
+    , m_revision(0)
+    , m_memoryBudget(DEFAULT_MEMORY_BUDGET)
+    , m_spillFile(nullptr)
+    , m_spillFailed(false)
+{
+}
+
+LongImage::~LongImage()
+{
+    clear();
+}
+
+void LongImage::clear()
+{
+    // 先释放条带，再删除临时文件（同时解除内存映射）
+    m_strips.clear();
+    if (m_spillFile) {
+        delete m_spillFile;
+        m_spillFile = nullptr;
+    }
+    m_freeRegions.clear();
+    m_spillFailed = false;
+    m_rows = 0;
+    ++m_revision;
+}
+
+void LongImage::reset(const cv::Mat &image)
+{
+    clear();
+    Strip strip;
+    strip.image = image;
+    m_strips.append(strip);
+    m_rows = image.rows;
+}
+
+bool LongImage::isEmpty() const
+{
+    return 0 == m_rows;
+}
+
+int LongImage::rows() const
+{
+    return m_rows;
+}
+
+int LongImage::cols() const
+{
+    return m_strips.isEmpty() ? 0 : m_strips.first().image.cols;
+}
+
+int LongImage::type() const
+{
+    return m_strips.isEmpty() ? CV_8UC4 : m_strips.first().image.type();
+}
+
+int LongImage::stripCount() const
+{
+    return m_strips.size();
+}
+
+int LongImage::spilledStripCount() const
+{
+    int count = 0;
+    for (const Strip &strip : m_strips) {
+        if (strip.spilled) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+qint64 LongImage::spillFileSize() const
+{
+    return m_spillFile ? m_spillFile->size() : 0;
+}
+
+void LongImage::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    spillIfNeeded();
+}
+
+quint64 LongImage::revision() const
+{
+    return m_revision;
+}
+
+//向下拼接：保留长图的前row行，在其后追加图片
+void LongImage::appendAt(int row, const cv::Mat &image)
+{
+    row = qBound(0, row, m_rows);
+    int start = 0;
+    int i = 0;
+    for (; i < m_strips.size(); ++i) {
+        const int end = start + m_strips.at(i).image.rows;
+        if (end >= row) {
+            break;
+        }
+        start = end;
+    }
+    if (i < m_strips.size()) {
+        // 拼接位置所在的条带只保留拼接位置之前的行，其后的条带全部丢弃
+        if (row > start) {
+            Strip &strip = m_strips[i];
+            strip.image = strip.spilled ? strip.image.rowRange(0, row - start) : trimStrip(strip.image, 0, row - start);
+            ++i;
+        }
+        while (m_strips.size() > i) {
+            releaseStrip(m_strips.takeLast());
+        }
+    }
+    Strip strip;
+    strip.image = image;
+    m_strips.append(strip);
+    m_rows = row + image.rows;
+    ++m_revision;
+    spillIfNeeded();
+}
+
+//向上拼接：去掉长图的前row行，在开头插入图片
+void LongImage::prependAt(int row, const cv::Mat &image)
+{
+    row = qBound(0, row, m_rows);
+    int removed = 0;
+    while (!m_strips.isEmpty() && removed + m_strips.first().image.rows <= row) {
+        removed += m_strips.first().image.rows;
+        releaseStrip(m_strips.takeFirst());
+    }
+    if (!m_strips.isEmpty() && row > removed) {
+        Strip &strip = m_strips[0];
+        const cv::Mat first = strip.image;
+        strip.image = strip.spilled ? first.rowRange(row - removed, first.rows) : trimStrip(first, row - removed, first.rows);
+    }
+    Strip strip;
+    strip.image = image;
+    m_strips.prepend(strip);
+    m_rows = m_rows - row + image.rows;
+    ++m_revision;
+    spillIfNeeded();
+}
+
+//获取长图的行区间
+cv::Mat LongImage::rowRange(int startRow, int endRow) const
+{
+    startRow = qBound(0, startRow, m_rows);
+    endRow = qBound(startRow, endRow, m_rows);
+    if (startRow == endRow) {
+        return cv::Mat();
+    }
+    cv::Mat result;
+    int start = 0;
+    for (const Strip &strip : m_strips) {
+        const int end = start + strip.image.rows;
+        if (end > startRow && start < endRow) {
+            const cv::Mat part = strip.image.rowRange(qMax(startRow, start) - start, qMin(endRow, end) - start);
+            if (start <= startRow && end >= endRow) {
+                return part;
+            }
+            if (result.empty()) {
+                result.create(endRow - startRow, strip.image.cols, strip.image.type());
+            }
+            cv::Mat dstRows = result.rowRange(qMax(startRow, start) - startRow, qMin(endRow, end) - startRow);
+            part.copyTo(dstRows);
+        }
+        if (end >= endRow) {
+            break;
+        }
+        start = end;
+    }
+    return result;
+}
+
+//获取长图行区间内每一行数据的指针
+void LongImage::rowPointers(int startRow, int endRow, std::vector<const uchar *> &rows) const
+{
+    startRow = qBound(0, startRow, m_rows);
+    endRow = qBound(startRow, endRow, m_rows);
+    rows.clear();
+    rows.reserve(static_cast<size_t>(endRow - startRow));
+    int start = 0;
+    for (const Strip &strip : m_strips) {
+        const int end = start + strip.image.rows;
+        for (int row = qMax(startRow, start); row < qMin(endRow, end); ++row) {
+            rows.push_back(strip.image.ptr(row - start));
+        }
+        if (end >= endRow) {
+            break;
+        }
+        start = end;
+    }
+}
+
+//将整张长图拷贝到dst，各条带并行拷贝
+void LongImage::copyTo(cv::Mat &dst) const
+{
+    if (dst.rows != m_rows || dst.cols != cols() || dst.type() != type()) {
+        qWarning() << __FUNCTION__ << __LINE__ << "long image size mismatch:" << dst.cols << "x" << dst.rows
+                   << ", expected:" << cols() << "x" << m_rows;
+        return;
+    }
+    QVector<cv::Mat> strips;
+    QVector<int> offsets;
+    strips.reserve(m_strips.size());
+    offsets.reserve(m_strips.size());
+    int offset = 0;
+    for (const Strip &strip : m_strips) {
+        strips.append(strip.image);
+        offsets.append(offset);
+        offset += strip.image.rows;
+    }
+    cv::parallel_for_(cv::Range(0, strips.size()), StripCopyBody(strips, offsets, dst));
+}
+
+//拼合为一张连续图片
+cv::Mat LongImage::toMat() const
+{
+    if (isEmpty()) {
+        return cv::Mat();
+    }
+    cv::Mat result(m_rows, cols(), type());
+    copyTo(result);
+    return result;
+}
+
+//生成预览图：按预览图高度等间隔取样长图的行，再缩小宽度，只读取取样的行
+cv::Mat LongImage::preview(int maxRows) const
+{
+    if (isEmpty() || maxRows <= 0) {
+        return cv::Mat();
+    }
+    if (m_rows <= maxRows) {
+        return toMat();
+    }
+    cv::Mat sampled(maxRows, cols(), type());
+    int stripIndex = 0;
+    int stripStart = 0;
+    for (int i = 0; i < maxRows; ++i) {
+        const int row = static_cast<int>((2 * static_cast<qint64>(i) + 1) * m_rows / (2 * static_cast<qint64>(maxRows)));
+        while (row >= stripStart + m_strips.at(stripIndex).image.rows) {
+            stripStart += m_strips.at(stripIndex).image.rows;
+            ++stripIndex;
+        }
+        m_strips.at(stripIndex).image.row(row - stripStart).copyTo(sampled.row(i));
+    }
+    const int previewCols = qMax(1, static_cast<int>(static_cast<qint64>(cols()) * maxRows / m_rows));
+    cv::Mat result;
+    cv::resize(sampled, result, cv::Size(previewCols, maxRows), 0, 0, cv::INTER_AREA);
+    return result;
+}
+
+//逐行写入PNG文件，各条带的行直接交给编码器，不拼合整张长图
+bool LongImage::savePng(const QString &fileName, int quality) const
+{
+    if (isEmpty() || CV_8UC4 != type()) {
+        qWarning() << __FUNCTION__ << __LINE__ << "invalid long image!";
+        return false;
+    }
+    FILE *fp = fopen(QFile::encodeName(fileName).constData(), "wb");
+    if (!fp) {
+        qWarning() << __FUNCTION__ << __LINE__ << "failed to open" << fileName;
+        return false;
+    }
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!png || !info) {
+        png_destroy_write_struct(&png, nullptr);
+        fclose(fp);
+        return false;
+    }
+    // libpng出错时跳转到此处
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        fclose(fp);
+        qWarning() << __FUNCTION__ << __LINE__ << "failed to write" << fileName;
+        return false;
+    }
+    png_init_io(png, fp);
+    // 与QImage::save相同：质量越高压缩级别越低
+    if (quality >= 0) {
+        png_set_compression_level(png, (100 - qMin(quality, 100)) * 9 / 91);
+    }
+    png_set_IHDR(png, info, static_cast<png_uint_32>(cols()), static_cast<png_uint_32>(m_rows), 8,
+                 PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    // 长图数据为BGRA（QImage::Format_ARGB32），写入时转为RGB并去掉透明通道
+    png_set_bgr(png);
+    png_set_filler(png, 0, PNG_FILLER_AFTER);
+    for (int i = 0; i < m_strips.size(); ++i) {
+        const cv::Mat &image = m_strips.at(i).image;
+        for (int row = 0; row < image.rows; ++row) {
+            png_write_row(png, const_cast<png_bytep>(image.ptr<png_byte>(row)));
+        }
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    if (0 != fclose(fp)) {
+        qWarning() << __FUNCTION__ << __LINE__ << "failed to write" << fileName;
+        return false;
+    }
+    return true;
+}
+
+//内存中的条带超过内存预算时，将长图中间的条带转存到临时文件
+void LongImage::spillIfNeeded()
+{
+    if (m_spillFailed || m_memoryBudget < 0) {
+        return;
+    }
+    qint64 residentMemory = 0;
+    for (const Strip &strip : m_strips) {
+        if (!strip.spilled) {
+            residentMemory += stripMemory(strip.image);
+        }
+    }
+    for (int i = RESIDENT_STRIPS; i < m_strips.size() - RESIDENT_STRIPS && residentMemory > m_memoryBudget; ++i) {
+        if (m_strips.at(i).spilled) {
+            continue;
+        }
+        const qint64 memory = stripMemory(m_strips.at(i).image);
+        if (!spillStrip(i)) {
+            // 转存失败（如磁盘空间不足）后不再尝试，长图继续保留在内存中
+            m_spillFailed = true;
+            return;
+        }
+        residentMemory -= memory;
+    }
+}
+
+//将条带写入临时文件，并替换为文件的内存映射
+bool LongImage::spillStrip(int index)
+{
+    if (!m_spillFile) {
+        // 临时文件放在缓存目录下，/tmp可能是内存文件系统
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (dir.isEmpty() || !QDir().mkpath(dir)) {
+            dir = QDir::tempPath();
+        }
+        m_spillFile = new QTemporaryFile(dir + "/longimage-XXXXXX");
+        if (!m_spillFile->open()) {
+            qWarning() << __FUNCTION__ << __LINE__ << "failed to create spill file:" << m_spillFile->errorString();
+            delete m_spillFile;
+            m_spillFile = nullptr;
+            return false;
+        }
+        qInfo() << __FUNCTION__ << __LINE__ << "long image spills to" << m_spillFile->fileName();
+    }
+    const cv::Mat image = m_strips.at(index).image;
+    const qint64 rowBytes = static_cast<qint64>(image.cols) * static_cast<qint64>(image.elemSize());
+    const qint64 size = rowBytes * image.rows;
+    // 优先复用已丢弃条带的空闲区域，没有足够大的区域时追加到文件末尾
+    qint64 offset = m_spillFile->size();
+    for (auto it = m_freeRegions.begin(); it != m_freeRegions.end(); ++it) {
+        if (it.value() >= size) {
+            offset = it.key();
+            const qint64 rest = it.value() - size;
+            m_freeRegions.erase(it);
+            if (rest > 0) {
+                m_freeRegions.insert(offset + size, rest);
+            }
+            break;
+        }
+    }
+    if (!m_spillFile->seek(offset)) {
+        return false;
+    }
+    for (int row = 0; row < image.rows; ++row) {
+        if (m_spillFile->write(reinterpret_cast<const char *>(image.ptr(row)), rowBytes) != rowBytes) {
+            qWarning() << __FUNCTION__ << __LINE__ << "failed to write spill file:" << m_spillFile->errorString();
+            return false;
+        }
+    }
+    if (!m_spillFile->flush()) {
+        return false;
+    }
+    uchar *data = m_spillFile->map(offset, size);
+    if (!data) {
+        qWarning() << __FUNCTION__ << __LINE__ << "failed to map spill file:" << m_spillFile->errorString();
+        return false;
+    }
+    Strip &strip = m_strips[index];
+    strip.image = cv::Mat(image.rows, image.cols, image.type(), data, static_cast<size_t>(rowBytes));
+    strip.spilled = true;
+    strip.mapped = data;
+    strip.fileOffset = offset;
+    strip.fileSize = size;
+    return true;
+}
+
+//丢弃条带：解除内存映射，区域位于文件末尾时截断文件，否则加入空闲区域
+void LongImage::releaseStrip(const Strip &strip)
+{
+    if (!strip.spilled || !m_spillFile) {
+        return;
+    }
+    m_spillFile->unmap(strip.mapped);
+    qint64 offset = strip.fileOffset;
+    qint64 size = strip.fileSize;
+    // 与前后相邻的空闲区域合并
+    auto next = m_freeRegions.lowerBound(offset);
+    if (next != m_freeRegions.end() && next.key() == offset + size) {
+        size += next.value();
+        next = m_freeRegions.erase(next);
+    }
+    if (next != m_freeRegions.begin()) {
+        auto prev = next - 1;
+        if (prev.key() + prev.value() == offset) {
+            offset = prev.key();
+            size += prev.value();
+            m_freeRegions.erase(prev);
+        }
+    }
+    if (offset + size >= m_spillFile->size()) {
+        m_spillFile->resize(offset);
+    } else {
+        m_freeRegions.insert(offset, size);
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LONGIMAGE_H
+#define LONGIMAGE_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+
+#include<opencv2/opencv.hpp>
+
+class QTemporaryFile;
+
+/**
+ * @brief 滚动截图的长图
+ * 长图由若干条带按顺序组成，每个条带是某一张拼接图片的行区间（与该图片共享数据，不拷贝），
+ * 拼接时只增删条带，不再每次重新分配并拷贝整张长图；只在保存时一次性拼合为连续图片。
+ * 内存中的条带超过内存预算后，长图中间的条带转存到临时文件并通过内存映射访问，
+ * 长图开头和末尾的条带（模板匹配使用）始终保留在内存中
+ */
+class LongImage
+{
+public:
+    LongImage();
+    ~LongImage();
+
+    /**
+     * @brief 清空长图
+     */
+    void clear();
+
+    /**
+     * @brief 以一张图片作为长图
+     * @param image:长图的第一张图片，与长图共享数据，之后不可再修改
+     */
+    void reset(const cv::Mat &image);
+
+    bool isEmpty() const;
+    int rows() const;
+    int cols() const;
+    int type() const;
+
+    /**
+     * @brief 条带数量
+     */
+    int stripCount() const;
+
+    /**
+     * @brief 已转存到临时文件的条带数量
+     */
+    int spilledStripCount() const;
+
+    /**
+     * @brief 临时文件的大小，丢弃的条带占用的区域会被复用或截断
+     */
+    qint64 spillFileSize() const;
+
+    /**
+     * @brief 设置内存预算，内存中的条带超过预算后转存到临时文件
+     * @param bytes:字节数
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief 长图内容的版本号，长图每次变化后递增，用于判断基于长图的缓存是否失效
+     */
+    quint64 revision() const;
+
+    /**
+     * @brief 向下拼接：保留长图的前row行，在其后追加图片
+     * @param row:追加位置
+     * @param image:追加的图片，与长图共享数据，之后不可再修改
+     */
+    void appendAt(int row, const cv::Mat &image);
+
+    /**
+     * @brief 向上拼接：去掉长图的前row行，在开头插入图片
+     * @param row:去掉的行数
+     * @param image:插入的图片，与长图共享数据，之后不可再修改
+     */
+    void prependAt(int row, const cv::Mat &image);
+
+    /**
+     * @brief 获取长图的行区间[startRow, endRow)
+     * 区间位于同一条带内时直接返回该条带的视图，跨条带时拷贝为一张连续图片；
+     * 返回的视图在长图下次变化前有效
+     */
+    cv::Mat rowRange(int startRow, int endRow) const;
+
+    /**
+     * @brief 获取长图行区间[startRow, endRow)内每一行数据的指针，不拷贝
+     * 指针在长图下次变化前有效
+     */
+    void rowPointers(int startRow, int endRow, std::vector<const uchar *> &rows) const;
+
+    /**
+     * @brief 将整张长图拷贝到dst，各条带并行拷贝
+     * @param dst:已分配好的rows()×cols()图片，可以是外部内存（如QImage）的视图
+     */
+    void copyTo(cv::Mat &dst) const;
+
+    /**
+     * @brief 拼合为一张连续图片
+     */
+    cv::Mat toMat() const;
+
+    /**
+     * @brief 生成预览图，高度不超过maxRows，按比例缩小，只读取需要的行
+     * @param maxRows:预览图最大高度
+     */
+    cv::Mat preview(int maxRows) const;
+
+    /**
+     * @brief 逐行写入PNG文件，不拼合整张长图
+     * @param fileName:文件名
+     * @param quality:图片质量，与QImage::save的PNG质量含义相同，-1为默认
+     */
+    bool savePng(const QString &fileName, int quality = -1) const;
+
+private:
+    /**
+     * @brief 内存中的条带超过内存预算时，将长图中间的条带转存到临时文件
+     */
+    void spillIfNeeded();
+
+    /**
+     * @brief 将条带写入临时文件，并替换为文件的内存映射
+     */
+    bool spillStrip(int index);
+
+private:
+    struct Strip {
+        cv::Mat image;          // 来源图片的行区间视图（裁剪后可能为拷贝），转存后为临时文件的内存映射
+        bool spilled = false;   // 是否已转存到临时文件
+        uchar *mapped = nullptr;    // 临时文件的内存映射地址，条带裁剪后仍指向整个区域
+        qint64 fileOffset = 0;  // 在临时文件中的区域
+        qint64 fileSize = 0;
+    };
+
+    /**
+     * @brief 丢弃条带，释放其在临时文件中占用的区域
+     */
+    void releaseStrip(const Strip &strip);
+
+private:
+    QList<Strip> m_strips;
+    int m_rows;
+    quint64 m_revision;
+
+    qint64 m_memoryBudget;
+    QTemporaryFile *m_spillFile;
+    // 临时文件中的空闲区域，偏移->大小，相邻区域合并
+    QMap<qint64, qint64> m_freeRegions;
+    bool m_spillFailed;
+
+    Q_DISABLE_COPY(LongImage)
+};
+
+#endif // LONGIMAGE_H
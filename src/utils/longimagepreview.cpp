@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "longimagepreview.h"
+#include "longimage.h"
+
+#include <vector>
+
+// 向下取整的除法，坐标可能为负数
+static qint64 floorDiv(qint64 value, qint64 divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// 向上取整的除法
+static qint64 ceilDiv(qint64 value, qint64 divisor)
+{
+    return -floorDiv(-value, divisor);
+}
+
+LongImagePreview::LongImagePreview(int maxRows)
+    : m_maxRows(qMax(1, maxRows))
+    , m_scale(1)
+    , m_cols(0)
+    , m_top(0)
+    , m_firstBlock(0)
+    , m_changed(false)
+    , m_keepStart(0)
+    , m_keepEnd(0)
+    , m_isPrepend(false)
+{
+}
+
+void LongImagePreview::clear()
+{
+    m_preview.release();
+    m_scale = 1;
+    m_cols = 0;
+    m_top = 0;
+    m_firstBlock = 0;
+    m_changed = false;
+}
+
+bool LongImagePreview::isEmpty() const
+{
+    return m_preview.empty();
+}
+
+int LongImagePreview::scale() const
+{
+    return m_scale;
+}
+
+cv::Mat LongImagePreview::image() const
+{
+    return m_preview;
+}
+
+//按整张长图重新生成预览图，只在第一次拼接时使用
+void LongImagePreview::reset(const LongImage &longImage)
+{
+    clear();
+    if (longImage.isEmpty()) {
+        return;
+    }
+    m_cols = longImage.cols();
+    while (ceilDiv(longImage.rows(), m_scale) > m_maxRows) {
+        m_scale *= 2;
+    }
+    m_preview = downscale(longImage, 0, ceilDiv(longImage.rows(), m_scale));
+    markChanged(0, 0, false);
+}
+
+//向下拼接：拼接位置所在的块及之后的块重新生成，之前的块保持不变
+void LongImagePreview::appendAt(const LongImage &longImage, int row)
+{
+    if (m_preview.empty() || longImage.cols() != m_cols) {
+        reset(longImage);
+        return;
+    }
+    const qint64 firstChanged = qMax(floorDiv(m_top + row, m_scale), m_firstBlock);
+    const qint64 endBlock = ceilDiv(m_top + longImage.rows(), m_scale);
+    const int keepRows = static_cast<int>(qMin<qint64>(firstChanged - m_firstBlock, m_preview.rows));
+    cv::Mat rows = downscale(longImage, m_firstBlock + keepRows, endBlock);
+    // 只缩短预览图的行数，不重新分配；追加时按倍数扩容
+    m_preview.resize(static_cast<size_t>(keepRows));
+    if (!rows.empty()) {
+        m_preview.push_back(rows);
+    }
+    markChanged(0, keepRows, false);
+    while (m_preview.rows > m_maxRows) {
+        halve();
+    }
+}
+
+//向上拼接：保留部分第一个完整的块及之后的块保持不变，之前的块重新生成
+void LongImagePreview::prependAt(const LongImage &longImage, int row, int insertedRows)
+{
+    if (m_preview.empty() || longImage.cols() != m_cols) {
+        reset(longImage);
+        return;
+    }
+    const qint64 retainedStart = m_top + row;
+    const qint64 firstValid = ceilDiv(retainedStart, m_scale);
+    const int dropRows = static_cast<int>(qBound<qint64>(0, firstValid - m_firstBlock, m_preview.rows));
+    const qint64 endBlock = m_firstBlock + dropRows;
+    m_top = retainedStart - insertedRows;
+    m_firstBlock = floorDiv(m_top, m_scale);
+    cv::Mat rows = downscale(longImage, m_firstBlock, endBlock);
+    const int oldRows = m_preview.rows;
+    if (dropRows >= oldRows) {
+        m_preview = rows;
+    } else if (!rows.empty()) {
+        cv::Mat preview;
+        cv::vconcat(rows, m_preview.rowRange(dropRows, oldRows), preview);
+        m_preview = preview;
+    } else {
+        m_preview = m_preview.rowRange(dropRows, oldRows).clone();
+    }
+    markChanged(dropRows, oldRows, true);
+    while (m_preview.rows > m_maxRows) {
+        halve();
+    }
+}
+
+bool LongImagePreview::takeChange(cv::Mat &rows, int &keepStart, int &keepEnd, bool &isPrepend)
+{
+    if (!m_changed) {
+        return false;
+    }
+    const int keptRows = m_keepEnd - m_keepStart;
+    rows = m_isPrepend ? m_preview.rowRange(0, m_preview.rows - keptRows)
+           : m_preview.rowRange(keptRows, m_preview.rows);
+    keepStart = m_keepStart;
+    keepEnd = m_keepEnd;
+    isPrepend = m_isPrepend;
+    m_changed = false;
+    return true;
+}
+
+//缩小长图中块[startBlock, endBlock)对应的行，首尾的块可能不完整
+cv::Mat LongImagePreview::downscale(const LongImage &longImage, qint64 startBlock, qint64 endBlock) const
+{
+    const int startRow = static_cast<int>(qMax<qint64>(startBlock * m_scale - m_top, 0));
+    const int endRow = static_cast<int>(qMin<qint64>(endBlock * m_scale - m_top, longImage.rows()));
+    if (endBlock <= startBlock || endRow <= startRow) {
+        return cv::Mat();
+    }
+    const cv::Size blockSize(qMax(1, m_cols / m_scale), 1);
+    const qint64 startPos = m_top + startRow;
+    const qint64 endPos = m_top + endRow;
+    cv::Mat part;
+    if (floorDiv(startPos, m_scale) == floorDiv(endPos - 1, m_scale)) {
+        cv::resize(longImage.rowRange(startRow, endRow), part, blockSize, 0, 0, cv::INTER_AREA);
+        return part;
+    }
+    // 首尾不完整的块单独缩小，中间完整的块按整数倍缩小，块之间的行不会混合
+    std::vector<cv::Mat> parts;
+    int middleStart = startRow;
+    if (startPos % m_scale != 0) {
+        middleStart = static_cast<int>((floorDiv(startPos, m_scale) + 1) * m_scale - m_top);
+        cv::resize(longImage.rowRange(startRow, middleStart), part, blockSize, 0, 0, cv::INTER_AREA);
+        parts.push_back(part);
+    }
+    const int middleEnd = static_cast<int>(floorDiv(endPos, m_scale) * m_scale - m_top);
+    if (middleEnd > middleStart) {
+        cv::Mat middle;
+        cv::resize(longImage.rowRange(middleStart, middleEnd), middle,
+                   cv::Size(blockSize.width, (middleEnd - middleStart) / m_scale), 0, 0, cv::INTER_AREA);
+        parts.push_back(middle);
+    }
+    if (endPos % m_scale != 0) {
+        cv::Mat last;
+        cv::resize(longImage.rowRange(middleEnd, endRow), last, blockSize, 0, 0, cv::INTER_AREA);
+        parts.push_back(last);
+    }
+    cv::Mat result;
+    cv::vconcat(parts, result);
+    return result;
+}
+
+//缩小倍数加倍：新的块由两个相邻的块组成，第一个和最后一个块可能只包含一个旧块
+void LongImagePreview::halve()
+{
+    const int cols = qMax(1, m_cols / (m_scale * 2));
+    std::vector<cv::Mat> parts;
+    int start = 0;
+    if (m_firstBlock % 2 != 0) {
+        cv::Mat part;
+        cv::resize(m_preview.row(0), part, cv::Size(cols, 1), 0, 0, cv::INTER_AREA);
+        parts.push_back(part);
+        start = 1;
+    }
+    const int pairs = (m_preview.rows - start) / 2;
+    if (pairs > 0) {
+        cv::Mat part;
+        cv::resize(m_preview.rowRange(start, start + pairs * 2), part, cv::Size(cols, pairs), 0, 0, cv::INTER_AREA);
+        parts.push_back(part);
+    }
+    if (start + pairs * 2 < m_preview.rows) {
+        cv::Mat part;
+        cv::resize(m_preview.row(m_preview.rows - 1), part, cv::Size(cols, 1), 0, 0, cv::INTER_AREA);
+        parts.push_back(part);
+    }
+    cv::vconcat(parts, m_preview);
+    m_scale *= 2;
+    m_firstBlock = floorDiv(m_firstBlock, 2);
+    markChanged(0, 0, false);
+}
+
+void LongImagePreview::markChanged(int keepStart, int keepEnd, bool isPrepend)
+{
+    if (m_changed) {
+        // 上次的变化还未取出，无法合并描述，改为整张预览图变化
+        keepStart = keepEnd = 0;
+        isPrepend = false;
+    }
+    m_changed = true;
+    m_keepStart = keepStart;
+    m_keepEnd = keepEnd;
+    m_isPrepend = isPrepend;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LONGIMAGEPREVIEW_H
+#define LONGIMAGEPREVIEW_H
+
+#include <QtGlobal>
+
+#include<opencv2/opencv.hpp>
+
+class LongImage;
+
+/**
+ * @brief 滚动截图长图的预览图，随拼接增量更新
+ * 预览图按固定的缩小倍数（2的幂）生成，每一行对应长图中连续的若干行（块）；
+ * 拼接时只缩小新拼接的部分并追加到预览图，预览图超过最大高度时整体再缩小一半。
+ * 每次更新的耗时只与新拼接部分的大小有关，不随长图高度增长
+ */
+class LongImagePreview
+{
+public:
+    /**
+     * @param maxRows:预览图最大高度
+     */
+    explicit LongImagePreview(int maxRows);
+
+    /**
+     * @brief 清空预览图
+     */
+    void clear();
+
+    bool isEmpty() const;
+
+    /**
+     * @brief 缩小倍数，预览图的一行对应长图的行数
+     */
+    int scale() const;
+
+    /**
+     * @brief 当前预览图，在预览图下次变化前有效
+     */
+    cv::Mat image() const;
+
+    /**
+     * @brief 按整张长图重新生成预览图
+     */
+    void reset(const LongImage &longImage);
+
+    /**
+     * @brief 长图向下拼接后更新预览图
+     * @param longImage:拼接后的长图
+     * @param row:拼接位置，即LongImage::appendAt的row
+     */
+    void appendAt(const LongImage &longImage, int row);
+
+    /**
+     * @brief 长图向上拼接后更新预览图
+     * @param longImage:拼接后的长图
+     * @param row:长图开头去掉的行数，即LongImage::prependAt的row
+     * @param insertedRows:插入的图片高度
+     */
+    void prependAt(const LongImage &longImage, int row, int insertedRows);
+
+    /**
+     * @brief 取出上次取出之后预览图的变化
+     * 新的预览图 = isPrepend ? rows + 旧预览图[keepStart, keepEnd) : 旧预览图[keepStart, keepEnd) + rows，
+     * keepStart与keepEnd相等时rows为整张预览图
+     * @param rows:变化的行，在预览图下次变化前有效
+     * @return 没有变化时返回false
+     */
+    bool takeChange(cv::Mat &rows, int &keepStart, int &keepEnd, bool &isPrepend);
+
+private:
+    /**
+     * @brief 缩小长图中块[startBlock, endBlock)对应的行
+     */
+    cv::Mat downscale(const LongImage &longImage, qint64 startBlock, qint64 endBlock) const;
+
+    /**
+     * @brief 缩小倍数加倍，预览图每两行合并为一行
+     */
+    void halve();
+
+    /**
+     * @brief 记录预览图的变化，上次的变化还未取出时，改为整张预览图变化
+     */
+    void markChanged(int keepStart, int keepEnd, bool isPrepend);
+
+private:
+    int m_maxRows;
+    int m_scale;            // 缩小倍数
+    int m_cols;             // 长图宽度
+    qint64 m_top;           // 长图第一行的坐标，向上拼接时减小，块按该坐标对齐，向上拼接后已有的块仍然有效
+    qint64 m_firstBlock;    // 预览图第一行对应的块
+    cv::Mat m_preview;
+
+    bool m_changed;
+    int m_keepStart;
+    int m_keepEnd;
+    bool m_isPrepend;
+};
+
+#endif // LONGIMAGEPREVIEW_H
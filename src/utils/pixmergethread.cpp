@@ -21,10 +21,190 @@
 
 #include <QMutexLocker>
 #include <QDateTime>
-const int PixMergeThread::LONG_IMG_MAX_HEIGHT = 10000;
+#include <QElapsedTimer>
+
+#include <string.h>
+#include <algorithm>
+
+// OpenCV 4.2起MatAllocator的接口使用cv::AccessFlag，之前的版本为int
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
+typedef cv::AccessFlag MatAccessFlag;
+#else
+typedef int MatAccessFlag;
+#endif
+
+// 长图超出内存预算的部分转存到临时文件，长度不再受内存限制
+const int PixMergeThread::LONG_IMG_MAX_HEIGHT = 150000;
+// 超过该高度的长图不再拼合为整张图片（QPixmap、剪贴板、JPEG均难以处理），保存时逐行写入PNG文件
+const int PixMergeThread::LONG_IMG_STREAM_SAVE_HEIGHT = 32767;
+// 预览图最大高度，预览框高度不超过屏幕高度的7/10
+const int PixMergeThread::PREVIEW_MAX_HEIGHT = 2048;
 const int PixMergeThread::TEMPLATE_HEIGHT = 50;
+// 新图片只可能与长图末尾(或开头)约一屏的区域重叠，匹配窗口取新图片高度的倍数
+const int PixMergeThread::MATCH_WINDOW_FACTOR = 2;
+// 流水线各级队列的长度：抓取的图片队列满时丢弃新图片，拼接队列满时转换线程等待，图片不会无限堆积
+const int PixMergeThread::PIPELINE_QUEUE_SIZE = 2;
+
+// 计算一行像素的64位哈希：按8字节读取，4路相互独立地累加，便于编译器展开循环、并行执行乘法
+// SSE2/NEON没有64位整数乘法，这里保持标量实现；长图尾部各行的哈希有缓存，每次拼接只计算新图片的行
+static quint64 hashRow(const uchar *data, int bytes)
+{
+    const quint64 prime = 0x9E3779B97F4A7C15ULL;
+    quint64 lanes[4] = {prime, prime + 1, prime + 2, prime + 3};
+    const int words = bytes / 8;
+    int i = 0;
+    for (; i + 4 <= words; i += 4) {
+        for (int lane = 0; lane < 4; ++lane) {
+            quint64 value;
+            memcpy(&value, data + (i + lane) * 8, 8);
+            lanes[lane] = (lanes[lane] ^ value) * prime;
+        }
+    }
+    quint64 hash = static_cast<quint64>(bytes);
+    for (int lane = 0; lane < 4; ++lane) {
+        hash = (hash ^ lanes[lane]) * prime;
+    }
+    for (; i < words; ++i) {
+        quint64 value;
+        memcpy(&value, data + i * 8, 8);
+        hash = (hash ^ value) * prime;
+    }
+    for (int j = words * 8; j < bytes; ++j) {
+        hash = (hash ^ data[j]) * prime;
+    }
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// 比较img1从aRow行、img2从bRow行开始的rows行是否完全相同，行连续存放时整块比较
+static bool isSameRows(const cv::Mat &img1, int aRow, const cv::Mat &img2, int bRow, int rows)
+{
+    const size_t rowBytes = img1.cols * img1.elemSize();
+    if (img1.step[0] == rowBytes && img2.step[0] == rowBytes) {
+        return memcmp(img1.ptr(aRow), img2.ptr(bRow), rowBytes * static_cast<size_t>(rows)) == 0;
+    }
+    for (int i = 0; i < rows; ++i) {
+        if (memcmp(img1.ptr(aRow + i), img2.ptr(bRow + i), rowBytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 从两张等宽图片的顶部（fromBottom为false）或底部开始，计算连续相同的行数，最多比较count行
+// 比较的行块按1、2、4...倍增，遇到不同的行块后在块内二分，每行最多比较约两次，比较次数为对数级
+static int countSameRows(const cv::Mat &img1, const cv::Mat &img2, int count, bool fromBottom)
+{
+    // 第offset行起的len行在两张图片中的起始行号
+    auto isSameBlock = [&](int offset, int len) {
+        const int aRow = fromBottom ? img1.rows - offset - len : offset;
+        const int bRow = fromBottom ? img2.rows - offset - len : offset;
+        return isSameRows(img1, aRow, img2, bRow, len);
+    };
+    int sameRows = 0;
+    int len = 1;
+    while (sameRows < count) {
+        len = qMin(len, count - sameRows);
+        if (!isSameBlock(sameRows, len)) {
+            break;
+        }
+        sameRows += len;
+        len *= 2;
+    }
+    if (sameRows >= count) {
+        return count;
+    }
+    // [sameRows, sameRows + len)中存在不同的行，二分查找第一个不同的行
+    while (len > 1) {
+        const int half = len / 2;
+        if (isSameBlock(sameRows, half)) {
+            sameRows += half;
+            len -= half;
+        } else {
+            len = half;
+        }
+    }
+    return sameRows;
+}
+
+// 计算各行的哈希
+static void hashRows(const std::vector<const uchar *> &rows, int rowBytes, std::vector<quint64> &hashes)
+{
+    hashes.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        hashes[i] = hashRow(rows[i], rowBytes);
+    }
+}
+
+// 计算图片各行的哈希
+static void hashMatRows(const cv::Mat &image, std::vector<quint64> &hashes)
+{
+    std::vector<const uchar *> rows;
+    rows.reserve(static_cast<size_t>(image.rows));
+    for (int i = 0; i < image.rows; ++i) {
+        rows.push_back(image.ptr(i));
+    }
+    hashRows(rows, image.cols * static_cast<int>(image.elemSize()), hashes);
+}
+
+// 使cv::Mat直接引用QImage的缓冲区：QImage的浅拷贝保存在UMatData中，与cv::Mat共用引用计数，
+// 最后一个引用该缓冲区的cv::Mat（包括行区间视图、长图条带）释放时才释放QImage
+class QImageMatAllocator : public cv::MatAllocator
+{
+public:
+    cv::Mat wrap(const QImage &image) const
+    {
+        uchar *data = const_cast<uchar *>(image.constBits());
+        cv::Mat mat(image.height(), image.width(), CV_8UC4, data, static_cast<size_t>(image.bytesPerLine()));
+        cv::UMatData *u = new cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = static_cast<size_t>(image.bytesPerLine()) * static_cast<size_t>(image.height());
+        u->userdata = new QImage(image);
+        mat.u = u;
+        mat.addref();
+        return mat;
+    }
+
+    // 只用于包装已有的QImage，不分配新内存
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+    {
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData *data, MatAccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override
+    {
+        return cv::Mat::getStdAllocator()->allocate(data, accessflags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData *data) const override
+    {
+        if (!data) {
+            return;
+        }
+        delete static_cast<QImage *>(data->userdata);
+        delete data;
+    }
+};
+
+// 拼接流水线的转换线程，与拼接线程同时运行
+class PixConvertThread : public QThread
+{
+public:
+    explicit PixConvertThread(PixMergeThread *mergeThread) : m_mergeThread(mergeThread) {}
+
+protected:
+    void run() override
+    {
+        m_mergeThread->convertTask();
+    }
+
+private:
+    PixMergeThread *m_mergeThread;
+};
 
 PixMergeThread::PixMergeThread(QObject *parent) : QThread(parent)
+    , m_longImagePreview(PREVIEW_MAX_HEIGHT)
 {
     m_lastTime = int(QDateTime::currentDateTime().toTime_t());
 }
@@ -34,57 +214,87 @@ PixMergeThread::~PixMergeThread()
 
 }
 
+//停止拼接，队列中未拼接的图片丢弃
 void PixMergeThread::stopTask()
 {
+    QMutexLocker locker(&m_Mutex);
     m_loopTask = false;
+    m_grabbedCondition.wakeAll();
+    m_queueCondition.wakeAll();
+    m_spaceCondition.wakeAll();
 }
 
-//滚动向上时添加
-void PixMergeThread::ScrollUpAddImg(const QPixmap &picture)
+//最后一张图片已加入队列，拼接完队列中的全部图片后结束线程，调用wait()即可等待拼接完成
+void PixMergeThread::finishTask()
 {
-    if (m_bottomHeight == -1) {
-        cv::Mat tempData = qPixmapToCvMat(picture);
-        m_bottomHeight = getBottomFixedHigh(m_curImg, tempData);
-        qDebug() << "计算出底部固定高度:" << m_bottomHeight;
-    }
-    QPair<QPixmap, PictureDirection> pair;
     QMutexLocker locker(&m_Mutex);
-    if (m_bottomHeight > 0) {
-        // 将图片底部固定区域裁剪掉后，加入拼接队列
-        pair.first = picture.copy(0, 0, picture.width(), m_bottomHeight);
-        pair.second = ScrollUp;
-        m_pixImgs.enqueue(pair);
-    } else {
-        pair.first = picture;
-        pair.second = ScrollUp;
-        m_pixImgs.enqueue(pair);
+    m_isQueueFinished = true;
+    m_grabbedCondition.wakeAll();
+}
+
+//滚动向上时转换图片
+cv::Mat PixMergeThread::trimScrollUpImg(const QImage &picture)
+{
+    cv::Mat frame = qImageToCvMat(picture);
+    int bottomHeight = -1;
+    {
+        // 拼接线程可能同时重置固定区域高度
+        QMutexLocker locker(&m_Mutex);
+        if (m_bottomHeight == -1) {
+            m_bottomHeight = getBottomFixedHigh(m_firstImg, frame);
+            qDebug() << "计算出底部固定高度:" << m_bottomHeight;
+        }
+        bottomHeight = m_bottomHeight;
     }
+    if (bottomHeight > 0) {
+        // 底部固定区域不参与拼接，只取图片上部的行区间，不拷贝
+        frame = frame.rowRange(0, qMin(bottomHeight, frame.rows));
+    }
+    return frame;
 }
 
-//滚动向下时添加
-void PixMergeThread::ScrollDwonAddImg(const QPixmap &picture)
+//滚动向下时转换图片
+cv::Mat PixMergeThread::trimScrollDownImg(const QImage &picture)
 {
-    if (m_headHeight == -1) {
-        cv::Mat tempData = qPixmapToCvMat(picture);
-        m_headHeight = getTopFixedHigh(m_curImg, tempData);
-        qDebug() << "计算出顶部固定高度:" << m_headHeight;
+    cv::Mat frame = qImageToCvMat(picture);
+    int headHeight = -1;
+    {
+        // 拼接线程可能同时重置固定区域高度
+        QMutexLocker locker(&m_Mutex);
+        if (m_headHeight == -1) {
+            m_headHeight = getTopFixedHigh(m_firstImg, frame);
+            qDebug() << "计算出顶部固定高度:" << m_headHeight;
+        }
+        headHeight = m_headHeight;
+    }
+    if (headHeight > 0) {
+        // 顶部固定区域不参与拼接，只取图片下部的行区间，不拷贝
+        frame = frame.rowRange(qMin(headHeight, frame.rows), frame.rows);
     }
-    QPair<QPixmap, PictureDirection> pair;
+    return frame;
+}
+
+//拼接线程请求转换线程重新计算固定区域高度
+void PixMergeThread::resetFixedHeight(PictureDirection direction)
+{
     QMutexLocker locker(&m_Mutex);
-    if (m_headHeight > 0) {
-        // 将图片顶部固定区域裁剪掉后，加入拼接队列
-        pair.first = picture.copy(0, m_headHeight, picture.width(), picture.height() - m_headHeight);
-        pair.second = ScrollDown;
-        m_pixImgs.enqueue(pair);
+    if (direction == ScrollDown) {
+        m_headHeight = -1;
     } else {
-        pair.first = picture;
-        pair.second = ScrollDown;
-        m_pixImgs.enqueue(pair);
+        m_bottomHeight = -1;
     }
 }
 
-void PixMergeThread::addShotImg(const QPixmap &picture, PictureDirection direction)
+//获取转换线程计算出的固定区域高度，未计算时为-1
+int PixMergeThread::fixedHeight(PictureDirection direction)
+{
+    QMutexLocker locker(&m_Mutex);
+    return (direction == ScrollDown) ? m_headHeight : m_bottomHeight;
+}
+
+void PixMergeThread::addShotImg(const QImage &picture, PictureDirection direction, int ticks)
 {
+    QMutexLocker locker(&m_Mutex);
     if (m_loopTask == false)
         return;
 
@@ -92,46 +302,197 @@ void PixMergeThread::addShotImg(const QPixmap &picture, PictureDirection directi
     ++m_ImageCount;
     qDebug() << "==========" << m_ImageCount;
 
-
-    if (m_curImg.empty()) {
-        m_curImg = qPixmapToCvMat(picture);
+    GrabbedImg grabbed;
+    grabbed.image = picture;
+    grabbed.direction = direction;
+    grabbed.ticks = ticks + m_droppedTicks;
+    if (m_isFirstImg) {
+        m_isFirstImg = false;
+        m_droppedTicks = 0;
+        m_grabTimer.start();
+        if (!isRunning()) {
+            // 线程未启动，直接作为长图的第一张图片
+            m_firstImg = qImageToCvMat(picture);
+            m_headHeight = -1;
+            m_bottomHeight = -1;
+            resetLongImage(m_firstImg);
+            return;
+        }
+        // 线程运行中，第一张图片经队列交给转换线程和拼接线程，GUI线程不访问长图
+        grabbed.isReset = true;
+        grabbed.ticks = 0;
+    } else if (isRunning() && m_grabbedImgs.size() >= PIPELINE_QUEUE_SIZE && !m_isLastPixmap.loadAcquire()) {
+        // 队列已满时丢弃新图片，不阻塞GUI线程；最后一张图片是保存的结果，始终加入队列
+        // 下一张图片与长图的重叠包含了丢弃的图片滚动的距离，滚轮事件数累加到下一张图片上
+        ++m_droppedCount;
+        m_droppedTicks = grabbed.ticks;
+        qWarning() << __FUNCTION__ << __LINE__ << "grabbed image queue is full, drop image, dropped:" << m_droppedCount;
         return;
     }
-    //将图片去除顶部或者底部的固定区域，放入图片队列
-    if (direction == ScrollDown) {
-        ScrollDwonAddImg(picture);
-    } else {
-        ScrollUpAddImg(picture);
-    }
+    m_droppedTicks = 0;
+    //放入抓取的图片队列，由转换线程去除顶部或者底部的固定区域
+    m_grabbedImgs.enqueue(grabbed);
+    m_grabbedCondition.wakeOne();
+}
 
+//转换线程：抓取的图片全部转换后结束，通知拼接线程
+void PixMergeThread::convertTask()
+{
+    int skippedTicks = 0; // 转换后为空、不参与拼接的图片的滚轮事件数，累加到下一张图片上
+    forever {
+        GrabbedImg grabbed;
+        {
+            QMutexLocker locker(&m_Mutex);
+            while (m_loopTask && !m_isQueueFinished && m_grabbedImgs.isEmpty()) {
+                m_grabbedCondition.wait(&m_Mutex);
+            }
+            if (!m_loopTask || m_grabbedImgs.isEmpty()) {
+                m_isConvertFinished = true;
+                m_queueCondition.wakeAll();
+                break;
+            }
+            grabbed = m_grabbedImgs.dequeue();
+        }
+        QElapsedTimer timer;
+        timer.start();
+        ConvertedImg converted;
+        converted.direction = grabbed.direction;
+        converted.isReset = grabbed.isReset;
+        converted.ticks = grabbed.isReset ? 0 : grabbed.ticks + skippedTicks;
+        skippedTicks = 0;
+        if (grabbed.isReset) {
+            // 重新开始拼接：第一张图片用于计算之后图片的固定区域，本身不去掉固定区域
+            m_firstImg = qImageToCvMat(grabbed.image);
+            converted.image = m_firstImg;
+        } else {
+            converted.image = (grabbed.direction == ScrollDown) ? trimScrollDownImg(grabbed.image) : trimScrollUpImg(grabbed.image);
+        }
+        const qint64 cost = timer.nsecsElapsed();
+
+        QMutexLocker locker(&m_Mutex);
+        if (converted.isReset) {
+            m_headHeight = -1;
+            m_bottomHeight = -1;
+        } else {
+            m_convertCost += cost;
+            ++m_convertCount;
+        }
+        // 拼接队列已满时等待拼接线程取走图片
+        while (m_loopTask && m_pixImgs.size() >= PIPELINE_QUEUE_SIZE) {
+            m_spaceCondition.wait(&m_Mutex);
+        }
+        if (converted.image.empty() && !converted.isReset) {
+            skippedTicks = converted.ticks;
+            continue;
+        }
+        m_pixImgs.enqueue(converted);
+        m_queueCondition.wakeOne();
+    }
 }
 
+//拼合长图，各条带直接并行拷贝到结果图片中
 QImage PixMergeThread::getMerageResult() const
 {
-    return  QImage(m_curImg.data, m_curImg.cols, m_curImg.rows, static_cast<int>(m_curImg.step), QImage::Format_ARGB32).copy();
+    if (m_longImage.isEmpty()) {
+        return QImage();
+    }
+    QImage result(m_longImage.cols(), m_longImage.rows(), QImage::Format_ARGB32);
+    if (result.isNull()) {
+        qWarning() << __FUNCTION__ << __LINE__ << "failed to allocate long image:" << m_longImage.cols() << "x" << m_longImage.rows();
+        return result;
+    }
+    cv::Mat dst(result.height(), result.width(), CV_8UC4, result.bits(), static_cast<size_t>(result.bytesPerLine()));
+    m_longImage.copyTo(dst);
+    return result;
+}
+
+//长图是否过大，不宜拼合为整张图片
+bool PixMergeThread::isLargeImage() const
+{
+    return m_longImage.rows() > LONG_IMG_STREAM_SAVE_HEIGHT;
+}
+
+//长图逐行写入PNG文件，不拼合整张图片
+bool PixMergeThread::saveMerageResult(const QString &fileName, int quality) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    const bool isSaved = m_longImage.savePng(fileName, quality);
+    qInfo() << __FUNCTION__ << __LINE__ << "save long image:" << m_longImage.cols() << "x" << m_longImage.rows()
+            << (isSaved ? "succeeded" : "failed") << ", cost:" << timer.elapsed() << "ms";
+    return isSaved;
 }
 
 void PixMergeThread::run()
 {
-    m_loopTask = true;
-    while (m_loopTask) {
-        while (!m_pixImgs.isEmpty()) {
-            QPair<QPixmap, PictureDirection> pair;
-            {
-                QMutexLocker locker(&m_Mutex);
-                pair = m_pixImgs.dequeue();
+    // 转换线程与拼接线程同时运行：拼接第N张图片时转换第N+1张图片
+    PixConvertThread convertThread(this);
+    convertThread.start();
+    forever {
+        ConvertedImg converted;
+        {
+            // 队列为空时等待新图片，不再定时轮询
+            QMutexLocker locker(&m_Mutex);
+            while (m_loopTask && !m_isConvertFinished && m_pixImgs.isEmpty()) {
+                m_queueCondition.wait(&m_Mutex);
             }
-            cv::Mat matImg = qPixmapToCvMat(pair.first);
-            if (mergeImageWork(matImg, pair.second)) {
-                // 更新预览图
-                emit updatePreviewImg(QImage(m_curImg.data, m_curImg.cols, m_curImg.rows,
-                                             static_cast<int>(m_curImg.step), QImage::Format_ARGB32));
+            // 停止拼接，或最后一张图片已拼接完成
+            if (!m_loopTask || m_pixImgs.isEmpty()) {
+                break;
             }
-
+            converted = m_pixImgs.dequeue();
+            m_spaceCondition.wakeAll();
+        }
+        if (converted.isReset) {
+            resetLongImage(converted.image);
+            continue;
         }
-        QThread::currentThread()->msleep(300);
+        QElapsedTimer timer;
+        timer.start();
+        const int oldRows = m_longImage.rows();
+        bool isMerged = mergeImageWork(converted.image, converted.direction);
+        const int addedRows = isMerged ? m_longImage.rows() - oldRows : 0;
+        int queueDepth = 0;
+        {
+            QMutexLocker locker(&m_Mutex);
+            m_mergeCost += timer.nsecsElapsed();
+            ++m_mergeCount;
+            m_mergedRows += addedRows;
+            queueDepth = m_grabbedImgs.size() + m_pixImgs.size();
+        }
+        emit mergeMeasured(isMerged, isMerged ? qreal(converted.image.rows - addedRows) / converted.image.rows : 0,
+                           converted.ticks, queueDepth);
+        qDebug() << "merge cost:" << timer.elapsed() << "ms, long image height:" << m_longImage.rows()
+                 << ", strips:" << m_longImage.stripCount() << ", spilled:" << m_longImage.spilledStripCount()
+                 << ", row hash matched:" << m_hashMatchCount << "/" << m_hashMatchCount + m_templateMatchCount;
+        cv::Mat rows;
+        int keepStart = 0;
+        int keepEnd = 0;
+        bool isPrepend = false;
+        // 预览图已在拼接时增量更新，只发送变化的行
+        if (isMerged && m_longImagePreview.takeChange(rows, keepStart, keepEnd, isPrepend)) {
+            emit updatePreviewImg(QImage(rows.data, rows.cols, rows.rows, static_cast<int>(rows.step),
+                                         QImage::Format_ARGB32).copy(),
+                                  keepStart, keepEnd, isPrepend, QSize(m_longImage.cols(), m_longImage.rows()));
+        }
+    }
+    convertThread.wait();
+    qInfo() << __FUNCTION__ << __LINE__ << "merge position found by row hash:" << m_hashMatchCount
+            << ", by template matching:" << m_templateMatchCount;
+    qint64 elapsed = 0;
+    unsigned int droppedCount = 0;
+    {
+        QMutexLocker locker(&m_Mutex);
+        elapsed = m_grabTimer.isValid() ? m_grabTimer.elapsed() : 0;
+        droppedCount = m_droppedCount;
     }
+    qInfo() << __FUNCTION__ << __LINE__ << "scroll shot pipeline: frames:" << m_mergeCount << ", dropped:" << droppedCount
+            << ", convert avg:" << (m_convertCount > 0 ? m_convertCost / m_convertCount / 1000 : 0) << "us"
+            << ", merge avg:" << (m_mergeCount > 0 ? m_mergeCost / m_mergeCount / 1000 : 0) << "us"
+            << ", actual scroll rate:" << (elapsed > 0 ? m_mergedRows * 1000 / elapsed : 0) << "rows/s"
+            << ", achievable scroll rate:" << qRound64(achievableScrollRate()) << "rows/s";
 }
+
 //设置是否为手动模式
 void PixMergeThread::setScrollModel(bool isManualScrollMode)
 {
@@ -139,9 +500,37 @@ void PixMergeThread::setScrollModel(bool isManualScrollMode)
     //m_lastTime = QDateTime::currentDateTime().toTime_t();
 }
 
+//清空长图：线程运行时丢弃尚未转换的图片，清空请求经队列交给拼接线程，GUI线程不访问长图
 void PixMergeThread::clearCurImg()
 {
-    m_curImg.release();
+    QMutexLocker locker(&m_Mutex);
+    m_isFirstImg = true;
+    m_droppedTicks = 0;
+    if (isRunning()) {
+        m_grabbedImgs.clear();
+        GrabbedImg grabbed;
+        grabbed.isReset = true;
+        m_grabbedImgs.enqueue(grabbed);
+        m_grabbedCondition.wakeOne();
+        return;
+    }
+    m_firstImg.release();
+    m_headHeight = -1;
+    m_bottomHeight = -1;
+    resetLongImage(cv::Mat());
+}
+
+//重新开始拼接，线程运行时只在拼接线程中调用
+void PixMergeThread::resetLongImage(const cv::Mat &image)
+{
+    if (image.empty()) {
+        m_longImage.clear();
+    } else {
+        m_longImage.reset(image);
+    }
+    m_longImagePreview.clear();
+    m_tailGray.release();
+    m_tailHashes.clear();
 }
 
 //计算时间差
@@ -162,18 +551,43 @@ bool PixMergeThread::isOneWay()
 // 设置最后一张图片标记
 void PixMergeThread::setIsLastImg(bool isLastImg)
 {
-    m_isLastPixmap = isLastImg;
+    m_isLastPixmap.storeRelease(isLastImg ? 1 : 0);
 }
 
-cv::Mat PixMergeThread::qPixmapToCvMat(const QPixmap &inPixmap)
+//抓取的图片队列已满：转换和拼接跟不上滚动，自动滚动时应暂缓滚动
+bool PixMergeThread::isPipelineFull()
 {
-    //qDebug() << inPixmap.toImage().format();
-    //if(QImage::Format_RGB32 == inPixmap.toImage().format()) {
-    QImage   swapped = inPixmap.toImage();
-    return cv::Mat(swapped.height(), swapped.width(), CV_8UC4, const_cast<uchar *>(swapped.bits()),
-                   static_cast<size_t>(swapped.bytesPerLine())).clone();
+    QMutexLocker locker(&m_Mutex);
+    return m_grabbedImgs.size() >= PIPELINE_QUEUE_SIZE;
+}
 
-    //}
+//流水线可达到的滚动速度（行/秒）：每张图片平均新增的行数除以转换和拼接中较慢一级的平均耗时
+qreal PixMergeThread::achievableScrollRate()
+{
+    QMutexLocker locker(&m_Mutex);
+    if (m_convertCount == 0 || m_mergeCount == 0) {
+        return 0;
+    }
+    const qreal stageCost = qMax(qreal(m_convertCost) / m_convertCount, qreal(m_mergeCost) / m_mergeCount);
+    if (stageCost <= 0) {
+        return 0;
+    }
+    return qreal(m_mergedRows) / m_mergeCount * 1e9 / stageCost;
+}
+
+//将QImage包装为cv::Mat，直接引用QImage的缓冲区，不拷贝
+cv::Mat PixMergeThread::qImageToCvMat(const QImage &inImage)
+{
+    QImage image = inImage;
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32
+            && image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+    if (image.isNull()) {
+        return cv::Mat();
+    }
+    static QImageMatAllocator allocator;
+    return allocator.wrap(image);
 }
 
 bool PixMergeThread::mergeImageWork(const cv::Mat &image, int imageStatus)
@@ -191,39 +605,33 @@ bool PixMergeThread::mergeImageWork(const cv::Mat &image, int imageStatus)
     }
 }
 
-int PixMergeThread::getTopFixedHigh(cv::Mat &img1, cv::Mat &img2)
+//顶部固定区域高度：新图片与长图开头从第一行起连续相同的行数
+int PixMergeThread::getTopFixedHigh(const cv::Mat &img1, const cv::Mat &img2)
 {
-    // 计算变化部分
-    for (int i = 0; i < img1.rows; ++i) {
-        for (int j = 0; j < img1.cols; ++j) {
-            if (img1.at<cv::Vec3b>(i, j) != img2.at<cv::Vec3b>(i, j)) {
-                return i;
-            }
-        }
+    const int count = qMin(img1.rows, img2.rows);
+    if (img1.cols != img2.cols || img1.type() != img2.type() || count <= 0) {
+        return 0;
     }
-    return 0;
+    const int sameRows = countSameRows(img1, img2, count, false);
+    // 全部相同说明页面没有滚动，无法区分固定区域
+    return sameRows < count ? sameRows : 0;
 }
-//裁剪底部固定区域
-int PixMergeThread::getBottomFixedHigh(cv::Mat &img1, cv::Mat &img2)
+//裁剪底部固定区域：返回新图片去掉底部固定区域后的高度
+int PixMergeThread::getBottomFixedHigh(const cv::Mat &img1, const cv::Mat &img2)
 {
-    int rowsCount = img2.rows - 1;
-    // 计算变化部分
-    for (int i = img1.rows - 1; i > 0; i--) {
-        for (int j = 0; j < img1.cols; ++j) {
-            if (img1.at<cv::Vec3b>(i, j) != img2.at<cv::Vec3b>(rowsCount, j)) {
-                return rowsCount;
-            }
-        }
-        --rowsCount;
+    const int count = qMin(img1.rows, img2.rows);
+    if (img1.cols != img2.cols || img1.type() != img2.type() || count <= 0) {
+        return 0;
     }
-    return 0;
+    const int sameRows = countSameRows(img1, img2, count, true);
+    return sameRows < count ? img2.rows - sameRows : 0;
 }
 
 //向上拼接图片
 bool PixMergeThread::splicePictureUp(const cv::Mat &image)
 {
     // 保存后的最后一张图片不做长度检查
-    if (!m_isLastPixmap && m_curImg.rows > LONG_IMG_MAX_HEIGHT) {
+    if (!m_isLastPixmap.loadAcquire() && m_longImage.rows() > LONG_IMG_MAX_HEIGHT) {
         // 拼接超过了最大限度
         emit merageError(MaxHeight);
         return false;
@@ -237,42 +645,54 @@ bool PixMergeThread::splicePictureUp(const cv::Mat &image)
     ++m_MeragerCount;
     qDebug() << "********m_MeragerCount******: " << m_MeragerCount;
     m_upCount++;
-    /*转灰度图像*/
-    cv::Mat image1_gray, image2_gray;
-    cvtColor(image, image1_gray, CV_BGR2GRAY);
-    cvtColor(m_curImg, image2_gray, CV_BGR2GRAY);
-    /*
-     * 取图像2的全部行，1到35列作为模板
-     * 这样image1作为原图，temp作为模板图像
-     */
-    cv::Mat temp = image1_gray(cv::Range(image.rows - TEMPLATE_HEIGHT, image.rows), cv::Range::all());
-    /*结果矩阵图像,大小，数据类型*/
-    cv::Mat res(image2_gray.rows - temp.rows + 1, image2_gray.cols - temp.cols + 1, CV_32FC1);
-    /*模板匹配，采用归一化相关系数匹配*/
-    matchTemplate(image2_gray, temp, res, CV_TM_CCOEFF_NORMED);
-    /*结果矩阵阈值化处理*/
-    threshold(res, res, 0.8, 1, CV_THRESH_TOZERO);
-    double minVal, maxVal, thresholdv = 0.8;
-
-    /*查找最大值及位置*/
-    cv::Point minLoc, maxLoc;
-    minMaxLoc(res, &minVal, &maxVal, &minLoc, &maxLoc);
-    /*图像拼接*/
-    cv::Mat temp1, result;
+    const int windowRows = qMin(m_longImage.rows(), image.rows * MATCH_WINDOW_FACTOR);
+    double maxVal = 0, thresholdv = 0.8;
+    cv::Point maxLoc;
+    int hashMatchRow = 0;
+    /*先用行哈希查找精确的重叠位置，图片不是整体平移时（如动画、抗锯齿）再进行模板匹配*/
+    if (findUpOverlapByRowHash(windowRows, image, hashMatchRow)) {
+        ++m_hashMatchCount;
+        maxVal = 1.0;
+        maxLoc.y = hashMatchRow;
+    } else {
+        ++m_templateMatchCount;
+        /*转灰度图像，长图只取开头的匹配窗口*/
+        cv::Mat image1_gray, image2_gray;
+        cvtColor(image, image1_gray, CV_BGR2GRAY);
+        cvtColor(m_longImage.rowRange(0, windowRows), image2_gray, CV_BGR2GRAY);
+        /*
+         * 取图像2的全部行，1到35列作为模板
+         * 这样image1作为原图，temp作为模板图像
+         */
+        cv::Mat temp = image1_gray(cv::Range(image.rows - TEMPLATE_HEIGHT, image.rows), cv::Range::all());
+        if (image2_gray.rows < temp.rows) {
+            emit merageError(Failed);
+            return false;
+        }
+        /*结果矩阵图像,大小，数据类型*/
+        cv::Mat res(image2_gray.rows - temp.rows + 1, image2_gray.cols - temp.cols + 1, CV_32FC1);
+        /*模板匹配，采用归一化相关系数匹配*/
+        matchTemplate(image2_gray, temp, res, CV_TM_CCOEFF_NORMED);
+        /*结果矩阵阈值化处理*/
+        threshold(res, res, 0.8, 1, CV_THRESH_TOZERO);
+        /*查找最大值及位置*/
+        double minVal;
+        cv::Point minLoc;
+        minMaxLoc(res, &minVal, &maxVal, &minLoc, &maxLoc);
+    }
+    /*图像拼接：新图片放在长图开头，长图去掉与新图片重叠的部分*/
     if (maxVal >= thresholdv && maxLoc.y > 0) { //只有度量值大于阈值才认为是匹配
-        result = cv::Mat::zeros(cvSize(image.cols, image.rows + m_curImg.rows - maxLoc.y - TEMPLATE_HEIGHT), image.type());
-        temp1 = m_curImg(cv::Rect(0, maxLoc.y + TEMPLATE_HEIGHT, m_curImg.cols, m_curImg.rows - maxLoc.y - TEMPLATE_HEIGHT));
-        image.copyTo(cv::Mat(result, cv::Rect(0, 0, image.cols, image.rows)));
-        temp1.copyTo(cv::Mat(result, cv::Rect(0, image.rows, temp1.cols, temp1.rows)));
-        if (result.rows == m_curImg.rows) {// 拼接前后图片高度不变
+        const int retainedStart = maxLoc.y + TEMPLATE_HEIGHT;
+        const int resultRows = image.rows + m_longImage.rows() - retainedStart;
+        if (resultRows == m_longImage.rows()) {// 拼接前后图片高度不变
             if (m_MeragerCount == 1) {
-                cv::Mat curImg = m_curImg;//拷贝不影响m_curImg
+                cv::Mat curImg = getCompareHead(image);
                 QRect rect = getScrollChangeRectArea(curImg, image);
                 if (rect.width() < 0 || rect.height() < 0) {
                     qDebug() << "1 拼接失败了";
                     emit merageError(Failed);
                 } else {
-                    m_bottomHeight = -1;
+                    resetFixedHeight(ScrollUp);
                     qDebug() << "1 无效区域，点击调整捕捉区域";
                     emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
                 }
@@ -286,22 +706,38 @@ bool PixMergeThread::splicePictureUp(const cv::Mat &image)
                 }*/
             }
             return false;
-        } else if (result.rows < m_curImg.rows) {
+        } else if (resultRows < m_longImage.rows()) {
             return false;
         }
         qDebug() << "拼接成功了";
         m_downCount = 0;
-        m_curImg = result;
+        // 尾部内容未变，只是整体下移，缓存跟随平移；缓存若包含被替换的行则失效
+        const bool tailGrayValid = isTailGrayValid() && m_tailGrayStart >= retainedStart;
+        const bool tailHashesValid = isTailHashesValid() && m_tailHashStart >= retainedStart;
+        m_longImage.prependAt(retainedStart, image);
+        m_longImagePreview.prependAt(m_longImage, retainedStart, image.rows);
+        if (tailGrayValid) {
+            m_tailGrayStart += image.rows - retainedStart;
+            m_tailGrayRevision = m_longImage.revision();
+        } else {
+            m_tailGray.release();
+        }
+        if (tailHashesValid) {
+            m_tailHashStart += image.rows - retainedStart;
+            m_tailHashRevision = m_longImage.revision();
+        } else {
+            m_tailHashes.clear();
+        }
         return true;
     } else {
         if (m_MeragerCount == 1) {
-            cv::Mat curImg = m_curImg;
+            cv::Mat curImg = getCompareHead(image);
             QRect rect = getScrollChangeRectArea(curImg, image);
             if (rect.width() < 0 || rect.height() < 0) {
                 qDebug() << "3 拼接失败了";
                 emit merageError(Failed);
             } else {
-                m_bottomHeight = -1;
+                resetFixedHeight(ScrollUp);
                 qDebug() << "2 无效区域，点击调整捕捉区域";
                 emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
             }
@@ -325,7 +761,7 @@ bool PixMergeThread::splicePictureUp(const cv::Mat &image)
 bool PixMergeThread::splicePictureDown(const cv::Mat &image)
 {
     // 保存后的最后一张图片不做长度检查
-    if (!m_isLastPixmap && m_curImg.rows > LONG_IMG_MAX_HEIGHT) {
+    if (!m_isLastPixmap.loadAcquire() && m_longImage.rows() > LONG_IMG_MAX_HEIGHT) {
         // 拼接超过了最大限度
         emit merageError(MaxHeight);
         return false;
@@ -337,38 +773,56 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
     ++m_MeragerCount;
     qDebug() << "**************m_MeragerCount: " << m_MeragerCount;
     m_downCount++;
-    /*转灰度图像*/
-    cv::Mat image1_gray, image2_gray;
-    cvtColor(m_curImg, image1_gray, CV_BGR2GRAY);
-    cvtColor(image, image2_gray, CV_BGR2GRAY);
-    //imwrite("m_curImg.png",m_curImg);
-    //imwrite("image.png",image);
-    /*
-     * 取图像2的全部行，1到35列作为模板
-     * 这样image1作为原图，temp作为模板图像
-     */
-    cv::Mat temp = image2_gray(cv::Range(0, TEMPLATE_HEIGHT), cv::Range::all());
-    /*结果矩阵图像,大小，数据类型*/
-    cv::Mat res(image1_gray.rows - temp.rows + 1, image2_gray.cols - temp.cols + 1, CV_32FC1);
-    /*模板匹配，采用归一化相关系数匹配*/
-    matchTemplate(image1_gray, temp, res, CV_TM_CCOEFF_NORMED);
-    /*结果矩阵阈值化处理*/
-    threshold(res, res, 0.8, 1, CV_THRESH_TOZERO);
-    double minVal, maxVal, thresholdv = 0.8;
-
-    /*查找最大值及位置*/
-    cv::Point minLoc, maxLoc;
-    minMaxLoc(res, &minVal, &maxVal, &minLoc, &maxLoc);
-    /*图像拼接*/
-    cv::Mat temp1, result;
+    const int windowRows = qMin(m_longImage.rows(), image.rows * MATCH_WINDOW_FACTOR);
+    const int windowStart = m_longImage.rows() - windowRows;
+    double maxVal = 0, thresholdv = 0.8;
+    cv::Point maxLoc;
+    cv::Mat image2_gray;
+    int hashMatchRow = 0;
+    // 新图片各行的哈希，拼接成功后追加到尾部行哈希缓存
+    std::vector<quint64> imageHashes;
+    if (image.cols == m_longImage.cols() && image.type() == m_longImage.type()) {
+        hashMatRows(image, imageHashes);
+    }
+    /*先用行哈希查找精确的重叠位置，图片不是整体平移时（如动画、抗锯齿）再进行模板匹配*/
+    if (findDownOverlapByRowHash(windowStart, imageHashes, hashMatchRow)) {
+        ++m_hashMatchCount;
+        maxVal = 1.0;
+        maxLoc.y = hashMatchRow;
+    } else {
+        ++m_templateMatchCount;
+        /*转灰度图像，长图只取尾部匹配窗口，使用缓存的灰度图*/
+        cv::Mat image1_gray = getTailGray(windowRows);
+        cvtColor(image, image2_gray, CV_BGR2GRAY);
+        //imwrite("m_curImg.png",m_curImg);
+        //imwrite("image.png",image);
+        /*
+         * 取图像2的全部行，1到35列作为模板
+         * 这样image1作为原图，temp作为模板图像
+         */
+        cv::Mat temp = image2_gray(cv::Range(0, TEMPLATE_HEIGHT), cv::Range::all());
+        if (image1_gray.rows < temp.rows) {
+            emit merageError(Failed);
+            return false;
+        }
+        /*结果矩阵图像,大小，数据类型*/
+        cv::Mat res(image1_gray.rows - temp.rows + 1, image2_gray.cols - temp.cols + 1, CV_32FC1);
+        /*模板匹配，采用归一化相关系数匹配*/
+        matchTemplate(image1_gray, temp, res, CV_TM_CCOEFF_NORMED);
+        /*结果矩阵阈值化处理*/
+        threshold(res, res, 0.8, 1, CV_THRESH_TOZERO);
+        /*查找最大值及位置*/
+        double minVal;
+        cv::Point minLoc;
+        minMaxLoc(res, &minVal, &maxVal, &minLoc, &maxLoc);
+        // 窗口内的行号转换为长图中的行号
+        maxLoc.y += windowStart;
+    }
+    /*图像拼接：长图保留匹配位置之前的部分，其后追加新图片*/
     if (maxVal >= thresholdv && maxLoc.y > 0) { //只有度量值大于阈值才认为是匹配
-        result = cv::Mat::zeros(cvSize(m_curImg.cols, maxLoc.y + image.rows), m_curImg.type());
-        temp1 = m_curImg(cv::Rect(0, 0, m_curImg.cols, maxLoc.y));
-        /*将图1的非模板部分和图2拷贝到result*/
-        temp1.copyTo(cv::Mat(result, cv::Rect(0, 0, m_curImg.cols, maxLoc.y)));
-        image.copyTo(cv::Mat(result, cv::Rect(0, maxLoc.y, image.cols, image.rows)));
-        if (result.rows == m_curImg.rows) {// 拼接前后图片高度不变
-            cv::Mat curImg = m_curImg;
+        const int resultRows = maxLoc.y + image.rows;
+        if (resultRows == m_longImage.rows()) {// 拼接前后图片高度不变
+            cv::Mat curImg = getCompareHead(image);
             QRect rect = getScrollChangeRectArea(curImg, image);
             if (m_isManualScrollModel == false) { //自动滚动时异常处理
                 if (m_MeragerCount == 1) {
@@ -376,7 +830,7 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
                         qDebug() << "1 拼接失败了";
                         emit merageError(Failed);
                     } else {
-                        m_headHeight = -1;
+                        resetFixedHeight(ScrollDown);
                         qDebug() << "1 无效区域，点击调整捕捉区域";
                         emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
                     }
@@ -390,7 +844,7 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
                         qDebug() << "1 拼接失败了";
                         emit merageError(Failed);
                     } else {
-                        m_headHeight = -1;
+                        resetFixedHeight(ScrollDown);
                         qDebug() << "1 无效区域，点击调整捕捉区域";
                         emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
                     }
@@ -405,16 +859,30 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
                 }
             }
             return false;
-        } else if (result.rows < m_curImg.rows) {
-            qDebug() << "===result.rows < m_curImg.rows";
+        } else if (resultRows < m_longImage.rows()) {
+            qDebug() << "===result.rows < m_longImage.rows";
             return false;
         }
         qDebug() << "拼接成功了";
         m_upCount = 0;
-        m_curImg = result;
+        const bool tailGrayValid = isTailGrayValid();
+        const bool tailHashesValid = isTailHashesValid();
+        m_longImage.appendAt(maxLoc.y, image);
+        m_longImagePreview.appendAt(m_longImage, maxLoc.y);
+        if (image2_gray.empty()) {
+            // 行哈希匹配成功时没有计算灰度图，缓存在下次模板匹配时重新生成
+            m_tailGray.release();
+        } else {
+            updateTailGray(maxLoc.y, image2_gray, tailGrayValid);
+        }
+        if (imageHashes.empty()) {
+            m_tailHashes.clear();
+        } else {
+            updateTailHashes(maxLoc.y, imageHashes, tailHashesValid);
+        }
         return true;
     } else {
-        cv::Mat curImg = m_curImg;//拷贝不影响m_curImg
+        cv::Mat curImg = getCompareHead(image);
         QRect rect = getScrollChangeRectArea(curImg, image);
         if (m_isManualScrollModel == false) { //自动滚动异常处理
             if (m_MeragerCount == 1) {
@@ -422,7 +890,7 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
                     qDebug() << "2 拼接到重复图片，拼接到低了";
                     emit merageError(ReachBottom);
                 } else {
-                    m_headHeight = -1;
+                    resetFixedHeight(ScrollDown);
                     qDebug() << "2 无效区域，点击调整捕捉区域";
                     emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
                 }
@@ -436,7 +904,7 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
                     qDebug() << "3 拼接失败了";
                     emit merageError(Failed);
                 } else {
-                    m_headHeight = -1;
+                    resetFixedHeight(ScrollDown);
                     qDebug() << "2 无效区域，点击调整捕捉区域";
                     emit invalidAreaError(InvalidArea, rect); //无效区域，点击调整捕捉区域
                 }
@@ -457,17 +925,172 @@ bool PixMergeThread::splicePictureDown(const cv::Mat &image)
     }
 }
 
+//长图尾部灰度图缓存是否有效
+bool PixMergeThread::isTailGrayValid() const
+{
+    return !m_tailGray.empty() && m_tailGrayRevision == m_longImage.revision();
+}
+
+//获取长图尾部窗口的灰度图
+cv::Mat PixMergeThread::getTailGray(int windowRows)
+{
+    const int start = m_longImage.rows() - windowRows;
+    if (!isTailGrayValid() || m_tailGrayStart > start) {
+        cv::Mat gray;
+        cvtColor(m_longImage.rowRange(start, m_longImage.rows()), gray, CV_BGR2GRAY);
+        m_tailGray = gray;
+        m_tailGrayStart = start;
+        m_tailGrayRevision = m_longImage.revision();
+    }
+    return m_tailGray.rowRange(start - m_tailGrayStart, m_tailGray.rows);
+}
+
+//向下拼接成功后更新尾部灰度图缓存：保留拼接位置之前的缓存行，追加新图片的灰度图，缓存高度不超过两张新图片
+//keepCache为拼接前缓存是否有效
+void PixMergeThread::updateTailGray(int mergeRow, const cv::Mat &imageGray, bool keepCache)
+{
+    int keepRows = 0;
+    if (keepCache && mergeRow > m_tailGrayStart) {
+        keepRows = qMin(mergeRow - m_tailGrayStart, imageGray.rows * (MATCH_WINDOW_FACTOR - 1));
+    }
+    if (keepRows > 0) {
+        const int keepEnd = mergeRow - m_tailGrayStart;
+        cv::Mat gray;
+        cv::vconcat(m_tailGray.rowRange(keepEnd - keepRows, keepEnd), imageGray, gray);
+        m_tailGray = gray;
+    } else {
+        m_tailGray = imageGray;
+    }
+    m_tailGrayStart = mergeRow - keepRows;
+    m_tailGrayRevision = m_longImage.revision();
+}
+
+//长图尾部行哈希缓存是否有效
+bool PixMergeThread::isTailHashesValid() const
+{
+    return !m_tailHashes.empty() && m_tailHashRevision == m_longImage.revision();
+}
+
+//获取长图尾部窗口各行的哈希，缓存未覆盖的行才计算哈希，返回窗口第一行的哈希
+const quint64 *PixMergeThread::getTailHashes(int windowStart)
+{
+    if (!isTailHashesValid()) {
+        m_tailHashes.clear();
+        m_tailHashStart = m_longImage.rows();
+    }
+    if (m_tailHashStart > windowStart) {
+        std::vector<const uchar *> rows;
+        std::vector<quint64> hashes;
+        m_longImage.rowPointers(windowStart, m_tailHashStart, rows);
+        hashRows(rows, m_longImage.cols() * CV_ELEM_SIZE(m_longImage.type()), hashes);
+        m_tailHashes.insert(m_tailHashes.begin(), hashes.begin(), hashes.end());
+        m_tailHashStart = windowStart;
+        m_tailHashRevision = m_longImage.revision();
+    }
+    return m_tailHashes.data() + (windowStart - m_tailHashStart);
+}
+
+//向下拼接成功后更新尾部行哈希缓存：与灰度图缓存相同，保留拼接位置之前的缓存行，追加新图片各行的哈希
+void PixMergeThread::updateTailHashes(int mergeRow, const std::vector<quint64> &imageHashes, bool keepCache)
+{
+    int keepRows = 0;
+    if (keepCache && mergeRow > m_tailHashStart) {
+        keepRows = qMin(mergeRow - m_tailHashStart, static_cast<int>(imageHashes.size()) * (MATCH_WINDOW_FACTOR - 1));
+    }
+    const int keepEnd = mergeRow - m_tailHashStart;
+    std::vector<quint64> hashes;
+    hashes.reserve(static_cast<size_t>(keepRows) + imageHashes.size());
+    if (keepRows > 0) {
+        hashes.insert(hashes.end(), m_tailHashes.begin() + (keepEnd - keepRows), m_tailHashes.begin() + keepEnd);
+    }
+    hashes.insert(hashes.end(), imageHashes.begin(), imageHashes.end());
+    m_tailHashes.swap(hashes);
+    m_tailHashStart = mergeRow - keepRows;
+    m_tailHashRevision = m_longImage.revision();
+}
+
+//向下滚动时通过行哈希查找精确的重叠位置：滚动截图的相邻图片通常只是整体平移，
+//长图尾部窗口中某一行起的全部行与新图片开头的行完全相同，且这样的位置唯一时，即为拼接位置
+//imageHashes为新图片各行的哈希，图片与长图宽度、格式不同时为空
+bool PixMergeThread::findDownOverlapByRowHash(int windowStart, const std::vector<quint64> &imageHashes, int &matchRow)
+{
+    if (imageHashes.empty()) {
+        return false;
+    }
+    const quint64 *windowHashes = getTailHashes(windowStart);
+    const int windowRows = m_longImage.rows() - windowStart;
+    const int imageRows = static_cast<int>(imageHashes.size());
+    int found = -1;
+    for (int y = 0; y + TEMPLATE_HEIGHT <= windowRows; ++y) {
+        const int overlap = qMin(windowRows - y, imageRows);
+        if (windowHashes[y] != imageHashes[0]
+                || !std::equal(windowHashes + y, windowHashes + y + overlap, imageHashes.begin())) {
+            continue;
+        }
+        if (found >= 0) {
+            // 多个位置完全相同（如大片空白），交给模板匹配
+            return false;
+        }
+        found = y;
+    }
+    if (found < 0) {
+        return false;
+    }
+    matchRow = windowStart + found;
+    return true;
+}
+
+//向上滚动时通过行哈希查找精确的重叠位置：长图开头的若干行与新图片末尾的行完全相同，且这样的位置唯一时，即为拼接位置
+//matchRow与模板匹配的结果含义相同，为新图片末尾TEMPLATE_HEIGHT行在长图中的位置
+bool PixMergeThread::findUpOverlapByRowHash(int windowRows, const cv::Mat &image, int &matchRow) const
+{
+    if (image.cols != m_longImage.cols() || image.type() != m_longImage.type()) {
+        return false;
+    }
+    const int rowBytes = image.cols * static_cast<int>(image.elemSize());
+    std::vector<const uchar *> rows;
+    std::vector<quint64> windowHashes, imageHashes;
+    m_longImage.rowPointers(0, windowRows, rows);
+    hashRows(rows, rowBytes, windowHashes);
+    hashMatRows(image, imageHashes);
+
+    const int maxOverlap = qMin(static_cast<int>(windowHashes.size()), image.rows);
+    int found = -1;
+    for (int overlap = TEMPLATE_HEIGHT; overlap <= maxOverlap; ++overlap) {
+        if (windowHashes[0] != imageHashes[static_cast<size_t>(image.rows - overlap)]
+                || !std::equal(windowHashes.begin(), windowHashes.begin() + overlap, imageHashes.end() - overlap)) {
+            continue;
+        }
+        if (found >= 0) {
+            return false;
+        }
+        found = overlap;
+    }
+    if (found < 0) {
+        return false;
+    }
+    matchRow = found - TEMPLATE_HEIGHT;
+    return true;
+}
+
+//获取长图开头用于计算滚动区域的部分，高度与新图片加顶部固定区域相同
+cv::Mat PixMergeThread::getCompareHead(const cv::Mat &image)
+{
+    return m_longImage.rowRange(0, qMin(m_longImage.rows(), image.rows + qMax(fixedHeight(ScrollDown), 0)));
+}
+
 //计算可以滚动的区域
 QRect PixMergeThread::getScrollChangeRectArea(cv::Mat &img1, const cv::Mat &img2)
 {
-    QImage tempImg = QImage(img1.data, img1.cols, img1.rows, static_cast<int>(img1.step), QImage::Format_ARGB32);
-    if (m_headHeight > 0) {
-        tempImg = tempImg.copy(0, m_headHeight, tempImg.width(), tempImg.height() - m_headHeight);
+    // 去掉顶部、底部固定区域，只取行区间，不拷贝
+    const int headHeight = fixedHeight(ScrollDown);
+    const int bottomHeight = fixedHeight(ScrollUp);
+    if (headHeight > 0) {
+        img1 = img1.rowRange(qMin(headHeight, img1.rows), img1.rows);
     }
-    if (m_bottomHeight > 0) {
-        tempImg = tempImg.copy(0, 0, tempImg.width(), m_bottomHeight);
+    if (bottomHeight > 0) {
+        img1 = img1.rowRange(0, qMin(bottomHeight, img1.rows));
     }
-    img1 = qPixmapToCvMat(QPixmap::fromImage(tempImg));
 
     int minI = img1.rows;
     int minJ = img1.cols;
@@ -486,7 +1109,7 @@ QRect PixMergeThread::getScrollChangeRectArea(cv::Mat &img1, const cv::Mat &img2
         }
     }
     qDebug() << "minJ: " << minJ << "minI:" << minI << "maxJ - minJ:" << maxJ - minJ << "maxI - minI" << maxI - minI;
-    return  QRect(minJ, minI + m_headHeight, maxJ - minJ, maxI - minI);
+    return  QRect(minJ, minI + headHeight, maxJ - minJ, maxI - minI);
 }
 
 
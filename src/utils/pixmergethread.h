@@ -22,20 +22,36 @@
 
 #include <QObject>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QWaitCondition>
 #include <QThread>
 #include <QPixmap>
 #include <QImage>
 #include <QQueue>
+#include <QElapsedTimer>
 #include <QDebug>
 
 #include<opencv2/opencv.hpp>
 
+#include <vector>
 
+#include "longimage.h"
+#include "longimagepreview.h"
+
+class PixConvertThread;
+
+/**
+ * @brief 滚动截图拼接线程
+ * 拼接分为三级流水线：GUI线程抓取图片，转换线程转换格式并去掉固定区域，拼接线程查找重叠位置并拼接。
+ * 各级之间的队列长度有限，抓取第N+1张图片、转换与拼接第N张图片同时进行；抓取的图片队列已满时丢弃新图片，GUI线程不等待。
+ * 线程运行时长图只由拼接线程修改，重新开始拼接（第一张图片、清空长图）的请求也通过队列传递
+ */
 class PixMergeThread : public QThread
 {
     Q_OBJECT
 
     Q_ENUMS(MergeErrorValue)
+    friend class PixConvertThread;
 public:
 
     enum MergeErrorValue {
@@ -54,8 +70,11 @@ public:
     explicit PixMergeThread(QObject *parent = nullptr);
     ~PixMergeThread();
     void stopTask();
-    void addShotImg(const QPixmap &picture, PictureDirection direction = ScrollDown);
+    void finishTask(); //最后一张图片已加入队列，拼接完队列中的图片后结束线程
+    void addShotImg(const QImage &picture, PictureDirection direction = ScrollDown, int ticks = 0); //ticks为截图前自动滚动的滚轮事件数
     QImage getMerageResult() const;
+    bool isLargeImage() const; //长图是否过大，不宜拼合为整张图片
+    bool saveMerageResult(const QString &fileName, int quality = -1) const; //长图逐行写入PNG文件，不拼合整张图片
     void run();
 
     //手动滚动时的函数处理
@@ -65,44 +84,123 @@ public:
     void calculateTimeDiff(int time); //计算时间差
     bool isOneWay(); //是否单向
     void setIsLastImg(bool isLastImg); //设置最后一张图片标记
+    bool isPipelineFull(); //抓取的图片队列已满，自动滚动时应暂缓滚动
+    qreal achievableScrollRate(); //流水线可达到的滚动速度（行/秒），由转换和拼接中较慢的一级决定
 protected:
-    cv::Mat qPixmapToCvMat(const QPixmap &inPixmap);
+    void convertTask(); //转换线程：将抓取的图片转换为cv::Mat并去掉固定区域，放入拼接队列
+    cv::Mat qImageToCvMat(const QImage &inImage); //将QImage包装为cv::Mat，共享缓冲区
     bool mergeImageWork(const cv::Mat &image, int imageStatus = ScrollDown);
-    int getTopFixedHigh(cv::Mat &img1, cv::Mat &img2);
+    int getTopFixedHigh(const cv::Mat &img1, const cv::Mat &img2); //计算顶部固定区域高度
 
     //手动滚动时的函数处理
-    int getBottomFixedHigh(cv::Mat &img1, cv::Mat &img2); //裁剪底部固定区域
+    int getBottomFixedHigh(const cv::Mat &img1, const cv::Mat &img2); //裁剪底部固定区域
     bool splicePictureUp(const cv::Mat &image);//向上拼接图片
     bool splicePictureDown(const cv::Mat &image);//向下拼接图片
     QRect getScrollChangeRectArea(cv::Mat &img1, const cv::Mat &img2);//计算可以滚动的区域
-    void ScrollUpAddImg(const QPixmap &picture); //滚动向上时添加
-    void ScrollDwonAddImg(const QPixmap &picture);//滚动向下时添加
+    cv::Mat getCompareHead(const cv::Mat &image); //获取长图开头用于计算滚动区域的部分
+    bool findDownOverlapByRowHash(int windowStart, const std::vector<quint64> &imageHashes, int &matchRow); //向下滚动时通过行哈希查找精确的重叠位置
+    bool findUpOverlapByRowHash(int windowRows, const cv::Mat &image, int &matchRow) const; //向上滚动时通过行哈希查找精确的重叠位置
+    bool isTailGrayValid() const; //长图尾部灰度图缓存是否有效
+    cv::Mat getTailGray(int windowRows); //获取长图尾部窗口的灰度图
+    void updateTailGray(int mergeRow, const cv::Mat &imageGray, bool keepCache); //向下拼接成功后更新尾部灰度图缓存
+    bool isTailHashesValid() const; //长图尾部行哈希缓存是否有效
+    const quint64 *getTailHashes(int windowStart); //获取长图尾部窗口各行的哈希
+    void updateTailHashes(int mergeRow, const std::vector<quint64> &imageHashes, bool keepCache); //向下拼接成功后更新尾部行哈希缓存
+    cv::Mat trimScrollUpImg(const QImage &picture); //滚动向上时转换图片，去掉底部固定区域
+    cv::Mat trimScrollDownImg(const QImage &picture);//滚动向下时转换图片，去掉顶部固定区域
+    void resetFixedHeight(PictureDirection direction); //拼接线程请求转换线程重新计算固定区域高度
+    int fixedHeight(PictureDirection direction); //获取固定区域高度，向下滚动为顶部，向上滚动为底部
+    void resetLongImage(const cv::Mat &image); //重新开始拼接，image为空时清空长图，否则作为长图的第一张图片
 signals:
     void merageError(MergeErrorValue state);
-    void updatePreviewImg(QImage img);
+    /**
+     * @brief 预览图变化，只包含变化的行
+     * 新的预览图 = isPrepend ? rows + 旧预览图[keepStart, keepEnd) : 旧预览图[keepStart, keepEnd) + rows，
+     * keepStart与keepEnd相等时rows为整张预览图；imageSize为长图实际大小
+     */
+    void updatePreviewImg(QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize);
     void invalidAreaError(MergeErrorValue state, QRect rect); //调整区域异常
+    /**
+     * @brief 一张图片拼接完成，用于调整自动滚动速度
+     * @param overlapRatio:新图片与长图重叠的行数占新图片高度的比例，拼接失败时为0
+     * @param ticks:上一张拼接的图片之后滚轮事件数，包括中途丢弃的图片的滚轮事件数
+     * @param queueDepth:流水线中等待转换和拼接的图片数
+     */
+    void mergeMeasured(bool isMerged, qreal overlapRatio, int ticks, int queueDepth);
 private:
+    // 抓取的图片，isReset为true时表示重新开始拼接，图片为空时只清空长图
+    struct GrabbedImg {
+        QImage image;
+        PictureDirection direction = ScrollDown;
+        bool isReset = false;
+        int ticks = 0; // 截图前自动滚动的滚轮事件数
+    };
+    // 转换后的图片，为去掉固定区域后的图片视图，引用抓取的QImage；重新开始拼接时为完整的第一张图片
+    struct ConvertedImg {
+        cv::Mat image;
+        PictureDirection direction = ScrollDown;
+        bool isReset = false;
+        int ticks = 0;
+    };
+
     QMutex m_Mutex;
+    QWaitCondition m_grabbedCondition; // 抓取的图片加入队列或线程需要结束时唤醒转换线程
+    QWaitCondition m_queueCondition; // 转换后的图片加入队列或线程需要结束时唤醒拼接线程
+    QWaitCondition m_spaceCondition; // 拼接队列取出图片后唤醒等待空位的转换线程
     bool m_loopTask = true;
-    cv::Mat m_curImg;
-    QQueue<QPair< QPixmap, PictureDirection >> m_pixImgs; //图片队列
+    bool m_isQueueFinished = false; // 最后一张图片已加入队列
+    bool m_isConvertFinished = false; // 抓取的图片已全部转换
+    LongImage m_longImage; // 拼接中的长图，以条带形式保存，保存时才拼合
+    LongImagePreview m_longImagePreview; // 长图的预览图，拼接时增量更新
+    cv::Mat m_firstImg; // 第一张图片，转换线程用于计算固定区域，不读取拼接中的长图
+    bool m_isFirstImg = true; // GUI线程使用：下一张抓取的图片作为长图的第一张图片
+    QQueue<GrabbedImg> m_grabbedImgs; //抓取的图片队列，等待转换
+    QQueue<ConvertedImg> m_pixImgs; //转换后的图片队列，等待拼接
+    unsigned int m_droppedCount = 0; // 抓取的图片队列已满时丢弃的图片数
+    int m_droppedTicks = 0; // 丢弃的图片的滚轮事件数，累加到下一张加入队列的图片上
     unsigned int m_ImageCount = 0;
     unsigned int m_MeragerCount = 0;
-    // 长图顶部固定区域高度
+    // 长图顶部固定区域高度，转换线程计算，拼接线程可重置为-1，需加锁读写
     int m_headHeight = -1;
     static const int LONG_IMG_MAX_HEIGHT;
+    static const int LONG_IMG_STREAM_SAVE_HEIGHT;
+    static const int PREVIEW_MAX_HEIGHT;
     static const int TEMPLATE_HEIGHT;
+    static const int MATCH_WINDOW_FACTOR;
+    static const int PIPELINE_QUEUE_SIZE;
+
+    // 流水线各级的耗时统计，用于计算可达到的滚动速度
+    QElapsedTimer m_grabTimer;          // 第一张图片抓取后开始计时
+    qint64 m_convertCost = 0;           // 转换耗时合计（纳秒）
+    qint64 m_mergeCost = 0;             // 拼接耗时合计（纳秒）
+    unsigned int m_convertCount = 0;
+    unsigned int m_mergeCount = 0;
+    qint64 m_mergedRows = 0;            // 拼接新增的行数合计
+
+    // 拼接位置的查找方式统计：行哈希精确匹配成功的次数，及需要模板匹配的次数
+    unsigned int m_hashMatchCount = 0;
+    unsigned int m_templateMatchCount = 0;
+
+    // 长图尾部窗口的灰度图缓存，模板匹配只在该窗口内进行，每次拼接耗时不随长图高度增长
+    cv::Mat m_tailGray;
+    int m_tailGrayStart = 0;                  // 缓存第一行在长图中的行号
+    quint64 m_tailGrayRevision = 0;           // 缓存对应的长图版本，长图变化后缓存失效
+
+    // 长图尾部窗口各行的哈希缓存，与灰度图缓存相同按长图版本失效，每次拼接只计算新图片各行的哈希
+    std::vector<quint64> m_tailHashes;
+    int m_tailHashStart = 0;                  // 缓存第一行在长图中的行号
+    quint64 m_tailHashRevision = 0;           // 缓存对应的长图版本
 
     //手动截图状态
     //bool m_successfullySplicedUp = false; //向上拼接成功
     //bool m_successfullySplicedDwon = false;//向下拼接成功
     bool m_isManualScrollModel = false;//是否手动模式
-    int m_bottomHeight = -1;// 长图底部固定区域高度
+    int m_bottomHeight = -1;// 长图底部固定区域高度，与m_headHeight相同需加锁读写
     int m_curTimeDiff = 0; //当前时间差
     int m_lastTime = 0;    //上一次的时间
     int m_upCount = 0;
     int m_downCount = 0;
-    bool m_isLastPixmap = false; // 是否是最后一张
+    QAtomicInt m_isLastPixmap; // 是否是最后一张，GUI线程设置，拼接线程读取
 };
 
 Q_DECLARE_METATYPE(PixMergeThread::MergeErrorValue);
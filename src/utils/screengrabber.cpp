@@ -25,6 +25,8 @@
 
 #include <QDBusInterface>
 #include <QDBusReply>
+#include <QDBusUnixFileDescriptor>
+#include <QElapsedTimer>
 #include <QDir>
 #include <QPixmap>
 #include <QScreen>
@@ -32,16 +34,281 @@
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QStandardPaths>
+#include <QDebug>
+#include <QtX11Extras/QX11Info>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+/**
+ * @brief MIT-SHM抓图上下文，共享内存段按请求过的最大尺寸分配，之后一直复用
+ */
+struct ScreenGrabber::XShmContext {
+    Display *display = nullptr;
+    XImage *ximage = nullptr;
+    XShmSegmentInfo shmInfo;
+    size_t segmentSize = 0;
+};
+
+static bool s_xshmErrorOccurred = false;
+
+// 远程显示等场景下XShmAttach/XShmGetImage会异步报错，默认的错误处理会直接退出进程
+static int xshmErrorHandler(Display *, XErrorEvent *)
+{
+    s_xshmErrorOccurred = true;
+    return 0;
+}
 
 ScreenGrabber::ScreenGrabber(QObject *parent) : QObject(parent)
 {
 
 }
 
+ScreenGrabber::~ScreenGrabber()
+{
+    releaseXShm();
+}
+
+void ScreenGrabber::releaseXShm()
+{
+    if (!m_shmContext)
+        return;
+    if (m_shmContext->ximage) {
+        // data指向共享内存段，不能由XDestroyImage释放
+        m_shmContext->ximage->data = nullptr;
+        XDestroyImage(m_shmContext->ximage);
+        m_shmContext->ximage = nullptr;
+    }
+    if (m_shmContext->segmentSize > 0) {
+        XShmDetach(m_shmContext->display, &m_shmContext->shmInfo);
+        XSync(m_shmContext->display, False);
+        shmdt(m_shmContext->shmInfo.shmaddr);
+        m_shmContext->segmentSize = 0;
+    }
+    delete m_shmContext;
+    m_shmContext = nullptr;
+}
+
+bool ScreenGrabber::grabByXShm(const QRect &nativeRect, QImage &image)
+{
+    if (m_shmUnavailable || nativeRect.isEmpty())
+        return false;
+
+    if (!m_shmContext) {
+        Display *display = QX11Info::display();
+        if (!display || !XShmQueryExtension(display)) {
+            qWarning() << "MIT-SHM extension is not available, fallback to grabWindow";
+            m_shmUnavailable = true;
+            return false;
+        }
+        m_shmContext = new XShmContext;
+        m_shmContext->display = display;
+    }
+
+    Display *display = m_shmContext->display;
+    const int screen = DefaultScreen(display);
+    const unsigned int width = static_cast<unsigned int>(nativeRect.width());
+    const unsigned int height = static_cast<unsigned int>(nativeRect.height());
+
+    // 尺寸变化时只重建XImage描述，共享内存段不够大时才重新分配
+    XImage *ximage = m_shmContext->ximage;
+    if (!ximage || ximage->width != nativeRect.width() || ximage->height != nativeRect.height()) {
+        if (ximage) {
+            ximage->data = nullptr;
+            XDestroyImage(ximage);
+        }
+        ximage = XShmCreateImage(display, DefaultVisual(display, screen), static_cast<unsigned int>(DefaultDepth(display, screen)),
+                                 ZPixmap, nullptr, &m_shmContext->shmInfo, width, height);
+        m_shmContext->ximage = ximage;
+        if (!ximage || ximage->bits_per_pixel != 32) {
+            qWarning() << "MIT-SHM image format is not supported, fallback to grabWindow";
+            releaseXShm();
+            m_shmUnavailable = true;
+            return false;
+        }
+
+        const size_t requiredSize = static_cast<size_t>(ximage->bytes_per_line) * height;
+        if (requiredSize > m_shmContext->segmentSize) {
+            if (m_shmContext->segmentSize > 0) {
+                XShmDetach(display, &m_shmContext->shmInfo);
+                XSync(display, False);
+                shmdt(m_shmContext->shmInfo.shmaddr);
+                m_shmContext->segmentSize = 0;
+            }
+            m_shmContext->shmInfo.shmid = shmget(IPC_PRIVATE, requiredSize, IPC_CREAT | 0600);
+            if (m_shmContext->shmInfo.shmid < 0) {
+                qWarning() << "shmget failed, fallback to grabWindow";
+                releaseXShm();
+                m_shmUnavailable = true;
+                return false;
+            }
+            m_shmContext->shmInfo.shmaddr = static_cast<char *>(shmat(m_shmContext->shmInfo.shmid, nullptr, 0));
+            // 标记删除，所有进程分离后由内核回收，避免异常退出时遗留共享内存
+            shmctl(m_shmContext->shmInfo.shmid, IPC_RMID, nullptr);
+            if (m_shmContext->shmInfo.shmaddr == reinterpret_cast<char *>(-1)) {
+                qWarning() << "shmat failed, fallback to grabWindow";
+                releaseXShm();
+                m_shmUnavailable = true;
+                return false;
+            }
+            m_shmContext->shmInfo.readOnly = False;
+            s_xshmErrorOccurred = false;
+            XErrorHandler oldHandler = XSetErrorHandler(xshmErrorHandler);
+            const bool attached = XShmAttach(display, &m_shmContext->shmInfo);
+            XSync(display, False);
+            XSetErrorHandler(oldHandler);
+            if (!attached || s_xshmErrorOccurred) {
+                qWarning() << "XShmAttach failed, fallback to grabWindow";
+                shmdt(m_shmContext->shmInfo.shmaddr);
+                releaseXShm();
+                m_shmUnavailable = true;
+                return false;
+            }
+            m_shmContext->segmentSize = requiredSize;
+        }
+        ximage->data = m_shmContext->shmInfo.shmaddr;
+    }
+
+    s_xshmErrorOccurred = false;
+    XErrorHandler oldHandler = XSetErrorHandler(xshmErrorHandler);
+    const bool grabbed = XShmGetImage(display, DefaultRootWindow(display), ximage, nativeRect.x(), nativeRect.y(), AllPlanes);
+    XSetErrorHandler(oldHandler);
+    if (!grabbed || s_xshmErrorOccurred) {
+        qWarning() << "XShmGetImage failed, fallback to grabWindow";
+        return false;
+    }
+
+    uchar *data = reinterpret_cast<uchar *>(ximage->data);
+    // 24位深度时填充字节不保证为0xff，Format_RGB32要求alpha为0xff
+    if (ximage->depth == 24) {
+        for (int y = 0; y < ximage->height; ++y) {
+            quint32 *line = reinterpret_cast<quint32 *>(data + y * ximage->bytes_per_line);
+            for (int x = 0; x < ximage->width; ++x)
+                line[x] |= 0xff000000;
+        }
+    }
+    image = QImage(data, ximage->width, ximage->height, ximage->bytes_per_line,
+                   ximage->depth == 32 ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    return true;
+}
+
+QImage ScreenGrabber::grabEntireDesktopImage(bool &ok, const QRect &rect, const qreal devicePixelRatio)
+{
+    if (Utils::isWaylandMode) {
+        return grabEntireDesktop(ok, rect, devicePixelRatio).toImage();
+    }
+
+    ok = true;
+    QScreen *t_primaryScreen = QGuiApplication::primaryScreen();
+    // 与QScreen::grabWindow保持一致，按屏幕缩放比例换算到物理像素
+    const qreal ratio = t_primaryScreen->devicePixelRatio();
+    const QRect nativeRect(qRound(rect.x() * ratio), qRound(rect.y() * ratio),
+                           qRound(rect.width() * ratio), qRound(rect.height() * ratio));
+    QImage image;
+    if (grabByXShm(nativeRect, image)) {
+        image.setDevicePixelRatio(ratio);
+        return image;
+    }
+    // 在多屏模式下, winId 不是0
+    return t_primaryScreen->grabWindow(QApplication::desktop()->winId(), rect.x(), rect.y(), rect.width(), rect.height()).toImage();
+}
+
+QImage ScreenGrabber::grabDetachedDesktopImage(bool &ok, const QRect &rect, const qreal devicePixelRatio)
+{
+    QImage image = grabEntireDesktopImage(ok, rect, devicePixelRatio);
+    // 共享内存段会被下一次抓图复用，需拷贝一份；其余方式抓取的图像已持有自己的数据
+    if (m_shmContext && m_shmContext->segmentSize > 0
+            && image.constBits() == reinterpret_cast<const uchar *>(m_shmContext->shmInfo.shmaddr)) {
+        return image.copy();
+    }
+    return image;
+}
+
+bool ScreenGrabber::grabByKWinScreenShot2(const QRect &rect, QImage &image)
+{
+    if (m_screenShot2Unavailable || rect.isEmpty())
+        return false;
+
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+        qWarning() << "create pipe failed, fallback to screenshotFullscreen";
+        return false;
+    }
+
+    QDBusInterface screenShot2Interface(QStringLiteral("org.kde.KWin"),
+                                        QStringLiteral("/org/kde/KWin/ScreenShot2"),
+                                        QStringLiteral("org.kde.KWin.ScreenShot2"));
+    QVariantMap options;
+    options.insert(QStringLiteral("native-resolution"), true);
+    options.insert(QStringLiteral("include-cursor"), false);
+    // 只截取需要的区域，不再截全屏后裁剪
+    QDBusReply<QVariantMap> reply = screenShot2Interface.call(QStringLiteral("CaptureArea"),
+                                                              rect.x(), rect.y(),
+                                                              static_cast<uint>(rect.width()), static_cast<uint>(rect.height()),
+                                                              options, QVariant::fromValue(QDBusUnixFileDescriptor(pipeFds[1])));
+    // QDBusUnixFileDescriptor内部持有副本，写端在本进程内不再需要，关闭后KWin写完即可读到EOF
+    close(pipeFds[1]);
+    if (!reply.isValid()) {
+        qWarning() << "KWin ScreenShot2 is not available:" << reply.error().message() << ", fallback to screenshotFullscreen";
+        close(pipeFds[0]);
+        m_screenShot2Unavailable = true;
+        return false;
+    }
+
+    const QVariantMap results = reply.value();
+    const int width = results.value(QStringLiteral("width")).toInt();
+    const int height = results.value(QStringLiteral("height")).toInt();
+    const int stride = results.value(QStringLiteral("stride")).toInt();
+    const QImage::Format format = static_cast<QImage::Format>(results.value(QStringLiteral("format")).toUInt());
+    if (results.value(QStringLiteral("type")).toString() != QStringLiteral("raw") || width <= 0 || height <= 0
+            || stride < width * 4 || format == QImage::Format_Invalid) {
+        qWarning() << "KWin ScreenShot2 returned unsupported image:" << results;
+        close(pipeFds[0]);
+        m_screenShot2Unavailable = true;
+        return false;
+    }
+
+    // 按KWin给出的stride直接读入图像内存，由QImage接管释放，不再经过PNG编解码
+    const size_t expectedSize = static_cast<size_t>(stride) * static_cast<size_t>(height);
+    uchar *data = new uchar[expectedSize];
+    size_t readSize = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (readSize < expectedSize && timer.elapsed() < 2000) {
+        pollfd pfd{pipeFds[0], POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+        const ssize_t n = read(pipeFds[0], data + readSize, expectedSize - readSize);
+        if (n <= 0)
+            break;
+        readSize += static_cast<size_t>(n);
+    }
+    close(pipeFds[0]);
+    if (readSize != expectedSize) {
+        qWarning() << "KWin ScreenShot2 read image data failed:" << readSize << "/" << expectedSize;
+        delete [] data;
+        return false;
+    }
+    image = QImage(data, width, height, stride, format, [](void *info) {
+        delete [] static_cast<uchar *>(info);
+    }, data);
+    return true;
+}
+
 QPixmap ScreenGrabber::grabEntireDesktop(bool &ok, const QRect &rect, const qreal devicePixelRatio)
 {
     ok = true;
     if (Utils::isWaylandMode) {
+        QImage image;
+        if (grabByKWinScreenShot2(rect, image))
+            return QPixmap::fromImage(image);
+
         QRect recordRect{
             static_cast<int>(rect.x() * devicePixelRatio),
             static_cast<int>(rect.y() * devicePixelRatio),
@@ -63,7 +330,6 @@ QPixmap ScreenGrabber::grabEntireDesktop(bool &ok, const QRect &rect, const qrea
         return res.copy(recordRect);
     }
 
-    QScreen *t_primaryScreen = QGuiApplication::primaryScreen();
-    // 在多屏模式下, winId 不是0
-    return t_primaryScreen->grabWindow(QApplication::desktop()->winId(), rect.x(), rect.y(), rect.width(), rect.height());
+    // 共享内存段会被下一次抓图复用，转换为QPixmap时会拷贝一份
+    return QPixmap::fromImage(grabEntireDesktopImage(ok, rect, devicePixelRatio));
 }
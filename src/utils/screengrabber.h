@@ -23,13 +23,64 @@
 #define SCREENGRABBER_H
 
 #include <QObject>
+#include <QImage>
 
 class ScreenGrabber : public QObject
 {
     Q_OBJECT
 public:
     explicit ScreenGrabber(QObject *parent = nullptr);
+    ~ScreenGrabber();
     QPixmap grabEntireDesktop(bool &ok, const QRect &rect, const qreal devicePixelRatio);
+    /**
+     * @brief grabEntireDesktopImage 抓取桌面指定区域的图像
+     * x11下优先使用MIT-SHM共享内存抓图，返回的QImage直接引用共享内存段，不做拷贝，
+     * 该内存段在下一次抓图时会被复用，因此调用方需在下一次抓图前使用完毕或自行copy()
+     * @param ok 是否抓取成功
+     * @param rect 抓取区域(逻辑坐标)
+     * @param devicePixelRatio 缩放比例
+     * @return
+     */
+    QImage grabEntireDesktopImage(bool &ok, const QRect &rect, const qreal devicePixelRatio);
+    /**
+     * @brief grabDetachedDesktopImage 抓取桌面指定区域的图像，返回的QImage持有自己的数据
+     * 与grabEntireDesktopImage相同，只在图像引用共享内存段时拷贝一次，调用方可长期持有（如滚动截图的拼接队列）
+     * @param ok 是否抓取成功
+     * @param rect 抓取区域(逻辑坐标)
+     * @param devicePixelRatio 缩放比例
+     * @return
+     */
+    QImage grabDetachedDesktopImage(bool &ok, const QRect &rect, const qreal devicePixelRatio);
+
+private:
+    /**
+     * @brief grabByXShm 通过MIT-SHM抓取根窗口的物理像素区域
+     * @param nativeRect 物理像素区域
+     * @param image 输出的图像，引用共享内存段
+     * @return 共享内存不可用或抓取失败时返回false
+     */
+    bool grabByXShm(const QRect &nativeRect, QImage &image);
+    /**
+     * @brief releaseXShm 释放共享内存段
+     */
+    void releaseXShm();
+
+    /**
+     * @brief grabByKWinScreenShot2 wayland下通过KWin的ScreenShot2接口抓取指定区域
+     * KWin按区域截图后通过管道直接写入原始像素数据，不再编码为PNG临时文件
+     * @param rect 抓取区域(逻辑坐标)
+     * @param image 输出的图像(物理像素)
+     * @return 接口不可用或抓取失败时返回false
+     */
+    bool grabByKWinScreenShot2(const QRect &rect, QImage &image);
+
+private:
+    struct XShmContext;
+    XShmContext *m_shmContext = nullptr;
+    // 共享内存扩展不可用时不再重复尝试
+    bool m_shmUnavailable = false;
+    // KWin不支持ScreenShot2接口（或无权限）时不再重复尝试
+    bool m_screenShot2Unavailable = false;
 };
 
 #endif // SCREENGRABBER_H
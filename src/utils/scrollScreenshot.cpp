@@ -21,7 +21,6 @@
 
 #include <QDebug>
 #include <QDateTime>
-#include <QEventLoop>
 #include <X11/Xlibint.h>
 #include <X11/extensions/XTest.h>
 
@@ -37,6 +36,11 @@ ScrollScreenshot::ScrollScreenshot(QObject *parent)  : QObject(parent)
 }
     m_mouseWheelTimer = new QTimer(this);
     connect(m_mouseWheelTimer, &QTimer::timeout, this, [ = ] {
+        // 转换和拼接跟不上滚动时暂缓滚动，等待流水线取走抓取的图片
+        if (m_PixMerageThread->isPipelineFull())
+        {
+            return;
+        }
         if (!Utils::isWaylandMode)
         {
             // 发送滚轮事件， 自动滚动
@@ -53,20 +57,20 @@ ScrollScreenshot::ScrollScreenshot(QObject *parent)  : QObject(parent)
 
         //当模拟鼠标进行自动滚动时，会发射此信号
         emit autoScroll(m_autoScrollFlag++);
-        // 滚动区域高度 200-300 取值2
-        // 滚动区域高度 > 300  取值 3
-        // 滚动区域高度 > 600  取值 5
-        m_scrollCount++;
-        if (m_scrollCount % m_shotFrequency == 0)
+        // 每发送若干次滚轮事件截图一次，次数由滚动速度控制根据拼接的重叠比例调整
+        const int ticks = m_autoScrollController.wheelTicked();
+        if (ticks > 0)
         {
+            m_grabTicks = ticks;
             emit getOneImg();
         }
     });
 
     m_PixMerageThread = new PixMergeThread(this);
-    connect(m_PixMerageThread, SIGNAL(updatePreviewImg(QImage)), this, SIGNAL(updatePreviewImg(QImage)));
+    connect(m_PixMerageThread, SIGNAL(updatePreviewImg(QImage, int, int, bool, QSize)), this, SIGNAL(updatePreviewImg(QImage, int, int, bool, QSize)));
     connect(m_PixMerageThread, SIGNAL(merageError(PixMergeThread::MergeErrorValue)), this, SLOT(merageImgState(PixMergeThread::MergeErrorValue)));
     connect(m_PixMerageThread, &PixMergeThread::invalidAreaError, this, &ScrollScreenshot::merageInvalidArea);
+    connect(m_PixMerageThread, &PixMergeThread::mergeMeasured, this, &ScrollScreenshot::adjustAutoScrollSpeed);
 #ifdef KF5_WAYLAND_FLAGE_ON
     connect(this, &ScrollScreenshot::sigalWheelScrolling, m_WaylandScrollMonitor, &WaylandScrollMonitor::slotManualScroll);
 #endif
@@ -82,7 +86,7 @@ ScrollScreenshot::~ScrollScreenshot()
     }
 }
 
-void ScrollScreenshot::addPixmap(const QPixmap &piximg, int wheelDirection)
+void ScrollScreenshot::addPixmap(const QImage &piximg, int wheelDirection)
 {
     if (m_startPixMerageThread == false) {
         m_PixMerageThread->start();
@@ -91,12 +95,16 @@ void ScrollScreenshot::addPixmap(const QPixmap &piximg, int wheelDirection)
     m_PixMerageThread->setScrollModel(m_isManualScrollModel);
     if (m_isManualScrollModel == false) {//自动
         if (m_curStatus == Wait) {
-            m_mouseWheelTimer->start(300);
+            m_autoScrollController.reset();
+            m_grabTicks = 0;
+            m_mouseWheelTimer->start(m_autoScrollController.interval());
             m_curStatus = Merging;
         }
         if (m_curStatus == Merging) {
             m_lastDirection = PixMergeThread::PictureDirection::ScrollDown; // 记录滚动方向
-            m_PixMerageThread->addShotImg(piximg, PixMergeThread::PictureDirection::ScrollDown);
+            // 滚轮事件数随图片传递，拼接完成后用于估计滚动高度
+            m_PixMerageThread->addShotImg(piximg, PixMergeThread::PictureDirection::ScrollDown, m_grabTicks);
+            m_grabTicks = 0;
         }
     } else if (m_isManualScrollModel == true) {//手动
         //qDebug() << "function piximg is null: " << __func__ << " ,line: " << __LINE__;
@@ -107,7 +115,7 @@ void ScrollScreenshot::addPixmap(const QPixmap &piximg, int wheelDirection)
     }
 }
 
-void ScrollScreenshot::addLastPixmap(const QPixmap &piximg)
+void ScrollScreenshot::addLastPixmap(const QImage &piximg)
 {
     setTimeAndCalculateTimeDiff(static_cast<int>(QDateTime::currentDateTime().toTime_t()));
     m_PixMerageThread->setIsLastImg(true); //添加最后一张图片标记
@@ -132,22 +140,36 @@ void ScrollScreenshot::changeState(const bool isStop)
     // 开始
     if (!isStop && m_curStatus == Stop) {
         m_curStatus = Merging;
-        m_mouseWheelTimer->start(300);
+        m_mouseWheelTimer->start(m_autoScrollController.interval());
     }
 }
-QImage ScrollScreenshot::savePixmap()
+QImage ScrollScreenshot::savePixmap(bool streamLargeImage)
 {
     m_mouseWheelTimer->stop();
 
-    QEventLoop eventloop1; // 延迟500毫秒
-    QTimer::singleShot(500, &eventloop1, SLOT(quit()));
-    eventloop1.exec();
-
-    m_PixMerageThread->stopTask();
+    // 最后一张图片已在addLastPixmap中加入队列，等待队列中的图片全部拼接完成
+    m_PixMerageThread->finishTask();
     m_PixMerageThread->wait();
+    m_isStreamSave = streamLargeImage && m_PixMerageThread->isLargeImage();
+    if (m_isStreamSave) {
+        qInfo() << __FUNCTION__ << __LINE__ << "长图过大，保存时逐行写入文件！";
+        return QImage();
+    }
     return m_PixMerageThread->getMerageResult();
 }
 
+//长图是否未拼合，需通过saveLongImage逐行写入文件
+bool ScrollScreenshot::isStreamSave() const
+{
+    return m_isStreamSave;
+}
+
+//长图逐行写入PNG文件
+bool ScrollScreenshot::saveLongImage(const QString &fileName, int quality)
+{
+    return m_PixMerageThread->saveMerageResult(fileName, quality);
+}
+
 
 //设置滚动模式，先设置滚动模式，再添加图片
 void ScrollScreenshot::setScrollModel(bool model)
@@ -176,6 +198,17 @@ void ScrollScreenshot::merageImgState(PixMergeThread::MergeErrorValue state)
     emit merageError(state);
 }
 
+//自动滚动时根据拼接结果调整滚动速度
+void ScrollScreenshot::adjustAutoScrollSpeed(bool isMerged, qreal overlapRatio, int ticks, int queueDepth)
+{
+    if (m_isManualScrollModel || m_curStatus != Merging) {
+        return;
+    }
+    if (m_autoScrollController.update(isMerged, overlapRatio, ticks, queueDepth) && m_mouseWheelTimer->isActive()) {
+        m_mouseWheelTimer->setInterval(m_autoScrollController.interval());
+    }
+}
+
 //调整捕捉区域
 void ScrollScreenshot::merageInvalidArea(PixMergeThread::MergeErrorValue state, QRect rect)
 {
@@ -21,6 +21,7 @@
 #define SCROLLSCREENSHOT_H
 
 #include "pixmergethread.h"
+#include "autoscrollcontroller.h"
 #ifdef KF5_WAYLAND_FLAGE_ON
 #include "waylandscrollmonitor.h"
 #endif
@@ -44,17 +45,29 @@ public:
 
     explicit ScrollScreenshot(QObject *parent = nullptr);
     ~ScrollScreenshot();
-    void addPixmap(const QPixmap &piximg, int wheelDirection = WheelDown); //添加图片到拼接线程
+    void addPixmap(const QImage &piximg, int wheelDirection = WheelDown); //添加图片到拼接线程
     /**
      * @brief 保存时，添加最后一张图片到拼接线程
      */
-    void addLastPixmap(const QPixmap &piximg);
+    void addLastPixmap(const QImage &piximg);
     /**
      * @brief 清除内存中用来存储图片的矩阵数据
      */
     void clearPixmap();
     void changeState(const bool isStop);
-    QImage savePixmap();
+    /**
+     * @brief 停止拼接并获取长图
+     * @param streamLargeImage:长图过大时是否不拼合为整张图片，此时返回空图片，之后通过saveLongImage保存
+     */
+    QImage savePixmap(bool streamLargeImage = false);
+    /**
+     * @brief 长图是否未拼合，需通过saveLongImage逐行写入文件
+     */
+    bool isStreamSave() const;
+    /**
+     * @brief 长图逐行写入PNG文件
+     */
+    bool saveLongImage(const QString &fileName, int quality = -1);
 
     //手动滚动时的函数处理
     void setScrollModel(bool model); //设置滚动模式，先设置滚动模式，再添加图片
@@ -62,7 +75,7 @@ public:
     void setTimeAndCalculateTimeDiff(int time); //设置时间并计算时间差
 signals:
     void getOneImg();
-    void updatePreviewImg(QImage img);
+    void updatePreviewImg(QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize);
     void merageError(PixMergeThread::MergeErrorValue);
 
     /**
@@ -73,6 +86,7 @@ signals:
 public slots:
     void merageImgState(PixMergeThread::MergeErrorValue state);
     void merageInvalidArea(PixMergeThread::MergeErrorValue state, QRect rect); //调整捕捉区域
+    void adjustAutoScrollSpeed(bool isMerged, qreal overlapRatio, int ticks, int queueDepth); //自动滚动时调整滚动速度
 private:
     /**
      * @brief 用来监听模拟自动滚动截图的标志,只有当进行自动滚动截图时此属性的值会一直增加
@@ -87,11 +101,9 @@ private:
     // 截图宽度
     unsigned int m_shotImgWidth = 0;
 
-    // 滚动事件发送m_shotFrequency次，截图一次。控制截图频率
-    unsigned int m_shotFrequency = 2;
-
-    // 滚动计数
-    unsigned int m_scrollCount = 0;
+    // 自动滚动的滚轮事件间隔及截图频率控制
+    AutoScrollController m_autoScrollController;
+    int m_grabTicks = 0; // 请求截图时的滚轮事件数，随截取的图片传给拼接线程
 
     ScrollStatus m_curStatus = ScrollStatus::Wait;
 
@@ -99,6 +111,7 @@ private:
     bool m_isManualScrollModel = false;//是否手动模式
     QRect m_rect;//调整区域
     bool m_startPixMerageThread = false;
+    bool m_isStreamSave = false; //长图是否未拼合，保存时逐行写入文件
 #ifdef KF5_WAYLAND_FLAGE_ON
     WaylandScrollMonitor *m_WaylandScrollMonitor = nullptr;
 #endif
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     Hou Lei <houlei@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shapeeffect.h"
+
+#include <QtConcurrent>
+#include <QVector>
+#include <QDebug>
+
+#include <cstring>
+
+const int ShapeEffect::BLUR_RADIUS = 5;        // 三次半径为5的盒式模糊，与原来缩小10倍再放大的效果接近
+const int ShapeEffect::MOSAIC_BLOCK_SIZE = 10;
+const int ShapeEffect::REGION_MARGIN = 32;     // 计算范围比图形大一些，图形小范围移动或变大时不需要重新计算
+
+// 非负的取余，坐标可能为负数
+static int positiveMod(int value, int divisor)
+{
+    const int mod = value % divisor;
+    return mod < 0 ? mod + divisor : mod;
+}
+
+//水平方向的盒式模糊，每行按滑动窗口累加，4个通道同时计算
+static void boxBlurHorizontal(const uchar *src, int srcStride, uchar *dst, int dstStride,
+                              int width, int height, int radius)
+{
+    const quint32 div = static_cast<quint32>(radius * 2 + 1);
+    const quint32 mul = (65536 + div / 2) / div;
+    for (int y = 0; y < height; ++y) {
+        const uchar *s = src + y * srcStride;
+        uchar *d = dst + y * dstStride;
+        quint32 sum[4] = {0, 0, 0, 0};
+        for (int i = -radius; i <= radius; ++i) {
+            const uchar *p = s + qBound(0, i, width - 1) * 4;
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += p[c];
+            }
+        }
+        for (int x = 0; x < width; ++x) {
+            const uchar *add = s + qMin(x + radius + 1, width - 1) * 4;
+            const uchar *sub = s + qMax(x - radius, 0) * 4;
+            for (int c = 0; c < 4; ++c) {
+                d[x * 4 + c] = static_cast<uchar>((sum[c] * mul + 32768) >> 16);
+                sum[c] = sum[c] + add[c] - sub[c];
+            }
+        }
+    }
+}
+
+//垂直方向的盒式模糊，按行累加整行的列和，内层循环是连续内存，编译器可以向量化
+static void boxBlurVertical(const uchar *src, int srcStride, uchar *dst, int dstStride,
+                            int width, int height, int radius)
+{
+    const quint32 div = static_cast<quint32>(radius * 2 + 1);
+    const quint32 mul = (65536 + div / 2) / div;
+    const int rowBytes = width * 4;
+    QVector<quint32> sums(rowBytes, 0);
+    quint32 *sum = sums.data();
+    for (int i = -radius; i <= radius; ++i) {
+        const uchar *s = src + qBound(0, i, height - 1) * srcStride;
+        for (int k = 0; k < rowBytes; ++k) {
+            sum[k] += s[k];
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        uchar *d = dst + y * dstStride;
+        const uchar *add = src + qMin(y + radius + 1, height - 1) * srcStride;
+        const uchar *sub = src + qMax(y - radius, 0) * srcStride;
+        for (int k = 0; k < rowBytes; ++k) {
+            d[k] = static_cast<uchar>((sum[k] * mul + 32768) >> 16);
+            sum[k] = sum[k] + add[k] - sub[k];
+        }
+    }
+}
+
+ShapeEffect::ShapeEffect(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<QImage>(this))
+    , m_isRunning(false)
+    , m_sourceSerial(0)
+    , m_runningSerial(0)
+{
+    connect(m_watcher, &QFutureWatcher<QImage>::finished, this, &ShapeEffect::onEffectFinished);
+}
+
+ShapeEffect::~ShapeEffect()
+{
+    m_watcher->waitForFinished();
+}
+
+void ShapeEffect::setSource(const QPixmap &source)
+{
+    m_source = source;
+    m_caches.clear();
+    m_pendingJobs.clear();
+    ++m_sourceSerial;
+}
+
+QSize ShapeEffect::sourceSize() const
+{
+    return m_source.size();
+}
+
+QPixmap ShapeEffect::effect(int index, bool isMosaic, const QRect &rect, QRect &effectRect)
+{
+    const QRect needRect = rect & m_source.rect();
+    QMap<int, EffectCache>::const_iterator cache = m_caches.constFind(index);
+    const bool hasCache = cache != m_caches.constEnd() && cache->isMosaic == isMosaic;
+    if (!needRect.isEmpty() && !(hasCache && cache->rect.contains(needRect))) {
+        // 正在计算的范围已包含需要的范围时不再重复计算
+        const bool isComputing = m_isRunning && m_runningSerial == m_sourceSerial
+                                 && m_runningJob.index == index && m_runningJob.isMosaic == isMosaic
+                                 && m_runningJob.rect.contains(needRect);
+        if (!isComputing) {
+            EffectJob job;
+            job.index = index;
+            job.isMosaic = isMosaic;
+            job.rect = effectRegion(isMosaic, needRect);
+            m_pendingJobs[index] = job;
+            startNextJob();
+        }
+    }
+    if (!hasCache) {
+        effectRect = QRect();
+        return QPixmap();
+    }
+    effectRect = cache->rect;
+    return cache->pixmap;
+}
+
+void ShapeEffect::retain(const QList<int> &indexes)
+{
+    for (QMap<int, EffectCache>::iterator it = m_caches.begin(); it != m_caches.end();) {
+        if (indexes.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_caches.erase(it);
+        }
+    }
+    for (QMap<int, EffectJob>::iterator it = m_pendingJobs.begin(); it != m_pendingJobs.end();) {
+        if (indexes.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_pendingJobs.erase(it);
+        }
+    }
+    if (m_isRunning && !indexes.contains(m_runningJob.index)) {
+        // 图形已删除，丢弃正在计算的结果
+        m_runningJob.rect = QRect();
+    }
+}
+
+QImage ShapeEffect::blur(const QImage &image, int radius)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if (result.isNull() || radius < 1) {
+        return result;
+    }
+    // 半径过大时累加的结果会溢出
+    radius = qMin(radius, 100);
+    QImage temp(result.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int pass = 0; pass < 3; ++pass) {
+        boxBlurHorizontal(result.constBits(), result.bytesPerLine(), temp.bits(), temp.bytesPerLine(),
+                          result.width(), result.height(), radius);
+        boxBlurVertical(temp.constBits(), temp.bytesPerLine(), result.bits(), result.bytesPerLine(),
+                        result.width(), result.height(), radius);
+    }
+    return result;
+}
+
+QImage ShapeEffect::mosaic(const QImage &image, int blockSize, const QPoint &origin)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if (result.isNull() || blockSize <= 1) {
+        return result;
+    }
+    const int width = result.width();
+    const int height = result.height();
+    const int stride = result.bytesPerLine();
+    uchar *bits = result.bits();
+    QVector<quint32> sums(width * 4);
+    int top = 0;
+    while (top < height) {
+        const int bottom = qMin(height, top + blockSize - positiveMod(origin.y() + top, blockSize));
+        // 先按列累加一行块，再按块求和
+        sums.fill(0);
+        quint32 *sum = sums.data();
+        for (int y = top; y < bottom; ++y) {
+            const uchar *s = bits + y * stride;
+            for (int k = 0; k < width * 4; ++k) {
+                sum[k] += s[k];
+            }
+        }
+        int left = 0;
+        while (left < width) {
+            const int right = qMin(width, left + blockSize - positiveMod(origin.x() + left, blockSize));
+            const quint32 count = static_cast<quint32>((right - left) * (bottom - top));
+            quint32 total[4] = {0, 0, 0, 0};
+            for (int x = left; x < right; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    total[c] += sum[x * 4 + c];
+                }
+            }
+            uchar average[4];
+            for (int c = 0; c < 4; ++c) {
+                average[c] = static_cast<uchar>((total[c] + count / 2) / count);
+            }
+            for (int y = top; y < bottom; ++y) {
+                uchar *d = bits + y * stride + left * 4;
+                for (int x = left; x < right; ++x, d += 4) {
+                    memcpy(d, average, 4);
+                }
+            }
+            left = right;
+        }
+        top = bottom;
+    }
+    return result;
+}
+
+bool ShapeEffect::flush()
+{
+    bool isUpdated = false;
+    if (m_isRunning) {
+        m_watcher->waitForFinished();
+        m_isRunning = false;
+        if (m_runningSerial == m_sourceSerial) {
+            isUpdated = storeResult(m_runningJob, m_watcher->result());
+        }
+        m_runningJob = EffectJob();
+    }
+    while (!m_pendingJobs.isEmpty() && !m_source.isNull()) {
+        const EffectJob job = m_pendingJobs.first();
+        m_pendingJobs.erase(m_pendingJobs.begin());
+        QRect outputRect;
+        const QImage input = prepareJob(job, outputRect);
+        isUpdated = storeResult(job, computeEffect(input, outputRect, job.rect.topLeft(), job.isMosaic)) || isUpdated;
+    }
+    if (isUpdated) {
+        emit effectReady();
+    }
+    return isUpdated;
+}
+
+void ShapeEffect::onEffectFinished()
+{
+    // flush中已取走结果，之后收到的是上一个计算的完成通知
+    if (!m_isRunning || !m_watcher->isFinished()) {
+        return;
+    }
+    m_isRunning = false;
+    if (m_runningSerial == m_sourceSerial && storeResult(m_runningJob, m_watcher->result())) {
+        emit effectReady();
+    }
+    m_runningJob = EffectJob();
+    startNextJob();
+}
+
+//缓存图形的效果图，图形已删除时丢弃
+bool ShapeEffect::storeResult(const EffectJob &job, const QImage &result)
+{
+    if (job.rect.isEmpty()) {
+        return false;
+    }
+    EffectCache cache;
+    cache.isMosaic = job.isMosaic;
+    cache.rect = job.rect;
+    cache.pixmap = QPixmap::fromImage(result);
+    m_caches[job.index] = cache;
+    return true;
+}
+
+//每次只在后台计算一个图形，同一个图形的多次请求只计算最新的范围
+void ShapeEffect::startNextJob()
+{
+    if (m_isRunning || m_pendingJobs.isEmpty() || m_source.isNull()) {
+        return;
+    }
+    m_runningJob = m_pendingJobs.first();
+    m_pendingJobs.erase(m_pendingJobs.begin());
+    QRect outputRect;
+    const QImage input = prepareJob(m_runningJob, outputRect);
+    m_isRunning = true;
+    m_runningSerial = m_sourceSerial;
+    m_watcher->setFuture(QtConcurrent::run(&ShapeEffect::computeEffect, input, outputRect,
+                                           m_runningJob.rect.topLeft(), m_runningJob.isMosaic));
+}
+
+//取计算需要的原图，outputRect返回效果图在其中的范围
+QImage ShapeEffect::prepareJob(const EffectJob &job, QRect &outputRect) const
+{
+    // 模糊需要图形范围外的像素，否则边缘颜色会偏向图形内部
+    QRect inputRect = job.rect;
+    if (!job.isMosaic) {
+        inputRect = inputRect.adjusted(-BLUR_RADIUS * 3, -BLUR_RADIUS * 3, BLUR_RADIUS * 3, BLUR_RADIUS * 3)
+                    & m_source.rect();
+    }
+    outputRect = job.rect.translated(-inputRect.topLeft());
+    // 只把需要的部分转为QImage，在GUI线程中完成
+    return m_source.copy(inputRect).toImage();
+}
+
+//计算范围：在图形范围外留出余量，马赛克按块对齐
+QRect ShapeEffect::effectRegion(bool isMosaic, const QRect &rect) const
+{
+    QRect region = rect.adjusted(-REGION_MARGIN, -REGION_MARGIN, REGION_MARGIN, REGION_MARGIN);
+    if (isMosaic) {
+        const int left = region.left() - positiveMod(region.left(), MOSAIC_BLOCK_SIZE);
+        const int top = region.top() - positiveMod(region.top(), MOSAIC_BLOCK_SIZE);
+        const int right = region.left() + region.width();
+        const int bottom = region.top() + region.height();
+        region = QRect(left, top,
+                       right - left + positiveMod(MOSAIC_BLOCK_SIZE - positiveMod(right, MOSAIC_BLOCK_SIZE), MOSAIC_BLOCK_SIZE),
+                       bottom - top + positiveMod(MOSAIC_BLOCK_SIZE - positiveMod(bottom, MOSAIC_BLOCK_SIZE), MOSAIC_BLOCK_SIZE));
+    }
+    return region & m_source.rect();
+}
+
+//在后台线程中执行
+QImage ShapeEffect::computeEffect(const QImage &image, const QRect &rect, const QPoint &origin, bool isMosaic)
+{
+    if (isMosaic) {
+        return mosaic(image.copy(rect), MOSAIC_BLOCK_SIZE, origin);
+    }
+    return blur(image, BLUR_RADIUS).copy(rect);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     Hou Lei <houlei@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAPEEFFECT_H
+#define SHAPEEFFECT_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QImage>
+#include <QMap>
+#include <QFutureWatcher>
+
+/**
+ * @brief 矩形、圆形的模糊和马赛克效果
+ * 只计算每个图形所在范围的效果图，在后台线程中计算，按图形的索引号缓存；
+ * 图形移动或变大超出已计算的范围时重新计算，计算完成前先使用上次的结果
+ */
+class ShapeEffect : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ShapeEffect(QObject *parent = nullptr);
+    ~ShapeEffect();
+
+    /**
+     * @brief 设置原图，即图形编辑区域的截图，坐标为设备像素；会清空已计算的效果图
+     */
+    void setSource(const QPixmap &source);
+    QSize sourceSize() const;
+
+    /**
+     * @brief 取图形的效果图
+     * @param index:图形的索引号
+     * @param isMosaic:是否为马赛克，否则为模糊
+     * @param rect:图形所在的范围，设备像素
+     * @param effectRect:返回效果图所在的范围，设备像素
+     * @return 效果图，范围还未计算时返回上次的结果（可能为空），计算完成后发出effectReady
+     */
+    QPixmap effect(int index, bool isMosaic, const QRect &rect, QRect &effectRect);
+
+    /**
+     * @brief 只保留indexes中的图形的效果图，其余的释放
+     */
+    void retain(const QList<int> &indexes);
+
+    /**
+     * @brief 等待正在计算的效果图，并在当前线程中计算完所有等待计算的图形；
+     * 保存截图前调用，保证效果图与图形的范围一致
+     * @return 是否有效果图更新
+     */
+    bool flush();
+
+    /**
+     * @brief 分离的盒式模糊，重复三次近似高斯模糊
+     * @param image:原图
+     * @param radius:模糊半径
+     * @return ARGB32_Premultiplied格式的模糊结果
+     */
+    static QImage blur(const QImage &image, int radius);
+
+    /**
+     * @brief 马赛克，每个块填充块内像素的平均值
+     * @param image:原图
+     * @param blockSize:块的大小
+     * @param origin:原图左上角在块网格中的坐标，保证不同范围计算的块对齐
+     */
+    static QImage mosaic(const QImage &image, int blockSize, const QPoint &origin = QPoint(0, 0));
+
+signals:
+    /**
+     * @brief 有图形的效果图计算完成
+     */
+    void effectReady();
+
+private slots:
+    void onEffectFinished();
+
+private:
+    struct EffectJob {
+        int index = -1;
+        bool isMosaic = false;
+        QRect rect;
+    };
+    struct EffectCache {
+        bool isMosaic = false;
+        QRect rect;
+        QPixmap pixmap;
+    };
+
+    void startNextJob();
+    QImage prepareJob(const EffectJob &job, QRect &outputRect) const;
+    bool storeResult(const EffectJob &job, const QImage &result);
+    QRect effectRegion(bool isMosaic, const QRect &rect) const;
+    static QImage computeEffect(const QImage &image, const QRect &rect, const QPoint &origin, bool isMosaic);
+
+    QPixmap m_source;
+    QMap<int, EffectCache> m_caches;
+    QMap<int, EffectJob> m_pendingJobs;     // 等待计算的图形，同一个图形只保留最新的范围
+    EffectJob m_runningJob;
+    QFutureWatcher<QImage> *m_watcher;
+    bool m_isRunning;
+    int m_sourceSerial;                     // 原图变化后丢弃正在计算的结果
+    int m_runningSerial;
+
+    static const int BLUR_RADIUS;
+    static const int MOSAIC_BLOCK_SIZE;
+    static const int REGION_MARGIN;
+};
+
+#endif // SHAPEEFFECT_H
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     He MingYang <hemingyang@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shapesgrid.h"
+#include "calculaterect.h"
+
+#include <QPolygonF>
+
+// 点击的容差：平板上控制点的点击范围为20，旋转点的点击范围为17
+const int ShapesGrid::HIT_MARGIN = 24;
+// 格子坐标的范围，超出的坐标归到边缘的格子，避免异常的坐标登记过多的格子
+const int ShapesGrid::MAX_CELL = 1024;
+
+ShapesGrid::ShapesGrid(int cellSize)
+    : m_cellSize(qMax(1, cellSize))
+    , m_count(0)
+{
+}
+
+void ShapesGrid::clear()
+{
+    m_cells.clear();
+    m_count = 0;
+}
+
+int ShapesGrid::count() const
+{
+    return m_count;
+}
+
+void ShapesGrid::insertShape(int order, const Toolshape &shape)
+{
+    m_count = qMax(m_count, order + 1);
+    QVector<QPointF> handles = shape.mainPoints;
+    if (shape.mainPoints.length() == 4) {
+        handles << getAnotherFPoints(shape.mainPoints);
+        handles << getRotatePoint(shape.mainPoints[0], shape.mainPoints[1],
+                                  shape.mainPoints[2], shape.mainPoints[3]);
+    }
+
+    if (shape.type == ShapeType::Line) {
+        //画笔只能点中经过的线段和控制点；简化后的线段可能很长，斜线按外接矩形登记的格子太多，
+        //分成不超过格子大小的小段分别登记
+        if (shape.points.length() == 1) {
+            insertRect(order, QRectF(shape.points[0], shape.points[0]));
+        }
+        for (int i = 1; i < shape.points.length(); ++i) {
+            const QPointF &start = shape.points[i - 1];
+            const QPointF &end = shape.points[i];
+            const int steps = qMax(1, qCeil(qMax(qAbs(end.x() - start.x()), qAbs(end.y() - start.y())) / m_cellSize));
+            QPointF last = start;
+            for (int k = 1; k <= steps; ++k) {
+                const QPointF next = start + (end - start) * k / steps;
+                insertRect(order, QRectF(last, next).normalized());
+                last = next;
+            }
+        }
+        for (const QPointF &point : handles) {
+            insertRect(order, QRectF(point, point));
+        }
+        return;
+    }
+
+    //矩形、圆形的模糊和马赛克在图形内部也可以点中，按外接矩形登记
+    QPolygonF polygon(handles);
+    polygon << shape.points;
+    if (!polygon.isEmpty()) {
+        insertRect(order, polygon.boundingRect());
+    }
+}
+
+QVector<int> ShapesGrid::shapesAt(const QPointF &pos) const
+{
+    return m_cells.value(cellKey(cellOf(pos.x()), cellOf(pos.y())));
+}
+
+void ShapesGrid::insertRect(int order, const QRectF &rect)
+{
+    const int left = cellOf(rect.left() - HIT_MARGIN);
+    const int right = cellOf(rect.right() + HIT_MARGIN);
+    const int top = cellOf(rect.top() - HIT_MARGIN);
+    const int bottom = cellOf(rect.bottom() + HIT_MARGIN);
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            QVector<int> &cell = m_cells[cellKey(x, y)];
+            // 同一个图形按顺序登记，重复登记的一定在末尾
+            if (cell.isEmpty() || cell.last() != order) {
+                cell.append(order);
+            }
+        }
+    }
+}
+
+int ShapesGrid::cellOf(qreal value) const
+{
+    return qBound(-MAX_CELL, qFloor(value / m_cellSize), MAX_CELL);
+}
+
+quint64 ShapesGrid::cellKey(int x, int y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     He MingYang <hemingyang@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAPESGRID_H
+#define SHAPESGRID_H
+
+#include "shapesutils.h"
+
+#include <QHash>
+#include <QVector>
+
+/**
+ * @brief 图形的均匀网格索引，鼠标点击和悬停时只需要精确判断鼠标附近的图形
+ * 每个图形按可能被点中的范围（图形本身、调整大小和旋转的控制点，再加上点击的容差）登记到覆盖的格子中，
+ * 画笔只登记经过的格子；查询时返回鼠标所在格子中的图形
+ */
+class ShapesGrid
+{
+public:
+    explicit ShapesGrid(int cellSize = 64);
+
+    void clear();
+
+    /**
+     * @brief 登记的图形数
+     */
+    int count() const;
+
+    /**
+     * @brief 登记图形，需要按图形在列表中的顺序依次登记
+     * @param order:图形在列表中的顺序
+     */
+    void insertShape(int order, const Toolshape &shape);
+
+    /**
+     * @brief 鼠标位置可能点中的图形
+     * @return 图形在列表中的顺序，升序排列
+     */
+    QVector<int> shapesAt(const QPointF &pos) const;
+
+private:
+    void insertRect(int order, const QRectF &rect);
+    int cellOf(qreal value) const;
+    static quint64 cellKey(int x, int y);
+
+    int m_cellSize;
+    int m_count;
+    QHash<quint64, QVector<int>> m_cells;
+
+    static const int HIT_MARGIN;
+    static const int MAX_CELL;
+};
+
+#endif // SHAPESGRID_H
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     He MingYang <hemingyang@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shapeshistory.h"
+
+// 足够保存几千次画笔操作，长时间标注也不会一直占用内存
+const qint64 ShapesHistory::DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+
+ShapesHistory::ShapesHistory(qint64 maxBytes)
+    : m_maxBytes(qMax<qint64>(0, maxBytes))
+    , m_usedBytes(0)
+{
+}
+
+ShapesHistory::Command ShapesHistory::addShape(int position, const Toolshape &shape, const QString &text)
+{
+    Command command;
+    command.type = AddShape;
+    command.index = shape.index;
+    command.position = position;
+    command.shape = shape;
+    command.textAfter = text;
+    return command;
+}
+
+ShapesHistory::Command ShapesHistory::removeShape(int position, const Toolshape &shape, const QString &text)
+{
+    Command command;
+    command.type = RemoveShape;
+    command.index = shape.index;
+    command.position = position;
+    command.shape = shape;
+    command.textBefore = text;
+    return command;
+}
+
+bool ShapesHistory::transformShape(const Toolshape &before, const Toolshape &after, Command &command)
+{
+    if (before.mainPoints == after.mainPoints && before.points == after.points) {
+        return false;
+    }
+    command = Command();
+    command.type = TransformShape;
+    command.index = after.index;
+    command.mainPointsBefore = before.mainPoints;
+    command.mainPointsAfter = after.mainPoints;
+    command.pointsBefore = before.points;
+    command.pointsAfter = after.points;
+    command.portionBefore = before.portion;
+    command.portionAfter = after.portion;
+    return true;
+}
+
+bool ShapesHistory::restyleShape(const Toolshape &before, const Toolshape &after, Command &command)
+{
+    if (before.colorIndex == after.colorIndex && before.lineWidth == after.lineWidth
+            && before.fontSize == after.fontSize) {
+        return false;
+    }
+    command = Command();
+    command.type = RestyleShape;
+    command.index = after.index;
+    command.colorIndexBefore = before.colorIndex;
+    command.colorIndexAfter = after.colorIndex;
+    command.lineWidthBefore = before.lineWidth;
+    command.lineWidthAfter = after.lineWidth;
+    command.fontSizeBefore = before.fontSize;
+    command.fontSizeAfter = after.fontSize;
+    return true;
+}
+
+ShapesHistory::Command ShapesHistory::editText(int index, const QString &before, const QString &after)
+{
+    Command command;
+    command.type = EditText;
+    command.index = index;
+    command.textBefore = before;
+    command.textAfter = after;
+    return command;
+}
+
+void ShapesHistory::push(const Command &command)
+{
+    for (const Command &redo : m_redoCommands) {
+        m_usedBytes -= commandBytes(redo);
+    }
+    m_redoCommands.clear();
+    m_undoCommands.append(command);
+    m_usedBytes += commandBytes(command);
+    trim();
+}
+
+bool ShapesHistory::takeUndo(Command &command)
+{
+    if (m_undoCommands.isEmpty()) {
+        return false;
+    }
+    command = m_undoCommands.takeLast();
+    m_redoCommands.append(command);
+    return true;
+}
+
+bool ShapesHistory::takeRedo(Command &command)
+{
+    if (m_redoCommands.isEmpty()) {
+        return false;
+    }
+    command = m_redoCommands.takeLast();
+    m_undoCommands.append(command);
+    return true;
+}
+
+void ShapesHistory::clear()
+{
+    m_undoCommands.clear();
+    m_redoCommands.clear();
+    m_usedBytes = 0;
+}
+
+bool ShapesHistory::canUndo() const
+{
+    return !m_undoCommands.isEmpty();
+}
+
+bool ShapesHistory::canRedo() const
+{
+    return !m_redoCommands.isEmpty();
+}
+
+int ShapesHistory::undoCount() const
+{
+    return m_undoCommands.length();
+}
+
+int ShapesHistory::redoCount() const
+{
+    return m_redoCommands.length();
+}
+
+qint64 ShapesHistory::usedBytes() const
+{
+    return m_usedBytes;
+}
+
+//按点和文字的数量估算，图形数据在记录和图形列表之间共享时也按独立的一份计算
+qint64 ShapesHistory::commandBytes(const Command &command)
+{
+    qint64 bytes = static_cast<qint64>(sizeof(Command));
+    const qint64 pointCount = command.shape.mainPoints.size() + command.shape.points.size()
+                              + command.mainPointsBefore.size() + command.mainPointsAfter.size()
+                              + command.pointsBefore.size() + command.pointsAfter.size();
+    bytes += pointCount * static_cast<qint64>(sizeof(QPointF));
+    const qint64 portionCount = command.shape.portion.size() + command.portionBefore.size() + command.portionAfter.size();
+    bytes += portionCount * static_cast<qint64>(2 * sizeof(qreal) + sizeof(void *));
+    bytes += (command.textBefore.size() + command.textAfter.size()) * static_cast<qint64>(sizeof(QChar));
+    return bytes;
+}
+
+//超出内存上限时丢弃最早的记录，最近一次操作总是保留
+void ShapesHistory::trim()
+{
+    while (m_usedBytes > m_maxBytes && m_undoCommands.length() > 1) {
+        m_usedBytes -= commandBytes(m_undoCommands.first());
+        m_undoCommands.removeFirst();
+    }
+}
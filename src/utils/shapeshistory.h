@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co.,Ltd.
+ *
+ * Author:     He MingYang <hemingyang@uniontech.com>
+ *
+ * Maintainer: Liu Zheng <liuzheng@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAPESHISTORY_H
+#define SHAPESHISTORY_H
+
+#include "shapesutils.h"
+
+#include <QList>
+#include <QString>
+
+/**
+ * @brief 图形编辑的撤销/恢复记录
+ * 每次操作只记录发生变化的图形和变化的部分（添加、删除、移动/缩放/旋转、修改样式、修改文字），
+ * 不保存整个图形列表；记录占用的内存超过上限时丢弃最早的记录
+ */
+class ShapesHistory
+{
+public:
+    enum CommandType {
+        AddShape,
+        RemoveShape,
+        TransformShape,
+        RestyleShape,
+        EditText
+    };
+
+    struct Command {
+        CommandType type = AddShape;
+        int index = -1;                 // 图形的索引号
+        int position = -1;              // 添加、删除时图形在列表中的位置
+        Toolshape shape;                // 添加、删除的图形
+        FourPoints mainPointsBefore;    // 移动、缩放、旋转前后的顶点
+        FourPoints mainPointsAfter;
+        QVector<QPointF> pointsBefore;
+        QVector<QPointF> pointsAfter;
+        QList<QList<qreal>> portionBefore;
+        QList<QList<qreal>> portionAfter;
+        int colorIndexBefore = 0;       // 修改前后的样式
+        int colorIndexAfter = 0;
+        int lineWidthBefore = 1;
+        int lineWidthAfter = 1;
+        int fontSizeBefore = 1;
+        int fontSizeAfter = 1;
+        QString textBefore;             // 文字图形修改前后的内容，添加、删除文字图形时为图形的内容
+        QString textAfter;
+    };
+
+    explicit ShapesHistory(qint64 maxBytes = DEFAULT_MAX_BYTES);
+
+    static Command addShape(int position, const Toolshape &shape, const QString &text = QString());
+    static Command removeShape(int position, const Toolshape &shape, const QString &text = QString());
+    /**
+     * @brief 图形的顶点变化，顶点没有变化时返回false
+     */
+    static bool transformShape(const Toolshape &before, const Toolshape &after, Command &command);
+    /**
+     * @brief 图形的颜色、线宽或字号变化，样式没有变化时返回false
+     */
+    static bool restyleShape(const Toolshape &before, const Toolshape &after, Command &command);
+    static Command editText(int index, const QString &before, const QString &after);
+
+    /**
+     * @brief 记录新的操作，清空可以恢复的操作
+     */
+    void push(const Command &command);
+    /**
+     * @brief 取出最近一次操作用于撤销，移到恢复列表中
+     */
+    bool takeUndo(Command &command);
+    /**
+     * @brief 取出最近一次撤销的操作用于恢复，移回撤销列表中
+     */
+    bool takeRedo(Command &command);
+    void clear();
+
+    bool canUndo() const;
+    bool canRedo() const;
+    int undoCount() const;
+    int redoCount() const;
+    qint64 usedBytes() const;
+
+    /**
+     * @brief 估算一条记录占用的内存
+     */
+    static qint64 commandBytes(const Command &command);
+
+    static const qint64 DEFAULT_MAX_BYTES;
+
+private:
+    void trim();
+
+    QList<Command> m_undoCommands;
+    QList<Command> m_redoCommands;
+    qint64 m_maxBytes;
+    qint64 m_usedBytes;
+};
+
+#endif // SHAPESHISTORY_H
@@ -23,13 +23,45 @@
 
 #include <QDebug>
 
+ShapeType::ShapeType(const QString &name)
+    : m_kind(None)
+{
+    if (name == QLatin1String("rectangle")) {
+        m_kind = Rectangle;
+    } else if (name == QLatin1String("oval")) {
+        m_kind = Oval;
+    } else if (name == QLatin1String("arrow")) {
+        m_kind = Arrow;
+    } else if (name == QLatin1String("line")) {
+        m_kind = Line;
+    } else if (name == QLatin1String("text")) {
+        m_kind = Text;
+    }
+}
+
+QString ShapeType::name() const
+{
+    switch (m_kind) {
+    case Rectangle:
+        return QStringLiteral("rectangle");
+    case Oval:
+        return QStringLiteral("oval");
+    case Arrow:
+        return QStringLiteral("arrow");
+    case Line:
+        return QStringLiteral("line");
+    case Text:
+        return QStringLiteral("text");
+    default:
+        return QString();
+    }
+}
+
 Toolshape::Toolshape()
 {
-    mainPoints.append(QPointF(0, 0));
-    mainPoints.append(QPointF(0, 0));
-    mainPoints.append(QPointF(0, 0));
-    mainPoints.append(QPointF(0, 0));
-    portion.clear();
+    //临时的图形很多，四个顶点共享同一份数据，修改时才复制
+    static const FourPoints emptyPoints(4, QPointF(0, 0));
+    mainPoints = emptyPoints;
 }
 
 //Toolshape::~Toolshape()
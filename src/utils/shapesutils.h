@@ -25,14 +25,48 @@
 #include <QtCore>
 #include <QColor>
 
-typedef QList<QPointF> FourPoints;
+//点连续存放，QList<QPointF>的每个点都要单独分配内存
+typedef QVector<QPointF> FourPoints;
 //Q_DECLARE_METATYPE(FourPoints)
 
+/* shape type*/
+/**
+ * @brief 图形的类型，绘制和鼠标判断时按枚举值比较，不再每次比较字符串
+ * 可以由配置中的类型名称（"rectangle"、"oval"、"arrow"、"line"、"text"）构造，未知的名称为None
+ */
+class ShapeType
+{
+public:
+    enum Kind {
+        None = 0,
+        Rectangle,
+        Oval,
+        Arrow,
+        Line,
+        Text
+    };
+
+    ShapeType(Kind kind = None) : m_kind(kind) {}
+    ShapeType(const QString &name);
+
+    operator Kind() const
+    {
+        return m_kind;
+    }
+    /**
+     * @brief 类型名称，None为空字符串
+     */
+    QString name() const;
+
+private:
+    Kind m_kind;
+};
+
 /* shape*/
 class Toolshape
 {
 public:
-    QString type;
+    ShapeType type;
     FourPoints mainPoints;
     int index = -1;
     int lineWidth = 1;
@@ -43,7 +77,7 @@ public:
     bool isShiftPressed = false;
     int fontSize = 1;
 
-    QList<QPointF> points;
+    QVector<QPointF> points;
     QList<QList<qreal>> portion;
     QPointF arrowRotatePos;
     Toolshape();
@@ -58,6 +58,7 @@ Shortcut::Shortcut(QObject *parent) : QObject(parent)
 #endif
     toolsGroup.groupItems << ShortcutItem(tr("Delete"), "Delete")
                           << ShortcutItem(tr("Undo"), "Ctrl+Z")
+                          << ShortcutItem(tr("Redo"), "Ctrl+Y")
                           << ShortcutItem(tr("Options"), "F3");
 
     recordGroup.groupItems << ShortcutItem(tr("Start recording"), "Ctr+Alt+R")
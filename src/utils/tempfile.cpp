@@ -39,17 +39,20 @@ TempFile::~TempFile()
 {
 }
 
-void TempFile::setFullScreenPixmap(const QPixmap &pixmap)
+const QImage &TempFile::getScaledFullscreenImage(qreal ratio)
 {
-    m_fullscreenPixmap = pixmap;
+    if (m_scaledFullscreenImage.isNull() || !qFuzzyCompare(m_scaledRatio, ratio)) {
+        const QImage fullscreenImage = m_fullscreenPixmap.toImage();
+        m_scaledFullscreenImage = fullscreenImage.scaled(static_cast<int>(fullscreenImage.width() / ratio),
+                                                         static_cast<int>(fullscreenImage.height() / ratio),
+                                                         Qt::KeepAspectRatio);
+        m_scaledRatio = ratio;
+    }
+    return m_scaledFullscreenImage;
 }
 
-void TempFile::setBlurPixmap(const QPixmap &pixmap)
-{
-    m_blurPixmap = pixmap;
-}
-
-void TempFile::setMosaicPixmap(const QPixmap &pixmap)
+void TempFile::setFullScreenPixmap(const QPixmap &pixmap)
 {
-    m_mosaicPixmap = pixmap;
+    m_fullscreenPixmap = pixmap;
+    m_scaledFullscreenImage = QImage();
 }
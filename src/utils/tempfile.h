@@ -24,6 +24,7 @@
 
 #include <QObject>
 #include <QWindow>
+#include <QImage>
 
 class TempFile : public QObject
 {
@@ -36,25 +37,22 @@ public slots:
     {
         return m_fullscreenPixmap;
     }
-    inline const QPixmap getMosaicPixmap() const
-    {
-        return m_mosaicPixmap;
-    }
-    inline const QPixmap getBlurPixmap() const
-    {
-        return m_blurPixmap;
-    }
+
+    /**
+     * @brief 按屏幕缩放比缩小后的全屏截图，放大镜从中取样；
+     * 截图或缩放比变化后第一次调用时生成，之后直接返回
+     * @param ratio:屏幕缩放比
+     */
+    const QImage &getScaledFullscreenImage(qreal ratio);
 
     void setFullScreenPixmap(const QPixmap &pixmap);
-    void setBlurPixmap(const QPixmap &pixmap);
-    void setMosaicPixmap(const QPixmap &pixmap);
 
 private:
     explicit TempFile(QObject *parent = 0);
     ~TempFile();
 
     QPixmap m_fullscreenPixmap;
-    QPixmap m_mosaicPixmap;
-    QPixmap m_blurPixmap;
+    QImage m_scaledFullscreenImage;
+    qreal m_scaledRatio = 0;
 };
 #endif // TEMPFILE_H
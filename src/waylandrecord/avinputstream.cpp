@@ -174,6 +174,7 @@ bool CAVInputStream::openSysStream()
 }
 bool CAVInputStream::audioCapture()
 {
+    //音频设备在倒计时期间已打开，采集线程按时间戳丢弃开始时间之前缓存的音频数据
     m_start_time = avlibInterface::m_av_gettime();
     if (m_bMix) {
         pthread_create(&m_hMicAudioThread, nullptr, captureMicToMixAudioThreadFunc, static_cast<void *>(this));
@@ -190,6 +191,32 @@ bool CAVInputStream::audioCapture()
     return true;
 }
 
+//音频包是否为开始采集前缓存的数据：pulse输入的时间戳为系统时间，与m_start_time比较，不依赖非阻塞读取
+bool CAVInputStream::isCachedAudioPacket(AVFormatContext *formatContext, int streamIndex, const AVPacket &packet) const
+{
+    if (nullptr == formatContext || streamIndex < 0 || packet.pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    const AVRational microseconds = {1, AV_TIME_BASE};
+    const int64_t pts = avlibInterface::m_av_rescale_q(packet.pts, formatContext->streams[streamIndex]->time_base, microseconds);
+    return pts < m_start_time;
+}
+
+//关闭音频输入流，只在采集线程未启动时调用（如取消倒计时）
+void CAVInputStream::closeInputStream()
+{
+    if (nullptr != m_pMicAudioFormatContext) {
+        avlibInterface::m_avformat_close_input(&m_pMicAudioFormatContext);
+        m_pMicAudioFormatContext = nullptr;
+    }
+    if (nullptr != m_pSysAudioFormatContext) {
+        avlibInterface::m_avformat_close_input(&m_pSysAudioFormatContext);
+        m_pSysAudioFormatContext = nullptr;
+    }
+    m_micAudioindex = -1;
+    m_sysAudioindex = -1;
+}
+
 //void CAVInputStream::writeToFrame(QImage *img, int64_t time){
 //    if (m_exit_thread)
 //        return;
@@ -373,6 +400,12 @@ int CAVInputStream::readMicAudioPacket()
                 continue;
             }
         }
+        //丢弃倒计时期间缓存的音频数据
+        if (ret >= 0 && isCachedAudioPacket(m_pMicAudioFormatContext, m_micAudioindex, inputPacket)) {
+            avlibInterface::m_av_packet_unref(&inputPacket);
+            avlibInterface::m_av_frame_free(&inputFrame);
+            continue;
+        }
         //AVPacket -> AVFrame
         if ((ret = avlibInterface::m_avcodec_decode_audio4(m_pMicAudioFormatContext->streams[m_micAudioindex]->codec, inputFrame, &got_frame_ptr, &inputPacket)) < 0) {
             printf("Could not decode audio frame\n");
@@ -421,6 +454,12 @@ int CAVInputStream::readMicToMixAudioPacket()
                 continue;
             }
         }
+        //丢弃倒计时期间缓存的音频数据
+        if (ret >= 0 && isCachedAudioPacket(m_pMicAudioFormatContext, m_micAudioindex, inputPacket)) {
+            avlibInterface::m_av_packet_unref(&inputPacket);
+            avlibInterface::m_av_frame_free(&inputFrame);
+            continue;
+        }
         //AVPacket -> AVFrame
         if ((ret = avlibInterface::m_avcodec_decode_audio4(m_pMicAudioFormatContext->streams[m_micAudioindex]->codec, inputFrame, &got_frame_ptr, &inputPacket)) < 0) {
             printf("Could not decode audio frame\n");
@@ -485,6 +524,12 @@ int CAVInputStream::readSysAudioPacket()
                 continue;
             }
         }
+        //丢弃倒计时期间缓存的音频数据
+        if (ret >= 0 && isCachedAudioPacket(m_pSysAudioFormatContext, m_sysAudioindex, inputPacket)) {
+            avlibInterface::m_av_packet_unref(&inputPacket);
+            avlibInterface::m_av_frame_free(&input_frame);
+            continue;
+        }
         if ((ret = avlibInterface::m_avcodec_decode_audio4(m_pSysAudioFormatContext->streams[m_sysAudioindex]->codec, input_frame, &got_frame_ptr, &inputPacket)) < 0) {
             printf("Could not decode audio frame\n");
             return ret;
@@ -529,6 +574,12 @@ int CAVInputStream::readSysToMixAudioPacket()
                 continue;
             }
         }
+        //丢弃倒计时期间缓存的音频数据
+        if (ret >= 0 && isCachedAudioPacket(m_pSysAudioFormatContext, m_sysAudioindex, inputPacket)) {
+            avlibInterface::m_av_packet_unref(&inputPacket);
+            avlibInterface::m_av_frame_free(&inputFrame);
+            continue;
+        }
         if ((ret = avlibInterface::m_avcodec_decode_audio4(m_pSysAudioFormatContext->streams[m_sysAudioindex]->codec, inputFrame, &got_frame_ptr, &inputPacket)) < 0) {
             printf("Could not decode audio frame\n");
             return ret;
@@ -25,6 +25,10 @@ public:
      * @return 是否打成功
      */
     bool  openInputStream();
+    /**
+     * @brief 关闭音频输入流，只在采集线程未启动时调用（如取消倒计时）
+     */
+    void  closeInputStream();
     void  onsFinisheStream();
     bool  audioCapture();
     bool  GetVideoInputInfo(int &width, int &height, int &framerate, AVPixelFormat &pixFmt);
@@ -94,6 +98,13 @@ protected:
     int  readSysAudioPacket();
     int  readSysToMixAudioPacket();
     void initScreenData();
+    /**
+     * @brief 音频包的时间戳是否早于开始采集的时间（倒计时期间打开设备后缓存的音频），采集线程丢弃这些数据
+     * @param formatContext:音频输入流上下文
+     * @param streamIndex:音频流索引
+     * @param packet:读取的音频包
+     */
+    bool isCachedAudioPacket(AVFormatContext *formatContext, int streamIndex, const AVPacket &packet) const;
     /**
      * @brief 打开麦克风音频输入流 注：录屏时不要求录制麦克风时，则此方法默认返回false
      * @return 是否打开成功
@@ -121,13 +121,18 @@ void RecordAdmin::init(int screenWidth, int screenHeight)
         m_pInputStream->m_bottom = 0;
     }
     setRecordAudioType(m_audioType);
-    QtConcurrent::run(this, &RecordAdmin::startStream);
+    m_prepareFuture = QtConcurrent::run(this, &RecordAdmin::prepareStream);
 
 //    pthread_create(&m_mainThread, nullptr, stream, static_cast<void *>(this));
 //    pthread_detach(m_mainThread);
 }
 
-int RecordAdmin::startStream()
+void RecordAdmin::start()
+{
+    QtConcurrent::run(this, &RecordAdmin::startStream);
+}
+
+int RecordAdmin::prepareStream()
 {
     bool bRet;
     qInfo() << "打开音频采集设备!";
@@ -159,6 +164,15 @@ int RecordAdmin::startStream()
         printf("初始化输出失败\n");
         return 1;
     }
+    return 0;
+}
+
+int RecordAdmin::startStream()
+{
+    //等待打开设备、编码器及输出文件完成
+    if (0 != m_prepareFuture.result()) {
+        return 1;
+    }
     qInfo() << "采集画面!";
     //设置写mp4/mkv视频帧
     m_writeFrameThread->setBWriteFrame(true);
@@ -183,6 +197,12 @@ void *RecordAdmin::stream(void *param)
 
 int RecordAdmin::stopStream()
 {
+    //倒计时期间的准备工作未完成时，需等待其完成后再关闭
+    m_prepareFuture.waitForFinished();
+    if (m_isClosed) {
+        return 0;
+    }
+    m_isClosed = true;
     //设置是否运行线程，用来关闭采集音频数据的线程
     m_pInputStream->setbRunThread(false);
     //设置关闭视频数据采集，将视频数据采集到队列中
@@ -199,3 +219,24 @@ int RecordAdmin::stopStream()
     m_cacheMutex.unlock();
     return 0;
 }
+
+void RecordAdmin::cancelStream()
+{
+    //等待打开设备、编码器及输出文件完成后再关闭
+    m_prepareFuture.waitForFinished();
+    if (m_isClosed) {
+        return;
+    }
+    m_isClosed = true;
+    m_context->setBGetFrame(false);
+    m_writeFrameThread->setBWriteFrame(false);
+    //采集音频的线程未启动，直接关闭音频设备
+    m_pInputStream->setbRunThread(false);
+    m_pInputStream->setbWriteAmix(false);
+    m_pInputStream->closeInputStream();
+    m_cacheMutex.lock();
+    m_pOutputStream->setIsWriteFrame(false);
+    m_pOutputStream->close();
+    m_cacheMutex.unlock();
+    qInfo() << "record admin is canceled!";
+}
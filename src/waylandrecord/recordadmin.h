@@ -14,6 +14,7 @@
 #define AUDIO_INPUT_DEVICE    "hw:0,0"
 #define VIDEO_INPUT_DEVICE    "/dev/video0"
 #include <QThread>
+#include <QFuture>
 
 
 using namespace std;
@@ -28,7 +29,7 @@ public:
 
 public:
     /**
-     * @brief init:初始化录屏管理
+     * @brief init:初始化录屏管理，在线程中打开音频设备、编码器及输出文件，不采集数据（可在倒计时期间调用）
      * @param screenWidth:原图宽度
      * @param screenHeight:原图高度
      * @param fps:帧率
@@ -41,12 +42,22 @@ public:
      */
     void init(int screenWidth, int screenHeight);
 
+    /**
+     * @brief start:开始写视频帧及采集音频，等待init中的准备工作完成后执行
+     */
+    void start();
+
     /**
      * @brief stopStream:停止录屏
      * @return
      */
     int stopStream();
 
+    /**
+     * @brief cancelStream:取消倒计时期间的准备，关闭音频设备、编码器及输出文件，未开始录制时调用
+     */
+    void cancelStream();
+
     /**
      * @brief insertOldFrame:缓存历史帧，自动排序
      * @param frame:gif帧
@@ -58,6 +69,7 @@ protected:
     void  setRecordAudioType(int audioType);
     void  setMicAudioRecord(bool bRecord);
     void  setSysAudioRecord(bool bRecord);
+    int   prepareStream();
     int   startStream();
     static void *stream(void *param);
 
@@ -103,6 +115,14 @@ private:
     int m_delay;
     QMutex m_oldFrameMutex;
     int m_gifBuffersize;
+    /**
+     * @brief 打开设备、编码器及输出文件的结果
+     */
+    QFuture<int> m_prepareFuture;
+    /**
+     * @brief 输入输出已关闭（取消或停止录屏），不再重复关闭
+     */
+    bool m_isClosed = false;
 };
 
 #endif // RECORDADMIN_H
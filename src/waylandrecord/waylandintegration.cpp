@@ -82,6 +82,16 @@ bool WaylandIntegration::isEGLInitialized()
     return globalWaylandIntegration->isEGLInitialized();
 }
 
+void WaylandIntegration::startRecord()
+{
+    globalWaylandIntegration->startRecord();
+}
+
+void WaylandIntegration::cancelRecord()
+{
+    globalWaylandIntegration->cancelRecord();
+}
+
 void WaylandIntegration::stopStreaming()
 {
     qDebug() << "stop recording!";
@@ -198,6 +208,10 @@ WaylandIntegration::WaylandIntegrationPrivate::WaylandIntegrationPrivate()
     m_gstRecordX = nullptr;
     //m_writeFrameThread = nullptr;
     m_bInitRecordAdmin = true;
+    m_bStartRecord.store(0);
+    m_bRecordStarted = false;
+    m_recordStartTime = 0;
+    m_bFirstFrameLogged = false;
     m_bGetFrame = true;
     m_screenCount = 1;
     //m_recordTIme = -1;
@@ -263,6 +277,26 @@ QMap<quint32, WaylandIntegration::WaylandOutput> WaylandIntegration::WaylandInte
     return m_outputMap;
 }
 
+void WaylandIntegration::WaylandIntegrationPrivate::startRecord()
+{
+    m_recordStartTime = QDateTime::currentMSecsSinceEpoch();
+    //先写入开始时间再发布标志，采集线程看到标志时开始时间已可见
+    m_bStartRecord.storeRelease(1);
+}
+
+void WaylandIntegration::WaylandIntegrationPrivate::cancelRecord()
+{
+    if (m_bStartRecord.loadAcquire()) {
+        return;
+    }
+    //不再接收画面，之后收到的画面也不再初始化录屏管理
+    m_bInitRecordAdmin = false;
+    stopStreaming();
+    if (Utils::isFFmpegEnv && m_recordAdmin) {
+        m_recordAdmin->cancelStream();
+    }
+}
+
 void WaylandIntegration::WaylandIntegrationPrivate::initWayland(QStringList list)
 {
     //通过wayland底层接口获取图片的方式不相同，需要获取电脑的厂商，hw的需要特殊处理
@@ -456,23 +490,9 @@ void WaylandIntegration::WaylandIntegrationPrivate::processBuffer(const KWayland
     quint32 stride = rbuf->stride();
     //    if(!bGetFrame())
     //        return;
-    if (m_bInitRecordAdmin) {
-        m_bInitRecordAdmin = false;
-        if (Utils::isFFmpegEnv) {
-            m_recordAdmin->init(static_cast<int>(m_screenSize.width()), static_cast<int>(m_screenSize.height()));
-            frameStartTime = avlibInterface::m_av_gettime();
-        } else {
-            frameStartTime = QDateTime::currentMSecsSinceEpoch();
-            isGstWriteVideoFrame = true;
-            if (m_gstRecordX) {
-                m_gstRecordX->waylandGstStartRecord();
-            } else {
-                qWarning() << "m_gstRecordX is nullptr!";
-            }
-            QtConcurrent::run(this, &WaylandIntegrationPrivate::gstWriteVideoFrame);
-        }
-        m_appendFrameToListFlag = true;
-        QtConcurrent::run(this, &WaylandIntegrationPrivate::appendFrameToList);
+    if (!initRecordOnBuffer()) {
+        close(dma_fd);
+        return;
     }
     unsigned char *mapData = static_cast<unsigned char *>(mmap(nullptr, stride * height, PROT_READ, MAP_SHARED, dma_fd, 0));
     if (MAP_FAILED == mapData) {
@@ -509,25 +529,10 @@ void WaylandIntegration::WaylandIntegrationPrivate::processBufferX86(const KWayl
     quint32 width = rbuf->width();
     quint32 height = rbuf->height();
     quint32 stride = rbuf->stride();
-    if (m_bInitRecordAdmin) {
-        m_bInitRecordAdmin = false;
-        if (Utils::isFFmpegEnv) {
-            m_recordAdmin->init(static_cast<int>(m_screenSize.width()), static_cast<int>(m_screenSize.height()));
-            frameStartTime = avlibInterface::m_av_gettime();
-        } else {
-            frameStartTime = QDateTime::currentMSecsSinceEpoch();
-            isGstWriteVideoFrame = true;
-            if (m_gstRecordX) {
-                m_gstRecordX->waylandGstStartRecord();
-            } else {
-                qWarning() << "m_gstRecordX is nullptr!";
-            }
-            QtConcurrent::run(this, &WaylandIntegrationPrivate::gstWriteVideoFrame);
-        }
-        m_appendFrameToListFlag = true;
-        QtConcurrent::run(this, &WaylandIntegrationPrivate::appendFrameToList);
+    if (!initRecordOnBuffer()) {
+        close(dma_fd);
+        return;
     }
-    QImage img(m_screenSize, QImage::Format_RGBA8888);
     if (m_screenCount == 1) {
         m_curNewImage.first = 0;//avlibInterface::m_av_gettime() - frameStartTime;
         {
@@ -547,6 +552,47 @@ void WaylandIntegration::WaylandIntegrationPrivate::processBufferX86(const KWayl
     }
     close(dma_fd);
 }
+//收到第一个画面时预先初始化录屏管理及编码器，倒计时结束后启动写视频帧的线程
+bool WaylandIntegration::WaylandIntegrationPrivate::initRecordOnBuffer()
+{
+    //倒计时期间打开音频设备、编码器及输出文件，构建gstreamer管道
+    if (m_bInitRecordAdmin) {
+        m_bInitRecordAdmin = false;
+        if (Utils::isFFmpegEnv) {
+            m_recordAdmin->init(static_cast<int>(m_screenSize.width()), static_cast<int>(m_screenSize.height()));
+        } else {
+            if (m_gstRecordX) {
+                m_gstRecordX->waylandGstPrepareRecord();
+            } else {
+                qWarning() << "m_gstRecordX is nullptr!";
+            }
+        }
+    }
+    //倒计时未结束，不处理画面
+    if (!m_bStartRecord.loadAcquire()) {
+        return false;
+    }
+    if (!m_bRecordStarted) {
+        m_bRecordStarted = true;
+        if (Utils::isFFmpegEnv) {
+            m_recordAdmin->start();
+            frameStartTime = avlibInterface::m_av_gettime();
+        } else {
+            frameStartTime = QDateTime::currentMSecsSinceEpoch();
+            isGstWriteVideoFrame = true;
+            if (m_gstRecordX) {
+                m_gstRecordX->waylandGstStartRecord();
+            } else {
+                qWarning() << "m_gstRecordX is nullptr!";
+            }
+            QtConcurrent::run(this, &WaylandIntegrationPrivate::gstWriteVideoFrame);
+        }
+        m_appendFrameToListFlag = true;
+        QtConcurrent::run(this, &WaylandIntegrationPrivate::appendFrameToList);
+    }
+    return true;
+}
+
 //通过线程每30ms钟向数据池中取出一张图片添加到环形缓冲区，以便后续视频编码
 void WaylandIntegration::WaylandIntegrationPrivate::appendFrameToList()
 {
@@ -637,7 +683,13 @@ void WaylandIntegration::WaylandIntegrationPrivate::appendFrameToList()
 void WaylandIntegration::WaylandIntegrationPrivate::gstWriteVideoFrame()
 {
     waylandFrame frame;
+    const unsigned long frameInterval = static_cast<unsigned long>(1000 / (m_fps > 0 ? m_fps : 24));
     while (isWriteVideo()) {
+        //管道积压时最多等待一帧的时间，期间新采集的帧留在环形缓冲区，缓冲区满时覆盖最旧的帧；
+        //超时后取出的帧由waylandWriteVideoFrame丢弃并计数
+        if (m_gstRecordX) {
+            m_gstRecordX->waitForNeedData(frameInterval);
+        }
         if (getFrame(frame)) {
             if (m_gstRecordX) {
                 m_gstRecordX->waylandWriteVideoFrame(frame._frame, frame._width, frame._height);
@@ -790,6 +842,10 @@ void WaylandIntegration::WaylandIntegrationPrivate::appendBuffer(unsigned char *
     if (!bGetFrame() || nullptr == frame || width <= 0 || height <= 0) {
         return;
     }
+    if (!m_bFirstFrameLogged) {
+        m_bFirstFrameLogged = true;
+        qInfo() << "(wayland) time-to-first-frame:" << QDateTime::currentMSecsSinceEpoch() - m_recordStartTime << "ms";
+    }
     int size = height * stride;
     unsigned char *ch = nullptr;
     if (m_bInit) {
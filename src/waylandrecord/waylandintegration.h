@@ -78,6 +78,16 @@ void init(QStringList list, GstRecordX *gstRecord);
 
 bool isEGLInitialized();
 
+/**
+ * @brief 倒计时结束，开始处理视频帧。init在倒计时期间调用，只做预先初始化
+ */
+void startRecord();
+
+/**
+ * @brief 取消倒计时期间的预先初始化，关闭已打开的音频设备、编码器及输出文件
+ */
+void cancelRecord();
+
 //bool startStreaming(const WaylandOutput &output);
 void stopStreaming();
 
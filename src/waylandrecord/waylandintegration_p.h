@@ -30,6 +30,7 @@
 #include <epoxy/egl.h>
 #include <epoxy/gl.h>
 #include <QMutex>
+#include <QAtomicInt>
 #include <EGL/egl.h>
 
 enum audioType {
@@ -123,6 +124,16 @@ public:
     void stopStreaming();
     QMap<quint32, WaylandOutput> screens();
 
+    /**
+     * @brief 倒计时结束，开始处理视频帧
+     */
+    void startRecord();
+
+    /**
+     * @brief 取消倒计时期间的预先初始化，之后不再处理视频帧
+     */
+    void cancelRecord();
+
     /**
      * @brief stopVideoRecord:停止获取视频流
      * @return
@@ -133,6 +144,14 @@ public:
     RecordAdmin *m_recordAdmin;
     //是否初始化录屏管理
     bool m_bInitRecordAdmin;
+    //倒计时是否已结束，界面线程写入，采集线程读取
+    QAtomicInt m_bStartRecord;
+    //是否已启动写视频帧的线程
+    bool m_bRecordStarted;
+    //倒计时结束的时间，用于统计首帧耗时
+    qint64 m_recordStartTime;
+    //是否已统计首帧耗时
+    bool m_bFirstFrameLogged;
 
     //WriteFrameThread *m_writeFrameThread;
     //     pthread_t m_writeFrameThread;
@@ -170,6 +189,12 @@ protected Q_SLOTS:
         */
     QImage getImage(int32_t fd, uint32_t width, uint32_t height, uint32_t stride, uint32_t format);
 
+    /**
+     * @brief 收到第一个画面时预先初始化录屏管理及编码器，倒计时结束后启动写视频帧的线程
+     * @return 倒计时是否已结束（未结束时丢弃当前画面）
+     */
+    bool initRecordOnBuffer();
+
     /**
      * @brief 安装注册wayland客户服务
      */
@@ -3,6 +3,8 @@
 #include <QApplication>
 #include <QDesktopWidget>
 
+#include <string.h>
+
 PreviewWidget::PreviewWidget(const QRect &rect, QWidget *parent) : QWidget(parent), m_previewRect(rect)
 {
     m_recordHeight = rect.height();
@@ -41,7 +43,7 @@ void PreviewWidget::paintEvent(QPaintEvent *event)
     //paint
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing, true);
-    painter.drawImage(rect(), m_currentPix);
+    painter.drawImage(rect(), m_currentPix, QRect(0, 0, m_currentPix.width(), m_previewRows));
 }
 //设置位置状态
 void PreviewWidget::setPreviewWidgetStatusPos(PostionStatus statusPos)
@@ -49,18 +51,57 @@ void PreviewWidget::setPreviewWidgetStatusPos(PostionStatus statusPos)
     m_StatusPos = statusPos;
 }
 //更新图片
-void PreviewWidget::updateImage(const QImage &image)
+void PreviewWidget::updateImage(const QImage &image, const QSize &imageSize)
+{
+    m_currentPix = image;
+    m_previewRows = image.height();
+    updatePreviewGeometry(imageSize.isValid() ? imageSize : image.size());
+}
+
+//更新预览图变化的行，其余行在缓冲区内移动，不重新缩放整张图片
+void PreviewWidget::updateImageRows(const QImage &rows, int keepStart, int keepEnd, bool isPrepend, const QSize &imageSize)
+{
+    keepStart = qBound(0, keepStart, m_previewRows);
+    keepEnd = qBound(keepStart, keepEnd, m_previewRows);
+    const int keptRows = keepEnd - keepStart;
+    const int width = rows.isNull() ? m_currentPix.width() : rows.width();
+    const int newRows = keptRows + rows.height();
+    if (width != m_currentPix.width() || newRows > m_currentPix.height()
+            || (!rows.isNull() && rows.format() != m_currentPix.format())) {
+        // 重新分配缓冲区，预留空间，之后追加的行直接写入
+        QImage buffer(width, qMax(newRows * 2, 1), rows.isNull() ? m_currentPix.format() : rows.format());
+        for (int i = 0; i < keptRows; ++i) {
+            memcpy(buffer.scanLine((isPrepend ? rows.height() : 0) + i), m_currentPix.constScanLine(keepStart + i),
+                   static_cast<size_t>(qMin(buffer.bytesPerLine(), m_currentPix.bytesPerLine())));
+        }
+        m_currentPix = buffer;
+    } else {
+        const int destStart = isPrepend ? rows.height() : 0;
+        if (destStart != keepStart) {
+            memmove(m_currentPix.scanLine(destStart), m_currentPix.constScanLine(keepStart),
+                    static_cast<size_t>(m_currentPix.bytesPerLine()) * static_cast<size_t>(keptRows));
+        }
+    }
+    const int rowsStart = isPrepend ? 0 : keptRows;
+    for (int i = 0; i < rows.height(); ++i) {
+        memcpy(m_currentPix.scanLine(rowsStart + i), rows.constScanLine(i),
+               static_cast<size_t>(qMin(rows.bytesPerLine(), m_currentPix.bytesPerLine())));
+    }
+    m_previewRows = newRows;
+    updatePreviewGeometry(imageSize);
+}
+
+//根据原图大小计算预览框的位置大小
+void PreviewWidget::updatePreviewGeometry(const QSize &originSize)
 {
     int previewHeight = 0; //预览高度
     int previewWidth = 0; //预览宽度
-    int imageHight = int(image.height() / m_screenRatio);
-    int imageWidth = int(image.width() / m_screenRatio);
-    bool unchanged = false; //是否高宽不变
+    int imageHight = int(originSize.height() / m_screenRatio);
+    int imageWidth = int(originSize.width() / m_screenRatio);
     //计算图片缩放后的预览宽高
     if (imageHight <= m_maxHeight && imageWidth <= m_maxWidth) {
         previewHeight = imageHight;
         previewWidth = imageWidth;
-        unchanged = true;
     } else if (imageHight <= m_maxHeight && imageWidth > m_maxWidth) {
         previewHeight = m_maxWidth * imageHight / imageWidth;
         previewWidth = m_maxWidth;
@@ -98,13 +139,7 @@ void PreviewWidget::updateImage(const QImage &image)
     }
     m_previewRect.setWidth(previewWidth);//重新设置预览宽度
     setGeometry(m_previewRect);
-    if (true == unchanged) {//高宽不变,不进行宽高等比缩放
-        m_currentPix = image;
-    } else {
-        QImage tempImage = image.scaled(previewWidth, previewHeight, Qt::
-                                        KeepAspectRatioByExpanding, Qt::SmoothTransformation);//以预览框的宽高等比例缩放
-        m_currentPix = image;
-    }
+    // 预览图在绘制时缩放到预览框大小，这里不再额外缩放整张图片
     update();
 }
 
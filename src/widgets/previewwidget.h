@@ -19,8 +19,15 @@ public:
     };
     explicit PreviewWidget(const QRect &rect, QWidget *parent = nullptr);
     void paintEvent(QPaintEvent *event) override;
-    //更新图片
-    void updateImage(const QImage &image);
+    //更新图片，image可以是缩小后的预览图，imageSize为原图大小（为空时使用image的大小）
+    void updateImage(const QImage &image, const QSize &imageSize = QSize());
+    /**
+     * @brief 更新预览图变化的行
+     * 新的预览图 = isPrepend ? rows + 旧预览图[keepStart, keepEnd) : 旧预览图[keepStart, keepEnd) + rows，
+     * keepStart与keepEnd相等时rows为整张预览图
+     * @param imageSize 原图大小
+     */
+    void updateImageRows(const QImage &rows, int keepStart, int keepEnd, bool isPrepend, const QSize &imageSize);
     //标记预览位置在左还是在右，0:右，1：左, 2内部
     void setPreviewWidgetStatusPos(PostionStatus statusPos);
     //计算预览位置或大小
@@ -48,7 +55,12 @@ signals:
 public slots:
 
 private:
-    QImage m_currentPix;
+    //根据原图大小计算预览框的位置大小
+    void updatePreviewGeometry(const QSize &originSize);
+
+private:
+    QImage m_currentPix; //预览图缓冲区，只有前m_previewRows行有效
+    int m_previewRows = 0; //预览图高度
     QRect m_previewRect; //预览区域
     int m_maxHeight = 0; //预览最大高度
     int m_maxWidth = 0;//预览最大宽度
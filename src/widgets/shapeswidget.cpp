@@ -21,7 +21,6 @@
 
 #include "../utils/calculaterect.h"
 #include "../utils/configsettings.h"
-#include "../utils/tempfile.h"
 #include "shapeswidget.h"
 
 #include <QApplication>
@@ -49,6 +48,7 @@ ShapesWidget::ShapesWidget(DWidget *parent)
       m_shapesIndex(-1),
       m_selectedIndex(-1),
       m_selectedOrder(-1),
+      m_shapeEffect(new ShapeEffect(this)),
       m_menuController(new MenuController)
 {
     //订阅手势事件
@@ -88,6 +88,7 @@ ShapesWidget::ShapesWidget(DWidget *parent)
             m_menuController, &MenuController::setUndoEnable);
     connect(ConfigSettings::instance(), &ConfigSettings::shapeConfigChanged,
             this, &ShapesWidget::updateSelectedShape);
+    connect(m_shapeEffect, &ShapeEffect::effectReady, this, &ShapesWidget::updateShapesLayer);
     //m_sideBar = new SideBar(this);
     //m_sideBar->hide();
 }
@@ -111,44 +112,51 @@ void ShapesWidget::updateSelectedShape(const QString &group,
         m_isSelectedText = false;
         return;
     }
-    if ((group == m_currentShape.type || "common" == group) && key == "color_index") {
+    if ((group == m_currentShape.type.name() || "common" == group) && key == "color_index") {
         m_penColor = BaseUtils::colorIndexOf(index);
     }
 
     if (m_selectedIndex != -1 && m_selectedOrder != -1 && m_selectedOrder < m_shapes.length()) {
-        if (m_selectedShape.type == "arrow" && key != "color_index") {
+        const Toolshape before = m_shapes[m_selectedOrder];
+        if (m_selectedShape.type == ShapeType::Arrow && key != "color_index") {
             if (key == "arrow_linewidth_index" && !m_selectedShape.isStraight) {
                 m_selectedShape.lineWidth = LINEWIDTH(index);
             } else if (key == "straightline_linewidth_index" && m_selectedShape.isStraight) {
                 m_selectedShape.lineWidth = LINEWIDTH(index);
             }
-        } else if (m_selectedShape.type == group && key == "linewidth_index") {
+        } else if (m_selectedShape.type.name() == group && key == "linewidth_index") {
             m_selectedShape.lineWidth = LINEWIDTH(index);
-        } else if (group == "text" && m_selectedShape.type == group && key == "color_index") {
+        } else if (group == "text" && m_selectedShape.type.name() == group && key == "color_index") {
             int tmpIndex = m_shapes[m_selectedOrder].index;
             if (m_editMap.contains(tmpIndex)) {
                 m_editMap.value(tmpIndex)->setColor(BaseUtils::colorIndexOf(index));
                 m_editMap.value(tmpIndex)->update();
             }
+            m_selectedShape.colorIndex = index;
 
-        } else if (group == "text" && m_selectedShape.type == group && key == "fontsize")  {
+        } else if (group == "text" && m_selectedShape.type.name() == group && key == "fontsize")  {
             qDebug() << "change font size";
             int tmpIndex = m_shapes[m_selectedOrder].index;
             if (m_editMap.contains(tmpIndex)) {
                 m_editMap.value(tmpIndex)->setFontSize(index);
                 m_editMap.value(tmpIndex)->update();
             }
-        } else if (group != "text" && m_selectedShape.type == group && key == "color_index") {
+            m_selectedShape.fontSize = index;
+        } else if (group != "text" && m_selectedShape.type.name() == group && key == "color_index") {
             m_selectedShape.colorIndex = index;
         }
 
         if (m_selectedOrder < m_shapes.length()) {
             m_shapes[m_selectedOrder] = m_selectedShape;
+            ShapesHistory::Command command;
+            if (ShapesHistory::restyleShape(before, m_selectedShape, command)) {
+                m_history.push(command);
+            }
         }
-        update();
+        updateShapesLayer();
     }
     qDebug() << ">>>>> function: " << __func__ << ", line: " << __LINE__ <<
-             ", m_selectedShape.type: " << m_selectedShape.type;
+             ", m_selectedShape.type: " << m_selectedShape.type.name();
 }
 /*
  * never used
@@ -209,7 +217,8 @@ void ShapesWidget::setAllTextEditReadOnly()
     }
 
     setNoChangedTextEditRemove();
-    update();
+    recordTextChanges();
+    updateShapesLayer();
 }
 
 void ShapesWidget::setNoChangedTextEditRemove()
@@ -218,10 +227,14 @@ void ShapesWidget::setNoChangedTextEditRemove()
         return;
     }
     for (int i = 0; i < m_shapes.length(); i++) {
-        if (m_shapes[i].type == "text") {
+        if (m_shapes[i].type == ShapeType::Text) {
             int t_tempIndex = m_shapes[i].index;
             if (m_editMap.value(t_tempIndex)->document()->toPlainText() == QString(tr("Input text here"))
                     || m_editMap.value(t_tempIndex)->document()->toPlainText().isEmpty()) {
+                // 已记录的文字被清空，记录为删除；新建后未输入的文字不记录
+                if (m_textSnapshots.contains(t_tempIndex)) {
+                    m_history.push(ShapesHistory::removeShape(i, m_shapes[i], m_textSnapshots.take(t_tempIndex)));
+                }
                 m_shapes.removeAt(i);
                 m_editMap.value(t_tempIndex)->clear();
                 m_editMap.remove(t_tempIndex);
@@ -232,11 +245,11 @@ void ShapesWidget::setNoChangedTextEditRemove()
         }
 
     }
-    if (m_shapes.length() == 0) {
+    if (m_shapes.length() == 0 && !m_history.canUndo()) {
         emit setShapesUndo(false);
     }
 
-    update();
+    updateShapesLayer();
 }
 
 void ShapesWidget::saveActionTriggered()
@@ -245,6 +258,7 @@ void ShapesWidget::saveActionTriggered()
     setAllTextEditReadOnly();
     clearSelected();
     m_clearAllTextBorder = true;
+    updateShapesLayer();
     qInfo() << __FUNCTION__ << __LINE__ << "已清楚图形编辑界面";
 }
 
@@ -256,49 +270,44 @@ bool ShapesWidget::clickedOnShapes(QPointF pos)
 //    qDebug() << ">>>>> function: " << __func__ << ", line: " << __LINE__
 //             << ", pos: " << pos
 //             << ", m_shapes.length(): " << m_shapes.length();
-    for (int i = 0; i < m_shapes.length(); i++) {
+    const QVector<int> candidates = shapesAt(pos);
+    for (int i : candidates) {
         //当前是否有形状被选中
         bool currentOnShape = false;
-        if (m_shapes[i].type == "rectangle") {
-            if (clickedOnRect(m_shapes[i].mainPoints, pos,
-                              m_shapes[i].isBlur || m_shapes[i].isMosaic)) {
+        const Toolshape &shape = m_shapes.at(i);
+        switch (shape.type) {
+        case ShapeType::Rectangle:
+            if (clickedOnRect(shape.mainPoints, pos, shape.isBlur || shape.isMosaic)) {
                 currentOnShape = true;
                 emit shapeClicked("rect");
             }
-        }
-        if (m_shapes[i].type == "oval") {
-            if (clickedOnEllipse(m_shapes[i].mainPoints, pos,
-                                 m_shapes[i].isBlur || m_shapes[i].isMosaic)) {
+            break;
+        case ShapeType::Oval:
+            if (clickedOnEllipse(shape.mainPoints, pos, shape.isBlur || shape.isMosaic)) {
                 currentOnShape = true;
                 emit shapeClicked("circ");
             }
-        }
-        if (m_shapes[i].type == "arrow") {
-            if (clickedOnArrow(m_shapes[i].points, pos)) {
+            break;
+        case ShapeType::Arrow:
+            if (clickedOnArrow(shape.points, pos)) {
                 currentOnShape = true;
                 emit shapeClicked("line");
             }
-        }
-        if (m_shapes[i].type == "line") {
-            if (clickedOnLine(m_shapes[i].mainPoints, m_shapes[i].points, pos)) {
+            break;
+        case ShapeType::Line:
+            if (clickedOnLine(shape.mainPoints, shape.points, pos)) {
                 currentOnShape = true;
                 emit shapeClicked("pen");
             }
-        }
-
-        if (m_shapes[i].type == "text") {
-            if (clickedOnText(m_shapes[i].mainPoints, pos)) {
-
-//                int tmpIndex = m_shapes[m_selectedOrder].index;
-//                if (m_editMap.contains(tmpIndex)) {
-//                    QColor t_color = m_editMap.value(tmpIndex)->getColor();
-////                    int colorNum = colorIndex(t_color);
-////                    ConfigSettings::instance()->setValue("text", "prev_color", colorNum);
-//                }
-
+            break;
+        case ShapeType::Text:
+            if (clickedOnText(shape.mainPoints, pos)) {
                 currentOnShape = true;
                 emit shapeClicked("text");
             }
+            break;
+        default:
+            break;
         }
 
         if (currentOnShape) {
@@ -310,46 +319,56 @@ bool ShapesWidget::clickedOnShapes(QPointF pos)
         } else {
             m_selectedIndex = -1;
             m_selectedOrder = -1;
-            update();
+            updateShapesLayer();
             continue;
         }
     }
+    if (!onShapes && !m_shapes.isEmpty()) {
+        //鼠标不在任何图形附近，与逐个判断所有图形的结果保持一致
+        m_selectedIndex = -1;
+        m_selectedOrder = -1;
+        m_isSelected = false;
+        m_isResize = false;
+        m_isRotated = false;
+    }
     return onShapes;
 }
 
 //判断是否选中图形,不是真实鼠标事件会触发
 bool ShapesWidget::clickedShapes(QPointF pos)
 {
-    for (int i = 0; i < m_shapes.length(); i++) {
-        if (m_shapes[i].type == "rectangle") {
-            if (clickedOnRect(m_shapes[i].mainPoints, pos,
-                              m_shapes[i].isBlur || m_shapes[i].isMosaic)) {
-                return true;
-            }
-        }
-        if (m_shapes[i].type == "oval") {
-            if (clickedOnEllipse(m_shapes[i].mainPoints, pos,
-                                 m_shapes[i].isBlur || m_shapes[i].isMosaic)) {
-                return true;
-            }
-        }
-        if (m_shapes[i].type == "arrow") {
-            if (clickedOnArrow(m_shapes[i].points, pos)) {
-                return true;
-            }
-        }
-        if (m_shapes[i].type == "line") {
-            if (clickedOnLine(m_shapes[i].mainPoints, m_shapes[i].points, pos)) {
-                return true;
-            }
+    const QVector<int> candidates = shapesAt(pos);
+    for (int i : candidates) {
+        const Toolshape &shape = m_shapes.at(i);
+        bool clicked = false;
+        switch (shape.type) {
+        case ShapeType::Rectangle:
+            clicked = clickedOnRect(shape.mainPoints, pos, shape.isBlur || shape.isMosaic);
+            break;
+        case ShapeType::Oval:
+            clicked = clickedOnEllipse(shape.mainPoints, pos, shape.isBlur || shape.isMosaic);
+            break;
+        case ShapeType::Arrow:
+            clicked = clickedOnArrow(shape.points, pos);
+            break;
+        case ShapeType::Line:
+            clicked = clickedOnLine(shape.mainPoints, shape.points, pos);
+            break;
+        case ShapeType::Text:
+            clicked = clickedOnText(shape.mainPoints, pos);
+            break;
+        default:
+            break;
         }
-
-        if (m_shapes[i].type == "text") {
-            if (clickedOnText(m_shapes[i].mainPoints, pos)) {
-                return true;
-            }
+        if (clicked) {
+            return true;
         }
     }
+    if (!m_shapes.isEmpty()) {
+        m_isSelected = false;
+        m_isResize = false;
+        m_isRotated = false;
+    }
     return false;
 }
 
@@ -549,7 +568,7 @@ bool ShapesWidget::clickedOnEllipse(FourPoints mainPoints, QPointF pos, bool isB
 }
 
 //箭头是否被点击
-bool ShapesWidget::clickedOnArrow(QList<QPointF> points, QPointF pos)
+bool ShapesWidget::clickedOnArrow(QVector<QPointF> points, QPointF pos)
 {
     if (points.length() != 2)
         return false;
@@ -611,7 +630,7 @@ bool ShapesWidget::clickedOnArrow(QList<QPointF> points, QPointF pos)
 
 //画出的线是否被点击
 bool ShapesWidget::clickedOnLine(FourPoints mainPoints,
-                                 QList<QPointF> points,
+                                 QVector<QPointF> points,
                                  QPointF pos)
 {
     m_isSelected = false;
@@ -803,7 +822,7 @@ bool ShapesWidget::hoverOnEllipse(FourPoints mainPoints, QPointF pos)
     return false;
 }
 
-bool ShapesWidget::hoverOnArrow(QList<QPointF> points, QPointF pos)
+bool ShapesWidget::hoverOnArrow(QVector<QPointF> points, QPointF pos)
 {
     if (points.length() != 2)
         return false;
@@ -843,7 +862,7 @@ bool ShapesWidget::hoverOnArrow(QList<QPointF> points, QPointF pos)
     }
 }
 
-bool ShapesWidget::hoverOnLine(FourPoints mainPoints, QList<QPointF> points,
+bool ShapesWidget::hoverOnLine(FourPoints mainPoints, QVector<QPointF> points,
                                QPointF pos)
 {
     FourPoints tmpFPoints = getAnotherFPoints(mainPoints);
@@ -910,19 +929,22 @@ bool ShapesWidget::hoverOnText(int textIndex, FourPoints mainPoints, QPointF pos
 
 bool ShapesWidget::hoverOnShapes(Toolshape toolShape, QPointF pos)
 {
-    if (toolShape.type == "rectangle") {
+    switch (toolShape.type) {
+    case ShapeType::Rectangle:
         return hoverOnRect(toolShape.mainPoints, pos);
-    } else if (toolShape.type == "oval") {
+    case ShapeType::Oval:
         return hoverOnEllipse(toolShape.mainPoints, pos);
-    } else if (toolShape.type == "arrow") {
+    case ShapeType::Arrow:
         return hoverOnArrow(toolShape.points, pos);
-    } else if (toolShape.type == "line") {
+    case ShapeType::Line:
         return hoverOnLine(toolShape.mainPoints, toolShape.points, pos);
-    } else if (toolShape.type == "text") {
+    case ShapeType::Text:
         return hoverOnText(toolShape.index, toolShape.mainPoints, pos);
+    default:
+        break;
     }
 
-    m_hoveredShape.type = "";
+    m_hoveredShape.type = ShapeType::None;
     return false;
 }
 
@@ -959,8 +981,8 @@ bool ShapesWidget::textEditIsReadOnly()
         if (m_editing || !i.value()->isReadOnly()) {
             setAllTextEditReadOnly();
             m_editing = false;
-            m_currentShape.type = "";
-            update();
+            m_currentShape.type = ShapeType::None;
+            updateShapesLayer();
             return true;
         }
         ++i;
@@ -977,29 +999,23 @@ void ShapesWidget::handleDrag(QPointF oldPoint, QPointF newPoint)
         return;
     }
 
-    if (m_shapes[m_selectedOrder].type == "arrow") {
-        for (int i = 0; i < m_shapes[m_selectedOrder].points.length(); i++) {
-            m_shapes[m_selectedOrder].points[i] = QPointF(
-                                                      m_shapes[m_selectedOrder].points[i].x() + (newPoint.x() - oldPoint.x()),
-                                                      m_shapes[m_selectedOrder].points[i].y() + (newPoint.y() - oldPoint.y())
-                                                  );
+    //只取一次引用，点连续存放，逐个平移
+    Toolshape &shape = m_shapes[m_selectedOrder];
+    const QPointF delta = newPoint - oldPoint;
+    if (shape.type == ShapeType::Arrow) {
+        for (QPointF &point : shape.points) {
+            point += delta;
         }
         return;
     }
 
-    if (m_shapes[m_selectedOrder].mainPoints.length() == 4) {
-        for (int i = 0; i < m_shapes[m_selectedOrder].mainPoints.length(); i++) {
-            m_shapes[m_selectedOrder].mainPoints[i] = QPointF(
-                                                          m_shapes[m_selectedOrder].mainPoints[i].x() + (newPoint.x() - oldPoint.x()),
-                                                          m_shapes[m_selectedOrder].mainPoints[i].y() + (newPoint.y() - oldPoint.y())
-                                                      );
+    if (shape.mainPoints.length() == 4) {
+        for (QPointF &point : shape.mainPoints) {
+            point += delta;
         }
     }
-    for (int i = 0; i < m_shapes[m_selectedOrder].points.length(); i++) {
-        m_shapes[m_selectedOrder].points[i] = QPointF(
-                                                  m_shapes[m_selectedOrder].points[i].x() + (newPoint.x() - oldPoint.x()),
-                                                  m_shapes[m_selectedOrder].points[i].y() + (newPoint.y() - oldPoint.y())
-                                              );
+    for (QPointF &point : shape.points) {
+        point += delta;
     }
 }
 
@@ -1008,11 +1024,11 @@ void ShapesWidget::handleRotate(QPointF pos)
 {
     qDebug() << "handleRotate:" << m_selectedIndex << m_shapes.length();
 
-    if (m_selectedIndex == -1 || m_selectedShape.type == "text") {
+    if (m_selectedIndex == -1 || m_selectedShape.type == ShapeType::Text) {
         return;
     }
 
-    if (m_selectedShape.type == "arrow") {
+    if (m_selectedShape.type == ShapeType::Arrow) {
         if (m_isArrowRotated == false) {
             if (m_shapes[m_selectedOrder].isShiftPressed) {
                 if (static_cast<int>(m_shapes[m_selectedOrder].points[0].x()) == static_cast<int>(m_shapes[m_selectedOrder].points[1].x())) {
@@ -1158,6 +1174,8 @@ bool ShapesWidget::event(QEvent *event)
         if (QGesture *pinch = static_cast<QGestureEvent *>(event)->gesture(Qt::PinchGesture)) {
             pinchTriggered(static_cast<QPinchGesture *>(pinch));
         }
+        //手势会移动、旋转图形
+        updateShapesLayer();
 //        if (QGesture *pan = static_cast<QGestureEvent *>(event)->gesture(Qt::PanGesture)){
 //            if(static_cast<QPanGesture *>(pan)->state() == Qt::GestureState::GestureFinished){
 //            }
@@ -1170,11 +1188,95 @@ bool ShapesWidget::event(QEvent *event)
 //        }
 //        if (QGesture *tap = static_cast<QGestureEvent *>(event)->gesture(Qt::CustomGesture)){
 //        }
+    } else if (event->type() != QEvent::Paint && event->type() != QEvent::MouseMove
+               && event->type() != QEvent::HoverMove) {
+        // 鼠标移动由mouseMoveEvent按需重绘；绘制事件中再请求重绘会导致不停地重绘
+        update();
     }
-    update();
     return QWidget::event(event);
 }
 
+//新建文字图形的编辑框，连接编辑框的信号
+TextEdit *ShapesWidget::createTextEdit(int shapeIndex)
+{
+    TextEdit *edit = new TextEdit(shapeIndex, this);
+    connect(edit, &TextEdit::repaintTextRect, this, &ShapesWidget::updateTextRect);
+//    connect(edit, &TextEdit::backToEditing, this, [ = ] {
+//        m_editing = true;
+//    });
+    connect(edit, &TextEdit::clickToEditing, this, [ = ](int index) {
+//        setAllTextEditReadOnly();
+        for (int k = 0; k < m_shapes.length(); k++) {
+            if (m_shapes[k].type == ShapeType::Text && m_shapes[k].index == index) {
+                m_selectedIndex = index;
+                m_selectedShape = m_shapes[k];
+                m_selectedOrder = k;
+                m_currentShape = m_selectedShape;
+                break;
+            }
+        }
+        QMap<int, TextEdit *>::iterator i = m_editMap.begin();
+        while (i != m_editMap.end()) {
+            if (i.key() != index) {
+                i.value()->setReadOnly(true);
+                i.value()->setEditing(false);
+            } else {
+                i.value()->setEditing(true);
+            }
+            QTextCursor textCursor =  i.value()->textCursor();
+            textCursor.clearSelection();
+            i.value()->setTextCursor(textCursor);
+            ++i;
+        }
+        m_editing = true;
+        m_isSelectedText = false;
+        updateShapesLayer();
+        emit shapeClicked("text");
+
+    });
+
+    connect(edit, &TextEdit::textEditSelected, this, [ = ](int index) {
+//        setAllTextEditReadOnly();
+        if (m_selectedIndex != index) {
+            m_editing = false;
+            m_currentShape.type = ShapeType::None;
+            for (int i = 0; i < m_currentShape.mainPoints.length(); i++) {
+                m_currentShape.mainPoints[i] = QPointF(0, 0);
+            }
+        }
+        for (int k = 0; k < m_shapes.length(); k++) {
+            if (m_shapes[k].type == ShapeType::Text && m_shapes[k].index == index) {
+                m_selectedIndex = index;
+                m_selectedShape = m_shapes[k];
+                m_selectedOrder = k;
+                break;
+            }
+        }
+        QMap<int, TextEdit *>::iterator i = m_editMap.begin();
+        while (i != m_editMap.end()) {
+            if (i.key() != index) {
+                i.value()->setReadOnly(true);
+                i.value()->setEditing(false);
+            }
+
+            QTextCursor textCursor =  i.value()->textCursor();
+            textCursor.clearSelection();
+            i.value()->setTextCursor(textCursor);
+            ++i;
+        }
+        m_isSelectedText = true;
+        updateShapesLayer();
+        emit shapeClicked("text");
+    });
+
+    connect(edit, &TextEdit::textEditFinish, this, [ = ](int index) {
+//        setAllTextEditReadOnly();
+        Q_UNUSED(index);
+        setAllTextEditReadOnly();
+    });
+    return edit;
+}
+
 //重写鼠标按压事件
 void ShapesWidget::mousePressEvent(QMouseEvent *e)
 {
@@ -1192,8 +1294,8 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
                 m_editing = false;
                 m_selectedIndex = -1;
                 m_selectedOrder = -1;
-                m_selectedShape.type = "";
-                update();
+                m_selectedShape.type = ShapeType::None;
+                updateShapesLayer();
                 DFrame::mousePressEvent(e);
             }
         }
@@ -1209,8 +1311,8 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
         m_editing = false;
         m_selectedIndex = -1;
         m_selectedOrder = -1;
-        m_selectedShape.type = "";
-        update();
+        m_selectedShape.type = ShapeType::None;
+        updateShapesLayer();
         DFrame::mousePressEvent(e);
 
         //return;
@@ -1224,8 +1326,8 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
             m_editing = false;
             m_selectedIndex = -1;
             m_selectedOrder = -1;
-            m_selectedShape.type = "";
-            update();
+            m_selectedShape.type = ShapeType::None;
+            updateShapesLayer();
             DFrame::mousePressEvent(e);
             return;
         }
@@ -1245,9 +1347,10 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
     if (!clickedOnShapes(m_pressedPoint)) {
 
         m_isRecording = true;
+        m_currentShapeRect = QRect();
         //qDebug() << "no one shape be clicked!" << m_selectedIndex << m_shapes.length();
 
-        m_currentShape.type = m_currentType;
+        m_currentShape.type = ShapeType(m_currentType);
         m_currentShape.colorIndex = ConfigSettings::instance()->value(
                                         m_currentType, "color_index").toInt();
         m_currentShape.lineWidth = LINEWIDTH(ConfigSettings::instance()->value(
@@ -1262,6 +1365,7 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
             if (m_currentType == "line") {
                 m_currentShape.index = m_currentIndex;
                 m_currentShape.points.append(m_pos1);
+                m_currentLinePath = QPainterPath(m_pos1);
             } else if (m_currentType == "arrow") {
                 m_currentShape.index = m_currentIndex;
                 m_currentShape.isShiftPressed = m_isShiftPressed;
@@ -1282,12 +1386,8 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
                                               "rectangle", "is_mosaic").toBool();
                 m_currentShape.isShiftPressed = m_isShiftPressed;
                 m_currentShape.index = m_currentIndex;
-                if (m_currentShape.isBlur && !m_blurEffectExist) {
-                    emit reloadEffectImg("blur");
-                    m_blurEffectExist = true;
-                } else if (m_currentShape.isMosaic &&  !m_mosaicEffectExist) {
-                    emit reloadEffectImg("mosaic");
-                    m_mosaicEffectExist = true;
+                if ((m_currentShape.isBlur || m_currentShape.isMosaic) && m_shapeEffect->sourceSize().isEmpty()) {
+                    emit reloadEffectImg(m_currentShape.isBlur ? "blur" : "mosaic");
                 }
             } else if (m_currentType == "oval") {
                 m_currentShape.isBlur = ConfigSettings::instance()->value(
@@ -1296,12 +1396,8 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
                                               "oval", "is_mosaic").toBool();
                 m_currentShape.isShiftPressed = m_isShiftPressed;
                 m_currentShape.index = m_currentIndex;
-                if (m_currentShape.isBlur && !m_blurEffectExist) {
-                    emit reloadEffectImg("blur");
-                    m_blurEffectExist = true;
-                } else if (m_currentShape.isMosaic &&  !m_mosaicEffectExist) {
-                    emit reloadEffectImg("mosaic");
-                    m_mosaicEffectExist = true;
+                if ((m_currentShape.isBlur || m_currentShape.isMosaic) && m_shapeEffect->sourceSize().isEmpty()) {
+                    emit reloadEffectImg(m_currentShape.isBlur ? "blur" : "mosaic");
                 }
             } else if (m_currentType == "text") {
                 if (!m_editing) {
@@ -1310,7 +1406,7 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
                     m_currentShape.mainPoints[0] = m_pos1;
                     m_currentShape.index = m_currentIndex;
                     qDebug() << "new textedit:" << m_currentIndex;
-                    TextEdit *edit = new TextEdit(m_currentIndex, this);
+                    TextEdit *edit = createTextEdit(m_currentIndex);
                     QString t_editText = QString(tr("Input text here"));
                     edit->setPlainText(t_editText);
                     m_editing = true;
@@ -1332,80 +1428,6 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
 //                    updateTextRect();
 
 //
-
-                    connect(edit, &TextEdit::repaintTextRect, this, &ShapesWidget::updateTextRect);
-//                    connect(edit, &TextEdit::backToEditing, this, [ = ] {
-//                        m_editing = true;
-//                    });
-                    connect(edit, &TextEdit::clickToEditing, this, [ = ](int index) {
-//                        setAllTextEditReadOnly();
-                        for (int k = 0; k < m_shapes.length(); k++) {
-                            if (m_shapes[k].type == "text" && m_shapes[k].index == index) {
-                                m_selectedIndex = index;
-                                m_selectedShape = m_shapes[k];
-                                m_selectedOrder = k;
-                                m_currentShape = m_selectedShape;
-                                break;
-                            }
-                        }
-                        QMap<int, TextEdit *>::iterator i = m_editMap.begin();
-                        while (i != m_editMap.end()) {
-                            if (i.key() != index) {
-                                i.value()->setReadOnly(true);
-                                i.value()->setEditing(false);
-                            } else {
-                                i.value()->setEditing(true);
-                            }
-                            QTextCursor textCursor =  i.value()->textCursor();
-                            textCursor.clearSelection();
-                            i.value()->setTextCursor(textCursor);
-                            ++i;
-                        }
-                        m_editing = true;
-                        m_isSelectedText = false;
-                        emit shapeClicked("text");
-
-                    });
-
-                    connect(edit, &TextEdit::textEditSelected, this, [ = ](int index) {
-//                        setAllTextEditReadOnly();
-                        if (m_selectedIndex != index) {
-                            m_editing = false;
-                            m_currentShape.type = "";
-                            for (int i = 0; i < m_currentShape.mainPoints.length(); i++) {
-                                m_currentShape.mainPoints[i] = QPointF(0, 0);
-                            }
-                        }
-                        for (int k = 0; k < m_shapes.length(); k++) {
-                            if (m_shapes[k].type == "text" && m_shapes[k].index == index) {
-                                m_selectedIndex = index;
-                                m_selectedShape = m_shapes[k];
-                                m_selectedOrder = k;
-                                break;
-                            }
-                        }
-                        QMap<int, TextEdit *>::iterator i = m_editMap.begin();
-                        while (i != m_editMap.end()) {
-                            if (i.key() != index) {
-                                i.value()->setReadOnly(true);
-                                i.value()->setEditing(false);
-                            }
-
-                            QTextCursor textCursor =  i.value()->textCursor();
-                            textCursor.clearSelection();
-                            i.value()->setTextCursor(textCursor);
-                            ++i;
-                        }
-                        m_isSelectedText = true;
-                        emit shapeClicked("text");
-                    });
-
-                    connect(edit, &TextEdit::textEditFinish, this, [ = ](int index) {
-//                        setAllTextEditReadOnly();
-                        Q_UNUSED(index);
-                        setAllTextEditReadOnly();
-                    });
-
                     edit->setSelecting(true);
                     edit->setFocus();
                     edit->move(static_cast<int>(m_pos1.x()), static_cast<int>(m_pos1.y()));
@@ -1419,30 +1441,31 @@ void ShapesWidget::mousePressEvent(QMouseEvent *e)
 
 
                     for (int k = 0; k < m_shapes.length(); k++) {
-                        if (m_shapes[k].type == "text" && m_shapes[k].index == m_currentIndex) {
+                        if (m_shapes[k].type == ShapeType::Text && m_shapes[k].index == m_currentIndex) {
                             m_selectedOrder = k;
                             break;
                         }
                     }
 
-                    qDebug() << "Insert text shape:" << m_shapes.size() << m_currentShape.type << m_currentShape.index;
+                    qDebug() << "Insert text shape:" << m_shapes.size() << m_currentShape.type.name() << m_currentShape.index;
                 } else {
                     m_editing = false;
                     setAllTextEditReadOnly();
 
                 }
             }
-            update();
+            updateShapesLayer();
         }
     } else {
         m_isRecording = false;
+        beginShapeTransform();
         //qDebug() << "some on shape be clicked!";
         if (m_editing && m_editMap.contains(m_shapes[m_selectedOrder].index)) {
             m_editMap.value(m_shapes[m_selectedOrder].index)->setReadOnly(true);
             m_editMap.value(m_shapes[m_selectedOrder].index)->setCursorVisible(false);
             m_editMap.value(m_shapes[m_selectedOrder].index)->setFocusPolicy(Qt::NoFocus);
         }
-        update();
+        updateShapesLayer();
     }
     DFrame::mousePressEvent(e);
 
@@ -1452,6 +1475,7 @@ void ShapesWidget::mouseReleaseEvent(QMouseEvent *e)
 {
     m_isPressed = false;
     m_isMoving = false;
+    commitShapeTransform();
 
     if (Qt::MouseEventSource::MouseEventSynthesizedByQt == e->source()
             && -1 != m_selectedIndex
@@ -1465,13 +1489,14 @@ void ShapesWidget::mouseReleaseEvent(QMouseEvent *e)
         m_editing = false;
         m_selectedIndex = -1;
         m_selectedOrder = -1;
-        m_selectedShape.type = "";
-        update();
+        m_selectedShape.type = ShapeType::None;
+        updateShapesLayer();
         DFrame::mousePressEvent(e);
     }
 
     //qDebug() << m_isRecording << m_isSelected << m_pos2;
     if (m_isRecording && !m_isSelected && m_pos2 != QPointF(0, 0)) {
+        const int shapesCount = m_shapes.length();
         if (m_currentType == "arrow") {
             if (m_currentShape.points.length() == 2) {
                 if (m_isShiftPressed) {
@@ -1489,6 +1514,8 @@ void ShapesWidget::mouseReleaseEvent(QMouseEvent *e)
                 m_shapes.append(m_currentShape);
             }
         } else if (m_currentType == "line") {
+            //只保存简化后的折线，与原线条的偏差不超过半个像素，绘制和点击判断都只需处理少量的点
+            m_currentShape.points = simplifyLine(m_currentShape.points, 0.5);
             FourPoints lineFPoints = fourPointsOfLine(m_currentShape.points);
             m_currentShape.mainPoints = lineFPoints;
             m_shapes.append(m_currentShape);
@@ -1497,23 +1524,27 @@ void ShapesWidget::mouseReleaseEvent(QMouseEvent *e)
             m_currentShape.mainPoints = rectFPoints;
             m_shapes.append(m_currentShape);
         }
+        if (m_shapes.length() > shapesCount) {
+            m_history.push(ShapesHistory::addShape(m_shapes.length() - 1, m_shapes.last()));
+        }
 
         //qDebug() << "ShapesWidget num:" << m_shapes.length();
         clearSelected();
     }
 
     m_isRecording = false;
-    if (m_currentShape.type != "text") {
+    if (m_currentShape.type != ShapeType::Text) {
         for (int i = 0; i < m_currentShape.mainPoints.length(); i++) {
             m_currentShape.mainPoints[i] = QPointF(0, 0);
         }
     }
 
     m_currentShape.points.clear();
+    m_currentLinePath = QPainterPath();
     m_pos1 = QPointF(0, 0);
     m_pos2 = QPointF(0, 0);
 
-    update();
+    updateShapesLayer();
     DFrame::mouseReleaseEvent(e);
 }
 
@@ -1534,7 +1565,7 @@ void ShapesWidget::mouseMoveEvent(QMouseEvent *e)
         m_pos2 = e->pos();
         updateCursorShape();
 
-        if (m_currentShape.type == "arrow") {
+        if (m_currentShape.type == ShapeType::Arrow) {
             if (m_currentShape.points.length() <= 1) {
                 if (m_isShiftPressed) {
                     if (std::atan2(std::abs(m_pos2.y() - m_pos1.y()),
@@ -1559,23 +1590,26 @@ void ShapesWidget::mouseMoveEvent(QMouseEvent *e)
                 }
             }
         }
-        if (m_currentShape.type == "line") {
+        if (m_currentShape.type == ShapeType::Line) {
             if (getDistance(m_currentShape.points[m_currentShape.points.length() - 1], m_pos2) > 3) {
                 m_currentShape.points.append(m_pos2);
-
+                m_currentLinePath.lineTo(m_pos2);
             }
         }
-        update();
+        // 已完成的图形不变，只重绘正在绘制的图形新旧位置所在的范围
+        const QRect currentShapeRect = currentShapeDirtyRect();
+        update(m_currentShapeRect.united(currentShapeRect));
+        m_currentShapeRect = currentShapeRect;
     } else if (!m_isRecording && m_isPressed) {
         if (m_isRotated && m_isPressed) {
             handleRotate(e->pos());
-            update();
+            updateTransformedShape();
         }
 
         if (m_isResize && m_isPressed) {
             // resize function
             handleResize(QPointF(e->pos()), m_clickedKey);
-            update();
+            updateTransformedShape();
             DFrame::mouseMoveEvent(e);
             return;
         }
@@ -1586,13 +1620,13 @@ void ShapesWidget::mouseMoveEvent(QMouseEvent *e)
             m_selectedShape = m_shapes[m_selectedOrder];
             m_hoveredShape = m_shapes[m_selectedOrder];
 
-            if (m_selectedShape.type == "text") {
+            if (m_selectedShape.type == ShapeType::Text) {
                 m_editMap.value(m_selectedIndex)->move(static_cast<int>(m_selectedShape.mainPoints[0].x()),
                                                        static_cast<int>(m_selectedShape.mainPoints[0].y()));
             }
 
             m_pressedPoint = m_movingPoint;
-            update();
+            updateTransformedShape();
         }
 
 
@@ -1600,7 +1634,8 @@ void ShapesWidget::mouseMoveEvent(QMouseEvent *e)
     } else {
         if (!m_isRecording) {
             m_isHovered = false;
-            for (int i = 0; i < m_shapes.length(); i++) {
+            const QVector<int> candidates = shapesAt(e->pos());
+            for (int i : candidates) {
                 m_hoveredIndex = m_shapes[i].index;
 
                 if (hoverOnShapes(m_shapes[i],  e->pos())) {
@@ -1661,23 +1696,18 @@ void ShapesWidget::mouseMoveEvent(QMouseEvent *e)
                     } else {
                         updateCursorShape();
                     }
-                    update();
                     break;
-                } else {
-                    updateCursorShape();
-                    update();
                 }
             }
             if (!m_isHovered) {
+                m_resizeDirection = Outting;
+                updateCursorShape();
                 for (int j = 0; j < m_hoveredShape.mainPoints.length(); j++) {
                     m_hoveredShape.mainPoints[j] = QPointF(0, 0);
                 }
-                m_hoveredShape.type = "";
-                update();
-            }
-            if (m_shapes.length() == 0) {
-                updateCursorShape();
+                m_hoveredShape.type = ShapeType::None;
             }
+            updateHoveredShape();
         } else {
             //TODO text
         }
@@ -1692,7 +1722,7 @@ void ShapesWidget::updateTextRect(TextEdit *edit, QRectF newRect)
     //qDebug() << "updateTextRect:" << newRect << index;
     for (int j = 0; j < m_shapes.length(); j++) {
 //        qDebug() << "updateTextRect  updating:" << j << m_shapes[j].index << index;
-        if (m_shapes[j].type == "text" && m_shapes[j].index == index) {
+        if (m_shapes[j].type == ShapeType::Text && m_shapes[j].index == index) {
             m_shapes[j].mainPoints[0] = QPointF(newRect.x(), newRect.y());
             m_shapes[j].mainPoints[1] = QPointF(newRect.x(), newRect.y() + newRect.height());
             m_shapes[j].mainPoints[2] = QPointF(newRect.x() + newRect.width(), newRect.y());
@@ -1704,7 +1734,7 @@ void ShapesWidget::updateTextRect(TextEdit *edit, QRectF newRect)
             m_selectedOrder = j;
         }
     }
-    update();
+    updateShapesLayer();
 }
 
 void ShapesWidget::paintImgPoint(QPainter &painter, QPointF pos, QPixmap img, bool isResize)
@@ -1726,7 +1756,7 @@ void ShapesWidget::paintImgPointArrow(QPainter &painter, QPointF pos, QPixmap im
 }
 */
 void ShapesWidget::paintRect(QPainter &painter, FourPoints rectFPoints, int index,
-                             ShapeBlurStatus rectStatus, bool isBlur, bool isMosaic)
+                             ShapeBlurStatus rectStatus, bool isBlur, bool isMosaic, int shapeIndex)
 {
     QPainterPath rectPath;
     if (rectStatus  == Hovered || ((isBlur || isMosaic) && index == m_selectedIndex)) {
@@ -1745,19 +1775,19 @@ void ShapesWidget::paintRect(QPainter &painter, FourPoints rectFPoints, int inde
 //    using namespace utils;
     if (isBlur) {
         painter.setClipPath(rectPath);
-        painter.drawPixmap(0, 0,  width(), height(),  TempFile::instance()->getBlurPixmap());
+        paintEffect(painter, rectPath, shapeIndex, false);
         painter.drawPath(rectPath);
     }
     if (isMosaic) {
         painter.setClipPath(rectPath);
-        painter.drawPixmap(0, 0,  width(), height(),  TempFile::instance()->getMosaicPixmap());
+        paintEffect(painter, rectPath, shapeIndex, true);
         painter.drawPath(rectPath);
     }
     painter.setClipping(false);
 }
 
 void ShapesWidget::paintEllipse(QPainter &painter, FourPoints ellipseFPoints, int index,
-                                ShapeBlurStatus  ovalStatus, bool isBlur, bool isMosaic)
+                                ShapeBlurStatus  ovalStatus, bool isBlur, bool isMosaic, int shapeIndex)
 {
     if (ovalStatus  == Hovered || ((isBlur || isMosaic) && index == m_selectedIndex)) {
         painter.setPen(QColor("#01bdff"));
@@ -1766,7 +1796,7 @@ void ShapesWidget::paintEllipse(QPainter &painter, FourPoints ellipseFPoints, in
     }
 
     FourPoints minorPoints = getAnotherFPoints(ellipseFPoints);
-    QList<QPointF> eightControlPoints = getEightControlPoint(ellipseFPoints);
+    QVector<QPointF> eightControlPoints = getEightControlPoint(ellipseFPoints);
     QPainterPath ellipsePath;
     QPainterPath rectPath;
 //    qDebug() << "here" << ellipseFPoints[0].y() - ellipseFPoints[2].y();
@@ -1796,23 +1826,23 @@ void ShapesWidget::paintEllipse(QPainter &painter, FourPoints ellipseFPoints, in
 //    using namespace utils;
     if (isBlur) {
         painter.setClipPath(ellipsePath);
-        painter.drawPixmap(0, 0,  width(), height(),  TempFile::instance()->getBlurPixmap());
+        paintEffect(painter, ellipsePath, shapeIndex, false);
         painter.drawPath(ellipsePath);
     }
     if (isMosaic) {
         painter.setClipPath(ellipsePath);
-        painter.drawPixmap(0, 0,  width(), height(),  TempFile::instance()->getMosaicPixmap());
+        paintEffect(painter, ellipsePath, shapeIndex, true);
         painter.drawPath(ellipsePath);
     }
     painter.setClipping(false);
 }
 
-void ShapesWidget::paintArrow(QPainter &painter, QList<QPointF> lineFPoints,
+void ShapesWidget::paintArrow(QPainter &painter, QVector<QPointF> lineFPoints,
                               int lineWidth, bool isStraight)
 {
     if (lineFPoints.length() == 2) {
         if (!isStraight) {
-            QList<QPointF> arrowPoints = pointOfArrow(lineFPoints[0],
+            QVector<QPointF> arrowPoints = pointOfArrow(lineFPoints[0],
                                                       lineFPoints[1], 8 + (lineWidth - 1) * 2);
             QPainterPath path;
             const QPen oldPen = painter.pen();
@@ -1831,18 +1861,13 @@ void ShapesWidget::paintArrow(QPainter &painter, QList<QPointF> lineFPoints,
     }
 }
 
-void ShapesWidget::paintLine(QPainter &painter, QList<QPointF> lineFPoints)
+//画笔保存的是简化后的折线，按折线绘制，每个点都要经过
+void ShapesWidget::paintLine(QPainter &painter, QVector<QPointF> lineFPoints)
 {
-    QPainterPath linePaths;
-    if (lineFPoints.length() >= 1)
-        linePaths.moveTo(lineFPoints[0]);
-    else
+    if (lineFPoints.length() < 2)
         return;
 
-    for (int k = 1; k < lineFPoints.length() - 2; k++) {
-        linePaths.quadTo(lineFPoints[k], lineFPoints[k + 1]);
-    }
-    painter.drawPath(linePaths);
+    painter.drawPolyline(QPolygonF(lineFPoints));
 }
 
 void ShapesWidget::paintText(QPainter &painter, FourPoints rectFPoints)
@@ -1860,61 +1885,251 @@ void ShapesWidget::paintText(QPainter &painter, FourPoints rectFPoints)
     }
 }
 
-void ShapesWidget::paintEvent(QPaintEvent *)
+void ShapesWidget::setEffectSource(const QPixmap &source)
 {
-    QPainter painter(this);
+    m_shapeEffect->setSource(source);
+    updateShapesLayer();
+}
+
+void ShapesWidget::flushEffects()
+{
+    m_shapeEffect->flush();
+    //重新生成缓存，绘制时请求图形当前范围中还未计算的部分
+    m_shapesLayerDirty = true;
+    repaint();
+    if (m_shapeEffect->flush()) {
+        m_shapesLayerDirty = true;
+        repaint();
+    }
+}
+
+//效果图的坐标为原图的设备像素，画到窗口中对应的位置
+void ShapesWidget::paintEffect(QPainter &painter, const QPainterPath &path, int shapeIndex, bool isMosaic)
+{
+    const QSize sourceSize = m_shapeEffect->sourceSize();
+    if (sourceSize.isEmpty() || width() <= 0 || height() <= 0) {
+        return;
+    }
+    const qreal scaleX = sourceSize.width() / static_cast<qreal>(width());
+    const qreal scaleY = sourceSize.height() / static_cast<qreal>(height());
+    const QRectF bound = path.boundingRect();
+    const QRect rect = QRectF(bound.x() * scaleX, bound.y() * scaleY,
+                              bound.width() * scaleX, bound.height() * scaleY).toAlignedRect();
+    QRect effectRect;
+    const QPixmap effect = m_shapeEffect->effect(shapeIndex, isMosaic, rect, effectRect);
+    if (effect.isNull()) {
+        return;
+    }
+    painter.drawPixmap(QRectF(effectRect.x() / scaleX, effectRect.y() / scaleY,
+                              effectRect.width() / scaleX, effectRect.height() / scaleY),
+                       effect, QRectF(effect.rect()));
+}
+
+//已完成的图形发生变化，下次绘制时重新生成缓存
+void ShapesWidget::updateShapesLayer()
+{
+    m_shapesLayerDirty = true;
+    m_shapesGridDirty = true;
+    update();
+}
+
+//图形在窗口中的范围，margin为线宽、箭头等超出图形顶点的部分
+QRect ShapesWidget::shapeBoundingRect(const Toolshape &shape, int margin) const
+{
+    QRectF rect;
+    if (shape.type == ShapeType::Arrow || shape.type == ShapeType::Line) {
+        for (const QPointF &point : shape.points) {
+            rect = rect.united(QRectF(point, QSizeF(1, 1)));
+        }
+    } else {
+        for (const QPointF &point : shape.mainPoints) {
+            rect = rect.united(QRectF(point, QSizeF(1, 1)));
+        }
+    }
+    if (rect.isNull()) {
+        return QRect();
+    }
+    return rect.toAlignedRect().adjusted(-margin, -margin, margin, margin);
+}
+
+//移动、缩放、旋转中的图形需要重绘的范围：线宽、缩放点超出图形顶点的部分，及图形外的旋转图标
+QRect ShapesWidget::transformedShapeRect(const Toolshape &shape) const
+{
+    QRect rect = shapeBoundingRect(shape, shape.lineWidth * 3 + RESIZEPOINT_WIDTH);
+    if (shape.mainPoints.length() == 4 && !rect.isNull()) {
+        const QPointF rotatePoint = getRotatePoint(shape.mainPoints[0], shape.mainPoints[1],
+                                                   shape.mainPoints[2], shape.mainPoints[3]);
+        rect = rect.united(QRect(rotatePoint.toPoint(), QSize(1, 1)).adjusted(-ROTATE_ICON_SIZE.width(), -ROTATE_ICON_SIZE.height(),
+                                                                              ROTATE_ICON_SIZE.width(), ROTATE_ICON_SIZE.height()));
+    }
+    return rect;
+}
+
+//移动、缩放、旋转中的图形不在缓存中，缓存不必重新生成，只重绘图形新旧位置所在的范围
+void ShapesWidget::updateTransformedShape()
+{
+    const int order = (m_overlayIndex != -1) ? shapeOrder(m_overlayIndex) : -1;
+    if (order == -1) {
+        updateShapesLayer();
+        return;
+    }
+    m_shapesGridDirty = true;
+    const QRect rect = transformedShapeRect(m_shapes[order]);
+    update(m_overlayRect.united(rect));
+    m_overlayRect = rect;
+}
+
+//正在绘制的图形需要重绘的范围，画笔只需要重绘最后一段
+QRect ShapesWidget::currentShapeDirtyRect() const
+{
+    const int margin = m_currentShape.lineWidth * 3 + 10;
+    if (m_currentShape.type == ShapeType::Rectangle || m_currentShape.type == ShapeType::Oval) {
+        Toolshape shape;
+        shape.mainPoints = getMainPoints(m_pos1, m_pos2, m_isShiftPressed);
+        return shapeBoundingRect(shape, margin);
+    } else if (m_currentShape.type == ShapeType::Arrow) {
+        return shapeBoundingRect(m_currentShape, margin);
+    } else if (m_currentShape.type == ShapeType::Line) {
+        Toolshape shape;
+        shape.type = m_currentShape.type;
+        shape.points = m_currentShape.points.mid(qMax(0, m_currentShape.points.length() - 4));
+        return shapeBoundingRect(shape, margin);
+    }
+    return QRect();
+}
+
+//图形变化后重新生成网格索引；图形列表被直接替换时按数量判断
+QVector<int> ShapesWidget::shapesAt(const QPointF &pos)
+{
+    if (m_shapesGridDirty || m_shapesGrid.count() != m_shapes.length()) {
+        m_shapesGrid.clear();
+        for (int i = 0; i < m_shapes.length(); i++) {
+            m_shapesGrid.insertShape(i, m_shapes[i]);
+        }
+        m_shapesGridDirty = false;
+    }
+    return m_shapesGrid.shapesAt(pos);
+}
+
+//悬停的图形变化时，只重绘新旧图形所在的范围
+void ShapesWidget::updateHoveredShape()
+{
+    const int hoveredIndex = m_isHovered ? m_hoveredShape.index : -1;
+    const QRect hoveredRect = m_isHovered ? shapeBoundingRect(m_hoveredShape, 10) : QRect();
+    if (hoveredIndex == m_lastHoveredIndex && hoveredRect == m_hoveredRect) {
+        return;
+    }
+    update(m_hoveredRect.united(hoveredRect));
+    m_lastHoveredIndex = hoveredIndex;
+    m_hoveredRect = hoveredRect;
+}
+
+//将所有已完成的图形绘制到缓存中
+void ShapesWidget::paintShapesLayer()
+{
+    const qreal ratio = devicePixelRatioF();
+    m_shapesLayer = QPixmap(size() * ratio);
+    m_shapesLayer.setDevicePixelRatio(ratio);
+    m_shapesLayer.fill(Qt::transparent);
+    m_shapesLayerDirty = false;
+
+    QPainter painter(&m_shapesLayer);
     painter.setRenderHints(QPainter::Antialiasing);
-    QPen pen;
     for (int i = 0; i < m_shapes.length(); i++) {
-        pen.setColor(BaseUtils::colorIndexOf(m_shapes[i].colorIndex));
-        pen.setWidthF(m_shapes[i].lineWidth - 0.5);
+        //移动、缩放、旋转中的图形在缓存之上单独绘制
+        if (m_overlayIndex != -1 && m_shapes.at(i).index == m_overlayIndex) {
+            continue;
+        }
+        paintShape(painter, i);
+    }
 
-        if (m_shapes[i].type == "rectangle") {
-            pen.setJoinStyle(Qt::MiterJoin);
-            painter.setPen(pen);
-            if ((m_shapes[i].isBlur || m_shapes[i].isMosaic) && m_selectedOrder == i) {
-                //画出具有模糊和马赛克效果的矩形框
-                paintRect(painter, m_shapes[i].mainPoints, i, Drawing,
-                          m_shapes[i].isBlur, m_shapes[i].isMosaic);
-            } else {
-                //画出普通的矩形框
-                paintRect(painter, m_shapes[i].mainPoints, m_shapes.length(), Normal,
-                          m_shapes[i].isBlur, m_shapes[i].isMosaic);
-            }
-        } else if (m_shapes[i].type == "oval") {
-            pen.setJoinStyle(Qt::MiterJoin);
-            painter.setPen(pen);
-            if ((m_shapes[i].isBlur || m_shapes[i].isMosaic) && m_selectedOrder == i) {
-                paintEllipse(painter, m_shapes[i].mainPoints, i, Drawing,
-                             m_shapes[i].isBlur, m_shapes[i].isMosaic);
-            } else {
-                paintEllipse(painter, m_shapes[i].mainPoints, m_shapes.length(), Normal,
-                             m_shapes[i].isBlur, m_shapes[i].isMosaic);
-            }
-        } else if (m_shapes[i].type == "arrow") {
-            pen.setJoinStyle(Qt::MiterJoin);
-            painter.setPen(pen);
-            paintArrow(painter, m_shapes[i].points, pen.width(), m_shapes[i].isStraight);
-        } else if (m_shapes[i].type == "line") {
-            pen.setJoinStyle(Qt::RoundJoin);
-            painter.setPen(pen);
-            paintLine(painter, m_shapes[i].points);
-        } else if (m_shapes[i].type == "text" && !m_clearAllTextBorder) {
-//            qDebug() << "*&^" << m_shapes[i].type << m_shapes[i].index << m_selectedIndex << i;
-            QMap<int, TextEdit *>::iterator m = m_editMap.begin();
-            while (m != m_editMap.end()) {
-                if (m.key() == m_shapes[i].index) {
-                    if (!(m.value()->isReadOnly() && m_selectedIndex != i)) {
-                        paintText(painter, m_shapes[i].mainPoints);
-                    }
-                    break;
-                }
-                ++m;
+    //释放已删除图形的效果图
+    QList<int> effectIndexes;
+    effectIndexes << m_currentShape.index;
+    for (const Toolshape &shape : m_shapes) {
+        if (shape.isBlur || shape.isMosaic) {
+            effectIndexes << shape.index;
+        }
+    }
+    m_shapeEffect->retain(effectIndexes);
+}
+
+//绘制一个已完成的图形
+void ShapesWidget::paintShape(QPainter &painter, int order)
+{
+    QPen pen;
+    const Toolshape &shape = m_shapes.at(order);
+    pen.setColor(BaseUtils::colorIndexOf(shape.colorIndex));
+    pen.setWidthF(shape.lineWidth - 0.5);
+
+    switch (shape.type) {
+    case ShapeType::Rectangle:
+        pen.setJoinStyle(Qt::MiterJoin);
+        painter.setPen(pen);
+        if ((shape.isBlur || shape.isMosaic) && m_selectedOrder == order) {
+            //画出具有模糊和马赛克效果的矩形框
+            paintRect(painter, shape.mainPoints, order, Drawing,
+                      shape.isBlur, shape.isMosaic, shape.index);
+        } else {
+            //画出普通的矩形框
+            paintRect(painter, shape.mainPoints, m_shapes.length(), Normal,
+                      shape.isBlur, shape.isMosaic, shape.index);
+        }
+        break;
+    case ShapeType::Oval:
+        pen.setJoinStyle(Qt::MiterJoin);
+        painter.setPen(pen);
+        if ((shape.isBlur || shape.isMosaic) && m_selectedOrder == order) {
+            paintEllipse(painter, shape.mainPoints, order, Drawing,
+                         shape.isBlur, shape.isMosaic, shape.index);
+        } else {
+            paintEllipse(painter, shape.mainPoints, m_shapes.length(), Normal,
+                         shape.isBlur, shape.isMosaic, shape.index);
+        }
+        break;
+    case ShapeType::Arrow:
+        pen.setJoinStyle(Qt::MiterJoin);
+        painter.setPen(pen);
+        paintArrow(painter, shape.points, pen.width(), shape.isStraight);
+        break;
+    case ShapeType::Line:
+        pen.setJoinStyle(Qt::RoundJoin);
+        painter.setPen(pen);
+        paintLine(painter, shape.points);
+        break;
+    case ShapeType::Text:
+        if (!m_clearAllTextBorder) {
+            QMap<int, TextEdit *>::const_iterator edit = m_editMap.constFind(shape.index);
+            if (edit != m_editMap.constEnd() && !(edit.value()->isReadOnly() && m_selectedIndex != order)) {
+                paintText(painter, shape.mainPoints);
             }
         }
+        break;
+    default:
+        break;
+    }
+}
+
+void ShapesWidget::paintEvent(QPaintEvent *e)
+{
+    const qreal ratio = devicePixelRatioF();
+    if (m_shapesLayerDirty || m_shapesLayer.size() != size() * ratio
+            || !qFuzzyCompare(m_shapesLayer.devicePixelRatio(), ratio)) {
+        paintShapesLayer();
     }
 
-    if ((m_pos1 != QPointF(0, 0) && m_pos2 != QPointF(0, 0)) || m_currentShape.type == "text") {
+    QPainter painter(this);
+    painter.setRenderHints(QPainter::Antialiasing);
+    //已完成的图形直接使用缓存，只绘制需要重绘的区域
+    const QRectF dirtyRect = e->rect();
+    painter.drawPixmap(dirtyRect, m_shapesLayer,
+                       QRectF(dirtyRect.topLeft() * ratio, dirtyRect.size() * ratio));
+    const int overlayOrder = (m_overlayIndex != -1) ? shapeOrder(m_overlayIndex) : -1;
+    if (overlayOrder != -1) {
+        paintShape(painter, overlayOrder);
+    }
+    QPen pen;
+    if ((m_pos1 != QPointF(0, 0) && m_pos2 != QPointF(0, 0)) || m_currentShape.type == ShapeType::Text) {
         FourPoints currentFPoint =  getMainPoints(m_pos1, m_pos2, m_isShiftPressed);
         pen.setColor(BaseUtils::colorIndexOf(m_currentShape.colorIndex));
         pen.setWidthF(m_currentShape.lineWidth - 0.5);
@@ -1923,35 +2138,36 @@ void ShapesWidget::paintEvent(QPaintEvent *)
 //                 << ", m_currentShape.type: " << m_currentShape.type
 //                 << ", m_currentType: " << m_currentType;
 
-        if (m_currentType == "rectangle" && m_currentShape.type != "text") {
+        const ShapeType currentType(m_currentType);
+        if (currentType == ShapeType::Rectangle && m_currentShape.type != ShapeType::Text) {
             pen.setJoinStyle(Qt::MiterJoin);
             painter.setPen(pen);
             if (m_currentShape.isBlur || m_currentShape.isMosaic) {
                 paintRect(painter, currentFPoint, m_shapes.length(), Drawing,
-                          m_currentShape.isBlur, m_currentShape.isMosaic);
+                          m_currentShape.isBlur, m_currentShape.isMosaic, m_currentShape.index);
             } else {
                 paintRect(painter, currentFPoint, m_shapes.length(), Normal,
-                          m_currentShape.isBlur, m_currentShape.isMosaic);
+                          m_currentShape.isBlur, m_currentShape.isMosaic, m_currentShape.index);
             }
-        } else if (m_currentType == "oval" && m_currentShape.type != "text") {
+        } else if (currentType == ShapeType::Oval && m_currentShape.type != ShapeType::Text) {
             pen.setJoinStyle(Qt::MiterJoin);
             painter.setPen(pen);
             if (m_currentShape.isBlur || m_currentShape.isMosaic) {
                 paintEllipse(painter, currentFPoint, m_shapes.length(), Drawing,
-                             m_currentShape.isBlur, m_currentShape.isMosaic);
+                             m_currentShape.isBlur, m_currentShape.isMosaic, m_currentShape.index);
             } else {
                 paintEllipse(painter, currentFPoint, m_shapes.length(), Normal,
-                             m_currentShape.isBlur, m_currentShape.isMosaic);
+                             m_currentShape.isBlur, m_currentShape.isMosaic, m_currentShape.index);
             }
-        } else if (m_currentType == "arrow" && m_currentShape.type != "text") {
+        } else if (currentType == ShapeType::Arrow && m_currentShape.type != ShapeType::Text) {
             pen.setJoinStyle(Qt::MiterJoin);
             painter.setPen(pen);
             paintArrow(painter, m_currentShape.points, pen.width(), m_currentShape.isStraight);
-        } else if (m_currentType == "line" && m_currentShape.type != "text") {
+        } else if (currentType == ShapeType::Line && m_currentShape.type != ShapeType::Text) {
             pen.setJoinStyle(Qt::RoundJoin);
             painter.setPen(pen);
-            paintLine(painter, m_currentShape.points);
-        } else if (m_currentType == "text" && !m_clearAllTextBorder) {
+            painter.drawPath(m_currentLinePath);
+        } else if (currentType == ShapeType::Text && !m_clearAllTextBorder) {
             if (m_editing) {
                 paintText(painter, m_currentShape.mainPoints);
             }
@@ -1962,25 +2178,32 @@ void ShapesWidget::paintEvent(QPaintEvent *)
             && m_hoveredIndex != -1) {
         pen.setWidthF(0.5);
         pen.setColor("#01bdff");
-        if (m_hoveredShape.type == "rectangle") {
+        switch (m_hoveredShape.type) {
+        case ShapeType::Rectangle:
             pen.setJoinStyle(Qt::MiterJoin);
             painter.setPen(pen);
             paintRect(painter, m_hoveredShape.mainPoints, m_hoveredIndex,  Hovered,
                       false, false);
-        } else if (m_hoveredShape.type == "oval") {
+            break;
+        case ShapeType::Oval:
             pen.setJoinStyle(Qt::MiterJoin);
             pen.setCapStyle(Qt::SquareCap);
             painter.setPen(pen);
             paintEllipse(painter, m_hoveredShape.mainPoints, m_hoveredIndex, Hovered,
                          false, false);
-        } else if (m_hoveredShape.type == "arrow") {
+            break;
+        case ShapeType::Arrow:
             pen.setJoinStyle(Qt::MiterJoin);
             painter.setPen(pen);
             paintArrow(painter, m_hoveredShape.points, pen.width(), true);
-        } else if (m_hoveredShape.type == "line") {
+            break;
+        case ShapeType::Line:
             pen.setJoinStyle(Qt::RoundJoin);
             painter.setPen(pen);
             paintLine(painter, m_hoveredShape.points);
+            break;
+        default:
+            break;
         }
     } else {
 //        qDebug() << "hoveredShape type:" << m_hoveredShape.type;
@@ -1993,7 +2216,7 @@ void ShapesWidget::paintEvent(QPaintEvent *)
     resizePointImg.setDevicePixelRatio(ration);
 
     //只有当选中图形时m_selectedShape才会有内容
-    if (m_selectedShape.type == "arrow" && m_selectedShape.points.length() == 2) {
+    if (m_selectedShape.type == ShapeType::Arrow && m_selectedShape.points.length() == 2) {
 
 //        qreal t_minx = qMin(m_selectedShape.points[1].x(), m_selectedShape.points[0].x());
 //        qreal t_miny = qMin(m_selectedShape.points[1].y(), m_selectedShape.points[0].y());
@@ -2013,15 +2236,15 @@ void ShapesWidget::paintEvent(QPaintEvent *)
 //        rotatePointImg.setDevicePixelRatio(this->devicePixelRatioF());
 //        paintImgPointArrow(painter, t_midpos, rotatePointImg);
 
-    } else if (m_selectedShape.type != "" && m_selectedShape.type != "text") {
-        if (m_selectedShape.mainPoints[0] != QPointF(0, 0) || m_selectedShape.type == "arrow") {
+    } else if (m_selectedShape.type != ShapeType::None && m_selectedShape.type != ShapeType::Text) {
+        if (m_selectedShape.mainPoints[0] != QPointF(0, 0) || m_selectedShape.type == ShapeType::Arrow) {
 
             QPointF rotatePoint = getRotatePoint(m_selectedShape.mainPoints[0],
                                                  m_selectedShape.mainPoints[1],
                                                  m_selectedShape.mainPoints[2],
                                                  m_selectedShape.mainPoints[3]);
 
-            if (m_selectedShape.type == "oval" || m_selectedShape.type == "line") {
+            if (m_selectedShape.type == ShapeType::Oval || m_selectedShape.type == ShapeType::Line) {
                 pen.setJoinStyle(Qt::MiterJoin);
                 pen.setWidth(1);
                 pen.setColor(QColor("#01bdff"));
@@ -2048,7 +2271,7 @@ void ShapesWidget::paintEvent(QPaintEvent *)
             }
         }
     }
-    if (m_shapes.length() > 0) {
+    if (m_shapes.length() > 0 || m_history.canUndo()) {
         emit setShapesUndo(true);
     }
 }
@@ -2068,6 +2291,9 @@ void ShapesWidget::pinchTriggered(QPinchGesture *pinch)
 {
     if (-1 == m_selectedIndex || "text" == m_currentType)
         return;
+    if (pinch->state() == Qt::GestureStarted && !m_isTransforming) {
+        beginShapeTransform();
+    }
     QPinchGesture::ChangeFlags changeFlags = pinch->changeFlags();
     if (changeFlags & QPinchGesture::RotationAngleChanged) {
         qreal rotationDelta = (pinch->rotationAngle() - pinch->lastRotationAngle()) * 0.01;
@@ -2123,6 +2349,9 @@ void ShapesWidget::pinchTriggered(QPinchGesture *pinch)
             m_shapes[m_selectedOrder].points[k].setY(y);
         }
     }
+    if (pinch->state() == Qt::GestureFinished || pinch->state() == Qt::GestureCanceled) {
+        commitShapeTransform();
+    }
 }
 
 void ShapesWidget::tapTriggered(QTapGesture *tap)
@@ -2135,36 +2364,42 @@ void ShapesWidget::tapTriggered(QTapGesture *tap)
         m_editing = false;
         m_selectedIndex = -1;
         m_selectedOrder = -1;
-        m_selectedShape.type = "";
+        m_selectedShape.type = ShapeType::None;
     }
 }
 
 void ShapesWidget::deleteCurrentShape()
 {
     qDebug() << "delete shape";
-    if (m_selectedOrder < m_shapes.length()) {
+    commitShapeTransform();
+    if (m_selectedOrder >= 0 && m_selectedOrder < m_shapes.length()) {
+        const Toolshape &shape = m_shapes[m_selectedOrder];
+        // 新建后还未记录的文字不记录删除
+        if (shape.type != ShapeType::Text || m_textSnapshots.contains(shape.index)) {
+            m_history.push(ShapesHistory::removeShape(m_selectedOrder, shape, m_textSnapshots.take(shape.index)));
+        }
         m_shapes.removeAt(m_selectedOrder);
     } else {
         qWarning() << "Invalid index";
     }
 
-    if (m_selectedShape.type == "text" && m_editMap.contains(m_selectedShape.index)) {
+    if (m_selectedShape.type == ShapeType::Text && m_editMap.contains(m_selectedShape.index)) {
         m_editMap.value(m_selectedShape.index)->clear();
         m_editMap.remove(m_selectedShape.index);
     }
 
     clearSelected();
-    m_selectedShape.type = "";
-    m_currentShape.type = "";
+    m_selectedShape.type = ShapeType::None;
+    m_currentShape.type = ShapeType::None;
     for (int i = 0; i < m_currentShape.mainPoints.length(); i++) {
         m_currentShape.mainPoints[i] = QPointF(0, 0);
     }
 
-    if (m_shapes.length() == 0) {
+    if (m_shapes.length() == 0 && !m_history.canUndo()) {
         emit setShapesUndo(false);
     }
 
-    update();
+    updateShapesLayer();
     m_selectedIndex = -1;
     m_selectedOrder = -1;
 }
@@ -2172,67 +2407,240 @@ void ShapesWidget::deleteCurrentShape()
 void ShapesWidget::undoDrawShapes()
 {
     textEditIsReadOnly();
+    commitShapeTransform();
     qDebug() << "undoDrawShapes m_selectedIndex:" << m_selectedIndex << m_shapes.length();
-    if (m_selectedOrder < m_shapes.length() && m_selectedIndex != -1) {
-        deleteCurrentShape();
-    } else if (m_shapes.length() > 0) {
-        int tmpIndex = m_shapes[m_shapes.length() - 1].index;
-        if (m_shapes[m_shapes.length() - 1].type == "text" && m_editMap.contains(tmpIndex)) {
-            m_editMap.value(tmpIndex)->clear();
-            delete m_editMap.value(tmpIndex);
-            m_editMap.remove(tmpIndex);
-        }
-
-        m_shapes.removeLast();
+    ShapesHistory::Command command;
+    bool isApplied = false;
+    while (!isApplied && m_history.takeUndo(command)) {
+        isApplied = applyCommand(command, true);
     }
-    qDebug() << "undoDrawShapes m_selectedIndex:" << m_selectedIndex << m_shapes.length();
-
-    if (m_shapes.length() == 0) {
-        emit setShapesUndo(false);
+    // 没有撤销记录（记录超出内存上限被丢弃）时删除最后一个图形
+    if (!isApplied && m_shapes.length() > 0) {
+        removeShape(m_shapes.length() - 1);
     }
-    m_isSelected = false;
-    clearSelected();
-    update();
+    qDebug() << "undoDrawShapes m_selectedIndex:" << m_selectedIndex << m_shapes.length();
+    finishHistoryChange();
 }
+
 void ShapesWidget::undoAllDrawShapes()
 {
+    textEditIsReadOnly();
+    commitShapeTransform();
     qDebug() << "undoAllDrawShapes undoDrawShapes m_selectedIndex:" << m_selectedIndex << m_shapes.length();
-    if (m_selectedOrder < m_shapes.length() && m_selectedIndex != -1) {
-        deleteCurrentShape();
-    } else if (m_shapes.length() > 0) {
+    ShapesHistory::Command command;
+    while (m_history.takeUndo(command)) {
+        applyCommand(command, true);
+    }
+    // 剩下的图形没有撤销记录（记录超出内存上限被丢弃），删除后恢复记录与图形列表对应不上，清空记录
+    if (m_shapes.length() > 0) {
         while (m_shapes.length() > 0) {
-            int tmpIndex = m_shapes[m_shapes.length() - 1].index;
-            if (m_shapes[m_shapes.length() - 1].type == "text" && m_editMap.contains(tmpIndex)) {
-                m_editMap.value(tmpIndex)->clear();
-                delete m_editMap.value(tmpIndex);
-                m_editMap.remove(tmpIndex);
-            }
-
-            m_shapes.removeLast();
+            removeShape(m_shapes.length() - 1);
         }
+        m_history.clear();
     }
     qDebug() << "undoDrawShapes m_selectedIndex:" << m_selectedIndex << m_shapes.length();
+    finishHistoryChange();
+}
 
-    if (m_shapes.length() == 0) {
-        emit setShapesUndo(false);
+void ShapesWidget::redoDrawShapes()
+{
+    textEditIsReadOnly();
+    commitShapeTransform();
+    ShapesHistory::Command command;
+    bool isApplied = false;
+    while (!isApplied && m_history.takeRedo(command)) {
+        isApplied = applyCommand(command, false);
+    }
+    qDebug() << "redoDrawShapes:" << isApplied << m_shapes.length();
+    finishHistoryChange();
+}
+
+void ShapesWidget::beginShapeTransform()
+{
+    commitShapeTransform();
+    if (m_selectedOrder >= 0 && m_selectedOrder < m_shapes.length()) {
+        m_transformShape = m_shapes[m_selectedOrder];
+        m_isTransforming = true;
+        //变换期间该图形不绘制到缓存中，缓存只在开始和结束时各重新生成一次
+        m_overlayIndex = m_transformShape.index;
+        m_overlayRect = transformedShapeRect(m_transformShape);
+        updateShapesLayer();
     }
-    m_isSelected = false;
+}
+
+void ShapesWidget::commitShapeTransform()
+{
+    if (!m_isTransforming) {
+        return;
+    }
+    m_isTransforming = false;
+    if (m_overlayIndex != -1) {
+        //变换结束，图形重新绘制到缓存中
+        m_overlayIndex = -1;
+        m_overlayRect = QRect();
+        updateShapesLayer();
+    }
+    const int order = shapeOrder(m_transformShape.index);
+    ShapesHistory::Command command;
+    if (order != -1 && ShapesHistory::transformShape(m_transformShape, m_shapes[order], command)) {
+        m_history.push(command);
+    }
+}
+
+void ShapesWidget::recordTextChanges()
+{
+    for (int i = 0; i < m_shapes.length(); i++) {
+        if (m_shapes[i].type != ShapeType::Text || !m_editMap.contains(m_shapes[i].index)) {
+            continue;
+        }
+        const QString text = m_editMap.value(m_shapes[i].index)->toPlainText();
+        if (text.isEmpty() || text == QString(tr("Input text here"))) {
+            continue;
+        }
+        QMap<int, QString>::iterator snapshot = m_textSnapshots.find(m_shapes[i].index);
+        if (snapshot == m_textSnapshots.end()) {
+            // 第一次输入完成时才记录为添加文字
+            m_history.push(ShapesHistory::addShape(i, m_shapes[i], text));
+            m_textSnapshots.insert(m_shapes[i].index, text);
+        } else if (snapshot.value() != text) {
+            m_history.push(ShapesHistory::editText(m_shapes[i].index, snapshot.value(), text));
+            snapshot.value() = text;
+        }
+    }
+}
+
+//记录按索引号查找图形，图形已被其他方式删除时跳过该记录
+bool ShapesWidget::applyCommand(const ShapesHistory::Command &command, bool isUndo)
+{
+    const int order = shapeOrder(command.index);
+    switch (command.type) {
+    case ShapesHistory::AddShape:
+    case ShapesHistory::RemoveShape: {
+        const bool isInsert = (command.type == ShapesHistory::RemoveShape) == isUndo;
+        if (isInsert && order == -1) {
+            insertShape(command.position, command.shape,
+                        command.type == ShapesHistory::AddShape ? command.textAfter : command.textBefore);
+            return true;
+        }
+        if (!isInsert && order != -1) {
+            removeShape(order);
+            return true;
+        }
+        return false;
+    }
+    case ShapesHistory::TransformShape: {
+        if (order == -1) {
+            return false;
+        }
+        Toolshape &shape = m_shapes[order];
+        shape.mainPoints = isUndo ? command.mainPointsBefore : command.mainPointsAfter;
+        shape.points = isUndo ? command.pointsBefore : command.pointsAfter;
+        shape.portion = isUndo ? command.portionBefore : command.portionAfter;
+        if (shape.type == ShapeType::Text && m_editMap.contains(shape.index)) {
+            m_editMap.value(shape.index)->move(static_cast<int>(shape.mainPoints[0].x()),
+                                               static_cast<int>(shape.mainPoints[0].y()));
+        }
+        return true;
+    }
+    case ShapesHistory::RestyleShape: {
+        if (order == -1) {
+            return false;
+        }
+        Toolshape &shape = m_shapes[order];
+        shape.colorIndex = isUndo ? command.colorIndexBefore : command.colorIndexAfter;
+        shape.lineWidth = isUndo ? command.lineWidthBefore : command.lineWidthAfter;
+        shape.fontSize = isUndo ? command.fontSizeBefore : command.fontSizeAfter;
+        if (shape.type == ShapeType::Text && m_editMap.contains(shape.index)) {
+            TextEdit *edit = m_editMap.value(shape.index);
+            edit->setColor(BaseUtils::colorIndexOf(shape.colorIndex));
+            edit->setFontSize(shape.fontSize);
+            edit->update();
+        }
+        return true;
+    }
+    case ShapesHistory::EditText: {
+        if (order == -1 || !m_editMap.contains(command.index)) {
+            return false;
+        }
+        const QString &text = isUndo ? command.textBefore : command.textAfter;
+        m_textSnapshots[command.index] = text;
+        m_editMap.value(command.index)->setPlainText(text);
+        return true;
+    }
+    }
+    return false;
+}
+
+int ShapesWidget::shapeOrder(int index) const
+{
+    for (int i = 0; i < m_shapes.length(); i++) {
+        if (m_shapes[i].index == index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ShapesWidget::insertShape(int position, const Toolshape &shape, const QString &text)
+{
+    const int order = qBound(0, position, m_shapes.length());
+    m_shapes.insert(order, shape);
+    if (shape.type == ShapeType::Text) {
+        TextEdit *edit = createTextEdit(shape.index);
+        m_editMap.insert(shape.index, edit);
+        m_textSnapshots.insert(shape.index, text);
+        // 先移动再设置内容，编辑框按当前位置更新图形的顶点
+        edit->move(static_cast<int>(shape.mainPoints[0].x()), static_cast<int>(shape.mainPoints[0].y()));
+        edit->setColor(BaseUtils::colorIndexOf(shape.colorIndex));
+        edit->setFontSize(shape.fontSize);
+        edit->setPlainText(text);
+        edit->setReadOnly(true);
+        edit->setEditing(false);
+        edit->show();
+    }
+}
+
+void ShapesWidget::removeShape(int order)
+{
+    const int index = m_shapes[order].index;
+    if (m_shapes[order].type == ShapeType::Text && m_editMap.contains(index)) {
+        TextEdit *edit = m_editMap.take(index);
+        edit->clear();
+        delete edit;
+        m_textSnapshots.remove(index);
+    }
+    m_shapes.removeAt(order);
+}
+
+void ShapesWidget::finishHistoryChange()
+{
+    // 图形的顺序可能已变化，清除选择
     clearSelected();
-    update();
+    m_isSelected = false;
+    m_selectedIndex = -1;
+    m_selectedOrder = -1;
+    m_selectedShape.type = ShapeType::None;
+    m_currentShape.type = ShapeType::None;
+    for (int i = 0; i < m_currentShape.mainPoints.length(); i++) {
+        m_currentShape.mainPoints[i] = QPointF(0, 0);
+    }
+    emit setShapesUndo(m_shapes.length() > 0 || m_history.canUndo());
+    updateShapesLayer();
 }
 /*
  * never used
 QString ShapesWidget::getCurrentType()
 {
-    return m_currentShape.type;
+    return m_currentShape.type.name();
 }
 */
 void ShapesWidget::microAdjust(QString direction)
 {
     if (m_selectedIndex != -1 && m_selectedOrder < m_shapes.length()) {
-        if (m_shapes[m_selectedOrder].type  == "text") {
+        if (m_shapes[m_selectedOrder].type  == ShapeType::Text) {
             return;
         }
+        beginShapeTransform();
 
         if (direction == "Left" || direction == "Right" || direction == "Up" || direction == "Down") {
             m_shapes[m_selectedOrder].mainPoints = pointMoveMicro(m_shapes[m_selectedOrder].mainPoints, direction);
@@ -2243,7 +2651,7 @@ void ShapesWidget::microAdjust(QString direction)
             m_shapes[m_selectedOrder].mainPoints = pointResizeMicro(m_shapes[m_selectedOrder].mainPoints, direction, true);
         }
 
-        if (m_shapes[m_selectedOrder].type == "line" || m_shapes[m_selectedOrder].type == "arrow") {
+        if (m_shapes[m_selectedOrder].type == ShapeType::Line || m_shapes[m_selectedOrder].type == ShapeType::Arrow) {
             if (m_shapes[m_selectedOrder].portion.length() == 0) {
                 for (int k = 0; k < m_shapes[m_selectedOrder].points.length(); k++) {
                     m_shapes[m_selectedOrder].portion.append(relativePosition(m_shapes[m_selectedOrder].mainPoints,
@@ -2258,8 +2666,9 @@ void ShapesWidget::microAdjust(QString direction)
 
         m_selectedShape.mainPoints = m_shapes[m_selectedOrder].mainPoints;
         m_selectedShape.points = m_shapes[m_selectedOrder].points;
-        m_hoveredShape.type = "";
-        update();
+        m_hoveredShape.type = ShapeType::None;
+        commitShapeTransform();
+        updateShapesLayer();
     }
 }
 
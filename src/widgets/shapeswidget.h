@@ -24,6 +24,9 @@
 
 #include "../utils/shapesutils.h"
 #include "../utils/baseutils.h"
+#include "../utils/shapeeffect.h"
+#include "../utils/shapesgrid.h"
+#include "../utils/shapeshistory.h"
 #include "../widgets/textedit.h"
 #include "../widgets/sidebar.h"
 #include "../menucontroller/menucontroller.h"
@@ -130,7 +133,7 @@ public slots:
      * @param pos: 当前鼠标的位置
      * @return
      */
-    bool clickedOnArrow(QList<QPointF> points, QPointF pos);
+    bool clickedOnArrow(QVector<QPointF> points, QPointF pos);
 
     /**
      * @brief clickedOnLine: 画出的线是否被点击
@@ -139,7 +142,7 @@ public slots:
      * @param pos: 当前鼠标的位置
      * @return
      */
-    bool clickedOnLine(FourPoints mainPoints, QList<QPointF> points, QPointF pos);
+    bool clickedOnLine(FourPoints mainPoints, QVector<QPointF> points, QPointF pos);
 
     /**
      * @brief clickedOnText: 文本框是否被点击
@@ -153,8 +156,8 @@ public slots:
     bool hoverOnShapes(Toolshape toolShape, QPointF pos);
     bool hoverOnRect(FourPoints rectPoints, QPointF pos, bool isTextBorder = false);
     bool hoverOnEllipse(FourPoints mainPoints, QPointF pos);
-    bool hoverOnArrow(QList<QPointF> points, QPointF pos);
-    bool hoverOnLine(FourPoints mainPoints, QList<QPointF> points, QPointF pos);
+    bool hoverOnArrow(QVector<QPointF> points, QPointF pos);
+    bool hoverOnLine(FourPoints mainPoints, QVector<QPointF> points, QPointF pos);
     bool hoverOnText(int textIndex, FourPoints mainPoints, QPointF pos);
 
     bool hoverOnRotatePoint(FourPoints mainPoints, QPointF pos);
@@ -162,6 +165,10 @@ public slots:
 
     void undoDrawShapes();
     void undoAllDrawShapes();
+    /**
+     * @brief redoDrawShapes:恢复最近一次撤销的操作
+     */
+    void redoDrawShapes();
     void deleteCurrentShape();
     //QString  getCurrentType();
     void microAdjust(QString direction);
@@ -171,6 +178,14 @@ public slots:
     void menuCloseSlot();
     //void updateSideBarPosition();
     void setGlobalRect(QRect rect);
+    /**
+     * @brief setEffectSource:设置模糊和马赛克效果的原图，即图形编辑区域的截图
+     */
+    void setEffectSource(const QPixmap &source);
+    /**
+     * @brief flushEffects:同步计算完所有模糊和马赛克效果并重绘，保存截图前调用，避免保存未打码的内容
+     */
+    void flushEffects();
 
 protected:
     bool event(QEvent *event);
@@ -239,8 +254,10 @@ private:
     int m_currentIndex;
     int m_hoveredIndex;
     int m_selectedOrder;
-    bool m_blurEffectExist = false;
-    bool m_mosaicEffectExist = false;
+    /**
+     * @brief m_shapeEffect:按图形所在范围在后台计算的模糊和马赛克效果
+     */
+    ShapeEffect *m_shapeEffect;
     /**
         * @brief m_lastEditMapKey 记录最后一个textedit在Map中的key值
         */
@@ -275,15 +292,101 @@ private:
 
     QRect m_globalRect;
 
+    /**
+     * @brief m_shapesLayer:已完成图形的缓存，图形变化时才重新生成
+     */
+    QPixmap m_shapesLayer;
+    bool m_shapesLayerDirty = true;
+    QRect m_currentShapeRect;   // 正在绘制的图形上次重绘的范围
+    QPainterPath m_currentLinePath; // 正在绘制的画笔路径，随鼠标移动逐段延长，不必每次重绘都重新生成
+    QRect m_hoveredRect;        // 悬停的图形上次重绘的范围
+    int m_lastHoveredIndex = -1;
+    /**
+     * @brief m_shapesGrid:图形的网格索引，图形变化后在下次查询时重新生成
+     */
+    ShapesGrid m_shapesGrid;
+    bool m_shapesGridDirty = true;
+    /**
+     * @brief m_history:图形编辑的撤销/恢复记录，只记录每次操作变化的部分
+     */
+    ShapesHistory m_history;
+    Toolshape m_transformShape;         // 移动、缩放、旋转开始时的图形，结束时比较生成记录
+    bool m_isTransforming = false;
+    int m_overlayIndex = -1;            // 移动、缩放、旋转中的图形，不绘制到缓存中，在缓存之上单独绘制
+    QRect m_overlayRect;                // 该图形上次重绘的范围
+    QMap<int, QString> m_textSnapshots; // 已记录的文字图形的内容，编辑完成时比较是否修改
+
+    /**
+     * @brief updateShapesLayer:已完成的图形发生变化，标记缓存失效并重绘整个窗口
+     */
+    void updateShapesLayer();
+    void paintShapesLayer();
+    void paintShape(QPainter &painter, int order);
+    QRect shapeBoundingRect(const Toolshape &shape, int margin) const;
+    /**
+     * @brief transformedShapeRect:移动、缩放、旋转中的图形需要重绘的范围，包括选中时的缩放点和旋转图标
+     */
+    QRect transformedShapeRect(const Toolshape &shape) const;
+    /**
+     * @brief updateTransformedShape:移动、缩放、旋转中的图形变化，缓存不变，只重绘图形新旧位置所在的范围
+     */
+    void updateTransformedShape();
+    QRect currentShapeDirtyRect() const;
+    /**
+     * @brief updateHoveredShape:悬停的图形变化时只重绘新旧图形所在的范围
+     */
+    void updateHoveredShape();
+    /**
+     * @brief shapesAt:鼠标位置可能点中的图形，只需要对这些图形精确判断
+     * @return 图形在m_shapes中的顺序，升序排列
+     */
+    QVector<int> shapesAt(const QPointF &pos);
+
+    /**
+     * @brief beginShapeTransform:选中的图形开始移动、缩放或旋转，记录开始时的顶点
+     */
+    void beginShapeTransform();
+    /**
+     * @brief commitShapeTransform:移动、缩放或旋转结束，顶点变化时生成撤销记录
+     */
+    void commitShapeTransform();
+    /**
+     * @brief recordTextChanges:文字编辑完成，记录新输入和修改过的文字
+     */
+    void recordTextChanges();
+    /**
+     * @brief applyCommand:撤销或恢复一条记录
+     * @return 记录对应的图形已不存在（或已存在）时返回false
+     */
+    bool applyCommand(const ShapesHistory::Command &command, bool isUndo);
+    /**
+     * @brief shapeOrder:索引号对应的图形在m_shapes中的顺序，不存在时返回-1
+     */
+    int shapeOrder(int index) const;
+    void insertShape(int position, const Toolshape &shape, const QString &text);
+    void removeShape(int order);
+    /**
+     * @brief finishHistoryChange:撤销或恢复后清除选择并更新撤销状态
+     */
+    void finishHistoryChange();
+    TextEdit *createTextEdit(int shapeIndex);
+
     void paintImgPoint(QPainter &painter, QPointF pos, QPixmap img, bool isResize = true);
     //void paintImgPointArrow(QPainter &painter, QPointF pos, QPixmap img);
     void paintRect(QPainter &painter, FourPoints rectFPoints, int index,
-                   ShapeBlurStatus  rectStatus = Normal, bool isBlur = false, bool isMosaic = false);
+                   ShapeBlurStatus  rectStatus = Normal, bool isBlur = false, bool isMosaic = false,
+                   int shapeIndex = -1);
     void paintEllipse(QPainter &painter, FourPoints ellipseFPoints, int index,
-                      ShapeBlurStatus  ovalStatus = Normal, bool isBlur = false, bool isMosaic = false);
-    void paintArrow(QPainter &painter, QList<QPointF> lineFPoints,
+                      ShapeBlurStatus  ovalStatus = Normal, bool isBlur = false, bool isMosaic = false,
+                      int shapeIndex = -1);
+    /**
+     * @brief paintEffect:在图形范围内画出模糊或马赛克效果，painter已按图形裁剪
+     * @param shapeIndex:图形的索引号，效果图按索引号缓存
+     */
+    void paintEffect(QPainter &painter, const QPainterPath &path, int shapeIndex, bool isMosaic);
+    void paintArrow(QPainter &painter, QVector<QPointF> lineFPoints,
                     int lineWidth, bool isStraight = false);
-    void paintLine(QPainter &painter, QList<QPointF> lineFPoints);
+    void paintLine(QPainter &painter, QVector<QPointF> lineFPoints);
     void paintText(QPainter &painter, FourPoints rectFPoints);
 };
 #endif // SHAPESWIDGET_H
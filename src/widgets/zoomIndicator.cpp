@@ -22,7 +22,6 @@
 #include "zoomIndicator.h"
 #include "../utils/baseutils.h"
 #include "../utils/tempfile.h"
-#include "../utils.h"
 
 #include <QCursor>
 #include <QTextOption>
@@ -58,6 +57,8 @@ ZoomIndicator::ZoomIndicator(DWidget *parent)
                          CENTER_RECT_WIDTH, CENTER_RECT_WIDTH);
 
     m_globalRect = QRect(0, 0, BACKGROUND_SIZE.width(), BACKGROUND_SIZE.height());
+    m_centerRectPixmap = QPixmap(":/images/action/center_rect.png");
+    m_magnifierPixmap = QPixmap(":/images/action/magnifier.png");
 }
 
 ZoomIndicator::~ZoomIndicator()
@@ -77,40 +78,31 @@ void ZoomIndicator::paintEvent(QPaintEvent *)
     centerPos = QPoint(std::max(centerPos.x() - this->window()->x(), 0),
                        std::max(centerPos.y() - this->window()->y(), 0));
     QPainter painter(this);
-    //获取背景图片
-    const QPixmap &fullscreenImgFile = TempFile::instance()->getFullscreenPixmap();
+    //获取按屏幕缩放比缩小后的背景图片，截图后只生成一次
     qreal ration = this->devicePixelRatioF();
-    QImage fullscreenImg = fullscreenImgFile.toImage();
-    //将背景图片按屏幕缩放比进行缩放
-    fullscreenImg =  fullscreenImg.scaled(static_cast<int>(fullscreenImg.width() / ration),
-                                          static_cast<int>(fullscreenImg.height() / ration), Qt::KeepAspectRatio);
-
-    //获取所有屏幕的信息
-    QList<Utils::ScreenInfo> screensInfo = Utils::getScreensInfo();
-    for (int i = 0; i < screensInfo.size(); i++) {
+    const QImage &fullscreenImg = TempFile::instance()->getScaledFullscreenImage(ration);
+
+    for (int i = 0; i < m_screensInfo.size(); i++) {
         //判断当前点在哪块屏幕上
-        if (centerPos.x() > screensInfo[i].x && centerPos.x() < screensInfo[i].x + screensInfo[i].width &&
-                centerPos.y() > screensInfo[i].y && centerPos.y() < screensInfo[i].y + screensInfo[i].height) {
+        if (centerPos.x() > m_screensInfo[i].x && centerPos.x() < m_screensInfo[i].x + m_screensInfo[i].width &&
+                centerPos.y() > m_screensInfo[i].y && centerPos.y() < m_screensInfo[i].y + m_screensInfo[i].height) {
 
-            centerPos.setX(static_cast<int>((centerPos.x() - screensInfo[i].x) + screensInfo[i].x / ration));
-            centerPos.setY(static_cast<int>((centerPos.y() - screensInfo[i].y) + screensInfo[i].y / ration));
+            centerPos.setX(static_cast<int>((centerPos.x() - m_screensInfo[i].x) + m_screensInfo[i].x / ration));
+            centerPos.setY(static_cast<int>((centerPos.y() - m_screensInfo[i].y) + m_screensInfo[i].y / ration));
         }
     }
     //返回centerPos位置的像素颜色
     const QRgb centerRectRgb = fullscreenImg.pixel(centerPos);
+    //只取光标附近的像素放大
     QRect tempRec = QRect(centerPos.x() - IMG_WIDTH / 2, centerPos.y() - IMG_WIDTH / 2, IMG_WIDTH, IMG_WIDTH) ;
-    qDebug() << " tempRec: " <<  tempRec;
-    QPixmap zoomPix = QPixmap(fullscreenImgFile).scaled(
-                          fullscreenImg.width(), fullscreenImg.height()).copy(tempRec);
-
-    zoomPix = zoomPix.scaled(QSize(INDICATOR_WIDTH,  INDICATOR_WIDTH),
-                             Qt::KeepAspectRatio);
+    const QPixmap zoomPix = QPixmap::fromImage(fullscreenImg.copy(tempRec).scaled(
+                                                   QSize(INDICATOR_WIDTH,  INDICATOR_WIDTH), Qt::KeepAspectRatio));
 
     painter.drawPixmap(QRect(5, 5, INDICATOR_WIDTH, INDICATOR_WIDTH), zoomPix);
 
 
-    painter.drawPixmap(m_centerRect, QPixmap(":/images/action/center_rect.png"));
-    painter.drawPixmap(m_globalRect, QPixmap(":/images/action/magnifier.png"));
+    painter.drawPixmap(m_centerRect, m_centerRectPixmap);
+    painter.drawPixmap(m_globalRect, m_magnifierPixmap);
 
     m_lastCenterPosBrush = QBrush(QColor(qRed(centerRectRgb),
                                          qGreen(centerRectRgb), qBlue(centerRectRgb)));
@@ -136,6 +128,10 @@ void ZoomIndicator::showMagnifier(QPoint pos)
         return;
     }
 
+    if (this->isHidden()) {
+        //获取所有屏幕的信息
+        m_screensInfo = Utils::getScreensInfo();
+    }
     this->show();
 
     this->move(pos);
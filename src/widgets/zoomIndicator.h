@@ -23,6 +23,7 @@
 #define ZOOMINDICATOR_H
 
 #include "zoomIndicatorGL.h"
+#include "../utils.h"
 #include <DLabel>
 #include <DWidget>
 #include <QPainter>
@@ -47,6 +48,9 @@ private:
     QRect m_globalRect;
     QRect m_centerRect;
     QBrush m_lastCenterPosBrush;
+    QPixmap m_centerRectPixmap;
+    QPixmap m_magnifierPixmap;
+    QList<Utils::ScreenInfo> m_screensInfo;    // 放大镜显示时获取，移动过程中不再重复获取
     ZoomIndicatorGL *m_zoomIndicatorGL = nullptr;
 };
 
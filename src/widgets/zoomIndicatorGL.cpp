@@ -50,6 +50,8 @@ ZoomIndicatorGL::ZoomIndicatorGL(DWidget *parent)
                          CENTER_RECT_WIDTH, CENTER_RECT_WIDTH);
 
     m_globalRect = QRect(-4, -4, BACKGROUND_SIZE.width() + 8, BACKGROUND_SIZE.height() + 8);
+    m_centerRectPixmap = QPixmap(":/images/action/center_rect.png");
+    m_magnifierPixmap = QPixmap(":/images/action/magnifier.png");
 }
 
 ZoomIndicatorGL::~ZoomIndicatorGL() {}
@@ -63,24 +65,18 @@ void ZoomIndicatorGL::paintGL()
                        std::max(centerPos.y() - this->window()->y(), 0));
 
     QPainter painter(this);
-    const QPixmap &fullscreenImgFile = TempFile::instance()->getFullscreenPixmap();
-    qreal ration = this->devicePixelRatioF();
-    QImage fullscreenImg = fullscreenImgFile.toImage();
-    fullscreenImg =  fullscreenImg.scaled(static_cast<int>(fullscreenImg.width() / ration),
-                                          static_cast<int>(fullscreenImg.height() / ration), Qt::KeepAspectRatio);
+    //按屏幕缩放比缩小后的背景图片，截图后只生成一次，每次只取光标附近的像素放大
+    const QImage &fullscreenImg = TempFile::instance()->getScaledFullscreenImage(this->devicePixelRatioF());
     const QRgb centerRectRgb = fullscreenImg.pixel(centerPos);
-    QPixmap zoomPix = QPixmap(fullscreenImgFile).scaled(
-                          fullscreenImg.width(), fullscreenImg.height()).copy(
-                          centerPos.x() - IMG_WIDTH / 2, centerPos.y() - IMG_WIDTH / 2, IMG_WIDTH, IMG_WIDTH);
-
-    zoomPix = zoomPix.scaled(QSize(INDICATOR_WIDTH,  INDICATOR_WIDTH),
-                             Qt::KeepAspectRatio);
+    const QRect zoomRect(centerPos.x() - IMG_WIDTH / 2, centerPos.y() - IMG_WIDTH / 2, IMG_WIDTH, IMG_WIDTH);
+    const QPixmap zoomPix = QPixmap::fromImage(fullscreenImg.copy(zoomRect).scaled(
+                                                   QSize(INDICATOR_WIDTH,  INDICATOR_WIDTH), Qt::KeepAspectRatio));
 
     painter.drawPixmap(QRect(0, 0, INDICATOR_WIDTH + 10, INDICATOR_WIDTH + 10), zoomPix);
 
 
-    painter.drawPixmap(m_centerRect, QPixmap(":/images/action/center_rect.png"));
-    painter.drawPixmap(m_globalRect, QPixmap(":/images/action/magnifier.png"));
+    painter.drawPixmap(m_centerRect, m_centerRectPixmap);
+    painter.drawPixmap(m_globalRect, m_magnifierPixmap);
 
     m_lastCenterPosBrush = QBrush(QColor(qRed(centerRectRgb),
                                          qGreen(centerRectRgb), qBlue(centerRectRgb)));
@@ -46,6 +46,8 @@ private:
     QRect m_globalRect;
     QRect m_centerRect;
     QBrush m_lastCenterPosBrush;
+    QPixmap m_centerRectPixmap;
+    QPixmap m_magnifierPixmap;
 };
 
 #endif // MAGNIFIER_H
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# 滚动截图拼接的性能与准确性基准测试
+# 生成模拟的滚动页面，逐帧送入PixMergeThread拼接，
+# 统计每次拼接的耗时分位数、内存峰值及与真实页面的像素误差
+# 用法: bench_scroll_stitch [--scenario sticky] [--width 1280] [--page-rows 12000]
+#
+#-------------------------------------------------
+
+QT       += core gui
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+TARGET = bench_scroll_stitch
+
+INCLUDEPATH += . ../../src/
+
+QMAKE_CXXFLAGS += -O2 -Wno-error=deprecated-declarations -Wno-deprecated-declarations
+LIBS += -lopencv_core -lopencv_imgproc -lpng
+
+HEADERS += \
+    syntheticpage.h \
+    ../../src/utils/pixmergethread.h \
+    ../../src/utils/longimage.h \
+    ../../src/utils/longimagepreview.h
+
+SOURCES += \
+    main.cpp \
+    syntheticpage.cpp \
+    ../../src/utils/pixmergethread.cpp \
+    ../../src/utils/longimage.cpp \
+    ../../src/utils/longimagepreview.cpp
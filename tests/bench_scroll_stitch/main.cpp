@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "syntheticpage.h"
+#include "utils/pixmergethread.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QTextStream>
+
+#include <algorithm>
+#include <string.h>
+
+// 同步调用拼接线程的转换和拼接步骤，逐帧计时
+class BenchMergeThread : public PixMergeThread
+{
+public:
+    bool mergeFrame(const QImage &image, PictureDirection direction)
+    {
+        const cv::Mat frame = (direction == ScrollDown) ? trimScrollDownImg(image) : trimScrollUpImg(image);
+        return mergeImageWork(frame, direction);
+    }
+};
+
+struct Scenario {
+    const char *name;
+    int headerRows;
+    int footerRows;
+    int repeatPeriod;
+    int minDelta;
+    int maxDelta;
+    bool scrollUp;
+};
+
+static QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+// 读取/proc/self/status中的内存统计(KB)
+static qint64 readStatusKb(const char *key)
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QByteArray prefix(key);
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.startsWith(prefix)) {
+            return line.mid(prefix.size()).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return 0;
+}
+
+// 重置内存峰值统计（Linux 4.0及以上支持）
+static void resetPeakMemory()
+{
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+}
+
+static QImage toImage(const cv::Mat &mat)
+{
+    return QImage(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step), QImage::Format_ARGB32).copy();
+}
+
+static double percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const int index = qBound(0, static_cast<int>(p * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    return sorted.at(index) / 1000.0;
+}
+
+static void runScenario(const Scenario &scenario, const SyntheticPage::Options &baseOptions)
+{
+    SyntheticPage::Options options = baseOptions;
+    options.headerRows = scenario.headerRows;
+    options.footerRows = scenario.footerRows;
+    options.repeatPeriod = scenario.repeatPeriod;
+    const SyntheticPage page(options);
+    const QVector<int> positions = page.scrollPositions(scenario.minDelta, scenario.maxDelta, scenario.scrollUp);
+    const PixMergeThread::PictureDirection direction = scenario.scrollUp ? PixMergeThread::ScrollUp : PixMergeThread::ScrollDown;
+
+    // 逐帧同步拼接，统计每次拼接（含去掉固定区域）的耗时和内存峰值
+    const qint64 baseRss = readStatusKb("VmRSS:");
+    resetPeakMemory();
+    QVector<qint64> costs;
+    int failed = 0;
+    QImage result;
+    {
+        BenchMergeThread thread;
+        thread.setScrollModel(false);
+        thread.addShotImg(toImage(page.frame(positions.first())), direction);
+        QElapsedTimer timer;
+        for (int i = 1; i < positions.size(); ++i) {
+            const QImage frame = toImage(page.frame(positions.at(i)));
+            timer.start();
+            if (!thread.mergeFrame(frame, direction)) {
+                ++failed;
+            }
+            costs.append(timer.nsecsElapsed());
+        }
+        result = thread.getMerageResult();
+    }
+    const qint64 peakKb = readStatusKb("VmHWM:") - baseRss;
+    std::sort(costs.begin(), costs.end());
+
+    // 与真实页面比较：高度差、不同的行数、平均每通道误差
+    const cv::Mat expected = page.expected(qMin(positions.first(), positions.last()), qMax(positions.first(), positions.last()));
+    const cv::Mat merged(result.height(), result.width(), CV_8UC4, const_cast<uchar *>(result.constBits()),
+                         static_cast<size_t>(result.bytesPerLine()));
+    const int rows = qMin(merged.rows, expected.rows);
+    int diffRows = 0;
+    for (int row = 0; row < rows; ++row) {
+        if (memcmp(merged.ptr(row), expected.ptr(row), expected.cols * expected.elemSize()) != 0) {
+            ++diffRows;
+        }
+    }
+    const double meanError = rows > 0 ? cv::norm(merged.rowRange(0, rows), expected.rowRange(0, rows), cv::NORM_L1)
+                             / (static_cast<double>(rows) * expected.cols * expected.channels()) : 0;
+
+    // 通过流水线拼接，统计吞吐量，生成截图代替抓取一级
+    qreal pipelineFps = 0;
+    qreal achievableRate = 0;
+    {
+        PixMergeThread thread;
+        thread.setScrollModel(false);
+        QElapsedTimer timer;
+        timer.start();
+        thread.start();
+        for (int scroll : positions) {
+            thread.addShotImg(toImage(page.frame(scroll)), direction);
+        }
+        thread.finishTask();
+        thread.wait();
+        const qint64 elapsed = timer.nsecsElapsed();
+        pipelineFps = elapsed > 0 ? (positions.size() - 1) * 1e9 / elapsed : 0;
+        achievableRate = thread.achievableScrollRate();
+    }
+
+    out() << scenario.name << ": frames " << positions.size() << ", failed " << failed << "\n"
+          << "  merge latency us: p50 " << percentile(costs, 0.5) << ", p90 " << percentile(costs, 0.9)
+          << ", p99 " << percentile(costs, 0.99) << ", max " << percentile(costs, 1.0) << "\n"
+          << "  peak memory: " << peakKb / 1024 << " MB\n"
+          << "  height " << merged.rows << " / " << expected.rows << ", different rows " << diffRows
+          << ", mean error " << meanError << "\n"
+          << "  pipeline: " << pipelineFps << " frames/s, achievable scroll rate " << qRound64(achievableRate) << " rows/s\n";
+    out().flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Scroll screenshot stitching benchmark");
+    parser.addHelpOption();
+    const QCommandLineOption widthOption("width", "Page width.", "pixels", "1280");
+    const QCommandLineOption pageRowsOption("page-rows", "Page height.", "pixels", "12000");
+    const QCommandLineOption viewportOption("viewport", "Capture area height.", "pixels", "900");
+    const QCommandLineOption seedOption("seed", "Random seed.", "seed", "20211020");
+    const QCommandLineOption scenarioOption("scenario", "Run only the named scenario.", "name");
+    parser.addOptions({widthOption, pageRowsOption, viewportOption, seedOption, scenarioOption});
+    parser.process(app);
+
+    SyntheticPage::Options options;
+    options.width = parser.value(widthOption).toInt();
+    options.pageRows = parser.value(pageRowsOption).toInt();
+    options.viewportRows = parser.value(viewportOption).toInt();
+    options.seed = parser.value(seedOption).toUInt();
+
+    const Scenario scenarios[] = {
+        {"plain", 0, 0, 0, 40, 300, false},
+        {"sticky", 64, 48, 0, 40, 300, false},
+        {"sticky-up", 64, 48, 0, 40, 300, true},
+        {"small-steps", 64, 48, 0, 5, 30, false},
+        {"repeated", 64, 48, 420, 100, 300, false},
+    };
+    for (const Scenario &scenario : scenarios) {
+        if (parser.isSet(scenarioOption) && parser.value(scenarioOption) != scenario.name) {
+            continue;
+        }
+        runScenario(scenario, options);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "syntheticpage.h"
+
+#include <algorithm>
+#include <string>
+
+static const int LINE_HEIGHT = 28;
+
+SyntheticPage::SyntheticPage(const Options &options)
+    : m_options(options)
+{
+    cv::RNG rng(m_options.seed);
+    const int bodyRows = m_options.repeatPeriod > 0 ? m_options.repeatPeriod : m_options.pageRows;
+    cv::Mat body(bodyRows, m_options.width, CV_8UC4, cv::Scalar(255, 255, 255, 255));
+    drawTextLines(body, rng);
+    if (m_options.repeatPeriod > 0) {
+        // 重复的段落：页面中存在多处完全相同的内容
+        m_page.create(m_options.pageRows, m_options.width, CV_8UC4);
+        for (int row = 0; row < m_options.pageRows; row += bodyRows) {
+            const int rows = qMin(bodyRows, m_options.pageRows - row);
+            body.rowRange(0, rows).copyTo(m_page.rowRange(row, row + rows));
+        }
+    } else {
+        m_page = body;
+    }
+
+    if (m_options.headerRows > 0) {
+        m_header.create(m_options.headerRows, m_options.width, CV_8UC4);
+        m_header.setTo(cv::Scalar(120, 80, 40, 255));
+        cv::putText(m_header, "Synthetic header", cv::Point(16, m_options.headerRows * 2 / 3),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255, 255), 2, cv::LINE_AA);
+    }
+    if (m_options.footerRows > 0) {
+        m_footer.create(m_options.footerRows, m_options.width, CV_8UC4);
+        m_footer.setTo(cv::Scalar(230, 230, 230, 255));
+        cv::putText(m_footer, "Synthetic footer", cv::Point(16, m_options.footerRows * 2 / 3),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(60, 60, 60, 255), 1, cv::LINE_AA);
+    }
+}
+
+int SyntheticPage::contentRows() const
+{
+    return m_options.viewportRows - m_options.headerRows - m_options.footerRows;
+}
+
+int SyntheticPage::maxScroll() const
+{
+    return m_options.pageRows - contentRows();
+}
+
+cv::Mat SyntheticPage::frame(int scroll) const
+{
+    return expected(scroll, scroll);
+}
+
+cv::Mat SyntheticPage::expected(int minScroll, int maxScroll) const
+{
+    std::vector<cv::Mat> parts;
+    if (!m_header.empty()) {
+        parts.push_back(m_header);
+    }
+    parts.push_back(m_page.rowRange(minScroll, maxScroll + contentRows()));
+    if (!m_footer.empty()) {
+        parts.push_back(m_footer);
+    }
+    cv::Mat result;
+    cv::vconcat(parts, result);
+    return result;
+}
+
+QVector<int> SyntheticPage::scrollPositions(int minDelta, int maxDelta, bool scrollUp) const
+{
+    cv::RNG rng(m_options.seed + 1);
+    QVector<int> positions;
+    int scroll = 0;
+    positions.append(scroll);
+    while (scroll < maxScroll()) {
+        scroll = qMin(scroll + rng.uniform(minDelta, maxDelta + 1), maxScroll());
+        positions.append(scroll);
+    }
+    if (scrollUp) {
+        std::reverse(positions.begin(), positions.end());
+    }
+    return positions;
+}
+
+// 随机单词组成的文字行，行间穿插色块（模拟图片），文字使用抗锯齿绘制
+void SyntheticPage::drawTextLines(cv::Mat &image, cv::RNG &rng) const
+{
+    int y = LINE_HEIGHT;
+    while (y < image.rows) {
+        if (rng.uniform(0, 12) == 0) {
+            const int blockRows = qMin(rng.uniform(60, 240), image.rows - y);
+            const int left = rng.uniform(16, image.cols / 2);
+            const cv::Rect block(left, y, rng.uniform(image.cols / 8, image.cols - left), blockRows);
+            cv::rectangle(image, block, cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256), 255), cv::FILLED);
+            y += blockRows + LINE_HEIGHT;
+            continue;
+        }
+        std::string line;
+        const int words = rng.uniform(3, 14);
+        for (int i = 0; i < words; ++i) {
+            const int letters = rng.uniform(2, 10);
+            for (int j = 0; j < letters; ++j) {
+                line += static_cast<char>('a' + rng.uniform(0, 26));
+            }
+            line += ' ';
+        }
+        cv::putText(image, line, cv::Point(rng.uniform(16, 64), y), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                    cv::Scalar(30, 30, 30, 255), 1, cv::LINE_AA);
+        y += LINE_HEIGHT;
+    }
+}
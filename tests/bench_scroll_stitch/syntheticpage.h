@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETICPAGE_H
+#define SYNTHETICPAGE_H
+
+#include <QVector>
+
+#include<opencv2/opencv.hpp>
+
+/**
+ * @brief 模拟的滚动页面：固定的顶栏和底栏之间显示页面的一部分，
+ * 页面由抗锯齿的文字行、色块及可选的重复段落组成
+ */
+class SyntheticPage
+{
+public:
+    struct Options {
+        int width = 1280;
+        int pageRows = 12000;       // 页面总高度
+        int viewportRows = 900;     // 截图区域高度，包括顶栏和底栏
+        int headerRows = 0;         // 固定顶栏高度
+        int footerRows = 0;         // 固定底栏高度
+        int repeatPeriod = 0;       // 大于0时页面每隔该高度重复同一段内容
+        unsigned int seed = 20211020;
+    };
+
+    explicit SyntheticPage(const Options &options);
+
+    /**
+     * @brief 截图区域中页面内容的高度
+     */
+    int contentRows() const;
+
+    /**
+     * @brief 页面可滚动的最大位置
+     */
+    int maxScroll() const;
+
+    /**
+     * @brief 页面滚动到scroll行时的截图：顶栏、页面第scroll行起的内容、底栏
+     */
+    cv::Mat frame(int scroll) const;
+
+    /**
+     * @brief 滚动位置在[minScroll, maxScroll]之间时拼接出的长图的真实内容
+     */
+    cv::Mat expected(int minScroll, int maxScroll) const;
+
+    /**
+     * @brief 生成滚动位置序列，相邻两次的滚动距离在[minDelta, maxDelta]之间随机取值
+     * @param scrollUp:从页面底部向上滚动
+     */
+    QVector<int> scrollPositions(int minDelta, int maxDelta, bool scrollUp) const;
+
+private:
+    void drawTextLines(cv::Mat &image, cv::RNG &rng) const;
+
+private:
+    Options m_options;
+    cv::Mat m_page;
+    cv::Mat m_header;
+    cv::Mat m_footer;
+};
+
+#endif // SYNTHETICPAGE_H
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# 图形编辑区鼠标命中判断的性能基准测试
+# 随机生成矩形、圆形、箭头和画笔，分别逐个判断全部图形和只判断网格中的候选图形，
+# 比较每次鼠标事件的耗时，并校验两种方式命中的图形一致
+# 用法: bench_shape_hittest [--shapes 500] [--events 20000] [--tablet]
+#
+#-------------------------------------------------
+
+QT       += core gui widgets dtkwidget
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+TARGET = bench_shape_hittest
+
+INCLUDEPATH += . ../../src/
+
+QMAKE_CXXFLAGS += -O2 -Wno-error=deprecated-declarations -Wno-deprecated-declarations
+
+HEADERS += \
+    ../../src/utils/calculaterect.h \
+    ../../src/utils/shapesutils.h \
+    ../../src/utils/shapesgrid.h
+
+SOURCES += \
+    main.cpp \
+    ../../src/utils/calculaterect.cpp \
+    ../../src/utils/shapesutils.cpp \
+    ../../src/utils/shapesgrid.cpp
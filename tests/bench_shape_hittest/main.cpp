@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "utils/calculaterect.h"
+#include "utils/shapesgrid.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <random>
+
+// 基准测试不链接utils.cpp，点击范围在这里定义
+bool Utils::isTabletEnvironment = false;
+
+// 与ShapesWidget中旋转点的点击范围一致
+static const int SPACING = 12;
+
+static QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+// 控制点和旋转点，与ShapesWidget::hoverOnRect等函数的判断顺序一致，按图形已选中处理
+static bool hoverOnHandles(const FourPoints &mainPoints, const QPointF &pos)
+{
+    for (const QPointF &point : mainPoints) {
+        if (pointClickIn(point, pos)) {
+            return true;
+        }
+    }
+    QPointF rotatePoint = getRotatePoint(mainPoints[0], mainPoints[1], mainPoints[2], mainPoints[3]);
+    rotatePoint = QPointF(rotatePoint.x() - 5, rotatePoint.y() - 5);
+    if (qAbs(pos.x() - rotatePoint.x()) <= SPACING && qAbs(pos.y() - rotatePoint.y()) <= SPACING) {
+        return true;
+    }
+    for (const QPointF &point : getAnotherFPoints(mainPoints)) {
+        if (pointClickIn(point, pos)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 与ShapesWidget::hoverOnShapes的判断一致
+static bool hoverOnShape(const Toolshape &shape, const QPointF &pos)
+{
+    if (shape.type == ShapeType::Rectangle) {
+        const FourPoints &p = shape.mainPoints;
+        return hoverOnHandles(p, pos) || pointOnLine(p[0], p[1], pos) || pointOnLine(p[1], p[3], pos)
+               || pointOnLine(p[3], p[2], pos) || pointOnLine(p[2], p[0], pos);
+    } else if (shape.type == ShapeType::Oval) {
+        return hoverOnHandles(shape.mainPoints, pos) || pointOnEllipse(shape.mainPoints, pos);
+    } else if (shape.type == ShapeType::Arrow) {
+        return shape.points.length() == 2 && (pointOnLine(shape.points[0], shape.points[1], pos)
+                                              || pointClickIn(shape.points[0], pos) || pointClickIn(shape.points[1], pos));
+    } else if (shape.type == ShapeType::Line) {
+        return hoverOnHandles(shape.mainPoints, pos) || pointOnArLine(shape.points, pos);
+    }
+    return false;
+}
+
+// 随机生成各类图形，范围为width x height的截图区域
+static QList<Toolshape> generateShapes(int count, int width, int height, std::mt19937 &random)
+{
+    std::uniform_real_distribution<qreal> xDist(0, width);
+    std::uniform_real_distribution<qreal> yDist(0, height);
+    std::uniform_real_distribution<qreal> sizeDist(20, 300);
+    std::uniform_real_distribution<qreal> stepDist(-6, 6);
+    std::uniform_int_distribution<int> lengthDist(20, 400);
+    static const ShapeType::Kind types[] = {ShapeType::Rectangle, ShapeType::Oval, ShapeType::Arrow, ShapeType::Line};
+
+    QList<Toolshape> shapes;
+    for (int i = 0; i < count; ++i) {
+        Toolshape shape;
+        shape.type = types[i % 4];
+        const QPointF start(xDist(random), yDist(random));
+        if (shape.type == ShapeType::Arrow) {
+            shape.points << start << start + QPointF(sizeDist(random), sizeDist(random) - 160);
+        } else if (shape.type == ShapeType::Line) {
+            //画笔为随机游走的折线，点的间距与鼠标移动事件接近
+            QPointF point = start;
+            const int length = lengthDist(random);
+            for (int k = 0; k < length; ++k) {
+                shape.points << point;
+                point += QPointF(stepDist(random), stepDist(random));
+            }
+            //与松开鼠标时保存的画笔一致
+            shape.points = simplifyLine(shape.points, 0.5);
+            shape.mainPoints = fourPointsOfLine(shape.points);
+        } else {
+            shape.mainPoints = getMainPoints(start, start + QPointF(sizeDist(random), sizeDist(random)));
+        }
+        shape.index = i;
+        shapes << shape;
+    }
+    return shapes;
+}
+
+static void runBenchmark(int shapeCount, int eventCount, quint32 seed)
+{
+    const int width = 1920;
+    const int height = 1080;
+    std::mt19937 random(seed);
+    const QList<Toolshape> shapes = generateShapes(shapeCount, width, height, random);
+
+    std::uniform_real_distribution<qreal> xDist(0, width);
+    std::uniform_real_distribution<qreal> yDist(0, height);
+    QVector<QPointF> positions;
+    positions.reserve(eventCount);
+    for (int i = 0; i < eventCount; ++i) {
+        positions << QPointF(xDist(random), yDist(random));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ShapesGrid grid;
+    for (int i = 0; i < shapes.length(); ++i) {
+        grid.insertShape(i, shapes[i]);
+    }
+    const qint64 buildNs = timer.nsecsElapsed();
+
+    //逐个判断全部图形，与原来的鼠标移动事件处理一致
+    QVector<int> linearHits(eventCount, -1);
+    timer.restart();
+    for (int e = 0; e < eventCount; ++e) {
+        for (int i = 0; i < shapes.length(); ++i) {
+            if (hoverOnShape(shapes[i], positions[e])) {
+                linearHits[e] = i;
+                break;
+            }
+        }
+    }
+    const qint64 linearNs = timer.nsecsElapsed();
+
+    //只判断鼠标所在格子中的图形
+    QVector<int> gridHits(eventCount, -1);
+    int candidates = 0;
+    timer.restart();
+    for (int e = 0; e < eventCount; ++e) {
+        const QVector<int> orders = grid.shapesAt(positions[e]);
+        candidates += orders.size();
+        for (int i : orders) {
+            if (hoverOnShape(shapes[i], positions[e])) {
+                gridHits[e] = i;
+                break;
+            }
+        }
+    }
+    const qint64 gridNs = timer.nsecsElapsed();
+
+    int mismatches = 0;
+    int hits = 0;
+    for (int e = 0; e < eventCount; ++e) {
+        mismatches += linearHits[e] != gridHits[e] ? 1 : 0;
+        hits += linearHits[e] != -1 ? 1 : 0;
+    }
+
+    out() << "shapes " << shapeCount << ": hits " << hits << "/" << eventCount
+          << ", candidates/event " << QString::number(double(candidates) / eventCount, 'f', 1)
+          << ", mismatches " << mismatches << "\n"
+          << "  linear " << QString::number(linearNs / 1000.0 / eventCount, 'f', 2) << " us/event"
+          << ", grid " << QString::number(gridNs / 1000.0 / eventCount, 'f', 2) << " us/event"
+          << ", speedup " << QString::number(double(linearNs) / qMax<qint64>(1, gridNs), 'f', 1) << "x"
+          << ", grid build " << QString::number(buildNs / 1000.0, 'f', 1) << " us\n";
+    out().flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Shape hit-testing benchmark");
+    parser.addHelpOption();
+    const QCommandLineOption shapesOption("shapes", "Run only with the given number of shapes.", "count");
+    const QCommandLineOption eventsOption("events", "Mouse events per run.", "count", "20000");
+    const QCommandLineOption seedOption("seed", "Random seed.", "seed", "20211020");
+    const QCommandLineOption tabletOption("tablet", "Use the tablet click padding.");
+    parser.addOptions({shapesOption, eventsOption, seedOption, tabletOption});
+    parser.process(app);
+
+    Utils::isTabletEnvironment = parser.isSet(tabletOption);
+    const int eventCount = qMax(1, parser.value(eventsOption).toInt());
+    const quint32 seed = parser.value(seedOption).toUInt();
+
+    QList<int> shapeCounts;
+    if (parser.isSet(shapesOption)) {
+        shapeCounts << qMax(1, parser.value(shapesOption).toInt());
+    } else {
+        shapeCounts << 100 << 200 << 500 << 1000;
+    }
+    for (int shapeCount : shapeCounts) {
+        runBenchmark(shapeCount, eventCount, seed);
+    }
+    return 0;
+}
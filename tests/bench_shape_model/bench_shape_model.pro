@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# 图形数据结构的性能基准测试
+# 用原来按字符串区分类型、QList存放点的图形与现在的Toolshape分别模拟绘制和拖动，
+# 统计200个图形时每帧绘制和拖动的耗时
+# 用法: bench_shape_model [--shapes 200] [--frames 300]
+#
+#-------------------------------------------------
+
+QT       += core gui widgets dtkwidget
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+TARGET = bench_shape_model
+
+INCLUDEPATH += . ../../src/
+
+QMAKE_CXXFLAGS += -O2 -Wno-error=deprecated-declarations -Wno-deprecated-declarations
+
+HEADERS += \
+    ../../src/utils/calculaterect.h \
+    ../../src/utils/shapesutils.h
+
+SOURCES += \
+    main.cpp \
+    ../../src/utils/calculaterect.cpp \
+    ../../src/utils/shapesutils.cpp
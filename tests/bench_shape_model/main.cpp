@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Deepin Technology Co., Ltd.
+ *
+ * Author:     He Mingyang<hemingyang@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "utils/calculaterect.h"
+#include "utils/shapesutils.h"
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTextStream>
+
+#include <random>
+
+// 基准测试不链接utils.cpp
+bool Utils::isTabletEnvironment = false;
+
+// 原来的图形：类型为字符串，点存放在QList中
+struct LegacyShape {
+    QString type;
+    QList<QPointF> mainPoints;
+    int index = -1;
+    int lineWidth = 1;
+    int colorIndex = 0;
+    bool isBlur = false;
+    bool isMosaic = false;
+    bool isStraight = false;
+    bool isShiftPressed = false;
+    int fontSize = 1;
+    QList<QPointF> points;
+    QList<QList<qreal>> portion;
+    QPointF arrowRotatePos;
+
+    LegacyShape()
+    {
+        mainPoints.append(QPointF(0, 0));
+        mainPoints.append(QPointF(0, 0));
+        mainPoints.append(QPointF(0, 0));
+        mainPoints.append(QPointF(0, 0));
+    }
+};
+
+static QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+static void paintPolygon(QPainter &painter, const QPointF &p0, const QPointF &p1, const QPointF &p2, const QPointF &p3)
+{
+    const QPointF points[4] = {p0, p1, p3, p2};
+    painter.drawPolygon(points, 4);
+}
+
+// 原来的绘制：按类型名称逐个比较，画笔按quadTo生成路径
+static void paintLegacy(QPainter &painter, const QList<LegacyShape> &shapes)
+{
+    QPen pen;
+    for (int i = 0; i < shapes.length(); i++) {
+        pen.setWidthF(shapes[i].lineWidth - 0.5);
+        painter.setPen(pen);
+        if (shapes[i].type == "rectangle") {
+            paintPolygon(painter, shapes[i].mainPoints[0], shapes[i].mainPoints[1], shapes[i].mainPoints[2], shapes[i].mainPoints[3]);
+        } else if (shapes[i].type == "oval") {
+            painter.drawEllipse(QRectF(shapes[i].mainPoints[0], shapes[i].mainPoints[3]));
+        } else if (shapes[i].type == "arrow") {
+            painter.drawLine(shapes[i].points[0], shapes[i].points[1]);
+        } else if (shapes[i].type == "line") {
+            QPainterPath path(shapes[i].points[0]);
+            for (int k = 1; k < shapes[i].points.length() - 2; k++) {
+                path.quadTo(shapes[i].points[k], shapes[i].points[k + 1]);
+            }
+            painter.drawPath(path);
+        } else if (shapes[i].type == "text") {
+            paintPolygon(painter, shapes[i].mainPoints[0], shapes[i].mainPoints[1], shapes[i].mainPoints[2], shapes[i].mainPoints[3]);
+        }
+    }
+}
+
+// 现在的绘制：按类型的枚举值分支，画笔按保存的折线绘制
+static void paintShapes(QPainter &painter, const Toolshapes &shapes)
+{
+    QPen pen;
+    for (const Toolshape &shape : shapes) {
+        pen.setWidthF(shape.lineWidth - 0.5);
+        painter.setPen(pen);
+        switch (shape.type) {
+        case ShapeType::Rectangle:
+        case ShapeType::Text:
+            paintPolygon(painter, shape.mainPoints[0], shape.mainPoints[1], shape.mainPoints[2], shape.mainPoints[3]);
+            break;
+        case ShapeType::Oval:
+            painter.drawEllipse(QRectF(shape.mainPoints[0], shape.mainPoints[3]));
+            break;
+        case ShapeType::Arrow:
+            painter.drawLine(shape.points[0], shape.points[1]);
+            break;
+        case ShapeType::Line:
+            painter.drawPolyline(QPolygonF(shape.points));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// 拖动一帧：平移选中的图形，复制为选中和悬停的图形，再按类型逐个判断鼠标所在的图形
+template <typename Shapes, typename Shape>
+static int dragFrame(Shapes &shapes, int order, const QPointF &delta, Shape &selected, Shape &hovered,
+                     bool (*isType)(const Shape &, int))
+{
+    for (int i = 0; i < shapes[order].mainPoints.length(); i++) {
+        shapes[order].mainPoints[i] = shapes[order].mainPoints[i] + delta;
+    }
+    for (int i = 0; i < shapes[order].points.length(); i++) {
+        shapes[order].points[i] = shapes[order].points[i] + delta;
+    }
+    selected = shapes[order];
+    hovered = shapes[order];
+    int matched = 0;
+    for (int i = 0; i < shapes.length(); i++) {
+        for (int type = 0; type < 5; type++) {
+            if (isType(shapes[i], type)) {
+                matched++;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+static const char *const TYPE_NAMES[] = {"rectangle", "oval", "arrow", "line", "text"};
+static const ShapeType::Kind TYPE_KINDS[] = {ShapeType::Rectangle, ShapeType::Oval, ShapeType::Arrow,
+                                             ShapeType::Line, ShapeType::Text};
+
+static bool legacyIsType(const LegacyShape &shape, int type)
+{
+    return shape.type == TYPE_NAMES[type];
+}
+
+static bool shapeIsType(const Toolshape &shape, int type)
+{
+    return shape.type == TYPE_KINDS[type];
+}
+
+static void runBenchmark(int shapeCount, int frames, quint32 seed)
+{
+    const int width = 1920;
+    const int height = 1080;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<qreal> xDist(0, width);
+    std::uniform_real_distribution<qreal> yDist(0, height);
+    std::uniform_real_distribution<qreal> sizeDist(20, 300);
+    std::uniform_real_distribution<qreal> stepDist(-6, 6);
+    std::uniform_int_distribution<int> lengthDist(100, 1500);
+
+    //两种图形使用相同的随机数据；画笔原来保存全部的点，现在保存简化后的折线
+    QList<LegacyShape> legacyShapes;
+    Toolshapes shapes;
+    for (int i = 0; i < shapeCount; ++i) {
+        LegacyShape legacy;
+        legacy.type = QString(TYPE_NAMES[i % 5]);
+        legacy.index = i;
+        legacy.lineWidth = 3;
+        const QPointF start(xDist(random), yDist(random));
+        if (legacy.type == "arrow") {
+            legacy.points << start << start + QPointF(sizeDist(random), sizeDist(random));
+        } else if (legacy.type == "line") {
+            QPointF point = start;
+            const int length = lengthDist(random);
+            for (int k = 0; k < length; ++k) {
+                legacy.points << point;
+                point += QPointF(stepDist(random), stepDist(random));
+            }
+        }
+        Toolshape shape;
+        shape.type = ShapeType(legacy.type);
+        shape.index = legacy.index;
+        shape.lineWidth = legacy.lineWidth;
+        shape.points = QVector<QPointF>::fromList(legacy.points);
+        if (legacy.type == "line") {
+            legacy.mainPoints = fourPointsOfLine(shape.points).toList();
+            shape.points = simplifyLine(shape.points, 0.5);
+            shape.mainPoints = fourPointsOfLine(shape.points);
+        } else if (legacy.type != "arrow") {
+            shape.mainPoints = getMainPoints(start, start + QPointF(sizeDist(random), sizeDist(random)));
+            legacy.mainPoints = shape.mainPoints.toList();
+        }
+        legacyShapes << legacy;
+        shapes << shape;
+    }
+
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer timer;
+
+    image.fill(Qt::transparent);
+    timer.start();
+    for (int f = 0; f < frames; ++f) {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        paintLegacy(painter, legacyShapes);
+    }
+    const qint64 legacyPaintNs = timer.nsecsElapsed();
+
+    image.fill(Qt::transparent);
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        paintShapes(painter, shapes);
+    }
+    const qint64 paintNs = timer.nsecsElapsed();
+
+    //拖动最后一个画笔，每帧移动一个像素
+    int order = shapeCount - 1;
+    while (order > 0 && shapes[order].type != ShapeType::Line) {
+        --order;
+    }
+    int legacyMatched = 0;
+    LegacyShape legacySelected;
+    LegacyShape legacyHovered;
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        legacyMatched += dragFrame(legacyShapes, order, QPointF(1, 0), legacySelected, legacyHovered, legacyIsType);
+    }
+    const qint64 legacyDragNs = timer.nsecsElapsed();
+
+    int matched = 0;
+    Toolshape selected;
+    Toolshape hovered;
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        matched += dragFrame(shapes, order, QPointF(1, 0), selected, hovered, shapeIsType);
+    }
+    const qint64 dragNs = timer.nsecsElapsed();
+
+    int legacyPoints = 0;
+    int points = 0;
+    for (int i = 0; i < shapeCount; ++i) {
+        legacyPoints += legacyShapes[i].points.length();
+        points += shapes[i].points.length();
+    }
+
+    out() << "shapes " << shapeCount << ", frames " << frames << ", points " << legacyPoints << " -> " << points
+          << (legacyMatched == matched ? "" : ", type mismatch") << "\n"
+          << "  paint: legacy " << QString::number(legacyPaintNs / 1000.0 / frames, 'f', 1) << " us/frame"
+          << ", typed " << QString::number(paintNs / 1000.0 / frames, 'f', 1) << " us/frame\n"
+          << "  drag:  legacy " << QString::number(legacyDragNs / 1000.0 / frames, 'f', 2) << " us/frame"
+          << ", typed " << QString::number(dragNs / 1000.0 / frames, 'f', 2) << " us/frame\n";
+    out().flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Shape model paint and drag benchmark");
+    parser.addHelpOption();
+    const QCommandLineOption shapesOption("shapes", "Number of shapes.", "count", "200");
+    const QCommandLineOption framesOption("frames", "Frames per run.", "count", "300");
+    const QCommandLineOption seedOption("seed", "Random seed.", "seed", "20211020");
+    parser.addOptions({shapesOption, framesOption, seedOption});
+    parser.process(app);
+
+    runBenchmark(qMax(5, parser.value(shapesOption).toInt()), qMax(1, parser.value(framesOption).toInt()),
+                 parser.value(seedOption).toUInt());
+    return 0;
+}
@@ -3,4 +3,7 @@ TEMPLATE  = subdirs
 SUBDIRS += \
           ut_screen_shot_recorder/ut_screen_shot_recorder.pro \
           ut_dde_dock_plugins/ut_dde_dock_plugins.pro \
-    ut_pin_screenshots
+    ut_pin_screenshots \
+    bench_scroll_stitch \
+    bench_shape_hittest \
+    bench_shape_model
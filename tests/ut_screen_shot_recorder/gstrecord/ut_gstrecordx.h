@@ -7,6 +7,9 @@
 #include "addr_pri.h"
 
 #include <QImage>
+#include <QFile>
+#include <QSettings>
+#include <QThread>
 using namespace testing;
 
 
@@ -62,6 +65,142 @@ TEST_F(GstRecordXTest, x11GstRecord)
     }
 
 }
+//x11 gstreamer录屏，倒计时期间预先构建管道
+TEST_F(GstRecordXTest, x11GstPrepareRecord)
+{
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 500, 500));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath("/tmp/test_prepare.webm");
+    m_gstRecordx->setX11RecordMouse(true);
+
+    m_gstRecordx->x11GstPrepareRecord();
+    //重复调用不会重复构建管道
+    m_gstRecordx->x11GstPrepareRecord();
+    m_gstRecordx->x11GstStartRecord();
+    EXPECT_GT(m_gstRecordx->getRecordStartTime(), 0);
+    m_gstRecordx->x11GstStopRecord();
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
+
+//x11 gstreamer录屏，倒计时期间取消，释放管道并删除输出文件
+TEST_F(GstRecordXTest, x11GstCancelPrepare)
+{
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+
+    const QString savePath = "/tmp/test_cancel.webm";
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 500, 500));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath(savePath);
+    m_gstRecordx->setX11RecordMouse(true);
+
+    m_gstRecordx->x11GstPrepareRecord();
+    m_gstRecordx->cancelPrepare();
+    EXPECT_FALSE(QFile::exists(savePath));
+    //取消后不再构建管道，也不会开始录制
+    m_gstRecordx->x11GstPrepareRecord();
+    m_gstRecordx->x11GstStartRecord();
+    EXPECT_FALSE(QFile::exists(savePath));
+    //重复取消无影响
+    m_gstRecordx->cancelPrepare();
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
+
+//x11 gstreamer录屏，开启管道统计
+TEST_F(GstRecordXTest, x11GstRecordTrace)
+{
+    qputenv("DEEPIN_SCREEN_RECORDER_GST_TRACE", "1");
+    EXPECT_TRUE(GstPipelineTracer::isEnabled());
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 500, 500));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath("/tmp/test_trace.webm");
+    m_gstRecordx->setX11RecordMouse(true);
+
+    m_gstRecordx->x11GstStartRecord();
+    m_gstRecordx->x11GstStopRecord();
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+    qunsetenv("DEEPIN_SCREEN_RECORDER_GST_TRACE");
+}
+
+//管道运行时间，由测试控制
+static GstClockTime s_traceRunningTime = 0;
+static GstClockTime gst_clock_get_time_stub(GstClock *clock)
+{
+    Q_UNUSED(clock);
+    return s_traceRunningTime;
+}
+
+//创建指定时间戳的buffer
+static GstBuffer *newTraceBuffer(GstClockTime pts)
+{
+    GstBuffer *buffer = gstInterface::m_gst_buffer_new_wrapped(gstInterface::m_g_malloc(16), 16);
+    GST_BUFFER_PTS(buffer) = pts;
+    return buffer;
+}
+
+//管道统计：直接调用探针的回调，统计结果中的编码延迟、迟到及丢弃的buffer数量
+TEST_F(GstRecordXTest, pipelineTracerSummary)
+{
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    //统计只读取管道的时钟及基准时间，使用假的管道和时钟
+    GstElement pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    GST_ELEMENT_CLOCK(&pipeline) = reinterpret_cast<GstClock *>(&pipeline);
+    gstInterface::p_gst_clock_get_time clockGetTime = gstInterface::m_gst_clock_get_time;
+    gstInterface::m_gst_clock_get_time = gst_clock_get_time_stub;
+
+    GstPipelineTracer tracer("test", &pipeline);
+    GstBuffer *buffers[3];
+    for (int i = 0; i < 3; ++i) {
+        buffers[i] = newTraceBuffer(i * 40 * GST_MSECOND);
+        tracer.onSourceBuffer();
+        tracer.onEncoderInput(buffers[i]);
+    }
+    QThread::msleep(20);
+    //第一个buffer按时输出
+    s_traceRunningTime = 100 * GST_MSECOND;
+    tracer.onEncoderOutput(buffers[0]);
+    //第二个buffer被编码器丢弃，第三个buffer输出时已落后600ms
+    s_traceRunningTime = (80 + 600) * GST_MSECOND;
+    tracer.onEncoderOutput(buffers[2]);
+
+    const GstPipelineTracer::Summary summary = tracer.printSummary(5);
+    EXPECT_EQ(3u, summary.sourceBuffers);
+    EXPECT_EQ(5u, summary.droppedAtSource);
+    EXPECT_EQ(0u, summary.rateDropped);
+    EXPECT_EQ(0u, summary.rateDuplicated);
+    EXPECT_EQ(3u, summary.encoderInputBuffers);
+    EXPECT_EQ(2u, summary.encoderOutputBuffers);
+    EXPECT_EQ(1u, summary.lateBuffers);
+    EXPECT_EQ(2u, summary.latencyCount);
+    EXPECT_GE(summary.latencyAvg, static_cast<qint64>(20 * GST_MSECOND));
+    EXPECT_GE(summary.latencyMax, summary.latencyAvg);
+
+    for (GstBuffer *buffer : buffers) {
+        gstInterface::m_gst_mini_object_unref(GST_MINI_OBJECT_CAST(buffer));
+    }
+    gstInterface::m_gst_clock_get_time = clockGetTime;
+}
+
 void g_object_set_stub(gpointer object, const gchar *first_property_name, ...)
 {
     Q_UNUSED(object);
@@ -136,3 +275,256 @@ TEST_F(GstRecordXTest, waylandWriteVideoFrame)
     }
 }
 
+
+ACCESS_PRIVATE_FIELD(GstRecordX, QList<GstRecordX::FrameBlock *>, m_frameBlocks);
+ACCESS_PRIVATE_FIELD(GstRecordX, QList<GstRecordX::FrameBlock *>, m_freeFrameBlocks);
+ACCESS_PRIVATE_FUN(GstRecordX, GstRecordX::FrameBlock *(int), acquireFrameBlock);
+
+//写入管道的视频帧使用内存池中的内存块，buffer释放后归还并复用
+TEST_F(GstRecordXTest, waylandFramePool)
+{
+    int argc = 1;
+    Stub stub;
+    stub.set(g_object_set, g_object_set_stub);
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+    QImage img1(":/testImg/addImg1.png");
+    img1 = img1.convertToFormat(QImage::Format_RGBA8888);
+
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, img1.width(), img1.height()));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath("/tmp/test_pool.webm");
+
+    QList<GstRecordX::FrameBlock *> &frameBlocks = access_private_field::GstRecordXm_frameBlocks(*m_gstRecordx);
+    QList<GstRecordX::FrameBlock *> &freeFrameBlocks = access_private_field::GstRecordXm_freeFrameBlocks(*m_gstRecordx);
+
+    m_gstRecordx->waylandGstStartRecord();
+    EXPECT_TRUE(m_gstRecordx->waylandWriteVideoFrame(img1.bits(), img1.width(), img1.height()));
+    ASSERT_EQ(1, frameBlocks.size());
+    GstRecordX::FrameBlock *pushedBlock = frameBlocks.first();
+    m_gstRecordx->waylandGstStopRecord();
+
+    //管道释放后所有buffer已归还内存池
+    EXPECT_EQ(frameBlocks.size(), freeFrameBlocks.size());
+    EXPECT_TRUE(freeFrameBlocks.contains(pushedBlock));
+
+    //相同大小的内存块直接复用，不再申请
+    const int size = img1.width() * img1.height() * 4;
+    GstRecordX::FrameBlock *block = call_private_fun::GstRecordXacquireFrameBlock(*m_gstRecordx, size);
+    EXPECT_EQ(pushedBlock, block);
+    EXPECT_EQ(1, frameBlocks.size());
+    EXPECT_TRUE(freeFrameBlocks.isEmpty());
+    m_gstRecordx->releaseFrameBlock(block);
+    EXPECT_EQ(1, freeFrameBlocks.size());
+
+    stub.reset(g_object_set);
+    gstInterface::m_g_main_loop_quit(m_gstRecordx->getGloop());
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
+
+ACCESS_PRIVATE_FIELD(GstRecordX, GstElement *, m_pipeline);
+
+//未停止录制直接析构时，先停止并释放管道，管道中的buffer归还后再释放内存池
+TEST_F(GstRecordXTest, waylandDestroyRunningPipeline)
+{
+    int argc = 1;
+    Stub stub;
+    stub.set(g_object_set, g_object_set_stub);
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+    QImage img1(":/testImg/addImg1.png");
+    img1 = img1.convertToFormat(QImage::Format_RGBA8888);
+
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, img1.width(), img1.height()));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath("/tmp/test_destroy.webm");
+
+    m_gstRecordx->waylandGstStartRecord();
+    EXPECT_TRUE(m_gstRecordx->waylandWriteVideoFrame(img1.bits(), img1.width(), img1.height()));
+    EXPECT_NE(nullptr, access_private_field::GstRecordXm_pipeline(*m_gstRecordx));
+
+    stub.reset(g_object_set);
+    gstInterface::m_g_main_loop_quit(m_gstRecordx->getGloop());
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+    QFile::remove("/tmp/test_destroy.webm");
+}
+
+ACCESS_PRIVATE_FIELD(GstRecordX, GstElement *, m_videoSrc);
+ACCESS_PRIVATE_FIELD(GstRecordX, quint64, m_pushedFrames);
+ACCESS_PRIVATE_FIELD(GstRecordX, quint64, m_droppedFrames);
+
+//appsrc发出enough-data后视频帧在源头丢弃，不拷贝也不入队；收到need-data后恢复写入
+TEST_F(GstRecordXTest, waylandEnoughDataDrop)
+{
+    int argc = 1;
+    Stub stub;
+    stub.set(g_object_set, g_object_set_stub);
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+    QImage img1(":/testImg/addImg1.png");
+    img1 = img1.convertToFormat(QImage::Format_RGBA8888);
+
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setRecordArea(QRect(0, 0, img1.width(), img1.height()));
+    m_gstRecordx->setAudioType(GstRecordX::AudioType::None);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setSavePath("/tmp/test_enough_data.webm");
+
+    quint64 &pushedFrames = access_private_field::GstRecordXm_pushedFrames(*m_gstRecordx);
+    quint64 &droppedFrames = access_private_field::GstRecordXm_droppedFrames(*m_gstRecordx);
+    QList<GstRecordX::FrameBlock *> &frameBlocks = access_private_field::GstRecordXm_frameBlocks(*m_gstRecordx);
+
+    m_gstRecordx->waylandGstStartRecord();
+    GstElement *videoSrc = access_private_field::GstRecordXm_videoSrc(*m_gstRecordx);
+    ASSERT_NE(nullptr, videoSrc);
+
+    gstInterface::m_g_signal_emit_by_name(videoSrc, "enough-data");
+    EXPECT_FALSE(m_gstRecordx->waitForNeedData(10));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_FALSE(m_gstRecordx->waylandWriteVideoFrame(img1.bits(), img1.width(), img1.height()));
+    }
+    EXPECT_EQ(3u, droppedFrames);
+    EXPECT_EQ(0u, pushedFrames);
+    //丢弃的帧没有申请内存块
+    EXPECT_TRUE(frameBlocks.isEmpty());
+
+    gstInterface::m_g_signal_emit_by_name(videoSrc, "need-data", 0u);
+    EXPECT_TRUE(m_gstRecordx->waitForNeedData(10));
+    EXPECT_TRUE(m_gstRecordx->waylandWriteVideoFrame(img1.bits(), img1.width(), img1.height()));
+    EXPECT_EQ(1u, pushedFrames);
+    EXPECT_EQ(3u, droppedFrames);
+
+    m_gstRecordx->waylandGstStopRecord();
+    stub.reset(g_object_set);
+    gstInterface::m_g_main_loop_quit(m_gstRecordx->getGloop());
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
+
+ACCESS_PRIVATE_FUN(GstRecordX, QString(), selectVideoEncoder);
+ACCESS_PRIVATE_FUN(GstRecordX, QString() const, encoderCacheKey);
+ACCESS_PRIVATE_FUN(GstRecordX, QSize() const, encoderBenchmarkSize);
+ACCESS_PRIVATE_FUN(GstRecordX, double(const QString &, const QSize &, qint64), benchmarkVideoEncoder);
+
+static int benchmarkVideoEncoderCount = 0;
+static double benchmarkVideoEncoder_stub(void *obj, const QString &encoder, const QSize &size, qint64 timeLimit)
+{
+    Q_UNUSED(obj);
+    Q_UNUSED(encoder);
+    Q_UNUSED(size);
+    Q_UNUSED(timeLimit);
+    benchmarkVideoEncoderCount++;
+    return 1000;
+}
+
+//相近的录制区域共用编码器测试结果，命中缓存时不再测试
+TEST_F(GstRecordXTest, selectVideoEncoderCache)
+{
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 1366, 768));
+    const QString cacheKey = call_private_fun::GstRecordXencoderCacheKey(*m_gstRecordx);
+    const QSize benchmarkSize = call_private_fun::GstRecordXencoderBenchmarkSize(*m_gstRecordx);
+    //测试分辨率不小于录制区域，保证结果对同档位的区域都适用
+    EXPECT_GE(benchmarkSize.width(), 1366);
+    EXPECT_GE(benchmarkSize.height(), 768);
+
+    m_gstRecordx->setRecordArea(QRect(0, 0, 1360, 760));
+    EXPECT_EQ(cacheKey, call_private_fun::GstRecordXencoderCacheKey(*m_gstRecordx));
+    m_gstRecordx->setRecordArea(QRect(0, 0, 3840, 2160));
+    EXPECT_NE(cacheKey, call_private_fun::GstRecordXencoderCacheKey(*m_gstRecordx));
+
+    Stub stub;
+    auto GstRecordX_benchmarkVideoEncoder = get_private_fun::GstRecordXbenchmarkVideoEncoder();
+    stub.set(GstRecordX_benchmarkVideoEncoder, benchmarkVideoEncoder_stub);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 1366, 768));
+    benchmarkVideoEncoderCount = 0;
+    //首次选择时测试并缓存结果
+    const QString encoder = call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx);
+    EXPECT_FALSE(encoder.isEmpty());
+    EXPECT_LT(0, benchmarkVideoEncoderCount);
+    //同档位的区域直接使用缓存结果
+    benchmarkVideoEncoderCount = 0;
+    m_gstRecordx->setRecordArea(QRect(0, 0, 1360, 760));
+    EXPECT_EQ(encoder, call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx));
+    EXPECT_EQ(0, benchmarkVideoEncoderCount);
+    stub.reset(GstRecordX_benchmarkVideoEncoder);
+
+    QSettings settings("deepin", "deepin-screen-recorder");
+    settings.beginGroup("gstencoder");
+    settings.remove(cacheKey);
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
+
+static double benchmarkVideoEncoderSlow_stub(void *obj, const QString &encoder, const QSize &size, qint64 timeLimit)
+{
+    Q_UNUSED(obj);
+    Q_UNUSED(size);
+    Q_UNUSED(timeLimit);
+    benchmarkVideoEncoderCount++;
+    return encoder.contains("cpu-used=16") ? 20 : 10;
+}
+
+static double benchmarkVideoEncoderTimeout_stub(void *obj, const QString &encoder, const QSize &size, qint64 timeLimit)
+{
+    Q_UNUSED(obj);
+    Q_UNUSED(encoder);
+    Q_UNUSED(size);
+    Q_UNUSED(timeLimit);
+    benchmarkVideoEncoderCount++;
+    QThread::msleep(1000);
+    return 10;
+}
+
+//慢速机器上所有配置都达不到实时编码速度时，测完所有配置并缓存最快的配置
+TEST_F(GstRecordXTest, selectVideoEncoderSlowMachine)
+{
+    int argc = 1;
+    gstInterface::m_gst_init(&argc, nullptr);
+    GstRecordX *m_gstRecordx = new GstRecordX();
+    m_gstRecordx->setFramerate(24);
+    m_gstRecordx->setVidoeType(GstRecordX::VideoType::webm);
+    m_gstRecordx->setRecordArea(QRect(0, 0, 1366, 768));
+    const QString cacheKey = call_private_fun::GstRecordXencoderCacheKey(*m_gstRecordx);
+    QSettings settings("deepin", "deepin-screen-recorder");
+    settings.beginGroup("gstencoder");
+    settings.remove(cacheKey);
+
+    Stub stub;
+    auto GstRecordX_benchmarkVideoEncoder = get_private_fun::GstRecordXbenchmarkVideoEncoder();
+    stub.set(GstRecordX_benchmarkVideoEncoder, benchmarkVideoEncoderSlow_stub);
+    benchmarkVideoEncoderCount = 0;
+    const QString encoder = call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx);
+    EXPECT_TRUE(encoder.contains("cpu-used=16"));
+    EXPECT_EQ(3, benchmarkVideoEncoderCount);
+    //结果已缓存，不再测试
+    benchmarkVideoEncoderCount = 0;
+    EXPECT_EQ(encoder, call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx));
+    EXPECT_EQ(0, benchmarkVideoEncoderCount);
+    stub.reset(GstRecordX_benchmarkVideoEncoder);
+
+    //测试超时时直接选择并缓存最快的配置
+    settings.remove(cacheKey);
+    stub.set(GstRecordX_benchmarkVideoEncoder, benchmarkVideoEncoderTimeout_stub);
+    benchmarkVideoEncoderCount = 0;
+    EXPECT_EQ(encoder, call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx));
+    EXPECT_EQ(1, benchmarkVideoEncoderCount);
+    benchmarkVideoEncoderCount = 0;
+    EXPECT_EQ(encoder, call_private_fun::GstRecordXselectVideoEncoder(*m_gstRecordx));
+    EXPECT_EQ(0, benchmarkVideoEncoderCount);
+    stub.reset(GstRecordX_benchmarkVideoEncoder);
+
+    settings.remove(cacheKey);
+    delete m_gstRecordx;
+    m_gstRecordx = nullptr;
+}
@@ -8,6 +8,9 @@
 #include "widgets/ut_shapeswidget.h" //放前面
 #include "ut_main_window.h"
 #include "utils/ut_pixmergethread.h"
+#include "utils/ut_longimage.h"
+#include "utils/ut_longimagepreview.h"
+#include "utils/ut_autoscrollcontroller.h"
 #include "utils/ut_scrollScreenshot.h"
 #include "utils/ut_audioutils.h"
 #include "utils/ut_baseutils.h"
@@ -16,6 +19,9 @@
 #include "utils/ut_screengrabber.h"
 #include "utils/ut_shortcut.h"
 #include "utils/ut_tempfile.h"
+#include "utils/ut_shapeeffect.h"
+#include "utils/ut_shapesgrid.h"
+#include "utils/ut_shapeshistory.h"
 #include "utils/ut_utils_other.h"
 #include "utils/ut_calculaterect.h"
 #include "widgets/ut_keybuttonwidget.h"
@@ -984,7 +984,7 @@ static bool setScrollModel_stub(void *obj, bool)
     return true;
 }
 //替换ScrollScreenshot的addPixmap函数
-static bool addPixmap_stub(void *obj, const QPixmap &piximg, int wheelDirection)
+static bool addPixmap_stub(void *obj, const QImage &piximg, int wheelDirection)
 {
     Q_UNUSED(obj);
     Q_UNUSED(piximg);
@@ -1344,7 +1344,7 @@ TEST_F(MainWindowTest, initScrollShot)
     */
 }
 
-ACCESS_PRIVATE_FIELD(MainWindow, QPixmap, m_firstScrollShotImg);
+ACCESS_PRIVATE_FIELD(MainWindow, QImage, m_firstScrollShotImg);
 //ACCESS_PRIVATE_FIELD(MainWindow, DPushButton *, m_shotButton);
 ACCESS_PRIVATE_FIELD(MainWindow, TopTips *, m_scrollShotSizeTips);
 ACCESS_PRIVATE_FIELD(MainWindow, PreviewWidget *, m_previewWidget);
@@ -1499,14 +1499,18 @@ TEST_F(MainWindowTest, scrollShotGrabPixmap)
 
 }
 
-static void updateImage_stub(void *obj, QImage img)
+static void updateImageRows_stub(void *obj, QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize)
 {
     Q_UNUSED(obj);
-    Q_UNUSED(img);
+    Q_UNUSED(rows);
+    Q_UNUSED(keepStart);
+    Q_UNUSED(keepEnd);
+    Q_UNUSED(isPrepend);
+    Q_UNUSED(imageSize);
     qDebug() << "预览窗口更新图片";
 }
 ACCESS_PRIVATE_FIELD(MainWindow, ScreenGrabber, m_screenGrabber);
-ACCESS_PRIVATE_FUN(MainWindow, void(QImage img), showPreviewWidgetImage);
+ACCESS_PRIVATE_FUN(MainWindow, void(QImage rows, int keepStart, int keepEnd, bool isPrepend, QSize imageSize), showPreviewWidgetImage);
 //显示预览窗口和图片单元测试用例
 TEST_F(MainWindowTest, showPreviewWidgetImage)
 {
@@ -1531,7 +1535,7 @@ TEST_F(MainWindowTest, showPreviewWidgetImage)
     MainWindow_previewWidget = new PreviewWidget(previewRecordRect);
     MainWindow_previewWidget->setScreenInfo(MainWindow_screenWidth, MainWindow_m_pixelRatio);
     MainWindow_previewWidget->initPreviewWidget();
-    stub.set(ADDR(PreviewWidget, updateImage), updateImage_stub);
+    stub.set(ADDR(PreviewWidget, updateImageRows), updateImageRows_stub);
 
     TopTips *&MainWindow_scrollShotSizeTips = access_private_field::MainWindowm_scrollShotSizeTips(*window);
     MainWindow_scrollShotSizeTips = new TopTips();
@@ -1542,8 +1546,8 @@ TEST_F(MainWindowTest, showPreviewWidgetImage)
 
     QImage img = pixmap.toImage();
 
-    call_private_fun::MainWindowshowPreviewWidgetImage(*window, img);
-    stub.reset(ADDR(PreviewWidget, updateImage));
+    call_private_fun::MainWindowshowPreviewWidgetImage(*window, img, 0, 0, false, img.size());
+    stub.reset(ADDR(PreviewWidget, updateImageRows));
     stub.reset(ADDR(MainWindow, initMainWindow));
 
     delete MainWindow_scrollShotSizeTips;
@@ -21,7 +21,7 @@ QT += dbus
 QT += multimedia
 QT += multimediawidgets
 QT += concurrent
-LIBS += -lX11 -lXext -lXtst -lXfixes -lXcursor -lgtest -lopencv_core -lopencv_imgproc -lKF5WaylandClient -lKF5ConfigCore -lavcodec -lavdevice -lavfilter -lavformat -lavutil -lswscale -lswresample -lepoxy
+LIBS += -lX11 -lXext -lXtst -lXfixes -lXcursor -lgtest -lopencv_core -lopencv_imgproc -lpng -lKF5WaylandClient -lKF5ConfigCore -lavcodec -lavdevice -lavfilter -lavformat -lavutil -lswscale -lswresample -lepoxy
 
 CONFIG += link_pkgconfig
 CONFIG += c++11
@@ -95,6 +95,9 @@ HEADERS += test_all_interfaces.h \
            utils/ut_screengrabber.h \
            utils/ut_shortcut.h \
            utils/ut_tempfile.h \
+           utils/ut_shapeeffect.h \
+           utils/ut_shapesgrid.h \
+           utils/ut_shapeshistory.h \
            utils/ut_utils_other.h \
            widgets/ut_colortoolwidget.h \
            widgets/ut_keybuttonwidget.h \
@@ -110,9 +113,15 @@ HEADERS += test_all_interfaces.h \
         ../../src/utils/shortcut.h \
         ../../src/utils/tempfile.h \
         ../../src/utils/shapesutils.h \
+        ../../src/utils/shapeeffect.h \
+        ../../src/utils/shapesgrid.h \
+        ../../src/utils/shapeshistory.h \
         ../../src/utils/camerawatcher.h \
         ../../src/utils/voicevolumewatcher.h \
         ../../src/utils/pixmergethread.h \
+        ../../src/utils/longimage.h \
+        ../../src/utils/longimagepreview.h \
+        ../../src/utils/autoscrollcontroller.h \
         ../../src/utils/scrollScreenshot.h \
         ../../src/utils/waylandscrollmonitor.h \
         ../../src/widgets/scrollshottip.h \
@@ -153,6 +162,7 @@ HEADERS += test_all_interfaces.h \
         ../../src/recordertablet.h \
         ../../src/gstrecord/gstrecordx.h \
         ../../src/gstrecord/gstinterface.h \
+        ../../src/gstrecord/gstpipelinetracer.h \
      ../../src/waylandrecord/writeframethread.h \
      ../../src/waylandrecord/waylandintegration.h \
      ../../src/waylandrecord/waylandintegration_p.h \
@@ -179,6 +189,9 @@ HEADERS += test_all_interfaces.h \
     dbusinterface/ut_ocrinterface.h \
     widgets/ut_scrollshottip.h \
     utils/ut_pixmergethread.h \
+    utils/ut_longimage.h \
+    utils/ut_longimagepreview.h \
+    utils/ut_autoscrollcontroller.h \
     utils/ut_scrollScreenshot.h \
     waylandrecord/ut_avinputstream.h \
     waylandrecord/ut_avoutputstream.h \
@@ -202,9 +215,15 @@ SOURCES += main.cpp \
     ../../src/utils/shortcut.cpp \
     ../../src/utils/tempfile.cpp \
     ../../src/utils/shapesutils.cpp \
+    ../../src/utils/shapeeffect.cpp \
+    ../../src/utils/shapesgrid.cpp \
+    ../../src/utils/shapeshistory.cpp \
     ../../src/utils/camerawatcher.cpp \
     ../../src/utils/voicevolumewatcher.cpp \
     ../../src/utils/pixmergethread.cpp \
+    ../../src/utils/longimage.cpp \
+    ../../src/utils/longimagepreview.cpp \
+    ../../src/utils/autoscrollcontroller.cpp \
     ../../src/utils/scrollScreenshot.cpp \
     ../../src/utils/waylandscrollmonitor.cpp \
     ../../src/widgets/scrollshottip.cpp \
@@ -248,4 +267,5 @@ SOURCES += main.cpp \
     #../../src/xgifrecord.cpp \
     ../../src/recordertablet.cpp \
     ../../src/gstrecord/gstrecordx.cpp \
-        ../../src/gstrecord/gstinterface.cpp
+        ../../src/gstrecord/gstinterface.cpp \
+        ../../src/gstrecord/gstpipelinetracer.cpp
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+
+#include "../../src/utils/autoscrollcontroller.h"
+
+using namespace testing;
+
+// 模拟页面每次滚轮事件滚动图片高度的1/8
+static const qreal AUTO_SCROLL_TICK_RATIO = 0.125;
+
+class AutoScrollControllerTest: public testing::Test
+{
+public:
+    AutoScrollController m_controller;
+
+    // 发送滚轮事件直到需要截图，返回发送的滚轮事件数
+    int scrollUntilGrab()
+    {
+        int ticks = 0;
+        while (ticks == 0) {
+            ticks = m_controller.wheelTicked();
+        }
+        return ticks;
+    }
+};
+
+//初始速度与原固定的定时器一致
+TEST_F(AutoScrollControllerTest, initialSpeed)
+{
+    EXPECT_EQ(300, m_controller.interval());
+    EXPECT_EQ(2, m_controller.shotFrequency());
+    EXPECT_EQ(0, m_controller.wheelTicked());
+    EXPECT_EQ(2, m_controller.wheelTicked());
+}
+
+//拼接没有积压时逐步加速，截图间隔增大到保持一半重叠的最大值
+TEST_F(AutoScrollControllerTest, speedUpKeepsSafeOverlap)
+{
+    for (int i = 0; i < 20; ++i) {
+        const int ticks = scrollUntilGrab();
+        const qreal overlap = 1 - AUTO_SCROLL_TICK_RATIO * ticks;
+        EXPECT_GE(overlap, 0.5);
+        m_controller.update(true, overlap, ticks, 0);
+    }
+    EXPECT_EQ(4, m_controller.shotFrequency());
+    EXPECT_EQ(100, m_controller.interval());
+}
+
+//拼接队列有积压时减速
+TEST_F(AutoScrollControllerTest, slowDownWhenQueued)
+{
+    const int ticks = scrollUntilGrab();
+    EXPECT_TRUE(m_controller.update(true, 1 - AUTO_SCROLL_TICK_RATIO * ticks, ticks, 2));
+    EXPECT_EQ(450, m_controller.interval());
+    for (int i = 0; i < 5; ++i) {
+        m_controller.update(true, 0.5, scrollUntilGrab(), 2);
+    }
+    EXPECT_EQ(600, m_controller.interval());
+}
+
+//按截图时的滚轮事件数计算重叠，拼接滞后于截图时不会高估滚动速度
+TEST_F(AutoScrollControllerTest, pipelinedGrabs)
+{
+    const int firstTicks = scrollUntilGrab();
+    const int secondTicks = scrollUntilGrab();
+    EXPECT_EQ(2, firstTicks);
+    EXPECT_EQ(2, secondTicks);
+    m_controller.update(true, 1 - AUTO_SCROLL_TICK_RATIO * firstTicks, firstTicks, 1);
+    EXPECT_EQ(4, m_controller.shotFrequency());
+    m_controller.update(true, 1 - AUTO_SCROLL_TICK_RATIO * secondTicks, secondTicks, 0);
+    EXPECT_EQ(4, m_controller.shotFrequency());
+}
+
+//中途丢弃的图片的滚轮事件数累加到下一张图片上，不会高估每次滚轮事件滚动的高度
+TEST_F(AutoScrollControllerTest, droppedGrabs)
+{
+    const int droppedTicks = scrollUntilGrab();
+    const int ticks = droppedTicks + scrollUntilGrab();
+    m_controller.update(true, 1 - AUTO_SCROLL_TICK_RATIO * ticks, ticks, 0);
+    EXPECT_EQ(4, m_controller.shotFrequency());
+    // 非自动滚动截取的图片不用于估计滚动高度
+    m_controller.update(true, 0, 0, 0);
+    EXPECT_EQ(4, m_controller.shotFrequency());
+}
+
+//拼接失败时退回到较慢的速度，reset恢复初始速度
+TEST_F(AutoScrollControllerTest, backOffOnFailure)
+{
+    for (int i = 0; i < 5; ++i) {
+        const int ticks = scrollUntilGrab();
+        m_controller.update(true, 1 - AUTO_SCROLL_TICK_RATIO * ticks, ticks, 0);
+    }
+    EXPECT_EQ(4, m_controller.shotFrequency());
+    EXPECT_EQ(200, m_controller.interval());
+    EXPECT_TRUE(m_controller.update(false, 0, scrollUntilGrab(), 0));
+    EXPECT_EQ(2, m_controller.shotFrequency());
+    EXPECT_EQ(300, m_controller.interval());
+    m_controller.reset();
+    EXPECT_EQ(2, m_controller.shotFrequency());
+    EXPECT_EQ(300, m_controller.interval());
+}
@@ -33,7 +33,7 @@ TEST_F(CalculaterectTest, test_getRotatePoint)
     qDebug() << getRotatePoint(point1, point2, point3, point4);
     //EXPECT_EQ(4, );
 
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << point1 << point2 << point3 << point4;
     EXPECT_EQ(4, fourPointsOfLine(points).size());
 
@@ -53,7 +53,7 @@ TEST_F(CalculaterectTest, test_base)
     QPointF point3(5, 5);
     QPointF point4(0, 5);
     QPointF pos(55, 55);
-    QList<QPointF> points;
+    QVector<QPointF> points;
     FourPoints rectFPoints;
     FourPoints fourPoints;
     FourPoints mainPoints;
@@ -87,7 +87,7 @@ TEST_F(CalculaterectTest, test_base)
     QPointF getControlPoint(QPointF point1, QPointF point2, bool direction) ;
 
     /* get eight control points */
-    //QList<QPointF> getEightControlPoint(FourPoints rectFPoints);
+    //QVector<QPointF> getEightControlPoint(FourPoints rectFPoints);
 
     /* judge whether the clickOnPoint is on the bezier */
     /* 0 <= pos.x() <= 1*/
@@ -96,7 +96,7 @@ TEST_F(CalculaterectTest, test_base)
     /* judge whether the clickOnPoint is on the ellipse */
     EXPECT_FALSE(pointOnEllipse(rectFPoints, pos));
 
-    QList<QPointF> pointsLine;
+    QVector<QPointF> pointsLine;
     pointsLine << point1 << point2 << point3 << point4;
     EXPECT_FALSE(pointOnArLine(pointsLine,  QPointF(55, 55)));
 
@@ -633,3 +633,44 @@ TEST_F(CalculaterectTest, test_getMainPoints)
     EXPECT_EQ(4,    getMainPoints(QPointF(20, 30),  QPointF(10, 20), true).size());
 
 }
+
+TEST_F(CalculaterectTest, test_simplifyLine)
+{
+    //直线上的点只保留首尾，折点保留
+    QVector<QPointF> points;
+    for (int x = 0; x <= 100; x += 4) {
+        points << QPointF(x, 0.2 * (x % 8 == 0 ? 1 : -1));
+    }
+    for (int y = 4; y <= 100; y += 4) {
+        points << QPointF(100, y);
+    }
+    QVector<QPointF> result = simplifyLine(points, 0.5);
+    ASSERT_EQ(3, result.size());
+    EXPECT_EQ(points.first(), result[0]);
+    EXPECT_EQ(QPointF(100, -0.2), result[1]);
+    EXPECT_EQ(points.last(), result[2]);
+
+    //简化后的折线与原线条的偏差不超过容差
+    QVector<QPointF> wave;
+    for (int i = 0; i < 200; i++) {
+        wave << QPointF(i * 3, 20 * std::sin(i * 0.1));
+    }
+    result = simplifyLine(wave, 0.5);
+    EXPECT_LT(result.size(), wave.size());
+    for (const QPointF &point : wave) {
+        qreal distance = 1e9;
+        for (int i = 1; i < result.size(); i++) {
+            const QPointF ab = result[i] - result[i - 1];
+            const qreal t = qBound<qreal>(0, QPointF::dotProduct(point - result[i - 1], ab) / QPointF::dotProduct(ab, ab), 1);
+            const QPointF d = point - result[i - 1] - t * ab;
+            distance = qMin(distance, std::sqrt(QPointF::dotProduct(d, d)));
+        }
+        EXPECT_LE(distance, 0.5);
+    }
+
+    //简化后两点之间的线段也能点中
+    EXPECT_TRUE(pointOnArLine(result.mid(0, 2), (result[0] + result[1]) / 2));
+    EXPECT_TRUE(pointOnArLine(QVector<QPointF>() << QPointF(0, 0) << QPointF(100, 0), QPointF(50, 3)));
+    EXPECT_FALSE(pointOnArLine(QVector<QPointF>() << QPointF(0, 0) << QPointF(100, 0), QPointF(50, 10)));
+    EXPECT_EQ(2, simplifyLine(QVector<QPointF>() << QPointF(0, 0) << QPointF(1, 1), 0.5).size());
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+#include <QImage>
+#include <QDir>
+#include <QFile>
+
+#include "../../src/utils/longimage.h"
+
+using namespace testing;
+
+class LongImageTest: public testing::Test
+{
+public:
+    cv::Mat m_page;
+    virtual void SetUp() override
+    {
+        m_page.create(1000, 64, CV_8UC4);
+        cv::RNG rng(20211019);
+        rng.fill(m_page, cv::RNG::UNIFORM, 0, 256);
+    }
+};
+
+//向下拼接：长图与页面对应行一致
+TEST_F(LongImageTest, appendAt)
+{
+    LongImage longImage;
+    EXPECT_TRUE(longImage.isEmpty());
+    longImage.reset(m_page.rowRange(0, 300).clone());
+    longImage.appendAt(200, m_page.rowRange(200, 500).clone());
+    longImage.appendAt(450, m_page.rowRange(450, 750).clone());
+    // 拼接位置正好在条带边界上
+    longImage.appendAt(750, m_page.rowRange(750, 1000).clone());
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(4, longImage.stripCount());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+
+    // 回退到第一个条带内，之后的条带全部丢弃
+    longImage.appendAt(100, m_page.rowRange(100, 400).clone());
+    ASSERT_EQ(400, longImage.rows());
+    EXPECT_EQ(2, longImage.stripCount());
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(0, 400), longImage.toMat(), cv::NORM_INF));
+}
+
+//向上拼接：长图与页面对应行一致
+TEST_F(LongImageTest, prependAt)
+{
+    LongImage longImage;
+    longImage.reset(m_page.rowRange(700, 1000).clone());
+    longImage.prependAt(100, m_page.rowRange(500, 800).clone());
+    longImage.prependAt(100, m_page.rowRange(200, 600).clone());
+    longImage.prependAt(250, m_page.rowRange(0, 450).clone());
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+}
+
+//获取行区间：条带内返回视图，跨条带时拷贝
+TEST_F(LongImageTest, rowRange)
+{
+    LongImage longImage;
+    longImage.reset(m_page.rowRange(0, 300).clone());
+    longImage.appendAt(250, m_page.rowRange(250, 550).clone());
+    longImage.appendAt(500, m_page.rowRange(500, 800).clone());
+
+    cv::Mat inStrip = longImage.rowRange(300, 500);
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(300, 500), inStrip, cv::NORM_INF));
+    cv::Mat crossStrips = longImage.rowRange(100, 700);
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(100, 700), crossStrips, cv::NORM_INF));
+    EXPECT_TRUE(longImage.rowRange(800, 900).empty());
+
+    // 拷贝到外部内存
+    QImage image(longImage.cols(), longImage.rows(), QImage::Format_ARGB32);
+    cv::Mat dst(image.height(), image.width(), CV_8UC4, image.bits(), static_cast<size_t>(image.bytesPerLine()));
+    longImage.copyTo(dst);
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(0, 800), dst, cv::NORM_INF));
+
+    longImage.clear();
+    EXPECT_TRUE(longImage.isEmpty());
+    EXPECT_TRUE(longImage.toMat().empty());
+}
+
+//超过内存预算后中间的条带转存到临时文件，长图内容不变
+TEST_F(LongImageTest, spillToFile)
+{
+    LongImage longImage;
+    longImage.setMemoryBudget(0);
+    longImage.reset(m_page.rowRange(0, 200).clone());
+    for (int start = 100; start + 200 <= m_page.rows; start += 100) {
+        longImage.appendAt(start, m_page.rowRange(start, start + 200).clone());
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    // 开头和末尾的条带保留在内存中
+    EXPECT_EQ(longImage.stripCount() - 4, longImage.spilledStripCount());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+
+    // 每个转存的条带100行
+    const qint64 stripBytes = 100 * m_page.cols * static_cast<qint64>(m_page.elemSize());
+    EXPECT_EQ(longImage.spilledStripCount() * stripBytes, longImage.spillFileSize());
+
+    // 回退到已转存的条带内继续拼接
+    longImage.appendAt(350, m_page.rowRange(350, 550).clone());
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(0, 550), longImage.toMat(), cv::NORM_INF));
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(250, 450), longImage.rowRange(250, 450), cv::NORM_INF));
+    // 丢弃的转存条带位于文件末尾，临时文件随之截断
+    EXPECT_EQ(2 * stripBytes, longImage.spillFileSize());
+}
+
+//内存按条带保留的行计算：每张图片只保留滚动的少量行时，不会因来源图片较大而提前转存
+TEST_F(LongImageTest, memoryOfTrimmedStrips)
+{
+    LongImage longImage;
+    const qint64 rowBytes = m_page.cols * static_cast<qint64>(m_page.elemSize());
+    longImage.setMemoryBudget(m_page.rows * rowBytes);
+    longImage.reset(m_page.rowRange(0, 200).clone());
+    for (int start = 20; start + 200 <= m_page.rows; start += 20) {
+        longImage.appendAt(start, m_page.rowRange(start, start + 200).clone());
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(41, longImage.stripCount());
+    EXPECT_EQ(0, longImage.spilledStripCount());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+
+    // 超过预算后仍会转存
+    longImage.setMemoryBudget(m_page.rows * rowBytes / 2);
+    EXPECT_LT(0, longImage.spilledStripCount());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+}
+
+//向上拼接时后转存的条带在文件靠前的位置，丢弃后其区域被之后转存的条带复用
+TEST_F(LongImageTest, spillFileReuse)
+{
+    LongImage longImage;
+    longImage.setMemoryBudget(0);
+    longImage.reset(m_page.rowRange(800, 1000).clone());
+    for (int start = 700; start >= 0; start -= 100) {
+        longImage.prependAt(100, m_page.rowRange(start, start + 200).clone());
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+    const qint64 fileSize = longImage.spillFileSize();
+    EXPECT_LT(0, fileSize);
+
+    // 回退到长图开头附近，保留的转存条带位于文件末尾，丢弃的条带位于文件中间
+    longImage.appendAt(350, m_page.rowRange(350, 550).clone());
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(0, 550), longImage.toMat(), cv::NORM_INF));
+    EXPECT_EQ(fileSize, longImage.spillFileSize());
+    for (int start = 400; start + 200 <= m_page.rows; start += 100) {
+        longImage.appendAt(start, m_page.rowRange(start, start + 200).clone());
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(0, cv::norm(m_page, longImage.toMat(), cv::NORM_INF));
+    // 再次转存的条带复用空闲区域，临时文件不再增长
+    EXPECT_EQ(fileSize, longImage.spillFileSize());
+}
+
+//预览图按比例缩小，高度不超过最大高度
+TEST_F(LongImageTest, preview)
+{
+    LongImage longImage;
+    longImage.reset(m_page.clone());
+    cv::Mat preview = longImage.preview(100);
+    EXPECT_EQ(100, preview.rows);
+    EXPECT_EQ(6, preview.cols);
+    EXPECT_EQ(m_page.rows, longImage.preview(2000).rows);
+}
+
+//逐行写入PNG文件，读回后与长图一致
+TEST_F(LongImageTest, savePng)
+{
+    LongImage longImage;
+    longImage.setMemoryBudget(0);
+    longImage.reset(m_page.rowRange(0, 300).clone());
+    longImage.appendAt(200, m_page.rowRange(200, 500).clone());
+    longImage.appendAt(400, m_page.rowRange(400, 700).clone());
+    longImage.appendAt(600, m_page.rowRange(600, 1000).clone());
+
+    const QString fileName = QDir::tempPath() + "/ut_longimage.png";
+    ASSERT_TRUE(longImage.savePng(fileName, 60));
+    QImage image(fileName);
+    QFile::remove(fileName);
+    ASSERT_EQ(QSize(m_page.cols, m_page.rows), image.size());
+    // PNG中不保存透明通道
+    image = image.convertToFormat(QImage::Format_RGB32);
+    cv::Mat saved(image.height(), image.width(), CV_8UC4, image.bits(), static_cast<size_t>(image.bytesPerLine()));
+    std::vector<cv::Mat> savedChannels, pageChannels;
+    cv::split(saved, savedChannels);
+    cv::split(m_page, pageChannels);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(0, cv::norm(pageChannels[i], savedChannels[i], cv::NORM_INF));
+    }
+}
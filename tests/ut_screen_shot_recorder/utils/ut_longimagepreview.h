@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+
+#include "../../src/utils/longimage.h"
+#include "../../src/utils/longimagepreview.h"
+
+using namespace testing;
+
+class LongImagePreviewTest: public testing::Test
+{
+public:
+    cv::Mat m_page;
+    cv::Mat m_guiPreview; // 按变化的行维护的预览图，模拟预览窗口
+    virtual void SetUp() override
+    {
+        m_page.create(1024, 64, CV_8UC4);
+        cv::RNG rng(20211020);
+        rng.fill(m_page, cv::RNG::UNIFORM, 0, 256);
+        m_guiPreview.release();
+    }
+
+    // 取出预览图的变化并应用到m_guiPreview
+    void applyChange(LongImagePreview &preview)
+    {
+        cv::Mat rows;
+        int keepStart = 0;
+        int keepEnd = 0;
+        bool isPrepend = false;
+        ASSERT_TRUE(preview.takeChange(rows, keepStart, keepEnd, isPrepend));
+        cv::Mat kept;
+        if (keepEnd > keepStart) {
+            kept = m_guiPreview.rowRange(keepStart, keepEnd).clone();
+        }
+        if (kept.empty()) {
+            m_guiPreview = rows.clone();
+        } else if (rows.empty()) {
+            m_guiPreview = kept;
+        } else if (isPrepend) {
+            cv::vconcat(rows, kept, m_guiPreview);
+        } else {
+            cv::vconcat(kept, rows, m_guiPreview);
+        }
+        EXPECT_FALSE(preview.takeChange(rows, keepStart, keepEnd, isPrepend));
+    }
+};
+
+//不需要缩小时，预览图与长图一致，向下拼接只发送拼接位置之后的行
+TEST_F(LongImagePreviewTest, appendAtFullSize)
+{
+    LongImage longImage;
+    LongImagePreview preview(2048);
+    longImage.reset(m_page.rowRange(0, 300).clone());
+    preview.reset(longImage);
+    applyChange(preview);
+
+    longImage.appendAt(200, m_page.rowRange(200, 500).clone());
+    preview.appendAt(longImage, 200);
+    cv::Mat rows;
+    int keepStart = -1;
+    int keepEnd = -1;
+    bool isPrepend = true;
+    ASSERT_TRUE(preview.takeChange(rows, keepStart, keepEnd, isPrepend));
+    EXPECT_EQ(0, keepStart);
+    EXPECT_EQ(200, keepEnd);
+    EXPECT_FALSE(isPrepend);
+    EXPECT_EQ(300, rows.rows);
+    EXPECT_EQ(1, preview.scale());
+    EXPECT_EQ(0, cv::norm(longImage.toMat(), preview.image(), cv::NORM_INF));
+}
+
+//不需要缩小时，向上拼接只发送开头新增的行
+TEST_F(LongImagePreviewTest, prependAtFullSize)
+{
+    LongImage longImage;
+    LongImagePreview preview(2048);
+    longImage.reset(m_page.rowRange(600, 1000).clone());
+    preview.reset(longImage);
+    applyChange(preview);
+
+    longImage.prependAt(200, m_page.rowRange(400, 800).clone());
+    preview.prependAt(longImage, 200, 400);
+    cv::Mat rows;
+    int keepStart = -1;
+    int keepEnd = -1;
+    bool isPrepend = false;
+    ASSERT_TRUE(preview.takeChange(rows, keepStart, keepEnd, isPrepend));
+    EXPECT_EQ(200, keepStart);
+    EXPECT_EQ(400, keepEnd);
+    EXPECT_TRUE(isPrepend);
+    EXPECT_EQ(400, rows.rows);
+    EXPECT_EQ(0, cv::norm(m_page.rowRange(400, 1000), preview.image(), cv::NORM_INF));
+}
+
+//向下拼接超过最大高度后逐级缩小，结果与整张长图直接缩小基本一致
+TEST_F(LongImagePreviewTest, appendAtDownscaled)
+{
+    LongImage longImage;
+    LongImagePreview preview(100);
+    longImage.reset(m_page.rowRange(0, 300).clone());
+    preview.reset(longImage);
+    applyChange(preview);
+    for (int row = 181; row < m_page.rows; row += 181) {
+        const int end = qMin(row + 300, m_page.rows);
+        longImage.appendAt(row, m_page.rowRange(row, end).clone());
+        preview.appendAt(longImage, row);
+        applyChange(preview);
+        EXPECT_LE(preview.image().rows, 100);
+        EXPECT_EQ(0, cv::norm(preview.image(), m_guiPreview, cv::NORM_INF));
+        if (end == m_page.rows) {
+            break;
+        }
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(16, preview.scale());
+    cv::Mat expected;
+    cv::resize(m_page, expected, cv::Size(m_page.cols / 16, m_page.rows / 16), 0, 0, cv::INTER_AREA);
+    ASSERT_EQ(expected.size(), preview.image().size());
+    EXPECT_LE(cv::norm(expected, preview.image(), cv::NORM_INF), 4);
+}
+
+//向上拼接超过最大高度后逐级缩小，已有的块按长图坐标对齐，不需要重新生成
+TEST_F(LongImagePreviewTest, prependAtDownscaled)
+{
+    LongImage longImage;
+    LongImagePreview preview(100);
+    int start = 720;
+    longImage.reset(m_page.rowRange(start, m_page.rows).clone());
+    preview.reset(longImage);
+    applyChange(preview);
+    while (start > 0) {
+        const int frameStart = qMax(start - 181, 0);
+        const int frameEnd = frameStart + 300;
+        longImage.prependAt(frameEnd - start, m_page.rowRange(frameStart, frameEnd).clone());
+        preview.prependAt(longImage, frameEnd - start, frameEnd - frameStart);
+        applyChange(preview);
+        EXPECT_LE(preview.image().rows, 100);
+        EXPECT_EQ(0, cv::norm(preview.image(), m_guiPreview, cv::NORM_INF));
+        start = frameStart;
+    }
+    ASSERT_EQ(m_page.rows, longImage.rows());
+    EXPECT_EQ(16, preview.scale());
+    cv::Mat expected;
+    cv::resize(m_page, expected, cv::Size(m_page.cols / 16, m_page.rows / 16), 0, 0, cv::INTER_AREA);
+    ASSERT_EQ(expected.size(), preview.image().size());
+    EXPECT_LE(cv::norm(expected, preview.image(), cv::NORM_INF), 4);
+}
+
+//清空后重新开始
+TEST_F(LongImagePreviewTest, clear)
+{
+    LongImage longImage;
+    LongImagePreview preview(100);
+    longImage.reset(m_page.clone());
+    preview.appendAt(longImage, 0);
+    EXPECT_FALSE(preview.isEmpty());
+    EXPECT_EQ(16, preview.scale());
+    preview.clear();
+    EXPECT_TRUE(preview.isEmpty());
+    EXPECT_EQ(1, preview.scale());
+    cv::Mat rows;
+    int keepStart = 0;
+    int keepEnd = 0;
+    bool isPrepend = false;
+    EXPECT_FALSE(preview.takeChange(rows, keepStart, keepEnd, isPrepend));
+}
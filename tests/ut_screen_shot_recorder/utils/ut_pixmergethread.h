@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 #include <QTimer>
 #include <QTest>
+#include <QElapsedTimer>
 #include "stub.h"
 #include "addr_pri.h"
 
@@ -50,14 +51,33 @@ QRect getScrollChangeRectArea_stub2(cv::Mat &img1, const cv::Mat &img2)
 
 ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_upCount);
 ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_downCount);
-ACCESS_PRIVATE_FIELD(PixMergeThread, cv::Mat, m_curImg);
+ACCESS_PRIVATE_FIELD(PixMergeThread, LongImage, m_longImage);
 ACCESS_PRIVATE_FIELD(PixMergeThread, unsigned int, m_MeragerCount);
 ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_curTimeDiff);
+ACCESS_PRIVATE_FIELD(PixMergeThread, unsigned int, m_hashMatchCount);
+ACCESS_PRIVATE_FIELD(PixMergeThread, unsigned int, m_templateMatchCount);
+ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_headHeight);
+ACCESS_PRIVATE_FIELD(PixMergeThread, unsigned int, m_droppedCount);
+ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_droppedTicks);
+ACCESS_PRIVATE_FIELD(PixMergeThread, std::vector<quint64>, m_tailHashes);
+ACCESS_PRIVATE_FIELD(PixMergeThread, int, m_tailHashStart);
 
 ACCESS_PRIVATE_FUN(PixMergeThread, QRect(cv::Mat &, const cv::Mat &), getScrollChangeRectArea);
-ACCESS_PRIVATE_FUN(PixMergeThread, cv::Mat(const QPixmap &), qPixmapToCvMat);
+ACCESS_PRIVATE_FUN(PixMergeThread, cv::Mat(const QImage &), qImageToCvMat);
+ACCESS_PRIVATE_FUN(PixMergeThread, void(const cv::Mat &), resetLongImage);
+ACCESS_PRIVATE_FUN(PixMergeThread, cv::Mat(const QImage &), trimScrollDownImg);
 ACCESS_PRIVATE_FUN(PixMergeThread, bool(const cv::Mat &), splicePictureDown);
 ACCESS_PRIVATE_FUN(PixMergeThread, bool(const cv::Mat &), splicePictureUp);
+ACCESS_PRIVATE_FUN(PixMergeThread, int(const cv::Mat &, const cv::Mat &), getTopFixedHigh);
+ACCESS_PRIVATE_FUN(PixMergeThread, int(const cv::Mat &, const cv::Mat &), getBottomFixedHigh);
+
+// 生成带固定顶栏和底栏的页面截图：顶栏、页面第scroll行起的内容、底栏
+static cv::Mat makeStickyFrame(const cv::Mat &page, const cv::Mat &header, const cv::Mat &footer, int scroll, int height)
+{
+    cv::Mat frame;
+    cv::vconcat(std::vector<cv::Mat> {header, page.rowRange(scroll, scroll + height - header.rows - footer.rows), footer}, frame);
+    return frame;
+}
 
 class PixMergeThreadTest: public testing::Test
 {
@@ -85,9 +105,9 @@ public:
 TEST_F(PixMergeThreadTest, startPixMergeThreadScrollDown)
 {
     m_pixMergeThread->clearCurImg();
-    QPixmap img1(":/testImg/addImg1.png");
-    QPixmap img2(":/testImg/addImg2.png");
-    QPixmap img3(":/testImg/addImg3.png");
+    QImage img1(":/testImg/addImg1.png");
+    QImage img2(":/testImg/addImg2.png");
+    QImage img3(":/testImg/addImg3.png");
     m_pixMergeThread->setScrollModel(true);
     m_pixMergeThread->start();
     m_pixMergeThread->addShotImg(img1);
@@ -105,9 +125,9 @@ TEST_F(PixMergeThreadTest, startPixMergeThreadScrollDown)
 TEST_F(PixMergeThreadTest, startPixMergeThreadScrollUp)
 {
     m_pixMergeThread->clearCurImg();
-    QPixmap img1(":/testImg/addImg1.png");
-    QPixmap img2(":/testImg/addImg2.png");
-    QPixmap img3(":/testImg/addImg3.png");
+    QImage img1(":/testImg/addImg1.png");
+    QImage img2(":/testImg/addImg2.png");
+    QImage img3(":/testImg/addImg3.png");
     m_pixMergeThread->setScrollModel(true);
     m_pixMergeThread->start();
     m_pixMergeThread->addShotImg(img3, PixMergeThread::PictureDirection::ScrollUp);
@@ -122,14 +142,151 @@ TEST_F(PixMergeThreadTest, startPixMergeThreadScrollUp)
 }
 
 
+//QImage包装为cv::Mat时共享缓冲区，QImage释放后cv::Mat仍然有效
+TEST_F(PixMergeThreadTest, qImageToCvMatSharesBuffer)
+{
+    QImage image = QImage(":/testImg/addImg1.png").convertToFormat(QImage::Format_ARGB32);
+    cv::Mat mat = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, image);
+    ASSERT_EQ(image.height(), mat.rows);
+    EXPECT_EQ(image.constBits(), mat.data);
+    EXPECT_EQ(static_cast<size_t>(image.bytesPerLine()), mat.step[0]);
+
+    const cv::Mat expected = mat.rowRange(100, 200).clone();
+    cv::Mat view = mat.rowRange(100, 200);
+    image = QImage();
+    mat.release();
+    EXPECT_EQ(0, cv::norm(expected, view, cv::NORM_INF));
+
+    // 非32位格式先转换
+    QImage rgb888 = QImage(":/testImg/addImg1.png").convertToFormat(QImage::Format_RGB888);
+    EXPECT_EQ(CV_8UC4, call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, rgb888).type());
+}
+
+//去掉顶部固定区域后得到的是原图片的行区间视图
+TEST_F(PixMergeThreadTest, trimScrollDownImgRoiView)
+{
+    int &m_headHeight = access_private_field::PixMergeThreadm_headHeight(*m_pixMergeThread);
+    m_pixMergeThread->clearCurImg();
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg1.png"));
+    m_headHeight = 50;
+    const QImage image = QImage(":/testImg/addImg2.png").convertToFormat(QImage::Format_ARGB32);
+    const cv::Mat frame = call_private_fun::PixMergeThreadtrimScrollDownImg(*m_pixMergeThread, image);
+    EXPECT_EQ(image.height() - 50, frame.rows);
+    EXPECT_EQ(image.constScanLine(50), frame.data);
+}
+
+//抓取的图片队列长度有限，队列满时自动滚动暂缓；线程启动后流水线依次转换、拼接
+TEST_F(PixMergeThreadTest, pipelineQueueBounded)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_pixMergeThread->clearCurImg();
+    m_pixMergeThread->setScrollModel(false);
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg1.png"));
+    EXPECT_FALSE(m_pixMergeThread->isPipelineFull());
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg2.png"));
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg3.png"));
+    EXPECT_TRUE(m_pixMergeThread->isPipelineFull());
+    EXPECT_EQ(0, m_pixMergeThread->achievableScrollRate());
+
+    m_pixMergeThread->setIsLastImg(true);
+    m_pixMergeThread->start();
+    m_pixMergeThread->finishTask();
+    EXPECT_TRUE(m_pixMergeThread->wait(5000));
+    EXPECT_FALSE(m_pixMergeThread->isPipelineFull());
+    EXPECT_GT(m_longImage.rows(), QImage(":/testImg/addImg1.png").height());
+    EXPECT_GT(m_pixMergeThread->achievableScrollRate(), 0);
+}
+
+//最后一张图片加入队列后，拼接完队列中的全部图片即结束线程
+TEST_F(PixMergeThreadTest, finishTaskAfterLastImg)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    unsigned int &m_MeragerCount = access_private_field::PixMergeThreadm_MeragerCount(*m_pixMergeThread);
+    m_pixMergeThread->clearCurImg();
+    m_pixMergeThread->setScrollModel(false);
+    m_pixMergeThread->start();
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg1.png"));
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg2.png"));
+    m_pixMergeThread->setIsLastImg(true);
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg3.png"));
+    m_pixMergeThread->finishTask();
+    EXPECT_TRUE(m_pixMergeThread->wait(5000));
+    EXPECT_EQ(2u, m_MeragerCount);
+    EXPECT_GT(m_longImage.rows(), QImage(":/testImg/addImg1.png").height());
+}
+
+//线程运行时清空长图：清空请求与之后的第一张图片经队列交给拼接线程处理
+TEST_F(PixMergeThreadTest, clearCurImgWhileRunning)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_pixMergeThread->setScrollModel(false);
+    m_pixMergeThread->start();
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg1.png"));
+    m_pixMergeThread->addShotImg(QImage(":/testImg/addImg2.png"));
+    m_pixMergeThread->clearCurImg();
+    // 清空后的下一张图片作为长图的第一张图片，之前的图片不再拼接到长图中
+    const QImage img3(":/testImg/addImg3.png");
+    m_pixMergeThread->addShotImg(img3);
+    m_pixMergeThread->finishTask();
+    EXPECT_TRUE(m_pixMergeThread->wait(5000));
+    EXPECT_EQ(img3.height(), m_longImage.rows());
+}
+
+//模拟转换线程处理缓慢
+static cv::Mat trimScrollDownImg_slow_stub(void *obj, const QImage &picture)
+{
+    Q_UNUSED(obj);
+    Q_UNUSED(picture);
+    QThread::msleep(300);
+    return cv::Mat();
+}
+
+//抓取的图片队列已满时丢弃新图片，GUI线程不等待转换线程
+TEST_F(PixMergeThreadTest, addShotImgDropWhenFull)
+{
+    unsigned int &m_droppedCount = access_private_field::PixMergeThreadm_droppedCount(*m_pixMergeThread);
+    auto PixMergeThread_trimScrollDownImg = get_private_fun::PixMergeThreadtrimScrollDownImg();
+    stub.set(PixMergeThread_trimScrollDownImg, trimScrollDownImg_slow_stub);
+    m_pixMergeThread->setScrollModel(false);
+    m_pixMergeThread->start();
+    const QImage img(":/testImg/addImg1.png");
+    m_pixMergeThread->addShotImg(img);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 5; i++) {
+        m_pixMergeThread->addShotImg(img, PixMergeThread::PictureDirection::ScrollDown, 2);
+    }
+    EXPECT_LT(timer.elapsed(), 250);
+    EXPECT_TRUE(m_pixMergeThread->isPipelineFull());
+    EXPECT_LT(0u, m_droppedCount);
+    // 丢弃的图片的滚轮事件数累加到下一张加入队列的图片上
+    EXPECT_EQ(static_cast<int>(m_droppedCount) * 2, access_private_field::PixMergeThreadm_droppedTicks(*m_pixMergeThread));
+    m_pixMergeThread->clearCurImg();
+    EXPECT_EQ(0, access_private_field::PixMergeThreadm_droppedTicks(*m_pixMergeThread));
+
+    m_pixMergeThread->stopTask();
+    EXPECT_TRUE(m_pixMergeThread->wait(5000));
+    stub.reset(PixMergeThread_trimScrollDownImg);
+}
+
+//停止拼接时不等待队列中的图片
+TEST_F(PixMergeThreadTest, stopTaskWakesIdleThread)
+{
+    m_pixMergeThread->start();
+    QThread::msleep(50);
+    EXPECT_TRUE(m_pixMergeThread->isRunning());
+    m_pixMergeThread->stopTask();
+    EXPECT_TRUE(m_pixMergeThread->wait(1000));
+}
+
 //向上拼接上半部分的异常处理
 TEST_F(PixMergeThreadTest, splicePictureUpUpperHalfError)
 {
-    QPixmap invalidArea1(":/testImg/upUpperHalfError1.png");
-    QPixmap invalidArea2(":/testImg/upUpperHalfError2.png");
-    cv::Mat &m_curImg = access_private_field::PixMergeThreadm_curImg(*m_pixMergeThread);
-    m_curImg = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea1);
-    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea2);
+    QImage invalidArea1(":/testImg/upUpperHalfError1.png");
+    QImage invalidArea2(":/testImg/upUpperHalfError2.png");
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea1));
+    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea2);
     unsigned int &m_MeragerCount = access_private_field::PixMergeThreadm_MeragerCount(*m_pixMergeThread);
     auto pixfun = get_private_fun::PixMergeThreadgetScrollChangeRectArea();
     stub.set(pixfun, getScrollChangeRectArea_stub);
@@ -152,11 +309,11 @@ TEST_F(PixMergeThreadTest, splicePictureUpUpperHalfError)
 //向上拼接下半部分的异常处理
 TEST_F(PixMergeThreadTest, splicePictureUpLowerHalfError)
 {
-    QPixmap invalidArea1(":/testImg/upLowerHalfError1.png");
-    QPixmap invalidArea2(":/testImg/upLowerHalfError2.png");
-    cv::Mat &m_curImg = access_private_field::PixMergeThreadm_curImg(*m_pixMergeThread);
-    m_curImg = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea1);
-    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea2);
+    QImage invalidArea1(":/testImg/upLowerHalfError1.png");
+    QImage invalidArea2(":/testImg/upLowerHalfError2.png");
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea1));
+    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea2);
     unsigned int &m_MeragerCount = access_private_field::PixMergeThreadm_MeragerCount(*m_pixMergeThread);
     auto pixfun = get_private_fun::PixMergeThreadgetScrollChangeRectArea();
     stub.set(pixfun, getScrollChangeRectArea_stub);
@@ -182,11 +339,11 @@ TEST_F(PixMergeThreadTest, splicePictureUpLowerHalfError)
 //向下拼接上半部分的异常处理
 TEST_F(PixMergeThreadTest, splicePictureDownUpperHalfError)
 {
-    QPixmap invalidArea1(":/testImg/downUpperHalfError1.png");
-    QPixmap invalidArea2(":/testImg/downUpperHalfError2.png");
-    cv::Mat &m_curImg = access_private_field::PixMergeThreadm_curImg(*m_pixMergeThread);
-    m_curImg = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea1);
-    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea2);
+    QImage invalidArea1(":/testImg/downUpperHalfError1.png");
+    QImage invalidArea2(":/testImg/downUpperHalfError2.png");
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea1));
+    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea2);
     unsigned int &m_MeragerCount = access_private_field::PixMergeThreadm_MeragerCount(*m_pixMergeThread);
     auto pixfun = get_private_fun::PixMergeThreadgetScrollChangeRectArea();
     stub.set(pixfun, getScrollChangeRectArea_stub);
@@ -224,10 +381,10 @@ TEST_F(PixMergeThreadTest, splicePictureDownUpperHalfError)
 //向下拼接下半部分的异常处理
 TEST_F(PixMergeThreadTest, splicePictureDownLowerHalfError)
 {
-    QPixmap img1(":/testImg/addImg1.png");
-    cv::Mat imgData = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, img1);
-    cv::Mat &m_curImg = access_private_field::PixMergeThreadm_curImg(*m_pixMergeThread);
-    m_curImg = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, img1);
+    QImage img1(":/testImg/addImg1.png");
+    cv::Mat imgData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, img1);
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, img1));
     unsigned int &m_MeragerCount = access_private_field::PixMergeThreadm_MeragerCount(*m_pixMergeThread);
 
     m_MeragerCount = 0;
@@ -252,10 +409,10 @@ TEST_F(PixMergeThreadTest, splicePictureDownLowerHalfError)
     m_curTimeDiff = 1;
     call_private_fun::PixMergeThreadsplicePictureDown(*m_pixMergeThread, imgData);
 
-    QPixmap invalidArea1(":/testImg/invalidArea3.png");
-    QPixmap invalidArea2(":/testImg/invalidArea4.png");
-    m_curImg = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea1);
-    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqPixmapToCvMat(*m_pixMergeThread, invalidArea2);
+    QImage invalidArea1(":/testImg/invalidArea3.png");
+    QImage invalidArea2(":/testImg/invalidArea4.png");
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea1));
+    cv::Mat invalidAreaData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, invalidArea2);
 
     m_MeragerCount = 0;
     m_pixMergeThread->setScrollModel(false);
@@ -266,6 +423,167 @@ TEST_F(PixMergeThreadTest, splicePictureDownLowerHalfError)
     call_private_fun::PixMergeThreadsplicePictureDown(*m_pixMergeThread, invalidAreaData);
 }
 
+//向下拼接只在长图尾部窗口内匹配，长图变长后拼接结果仍与原始页面一致
+TEST_F(PixMergeThreadTest, splicePictureDownTailWindow)
+{
+    const int frameHeight = 300;
+    const int step = 120;
+    const int frameCount = 40;
+    cv::Mat page(frameHeight + step * (frameCount - 1), 400, CV_8UC4);
+    cv::RNG rng(20211019);
+    rng.fill(page, cv::RNG::UNIFORM, 0, 256);
+
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    m_longImage.reset(page.rowRange(0, frameHeight).clone());
+    m_pixMergeThread->setScrollModel(false);
+    for (int i = 1; i < frameCount; ++i) {
+        cv::Mat frame = page.rowRange(i * step, i * step + frameHeight).clone();
+        EXPECT_TRUE(call_private_fun::PixMergeThreadsplicePictureDown(*m_pixMergeThread, frame));
+    }
+    ASSERT_EQ(page.rows, m_longImage.rows());
+    EXPECT_EQ(0, cv::norm(page, m_longImage.toMat(), cv::NORM_INF));
+    // 长图以条带形式保存，拼合结果与原始页面一致
+    QImage result = m_pixMergeThread->getMerageResult();
+    ASSERT_EQ(page.rows, result.height());
+    cv::Mat resultData(result.height(), result.width(), CV_8UC4, result.bits(), static_cast<size_t>(result.bytesPerLine()));
+    EXPECT_EQ(0, cv::norm(page, resultData, cv::NORM_INF));
+}
+
+//按滚动顺序排列的测试图片，相邻图片为整体平移，拼接结果为Scrollshot.png的开头部分
+static const char *const ROW_HASH_TEST_IMAGES[] = {
+    ":/testImg/addImg1.png", ":/testImg/addImg2.png", ":/testImg/addImg3.png",
+    ":/testImg/addImg4.png", ":/testImg/addImg5.png", ":/testImg/addImg6.png",
+    ":/testImg/addImg7.png", ":/testImg/addImg9.png", ":/testImg/addImg10.png"
+};
+static const int ROW_HASH_TEST_IMAGE_COUNT = sizeof(ROW_HASH_TEST_IMAGES) / sizeof(ROW_HASH_TEST_IMAGES[0]);
+
+//向下拼接：相邻图片为整体平移时全部通过行哈希找到拼接位置
+TEST_F(PixMergeThreadTest, splicePictureDownRowHash)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    unsigned int &m_hashMatchCount = access_private_field::PixMergeThreadm_hashMatchCount(*m_pixMergeThread);
+    unsigned int &m_templateMatchCount = access_private_field::PixMergeThreadm_templateMatchCount(*m_pixMergeThread);
+    m_pixMergeThread->setScrollModel(false);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[0])));
+    for (int i = 1; i < ROW_HASH_TEST_IMAGE_COUNT; ++i) {
+        cv::Mat imgData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[i]));
+        EXPECT_TRUE(call_private_fun::PixMergeThreadsplicePictureDown(*m_pixMergeThread, imgData));
+    }
+    EXPECT_EQ(static_cast<unsigned int>(ROW_HASH_TEST_IMAGE_COUNT - 1), m_hashMatchCount);
+    EXPECT_EQ(0u, m_templateMatchCount);
+
+    cv::Mat expected = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(":/testImg/Scrollshot.png"));
+    ASSERT_LE(m_longImage.rows(), expected.rows);
+    EXPECT_EQ(0, cv::norm(expected.rowRange(0, m_longImage.rows()), m_longImage.toMat(), cv::NORM_INF));
+
+    // 尾部行哈希缓存覆盖到长图末尾，高度不超过匹配窗口
+    std::vector<quint64> &m_tailHashes = access_private_field::PixMergeThreadm_tailHashes(*m_pixMergeThread);
+    const int tailHashStart = access_private_field::PixMergeThreadm_tailHashStart(*m_pixMergeThread);
+    const int lastRows = QImage(ROW_HASH_TEST_IMAGES[ROW_HASH_TEST_IMAGE_COUNT - 1]).height();
+    EXPECT_EQ(m_longImage.rows() - tailHashStart, static_cast<int>(m_tailHashes.size()));
+    EXPECT_LE(static_cast<int>(m_tailHashes.size()), lastRows * 2);
+    call_private_fun::PixMergeThreadresetLongImage(*m_pixMergeThread, cv::Mat());
+    EXPECT_TRUE(m_tailHashes.empty());
+}
+
+//向上拼接：相邻图片为整体平移时全部通过行哈希找到拼接位置
+TEST_F(PixMergeThreadTest, splicePictureUpRowHash)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    unsigned int &m_hashMatchCount = access_private_field::PixMergeThreadm_hashMatchCount(*m_pixMergeThread);
+    unsigned int &m_templateMatchCount = access_private_field::PixMergeThreadm_templateMatchCount(*m_pixMergeThread);
+    m_pixMergeThread->setScrollModel(true);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[ROW_HASH_TEST_IMAGE_COUNT - 1])));
+    for (int i = ROW_HASH_TEST_IMAGE_COUNT - 2; i >= 0; --i) {
+        cv::Mat imgData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[i]));
+        EXPECT_TRUE(call_private_fun::PixMergeThreadsplicePictureUp(*m_pixMergeThread, imgData));
+    }
+    EXPECT_EQ(static_cast<unsigned int>(ROW_HASH_TEST_IMAGE_COUNT - 1), m_hashMatchCount);
+    EXPECT_EQ(0u, m_templateMatchCount);
+
+    cv::Mat expected = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(":/testImg/Scrollshot.png"));
+    ASSERT_LE(m_longImage.rows(), expected.rows);
+    EXPECT_EQ(0, cv::norm(expected.rowRange(0, m_longImage.rows()), m_longImage.toMat(), cv::NORM_INF));
+}
+
+//重叠区域内容有变化（如动画）时行哈希匹配失败，改用模板匹配
+TEST_F(PixMergeThreadTest, splicePictureDownRowHashFallback)
+{
+    LongImage &m_longImage = access_private_field::PixMergeThreadm_longImage(*m_pixMergeThread);
+    unsigned int &m_hashMatchCount = access_private_field::PixMergeThreadm_hashMatchCount(*m_pixMergeThread);
+    unsigned int &m_templateMatchCount = access_private_field::PixMergeThreadm_templateMatchCount(*m_pixMergeThread);
+    m_pixMergeThread->setScrollModel(false);
+    m_longImage.reset(call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[0])));
+    cv::Mat imgData = call_private_fun::PixMergeThreadqImageToCvMat(*m_pixMergeThread, QImage(ROW_HASH_TEST_IMAGES[1]));
+    // 修改重叠区域内远离模板的一个像素
+    cv::Vec4b &pixel = imgData.at<cv::Vec4b>(imgData.rows / 2, imgData.cols / 2);
+    pixel[0] = static_cast<uchar>(pixel[0] ^ 0xff);
+    EXPECT_TRUE(call_private_fun::PixMergeThreadsplicePictureDown(*m_pixMergeThread, imgData));
+    EXPECT_EQ(0u, m_hashMatchCount);
+    EXPECT_EQ(1u, m_templateMatchCount);
+    EXPECT_EQ(55 + imgData.rows, m_longImage.rows());
+}
+
+//固定顶栏、底栏的高度计算
+TEST_F(PixMergeThreadTest, getStickyHeaderFooterHeight)
+{
+    cv::RNG rng(20211019);
+    cv::Mat page(2000, 800, CV_8UC4);
+    rng.fill(page, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat header(64, page.cols, CV_8UC4, cv::Scalar(200, 120, 40, 255));
+    cv::Mat footer(48, page.cols, CV_8UC4, cv::Scalar(30, 30, 30, 255));
+    const cv::Mat frame1 = makeStickyFrame(page, header, footer, 0, 600);
+    const cv::Mat frame2 = makeStickyFrame(page, header, footer, 150, 600);
+    EXPECT_EQ(header.rows, call_private_fun::PixMergeThreadgetTopFixedHigh(*m_pixMergeThread, frame1, frame2));
+    EXPECT_EQ(frame2.rows - footer.rows, call_private_fun::PixMergeThreadgetBottomFixedHigh(*m_pixMergeThread, frame1, frame2));
+
+    // 没有固定区域
+    const cv::Mat plain1 = page.rowRange(0, 600);
+    const cv::Mat plain2 = page.rowRange(150, 750);
+    EXPECT_EQ(0, call_private_fun::PixMergeThreadgetTopFixedHigh(*m_pixMergeThread, plain1, plain2));
+    EXPECT_EQ(plain2.rows, call_private_fun::PixMergeThreadgetBottomFixedHigh(*m_pixMergeThread, plain1, plain2));
+
+    // 页面没有滚动，整张图片相同
+    EXPECT_EQ(0, call_private_fun::PixMergeThreadgetTopFixedHigh(*m_pixMergeThread, frame1, frame1));
+    EXPECT_EQ(0, call_private_fun::PixMergeThreadgetBottomFixedHigh(*m_pixMergeThread, frame1, frame1));
+
+    // 只有第100行最后一个像素的透明通道不同，需要比较整行的全部字节；行不连续存放（ROI）时逐行比较
+    cv::Mat roiPage(page.rows, page.cols + 16, CV_8UC4, cv::Scalar::all(0));
+    cv::Mat roi = roiPage.colRange(8, 8 + page.cols);
+    frame1.copyTo(roi.rowRange(0, frame1.rows));
+    cv::Mat changed = frame1.clone();
+    changed.at<cv::Vec4b>(100, changed.cols - 1)[3] = 0;
+    EXPECT_EQ(100, call_private_fun::PixMergeThreadgetTopFixedHigh(*m_pixMergeThread, roi.rowRange(0, frame1.rows), changed));
+    EXPECT_EQ(101, call_private_fun::PixMergeThreadgetBottomFixedHigh(*m_pixMergeThread, roi.rowRange(0, frame1.rows), changed));
+}
+
+//4K宽度下固定区域的计算耗时
+TEST_F(PixMergeThreadTest, getStickyHeaderFooterHeight4K)
+{
+    cv::RNG rng(4096);
+    cv::Mat page(3000, 3840, CV_8UC4);
+    rng.fill(page, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat header(120, page.cols, CV_8UC4, cv::Scalar(255, 255, 255, 255));
+    cv::Mat footer(80, page.cols, CV_8UC4, cv::Scalar(240, 240, 240, 255));
+    const cv::Mat frame1 = makeStickyFrame(page, header, footer, 0, 2160);
+    const cv::Mat frame2 = makeStickyFrame(page, header, footer, 300, 2160);
+
+    const int times = 100;
+    int topHeight = 0;
+    int bottomHeight = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < times; ++i) {
+        topHeight = call_private_fun::PixMergeThreadgetTopFixedHigh(*m_pixMergeThread, frame1, frame2);
+        bottomHeight = call_private_fun::PixMergeThreadgetBottomFixedHigh(*m_pixMergeThread, frame1, frame2);
+    }
+    const qint64 elapsed = timer.nsecsElapsed() / times;
+    qInfo() << "fixed header/footer detection at 4K:" << elapsed << "ns";
+    EXPECT_EQ(header.rows, topHeight);
+    EXPECT_EQ(frame2.rows - footer.rows, bottomHeight);
+    EXPECT_LT(elapsed, 1000000);
+}
+
 //其他
 TEST_F(PixMergeThreadTest, PixMergeThreadOthers)
 {
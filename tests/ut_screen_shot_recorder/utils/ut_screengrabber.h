@@ -3,9 +3,12 @@
 #include <QRect>
 #include <QPixmap>
 #include <QDebug>
+#include <QDBusInterface>
+#include <QDBusMessage>
 #include "../../src/utils/screengrabber.h"
 #include "../../src/utils.h"
 #include "stub.h"
+#include "addr_pri.h"
 
 
 using namespace testing;
@@ -47,3 +50,55 @@ TEST_F(ScreenGrabberTest, grabEntireDesktop_wayland)
     qDebug() << pix.rect();
     EXPECT_EQ(false, ok);
 }
+TEST_F(ScreenGrabberTest, grabEntireDesktopImage)
+{
+    bool ok = false;
+    QImage img = screenGrabber.grabEntireDesktopImage(ok, QRect(0, 0, 600, 400), 1);
+    EXPECT_EQ(true, ok);
+    // 较小区域复用已分配的共享内存段
+    img = screenGrabber.grabEntireDesktopImage(ok, QRect(10, 10, 200, 100), 1);
+    EXPECT_EQ(true, ok);
+    EXPECT_FALSE(img.isNull());
+}
+
+ACCESS_PRIVATE_FIELD(ScreenGrabber, bool, m_screenShot2Unavailable);
+
+static int captureAreaCallCount = 0;
+static int screenshotFullscreenCallCount = 0;
+//模拟KWin不支持ScreenShot2接口，所有dbus调用均返回无效应答
+static QDBusMessage callWithArgumentList_screenShot2_stub(void *obj, QDBus::CallMode mode, const QString &method, const QList<QVariant> &args)
+{
+    Q_UNUSED(obj);
+    Q_UNUSED(mode);
+    Q_UNUSED(args);
+    if (method == QStringLiteral("CaptureArea")) {
+        captureAreaCallCount++;
+    } else if (method == QStringLiteral("screenshotFullscreen")) {
+        screenshotFullscreenCallCount++;
+    }
+    return QDBusMessage();
+}
+
+//ScreenShot2不可用时回退到screenshotFullscreen，之后不再尝试ScreenShot2
+TEST_F(ScreenGrabberTest, grabEntireDesktop_screenShot2Unavailable)
+{
+    Utils::isWaylandMode = true;
+    stub.set(ADDR(QDBusInterface, callWithArgumentList), callWithArgumentList_screenShot2_stub);
+    captureAreaCallCount = 0;
+    screenshotFullscreenCallCount = 0;
+    bool &screenShot2Unavailable = access_private_field::ScreenGrabberm_screenShot2Unavailable(screenGrabber);
+    EXPECT_FALSE(screenShot2Unavailable);
+
+    bool ok = true;
+    QRect rect(0, 0, 600, 400);
+    screenGrabber.grabEntireDesktop(ok, rect, 1);
+    EXPECT_EQ(1, captureAreaCallCount);
+    EXPECT_EQ(1, screenshotFullscreenCallCount);
+    EXPECT_TRUE(screenShot2Unavailable);
+
+    screenGrabber.grabEntireDesktop(ok, rect, 1);
+    EXPECT_EQ(1, captureAreaCallCount);
+    EXPECT_EQ(2, screenshotFullscreenCallCount);
+
+    stub.reset(ADDR(QDBusInterface, callWithArgumentList));
+}
@@ -58,7 +58,7 @@ public:
 //添加图片
 TEST_F(ScrollScreenshotTest, startAddPixmap)
 {
-    QPixmap img(":/testImg/addImg1.png");
+    QImage img(":/testImg/addImg1.png");
     m_ScrollScreenshot->setScrollModel(false);
     m_ScrollScreenshot->addPixmap(img);
     QEventLoop loop;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+#include <QSignalSpy>
+
+#include "../../src/utils/shapeeffect.h"
+
+using namespace testing;
+
+class ShapeEffectTest: public testing::Test
+{
+public:
+    QImage m_image;
+    virtual void SetUp() override
+    {
+        // 左半边黑色，右半边白色
+        m_image = QImage(200, 100, QImage::Format_ARGB32_Premultiplied);
+        m_image.fill(Qt::black);
+        for (int y = 0; y < m_image.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(m_image.scanLine(y));
+            for (int x = m_image.width() / 2; x < m_image.width(); ++x) {
+                line[x] = qRgb(255, 255, 255);
+            }
+        }
+    }
+};
+
+//纯色图片模糊后不变，黑白交界处平滑过渡
+TEST_F(ShapeEffectTest, blur)
+{
+    QImage plain(64, 64, QImage::Format_RGB32);
+    plain.fill(QColor(10, 120, 250));
+    const QImage plainBlur = ShapeEffect::blur(plain, 5);
+    EXPECT_EQ(QImage::Format_ARGB32_Premultiplied, plainBlur.format());
+    EXPECT_EQ(qRgb(10, 120, 250), plainBlur.pixel(0, 0));
+    EXPECT_EQ(qRgb(10, 120, 250), plainBlur.pixel(32, 32));
+    EXPECT_EQ(qRgb(10, 120, 250), plainBlur.pixel(63, 63));
+
+    const QImage result = ShapeEffect::blur(m_image, 5);
+    ASSERT_EQ(m_image.size(), result.size());
+    EXPECT_EQ(0, qRed(result.pixel(0, 50)));
+    EXPECT_EQ(255, qRed(result.pixel(199, 50)));
+    EXPECT_GT(qRed(result.pixel(99, 50)), 0);
+    EXPECT_LT(qRed(result.pixel(100, 50)), 255);
+    // 交界两侧对称
+    EXPECT_NEAR(255 - qRed(result.pixel(95, 50)), qRed(result.pixel(104, 50)), 2);
+    for (int x = 1; x < result.width(); ++x) {
+        EXPECT_LE(qRed(result.pixel(x - 1, 50)), qRed(result.pixel(x, 50)));
+    }
+}
+
+//马赛克的块按origin对齐，块内为平均值
+TEST_F(ShapeEffectTest, mosaic)
+{
+    const QImage result = ShapeEffect::mosaic(m_image, 10);
+    ASSERT_EQ(m_image.size(), result.size());
+    EXPECT_EQ(result.pixel(90, 0), result.pixel(99, 9));
+    EXPECT_EQ(0, qRed(result.pixel(99, 0)));
+    EXPECT_EQ(255, qRed(result.pixel(100, 0)));
+
+    // 原图左上角在网格中的坐标为(5, 0)，交界所在的块为[95, 105)，黑白各一半
+    const QImage shifted = ShapeEffect::mosaic(m_image, 10, QPoint(5, 0));
+    EXPECT_EQ(shifted.pixel(95, 0), shifted.pixel(104, 9));
+    EXPECT_NEAR(128, qRed(shifted.pixel(100, 0)), 1);
+    EXPECT_EQ(0, qRed(shifted.pixel(94, 0)));
+}
+
+//效果图在后台计算，完成前返回空图，完成后按图形缓存
+TEST_F(ShapeEffectTest, effectCache)
+{
+    ShapeEffect effect;
+    effect.setSource(QPixmap::fromImage(m_image));
+    EXPECT_EQ(m_image.size(), effect.sourceSize());
+
+    QSignalSpy spy(&effect, &ShapeEffect::effectReady);
+    QRect effectRect;
+    EXPECT_TRUE(effect.effect(1, false, QRect(80, 20, 40, 40), effectRect).isNull());
+    ASSERT_TRUE(spy.wait(5000));
+
+    QPixmap pixmap = effect.effect(1, false, QRect(80, 20, 40, 40), effectRect);
+    ASSERT_FALSE(pixmap.isNull());
+    EXPECT_TRUE(effectRect.contains(QRect(80, 20, 40, 40)));
+    EXPECT_TRUE(m_image.rect().contains(effectRect));
+    EXPECT_EQ(effectRect.size(), pixmap.size());
+    // 只计算图形附近的范围
+    EXPECT_LT(effectRect.width(), m_image.width());
+
+    // 与整张图片模糊的结果一致
+    const QImage whole = ShapeEffect::blur(m_image, 5).copy(effectRect);
+    const QImage part = pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    EXPECT_EQ(whole, part);
+
+    // 范围不变时不再计算
+    effect.effect(1, false, QRect(85, 25, 30, 30), effectRect);
+    EXPECT_FALSE(spy.wait(200));
+
+    // 删除图形后释放效果图
+    effect.retain(QList<int>());
+    EXPECT_TRUE(effect.effect(1, false, QRect(80, 20, 40, 40), effectRect).isNull());
+    ASSERT_TRUE(spy.wait(5000));
+}
+
+//保存前同步计算完正在计算和等待计算的效果图
+TEST_F(ShapeEffectTest, flush)
+{
+    ShapeEffect effect;
+    effect.setSource(QPixmap::fromImage(m_image));
+    QRect effectRect;
+    EXPECT_TRUE(effect.effect(1, false, QRect(80, 20, 40, 40), effectRect).isNull());
+    EXPECT_TRUE(effect.effect(2, true, QRect(10, 10, 30, 30), effectRect).isNull());
+    EXPECT_TRUE(effect.flush());
+
+    QPixmap pixmap = effect.effect(1, false, QRect(80, 20, 40, 40), effectRect);
+    ASSERT_FALSE(pixmap.isNull());
+    EXPECT_EQ(ShapeEffect::blur(m_image, 5).copy(effectRect),
+              pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    EXPECT_FALSE(effect.effect(2, true, QRect(10, 10, 30, 30), effectRect).isNull());
+    EXPECT_TRUE(effectRect.contains(QRect(10, 10, 30, 30)));
+    // 没有需要计算的范围
+    EXPECT_FALSE(effect.flush());
+
+    // 之后收到的完成通知不影响新的计算
+    QSignalSpy spy(&effect, &ShapeEffect::effectReady);
+    effect.effect(1, false, QRect(150, 20, 40, 40), effectRect);
+    ASSERT_TRUE(spy.wait(5000));
+    effect.effect(1, false, QRect(150, 20, 40, 40), effectRect);
+    EXPECT_TRUE(effectRect.contains(QRect(150, 20, 40, 40)));
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+
+#include "../../src/utils/shapesgrid.h"
+#include "../../src/utils/calculaterect.h"
+
+using namespace testing;
+
+class ShapesGridTest: public testing::Test
+{
+public:
+    ShapesGrid m_grid;
+    virtual void SetUp() override
+    {
+        m_grid.clear();
+    }
+
+    Toolshape rectShape(const QPointF &topLeft, const QPointF &bottomRight)
+    {
+        Toolshape shape;
+        shape.type = ShapeType::Rectangle;
+        shape.mainPoints = getMainPoints(topLeft, bottomRight);
+        return shape;
+    }
+};
+
+//矩形按外接矩形登记，包括控制点和上方的旋转点
+TEST_F(ShapesGridTest, rectangle)
+{
+    m_grid.insertShape(0, rectShape(QPointF(100, 100), QPointF(200, 150)));
+    EXPECT_EQ(1, m_grid.count());
+    EXPECT_EQ(QVector<int>() << 0, m_grid.shapesAt(QPointF(150, 100)));
+    EXPECT_EQ(QVector<int>() << 0, m_grid.shapesAt(QPointF(150, 125)));
+    EXPECT_EQ(QVector<int>() << 0, m_grid.shapesAt(QPointF(150, 72)));
+    EXPECT_TRUE(m_grid.shapesAt(QPointF(600, 600)).isEmpty());
+    EXPECT_TRUE(m_grid.shapesAt(QPointF(-600, 125)).isEmpty());
+}
+
+//画笔只登记经过的格子，外接矩形内远离线条的位置不需要判断
+TEST_F(ShapesGridTest, line)
+{
+    Toolshape line;
+    line.type = ShapeType::Line;
+    for (int x = 0; x <= 500; x += 5) {
+        line.points << QPointF(x, 0);
+    }
+    for (int y = 5; y <= 500; y += 5) {
+        line.points << QPointF(500, y);
+    }
+    line.mainPoints = fourPointsOfLine(line.points);
+    m_grid.insertShape(0, line);
+    EXPECT_EQ(QVector<int>() << 0, m_grid.shapesAt(QPointF(250, 2)));
+    EXPECT_EQ(QVector<int>() << 0, m_grid.shapesAt(QPointF(498, 300)));
+    EXPECT_TRUE(m_grid.shapesAt(QPointF(100, 400)).isEmpty());
+}
+
+//重叠的图形按在列表中的顺序返回，清空后重新登记
+TEST_F(ShapesGridTest, order)
+{
+    m_grid.insertShape(0, rectShape(QPointF(0, 0), QPointF(300, 300)));
+    m_grid.insertShape(1, rectShape(QPointF(600, 600), QPointF(700, 700)));
+    m_grid.insertShape(2, rectShape(QPointF(100, 100), QPointF(200, 200)));
+    EXPECT_EQ(3, m_grid.count());
+    EXPECT_EQ(QVector<int>() << 0 << 2, m_grid.shapesAt(QPointF(150, 150)));
+    EXPECT_EQ(QVector<int>() << 1, m_grid.shapesAt(QPointF(650, 650)));
+
+    m_grid.clear();
+    EXPECT_EQ(0, m_grid.count());
+    EXPECT_TRUE(m_grid.shapesAt(QPointF(150, 150)).isEmpty());
+}
+
+//类型名称与枚举值互相转换，未知的名称为None
+TEST_F(ShapesGridTest, shapeType)
+{
+    Toolshape shape;
+    EXPECT_EQ(ShapeType::None, shape.type);
+    EXPECT_EQ(4, shape.mainPoints.size());
+
+    const QStringList names = QStringList() << "rectangle" << "oval" << "arrow" << "line" << "text";
+    for (const QString &name : names) {
+        shape.type = name;
+        EXPECT_NE(ShapeType::None, shape.type);
+        EXPECT_EQ(name, shape.type.name());
+    }
+    shape.type = QString("common");
+    EXPECT_EQ(ShapeType::None, shape.type);
+    EXPECT_TRUE(shape.type.name().isEmpty());
+
+    //复制的图形修改顶点时不影响原图形
+    Toolshape copy = shape;
+    copy.mainPoints[0] = QPointF(1, 1);
+    EXPECT_EQ(QPointF(0, 0), shape.mainPoints[0]);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * Author:     zhangwenchao <zhangwenchao@uniontech.com>
+ *
+ * Maintainer: WangYu <wangyu@uniontech.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <gtest/gtest.h>
+
+#include "../../src/utils/shapeshistory.h"
+
+using namespace testing;
+
+class ShapesHistoryTest: public testing::Test
+{
+public:
+    Toolshape lineShape(int index, int pointCount)
+    {
+        Toolshape shape;
+        shape.type = ShapeType::Line;
+        shape.index = index;
+        for (int i = 0; i < pointCount; i++) {
+            shape.points.append(QPointF(i, i));
+        }
+        return shape;
+    }
+};
+
+//撤销的记录移到恢复列表，恢复后移回
+TEST_F(ShapesHistoryTest, undoRedo)
+{
+    ShapesHistory history;
+    EXPECT_FALSE(history.canUndo());
+    history.push(ShapesHistory::addShape(0, lineShape(1, 10)));
+    history.push(ShapesHistory::addShape(1, lineShape(2, 10)));
+    EXPECT_EQ(2, history.undoCount());
+
+    ShapesHistory::Command command;
+    ASSERT_TRUE(history.takeUndo(command));
+    EXPECT_EQ(ShapesHistory::AddShape, command.type);
+    EXPECT_EQ(2, command.index);
+    EXPECT_EQ(1, command.position);
+    EXPECT_EQ(1, history.undoCount());
+    EXPECT_TRUE(history.canRedo());
+
+    ASSERT_TRUE(history.takeRedo(command));
+    EXPECT_EQ(2, command.index);
+    EXPECT_FALSE(history.canRedo());
+    EXPECT_EQ(2, history.undoCount());
+
+    // 撤销后有新的操作，不能再恢复
+    history.takeUndo(command);
+    history.push(ShapesHistory::removeShape(0, lineShape(1, 10)));
+    EXPECT_FALSE(history.canRedo());
+    EXPECT_FALSE(history.takeRedo(command));
+
+    history.clear();
+    EXPECT_FALSE(history.canUndo());
+    EXPECT_EQ(0, history.usedBytes());
+}
+
+//只在顶点或样式变化时生成记录，记录只保存变化的部分
+TEST_F(ShapesHistoryTest, deltaCommands)
+{
+    Toolshape before = lineShape(3, 4);
+    Toolshape after = before;
+    ShapesHistory::Command command;
+    EXPECT_FALSE(ShapesHistory::transformShape(before, after, command));
+    EXPECT_FALSE(ShapesHistory::restyleShape(before, after, command));
+
+    after.points[0] += QPointF(5, 5);
+    ASSERT_TRUE(ShapesHistory::transformShape(before, after, command));
+    EXPECT_EQ(ShapesHistory::TransformShape, command.type);
+    EXPECT_EQ(3, command.index);
+    EXPECT_EQ(QPointF(0, 0), command.pointsBefore[0]);
+    EXPECT_EQ(QPointF(5, 5), command.pointsAfter[0]);
+    EXPECT_TRUE(command.shape.points.isEmpty());
+
+    after.colorIndex = before.colorIndex + 1;
+    ASSERT_TRUE(ShapesHistory::restyleShape(before, after, command));
+    EXPECT_EQ(ShapesHistory::RestyleShape, command.type);
+    EXPECT_EQ(before.colorIndex, command.colorIndexBefore);
+    EXPECT_EQ(after.colorIndex, command.colorIndexAfter);
+    EXPECT_TRUE(command.pointsAfter.isEmpty());
+
+    command = ShapesHistory::editText(4, "a", "ab");
+    EXPECT_EQ(ShapesHistory::EditText, command.type);
+    EXPECT_EQ(QString("a"), command.textBefore);
+    EXPECT_EQ(QString("ab"), command.textAfter);
+}
+
+//超出内存上限时丢弃最早的记录，最近一次操作总是保留
+TEST_F(ShapesHistoryTest, memoryLimit)
+{
+    const ShapesHistory::Command big = ShapesHistory::addShape(0, lineShape(1, 1000));
+    const qint64 bigBytes = ShapesHistory::commandBytes(big);
+    EXPECT_GT(bigBytes, 1000 * static_cast<qint64>(sizeof(QPointF)));
+
+    ShapesHistory history(bigBytes * 3);
+    for (int i = 0; i < 10; i++) {
+        history.push(ShapesHistory::addShape(i, lineShape(i, 1000)));
+    }
+    EXPECT_EQ(3, history.undoCount());
+    EXPECT_LE(history.usedBytes(), bigBytes * 3);
+
+    ShapesHistory::Command command;
+    ASSERT_TRUE(history.takeUndo(command));
+    EXPECT_EQ(9, command.index);
+
+    ShapesHistory tiny(1);
+    tiny.push(big);
+    EXPECT_EQ(1, tiny.undoCount());
+    EXPECT_EQ(bigBytes, tiny.usedBytes());
+}
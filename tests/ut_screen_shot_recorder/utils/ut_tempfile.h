@@ -36,16 +36,20 @@ TEST_F(TempFileTest, setFullScreenPixmap)
     EXPECT_NE(nullptr, tempFile);
 }
 
-TEST_F(TempFileTest, setBlurPixmap)
+TEST_F(TempFileTest, getScaledFullscreenImage)
 {
-    tempFile->setBlurPixmap(m_pix);
-    tempFile->getBlurPixmap();
-    EXPECT_NE(nullptr, tempFile);
-}
-
-TEST_F(TempFileTest, setMosaicPixmap)
-{
-    tempFile->setMosaicPixmap(m_pix);
-    tempFile->getMosaicPixmap();
-    EXPECT_NE(nullptr, tempFile);
+    QPixmap pix(200, 100);
+    pix.fill(Qt::red);
+    tempFile->setFullScreenPixmap(pix);
+    const QImage image = tempFile->getScaledFullscreenImage(2);
+    EXPECT_EQ(QSize(100, 50), image.size());
+    EXPECT_EQ(qRgb(255, 0, 0), image.pixel(10, 10));
+    // 截图不变时返回缓存的图片
+    EXPECT_EQ(image.cacheKey(), tempFile->getScaledFullscreenImage(2).cacheKey());
+    EXPECT_EQ(QSize(200, 100), tempFile->getScaledFullscreenImage(1).size());
+
+    pix.fill(Qt::blue);
+    tempFile->setFullScreenPixmap(pix);
+    EXPECT_EQ(qRgb(0, 0, 255), tempFile->getScaledFullscreenImage(1).pixel(10, 10));
+    tempFile->setFullScreenPixmap(m_pix);
 }
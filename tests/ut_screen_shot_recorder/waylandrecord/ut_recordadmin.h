@@ -132,6 +132,30 @@ TEST_F(RecordAdminTest, stopStream)
 
 }
 
+static int closeOutputCount = 0;
+void closeOutput_stub()
+{
+    closeOutputCount++;
+}
+
+//取消倒计时后关闭输出，退出时停止录屏不再重复关闭
+TEST_F(RecordAdminTest, cancelStream)
+{
+    stub.set(ADDR(WaylandIntegration::WaylandIntegrationPrivate, setBGetFrame), setBGetFrame_stub);
+    stub.set(ADDR(CAVOutputStream, close), closeOutput_stub);
+    closeOutputCount = 0;
+
+    m_recordAdmin->cancelStream();
+    EXPECT_EQ(1, closeOutputCount);
+    EXPECT_EQ(nullptr, m_recordAdmin->m_pInputStream->m_pMicAudioFormatContext);
+    EXPECT_EQ(nullptr, m_recordAdmin->m_pInputStream->m_pSysAudioFormatContext);
+    m_recordAdmin->stopStream();
+    EXPECT_EQ(1, closeOutputCount);
+
+    stub.reset(ADDR(WaylandIntegration::WaylandIntegrationPrivate, setBGetFrame));
+    stub.reset(ADDR(CAVOutputStream, close));
+}
+
 bool setMicAudioRecord_stub(bool flag)
 {
     return flag;
@@ -19,10 +19,10 @@ ACCESS_PRIVATE_FUN(ShapesWidget, void(QEvent *e), enterEvent);
 ACCESS_PRIVATE_FUN(ShapesWidget, bool(QPointF pos), clickedShapes);
 ACCESS_PRIVATE_FUN(ShapesWidget, void(TextEdit *edit, QRectF newRect), updateTextRect);
 ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, QPointF, QPixmap, bool), paintImgPoint);
-ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, FourPoints, int, ShapesWidget::ShapeBlurStatus, bool, bool), paintRect);
-ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, FourPoints, int, ShapesWidget::ShapeBlurStatus, bool, bool), paintEllipse);
-ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, QList<QPointF>, int, bool), paintArrow);
-ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, QList<QPointF>), paintLine);
+ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, FourPoints, int, ShapesWidget::ShapeBlurStatus, bool, bool, int), paintRect);
+ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, FourPoints, int, ShapesWidget::ShapeBlurStatus, bool, bool, int), paintEllipse);
+ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, QVector<QPointF>, int, bool), paintArrow);
+ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, QVector<QPointF>), paintLine);
 ACCESS_PRIVATE_FUN(ShapesWidget, void(QPainter &, FourPoints), paintText);
 ACCESS_PRIVATE_FUN(ShapesWidget, void(QPinchGesture *pinch), pinchTriggered);
 ACCESS_PRIVATE_FUN(ShapesWidget, void(QTapGesture *tap), tapTriggered);
@@ -76,14 +76,14 @@ bool clickedOnEllipse_stub(FourPoints mainPoints, QPointF pos, bool isBlurMosaic
     return true;
 }
 
-bool clickedOnArrow_stub(QList<QPointF> points, QPointF pos)
+bool clickedOnArrow_stub(QVector<QPointF> points, QPointF pos)
 {
     Q_UNUSED(points)
     Q_UNUSED(pos)
     return true;
 }
 
-bool clickedOnLine_stub(FourPoints mainPoints, QList<QPointF> points, QPointF pos)
+bool clickedOnLine_stub(FourPoints mainPoints, QVector<QPointF> points, QPointF pos)
 {
     Q_UNUSED(mainPoints)
     Q_UNUSED(points)
@@ -138,7 +138,7 @@ TEST_F(ShapesWidgetTest, paintEvent)
     toolShape2.type = QString("oval");
     Toolshape toolShape3;
     toolShape3.type = QString("arrow");
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -310,7 +310,7 @@ TEST_F(ShapesWidgetTest, mouseMoveEvent)
     QMouseEvent *ev = new QMouseEvent(QEvent::MouseButtonPress, QPoint(10, 10), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
     access_private_field::ShapesWidgetm_isRecording(*shapesWidget) = true;
     access_private_field::ShapesWidgetm_isPressed(*shapesWidget) = true;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -322,7 +322,7 @@ TEST_F(ShapesWidgetTest, mouseMoveEvent)
     access_private_field::ShapesWidgetm_isShiftPressed(*shapesWidget) = false;
     call_private_fun::ShapesWidgetmouseMoveEvent(*shapesWidget, ev);
 
-    QList<QPointF> points1;
+    QVector<QPointF> points1;
     points1 << QPointF(96, 235);
     access_private_field::ShapesWidgetm_currentShape(*shapesWidget).type = QString("arrow");
     access_private_field::ShapesWidgetm_currentShape(*shapesWidget).points = points1;
@@ -414,7 +414,7 @@ TEST_F(ShapesWidgetTest, updateTextRect)
     Toolshape toolShape3;
     toolShape3.type = QString("text");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -468,7 +468,7 @@ TEST_F(ShapesWidgetTest, updateSelectedShape)
     Toolshape toolShape3;
     toolShape3.type = QString("arrow");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -609,10 +609,10 @@ TEST_F(ShapesWidgetTest, paintRect)
     mainPoints << QPointF(265, 335);
     int index = 0;
     ShapesWidget::ShapeBlurStatus status = ShapesWidget::Hovered;
-    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status, false, false);
+    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status, false, false, -1);
     ShapesWidget::ShapeBlurStatus status1 = ShapesWidget::Drawing;
-    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status1, false, false);
-    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status, true, true);
+    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status1, false, false, -1);
+    call_private_fun::ShapesWidgetpaintRect(*shapesWidget, painter, mainPoints, index, status, true, true, -1);
 }
 
 TEST_F(ShapesWidgetTest, paintEllipse)
@@ -625,22 +625,22 @@ TEST_F(ShapesWidgetTest, paintEllipse)
     ellipseFPoints << QPointF(265, 335);
     int index = 0;
     ShapesWidget::ShapeBlurStatus status = ShapesWidget::Hovered;
-    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints, index, status, false, false);
+    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints, index, status, false, false, -1);
     ShapesWidget::ShapeBlurStatus status1 = ShapesWidget::Drawing;
-    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints, index, status1, true, true);
+    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints, index, status1, true, true, -1);
 
     FourPoints ellipseFPoints1;
     ellipseFPoints1 << QPointF(0, 10);
     ellipseFPoints1 << QPointF(0, 0);
     ellipseFPoints1 << QPointF(0, 0);
     ellipseFPoints1 << QPointF(0, 0);
-    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints1, index, status1, true, true);
+    call_private_fun::ShapesWidgetpaintEllipse(*shapesWidget, painter, ellipseFPoints1, index, status1, true, true, -1);
 }
 
 TEST_F(ShapesWidgetTest, paintArrow)
 {
     QPainter painter;
-    QList<QPointF> lineFPoints;
+    QVector<QPointF> lineFPoints;
     lineFPoints << QPointF(96, 235);
     lineFPoints << QPointF(96, 335);
     int lineWidth = 10;
@@ -651,15 +651,15 @@ TEST_F(ShapesWidgetTest, paintArrow)
 TEST_F(ShapesWidgetTest, paintLine)
 {
     QPainter painter;
-    QList<QPointF> lineFPoints;
+    QVector<QPointF> lineFPoints;
     lineFPoints << QPointF(96, 235);
     lineFPoints << QPointF(96, 335);
     call_private_fun::ShapesWidgetpaintLine(*shapesWidget, painter, lineFPoints);
 
-    QList<QPointF> lineFPoints1;
+    QVector<QPointF> lineFPoints1;
     call_private_fun::ShapesWidgetpaintLine(*shapesWidget, painter, lineFPoints1);
 
-    QList<QPointF> lineFPoints2;
+    QVector<QPointF> lineFPoints2;
     lineFPoints2 << QPointF(96, 235);
     lineFPoints2 << QPointF(96, 335);
     lineFPoints2 << QPointF(265, 235);
@@ -753,7 +753,7 @@ TEST_F(ShapesWidgetTest, handleDrag)
     toolShape2.type = QString("oval");
     Toolshape toolShape3;
     toolShape3.type = QString("arrow");
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -786,7 +786,7 @@ TEST_F(ShapesWidgetTest, handleDrag)
     toolShape6.mainPoints = mainPoints1;
     QPointF oldPoint2(213, 231);
     QPointF newPoint2(213, 231);
-    QList<QPointF> points1;
+    QVector<QPointF> points1;
     points1 << QPointF(96, 235);
     points1 << QPointF(96, 335);
     points1 << QPointF(265, 235);
@@ -1126,7 +1126,7 @@ TEST_F(ShapesWidgetTest, clickedOnEllipse)
 
 TEST_F(ShapesWidgetTest, clickedOnArrow)
 {
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1134,25 +1134,25 @@ TEST_F(ShapesWidgetTest, clickedOnArrow)
     QPointF pos = QPointF(220, 233);
     EXPECT_FALSE(shapesWidget->clickedOnArrow(points, pos));
 
-    QList<QPointF> points0;
+    QVector<QPointF> points0;
     points0 << QPointF(567, 138);
     points0 << QPointF(427, 289);
     QPointF pos0 = QPointF(565, 138);
     shapesWidget->clickedOnArrow(points0, pos0);
 
-    QList<QPointF> points1;
+    QVector<QPointF> points1;
     points1 << QPointF(554, 240);
     points1 << QPointF(432, 397);
     QPointF pos1 = QPointF(430, 399);
     shapesWidget->clickedOnArrow(points1, pos1);
 
-    QList<QPointF> points2;
+    QVector<QPointF> points2;
     points2 << QPointF(567, 138);
     points2 << QPointF(427, 289);
     QPointF pos2 = QPointF(524, 187);
     shapesWidget->clickedOnArrow(points2, pos2);
 
-    QList<QPointF> points3;
+    QVector<QPointF> points3;
     points3 << QPointF(554, 240);
     points3 << QPointF(572, 370);
     QPointF pos3 = QPointF(565, 138);
@@ -1167,7 +1167,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints << QPointF(96, 335);
     mainPoints << QPointF(265, 235);
     mainPoints << QPointF(265, 335);
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1182,7 +1182,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints1 << QPointF(92, 329);
     mainPoints1 << QPointF(172, 307);
     mainPoints1 << QPointF(172, 329);
-    QList<QPointF> points1;
+    QVector<QPointF> points1;
     points1 << QPointF(102, 319);
     points1 << QPointF(109, 319);
     points1 << QPointF(114, 319);
@@ -1204,7 +1204,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints2 << QPointF(92, 362);
     mainPoints2 << QPointF(163, 307);
     mainPoints2 << QPointF(163, 362);
-    QList<QPointF> points2;
+    QVector<QPointF> points2;
     points2 << QPointF(100.875, 337);
     points2 << QPointF(107.088, 337);
     points2 << QPointF(111.525, 337);
@@ -1226,7 +1226,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints3 << QPointF(92, 329);
     mainPoints3 << QPointF(172, 307);
     mainPoints3 << QPointF(172, 329);
-    QList<QPointF> points3;
+    QVector<QPointF> points3;
     points3 << QPointF(102, 319);
     points3 << QPointF(109, 319);
     points3 << QPointF(114, 319);
@@ -1248,7 +1248,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints4 << QPointF(92, 329);
     mainPoints4 << QPointF(172, 329);
     mainPoints4 << QPointF(172, 307);
-    QList<QPointF> points4;
+    QVector<QPointF> points4;
     points4 << QPointF(102, 319);
     points4 << QPointF(109, 319);
     points4 << QPointF(114, 319);
@@ -1270,7 +1270,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints5 << QPointF(172, 329);
     mainPoints5 << QPointF(92, 329);
     mainPoints5 << QPointF(172, 307);
-    QList<QPointF> points5;
+    QVector<QPointF> points5;
     points5 << QPointF(102, 319);
     points5 << QPointF(109, 319);
     points5 << QPointF(114, 319);
@@ -1292,7 +1292,7 @@ TEST_F(ShapesWidgetTest, clickedOnLine)
     mainPoints6 << QPointF(92, 307);
     mainPoints6 << QPointF(92, 329);
     mainPoints6 << QPointF(172, 307);
-    QList<QPointF> points6;
+    QVector<QPointF> points6;
     points6 << QPointF(102, 319);
     points6 << QPointF(109, 319);
     points6 << QPointF(114, 319);
@@ -1317,7 +1317,7 @@ TEST_F(ShapesWidgetTest, hoverOnLine)
     mainPoints << QPointF(96, 335);
     mainPoints << QPointF(265, 235);
     mainPoints << QPointF(265, 335);
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1328,7 +1328,7 @@ TEST_F(ShapesWidgetTest, hoverOnLine)
 
 TEST_F(ShapesWidgetTest, hoverOnArrow)
 {
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1405,7 +1405,7 @@ TEST_F(ShapesWidgetTest, undoDrawShapes)
     Toolshape toolShape3;
     toolShape3.type = QString("text");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1455,7 +1455,7 @@ TEST_F(ShapesWidgetTest, undoAllDrawShapes)
     Toolshape toolShape3;
     toolShape3.type = QString("text");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1474,7 +1474,13 @@ TEST_F(ShapesWidgetTest, undoAllDrawShapes)
     access_private_field::ShapesWidgetm_shapes(*shapesWidget) = toolShapes;
     access_private_field::ShapesWidgetm_selectedOrder(*shapesWidget) = 0;
     access_private_field::ShapesWidgetm_selectedIndex(*shapesWidget) = 0;
+    // 只有一个图形有撤销记录，其余图形没有记录时全部撤销后不能再恢复
+    shapesWidget->m_history.clear();
+    shapesWidget->m_history.push(ShapesHistory::addShape(2, toolShape3));
     shapesWidget->undoAllDrawShapes();
+    EXPECT_EQ(0, shapesWidget->m_shapes.length());
+    EXPECT_FALSE(shapesWidget->m_history.canUndo());
+    EXPECT_FALSE(shapesWidget->m_history.canRedo());
     /*
         access_private_field::ShapesWidgetm_selectedIndex(*shapesWidget) = -1;
         QMap<int, TextEdit *> editMap;
@@ -1503,7 +1509,7 @@ TEST_F(ShapesWidgetTest, deleteCurrentShape)
     Toolshape toolShape3;
     toolShape3.type = QString("rectangle");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1605,7 +1611,7 @@ TEST_F(ShapesWidgetTest, microAdjust)
     Toolshape toolShape3;
     toolShape3.type = QString("text");
     toolShape3.index = 2;
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1658,7 +1664,7 @@ TEST_F(ShapesWidgetTest, handleResize)
     toolShape2.type = QString("oval");
     Toolshape toolShape3;
     toolShape3.type = QString("arrow");
-    QList<QPointF> points;
+    QVector<QPointF> points;
     points << QPointF(96, 235);
     points << QPointF(96, 335);
     points << QPointF(265, 235);
@@ -1682,7 +1688,7 @@ TEST_F(ShapesWidgetTest, handleResize)
     mainPoints << QPointF(265, 235);
     mainPoints << QPointF(265, 335);
     access_private_field::ShapesWidgetm_selectedShape(*shapesWidget).mainPoints = mainPoints;
-    QList<QPointF> lineFPoints;
+    QVector<QPointF> lineFPoints;
     lineFPoints << QPointF(96, 235);
     lineFPoints << QPointF(96, 335);
     lineFPoints << QPointF(96, 600);
@@ -1756,3 +1762,80 @@ TEST_F(ShapesWidgetTest, clickedShapes)
 
 
 
+
+//绘制图形时已完成图形的缓存不重新生成，只重绘正在绘制的图形所在的范围
+TEST_F(ShapesWidgetTest, shapesLayerCache)
+{
+    shapesWidget->resize(400, 400);
+    Toolshape toolShape;
+    toolShape.type = QString("rectangle");
+    toolShape.mainPoints.clear();
+    toolShape.mainPoints << QPointF(20, 20) << QPointF(20, 80) << QPointF(80, 20) << QPointF(80, 80);
+    shapesWidget->m_shapes << toolShape;
+    QPaintEvent *e = new QPaintEvent(shapesWidget->rect());
+    call_private_fun::ShapesWidgetpaintEvent(*shapesWidget, e);
+    EXPECT_FALSE(shapesWidget->m_shapesLayerDirty);
+    EXPECT_EQ(shapesWidget->size() * shapesWidget->devicePixelRatioF(), shapesWidget->m_shapesLayer.size());
+
+    shapesWidget->m_isRecording = true;
+    shapesWidget->m_isPressed = true;
+    shapesWidget->m_currentType = QString("rectangle");
+    shapesWidget->m_currentShape.type = QString("rectangle");
+    shapesWidget->m_currentShape.lineWidth = 3;
+    shapesWidget->m_pos1 = QPointF(200, 200);
+    QMouseEvent *ev = new QMouseEvent(QEvent::MouseMove, QPoint(250, 260), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    call_private_fun::ShapesWidgetmouseMoveEvent(*shapesWidget, ev);
+    EXPECT_FALSE(shapesWidget->m_shapesLayerDirty);
+    EXPECT_TRUE(shapesWidget->m_currentShapeRect.contains(QPoint(200, 200)));
+    EXPECT_TRUE(shapesWidget->m_currentShapeRect.contains(QPoint(250, 260)));
+    EXPECT_FALSE(shapesWidget->m_currentShapeRect.contains(QPoint(50, 50)));
+
+    shapesWidget->m_isRecording = false;
+    shapesWidget->m_isPressed = false;
+    shapesWidget->undoDrawShapes();
+    EXPECT_TRUE(shapesWidget->m_shapesLayerDirty);
+
+    delete ev;
+    delete e;
+}
+
+//移动图形时该图形在缓存之上单独绘制，缓存不重新生成，只重绘图形新旧位置所在的范围；结束后重新绘制到缓存中
+TEST_F(ShapesWidgetTest, shapesLayerTransformOverlay)
+{
+    shapesWidget->resize(400, 400);
+    Toolshape toolShape;
+    toolShape.type = QString("rectangle");
+    toolShape.index = 0;
+    toolShape.mainPoints.clear();
+    toolShape.mainPoints << QPointF(20, 20) << QPointF(20, 80) << QPointF(80, 20) << QPointF(80, 80);
+    shapesWidget->m_shapes << toolShape;
+    shapesWidget->m_selectedOrder = 0;
+    shapesWidget->m_selectedIndex = 0;
+    shapesWidget->beginShapeTransform();
+    EXPECT_EQ(0, shapesWidget->m_overlayIndex);
+    QPaintEvent *e = new QPaintEvent(shapesWidget->rect());
+    call_private_fun::ShapesWidgetpaintEvent(*shapesWidget, e);
+    EXPECT_FALSE(shapesWidget->m_shapesLayerDirty);
+
+    shapesWidget->m_isRecording = false;
+    shapesWidget->m_isPressed = true;
+    shapesWidget->m_isSelected = true;
+    shapesWidget->m_isRotated = false;
+    shapesWidget->m_isResize = false;
+    shapesWidget->m_pressedPoint = QPointF(50, 50);
+    QMouseEvent *ev = new QMouseEvent(QEvent::MouseMove, QPoint(250, 250), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    call_private_fun::ShapesWidgetmouseMoveEvent(*shapesWidget, ev);
+    EXPECT_EQ(QPointF(220, 220), shapesWidget->m_shapes[0].mainPoints[0]);
+    EXPECT_FALSE(shapesWidget->m_shapesLayerDirty);
+    EXPECT_TRUE(shapesWidget->m_overlayRect.contains(QPoint(250, 250)));
+    EXPECT_FALSE(shapesWidget->m_overlayRect.contains(QPoint(50, 50)));
+
+    shapesWidget->m_isPressed = false;
+    shapesWidget->commitShapeTransform();
+    EXPECT_EQ(-1, shapesWidget->m_overlayIndex);
+    EXPECT_TRUE(shapesWidget->m_shapesLayerDirty);
+    EXPECT_TRUE(shapesWidget->m_history.canUndo());
+
+    delete ev;
+    delete e;
+}